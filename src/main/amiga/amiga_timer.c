@@ -50,6 +50,15 @@ ULONG getMilliseconds(){
 }
  
 
+ULONG getMicroseconds(){
+	struct timeval endTime;
+
+	GetSysTime(&endTime);
+	SubTime(&endTime,&startTime);
+
+	return (endTime.tv_secs * 1000000 + endTime.tv_micro);
+}
+
 //
 // Same as I_GetTime, but returns time in milliseconds
 //
@@ -0,0 +1,357 @@
+/***************************************************************************
+    Memory Arena.
+
+    Region based allocator. Each region is sized up front and allocated
+    from as a stack. Freed blocks are reclaimed once they reach the top of
+    their region, so transient allocations (e.g. ROM loading buffers) return
+    their memory without fragmenting the heap.
+
+    Memory is reclaimed in LIFO order. A block freed out of order (e.g. an
+    XML node) stays in its region as a hole until everything above it is
+    freed. Holes are reused by later allocations that fit, but are not
+    split or merged, so a long lived buffer that is freed and allocated
+    again at a larger size strands its old block. Reuse such buffers.
+
+    Allocations that do not fit in their region fall back to the heap and
+    are recorded as overflows in the usage report.
+
+    Define ARENA_FIXED_BLOCK in globals.h to carve all regions from a single
+    static block.
+
+    Optional regions (e.g. rewind) are not part of that block. They have no
+    memory until Arena_reserve is called, which allocates them from the heap.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "arena.h"
+
+// Every block is preceded by a header. Keeps the returned data 16 byte aligned.
+typedef struct
+{
+    uint32_t size;      // Requested size in bytes
+    uint32_t prev;      // Offset of the previous block header in the region
+    uint8_t  region;    // Owning region, or ARENA_HEAP
+    uint8_t  freed;     // Block has been freed, but is not yet on top of the stack
+    uint16_t magic;
+    uint32_t pad;
+} arena_block_t;
+
+typedef struct
+{
+    const char* name;
+    uint8_t* base;
+    uint32_t size;      // Budget
+    uint32_t used;      // Current top of stack
+    uint32_t top;       // Offset of the topmost block header
+    uint32_t peak;      // Peak usage
+    uint32_t overflow;  // Bytes currently allocated from the heap
+    uint32_t overflow_peak;
+    uint32_t holes;     // Freed blocks below the top of stack, which can be reused
+    Boolean  reserved;  // Optional region allocated by Arena_reserve
+} arena_region_t;
+
+#define ARENA_HEAP  0xFF
+#define ARENA_NONE  0xFFFFFFFF
+#define ARENA_MAGIC 0xA4E1
+#define ARENA_ALIGN(x) (((x) + 15) & ~15)
+
+#define ARENA_TOTAL_SIZE (ARENA_ROM_SIZE + ARENA_VIDEO_SIZE + ARENA_AUDIO_SIZE + ARENA_CONFIG_SIZE + ARENA_LOAD_SIZE + ARENA_ROAD_SIZE)
+
+#ifdef ARENA_FIXED_BLOCK
+static uint32_t Arena_block[ARENA_TOTAL_SIZE / sizeof(uint32_t)];
+#endif
+
+static arena_region_t Arena_regions[ARENA_REGIONS] =
+{
+    { "ROM",    NULL, ARENA_ROM_SIZE,    0, ARENA_NONE, 0, 0, 0, 0, FALSE },
+    { "Video",  NULL, ARENA_VIDEO_SIZE,  0, ARENA_NONE, 0, 0, 0, 0, FALSE },
+    { "Audio",  NULL, ARENA_AUDIO_SIZE,  0, ARENA_NONE, 0, 0, 0, 0, FALSE },
+    { "Config", NULL, ARENA_CONFIG_SIZE, 0, ARENA_NONE, 0, 0, 0, 0, FALSE },
+    { "Load",   NULL, ARENA_LOAD_SIZE,   0, ARENA_NONE, 0, 0, 0, 0, FALSE },
+    { "Rewind", NULL, 0,                 0, ARENA_NONE, 0, 0, 0, 0, FALSE },
+    { "Road",   NULL, ARENA_ROAD_SIZE,   0, ARENA_NONE, 0, 0, 0, 0, FALSE },
+};
+
+static Boolean Arena_initialized = FALSE;
+
+void* Arena_heap_alloc(uint8_t region, uint32_t size);
+void Arena_pop_freed(arena_region_t* r);
+arena_block_t* Arena_find_hole(arena_region_t* r, uint32_t size);
+
+void Arena_init()
+{
+    int i;
+
+    if (Arena_initialized)
+        return;
+
+#ifdef ARENA_FIXED_BLOCK
+    uint8_t* base = (uint8_t*) Arena_block;
+#else
+    uint8_t* base = (uint8_t*) malloc(ARENA_TOTAL_SIZE);
+
+    if (base == NULL)
+    {
+        fprintf(stderr, "Arena: Unable to allocate %u bytes. Using heap.\n", ARENA_TOTAL_SIZE);
+        return;
+    }
+#endif
+
+    for (i = 0; i < ARENA_REGIONS; i++)
+    {
+        arena_region_t* r = &Arena_regions[i];
+        r->base = base;
+        r->used  = 0;
+        r->top   = ARENA_NONE;
+        r->holes = 0;
+        base    += r->size;
+    }
+
+    Arena_initialized = TRUE;
+}
+
+void Arena_destroy()
+{
+    int i;
+
+    if (!Arena_initialized)
+        return;
+
+#ifndef ARENA_FIXED_BLOCK
+    free(Arena_regions[0].base);
+#endif
+
+    for (i = 0; i < ARENA_REGIONS; i++)
+    {
+        if (Arena_regions[i].reserved)
+        {
+            free(Arena_regions[i].base);
+            Arena_regions[i].size     = 0;
+            Arena_regions[i].reserved = FALSE;
+        }
+        Arena_regions[i].base = NULL;
+        Arena_regions[i].used  = 0;
+        Arena_regions[i].top   = ARENA_NONE;
+        Arena_regions[i].holes = 0;
+    }
+
+    Arena_initialized = FALSE;
+}
+
+// Allocate an optional region, which has no memory until it is needed.
+// Returns FALSE when the memory is not available.
+Boolean Arena_reserve(uint8_t region, uint32_t size)
+{
+    arena_region_t* r = &Arena_regions[region];
+
+    // Without the arena, allocations fall back to the heap anyway
+    if (!Arena_initialized || r->reserved)
+        return TRUE;
+
+    uint8_t* base = (uint8_t*) malloc(size);
+
+    if (base == NULL)
+    {
+        fprintf(stderr, "Arena: Unable to reserve %u bytes for region %s.\n", size, r->name);
+        return FALSE;
+    }
+
+    r->base     = base;
+    r->size     = size;
+    r->reserved = TRUE;
+    return TRUE;
+}
+
+void* Arena_heap_alloc(uint8_t region, uint32_t size)
+{
+    arena_block_t* block = (arena_block_t*) malloc(sizeof(arena_block_t) + size);
+
+    if (block == NULL)
+    {
+        fprintf(stderr, "Arena: Out of memory allocating %u bytes.\n", size);
+        return NULL;
+    }
+
+    block->size   = size;
+    block->prev   = region;  // Remember the region for overflow accounting
+    block->region = ARENA_HEAP;
+    block->freed  = FALSE;
+    block->magic  = ARENA_MAGIC;
+
+    arena_region_t* r = &Arena_regions[region];
+    r->overflow += size;
+    if (r->overflow > r->overflow_peak)
+        r->overflow_peak = r->overflow;
+
+    return block + 1;
+}
+
+void* Arena_alloc(uint8_t region, uint32_t size)
+{
+    arena_region_t* r = &Arena_regions[region];
+    uint32_t needed   = sizeof(arena_block_t) + ARENA_ALIGN(size);
+
+    if (!Arena_initialized)
+        return Arena_heap_alloc(region, size);
+
+    // Reuse a block that was freed out of order
+    arena_block_t* block = r->holes ? Arena_find_hole(r, size) : NULL;
+    if (block)
+    {
+        block->size  = size;
+        block->freed = FALSE;
+        r->holes--;
+        return block + 1;
+    }
+
+    if (r->used + needed > r->size)
+        return Arena_heap_alloc(region, size);
+
+    block = (arena_block_t*) (r->base + r->used);
+    block->size   = size;
+    block->prev   = r->top;
+    block->region = region;
+    block->freed  = FALSE;
+    block->magic  = ARENA_MAGIC;
+
+    r->top   = r->used;
+    r->used += needed;
+    if (r->used > r->peak)
+        r->peak = r->used;
+
+    return block + 1;
+}
+
+void* Arena_calloc(uint8_t region, uint32_t count, uint32_t size)
+{
+    void* data = Arena_alloc(region, count * size);
+    if (data)
+        memset(data, 0, count * size);
+    return data;
+}
+
+void* Arena_realloc(uint8_t region, void* ptr, uint32_t size)
+{
+    if (ptr == NULL)
+        return Arena_alloc(region, size);
+
+    arena_block_t* block = ((arena_block_t*) ptr) - 1;
+
+    // Grow or shrink in place when the block is on top of its region
+    if (block->region != ARENA_HEAP)
+    {
+        arena_region_t* r = &Arena_regions[block->region];
+        uint32_t offset   = (uint32_t) ((uint8_t*) block - r->base);
+
+        if (offset == r->top && offset + sizeof(arena_block_t) + ARENA_ALIGN(size) <= r->size)
+        {
+            block->size = size;
+            r->used     = offset + sizeof(arena_block_t) + ARENA_ALIGN(size);
+            if (r->used > r->peak)
+                r->peak = r->used;
+            return ptr;
+        }
+    }
+
+    void* data = Arena_alloc(region, size);
+    if (data == NULL)
+        return NULL;
+
+    memcpy(data, ptr, block->size < size ? block->size : size);
+    Arena_free(ptr);
+    return data;
+}
+
+char* Arena_strdup(uint8_t region, const char* s)
+{
+    uint32_t length = strlen(s) + 1;
+    char* data = (char*) Arena_alloc(region, length);
+    if (data)
+        memcpy(data, s, length);
+    return data;
+}
+
+// Reclaim freed blocks from the top of the region
+void Arena_pop_freed(arena_region_t* r)
+{
+    while (r->top != ARENA_NONE)
+    {
+        arena_block_t* block = (arena_block_t*) (r->base + r->top);
+        if (!block->freed)
+            break;
+        r->used = r->top;
+        r->top  = block->prev;
+        r->holes--;
+    }
+}
+
+// First fit search for a freed block below the top of the region with room for size bytes.
+// A block's room runs up to the header of the block above it. Blocks are not split.
+arena_block_t* Arena_find_hole(arena_region_t* r, uint32_t size)
+{
+    uint32_t above  = r->used;
+    uint32_t offset = r->top;
+
+    while (offset != ARENA_NONE)
+    {
+        arena_block_t* block = (arena_block_t*) (r->base + offset);
+        if (block->freed && above - offset - sizeof(arena_block_t) >= ARENA_ALIGN(size))
+            return block;
+        above  = offset;
+        offset = block->prev;
+    }
+
+    return NULL;
+}
+
+void Arena_free(void* ptr)
+{
+    if (ptr == NULL)
+        return;
+
+    arena_block_t* block = ((arena_block_t*) ptr) - 1;
+
+    if (block->magic != ARENA_MAGIC)
+    {
+        fprintf(stderr, "Arena: Invalid free at %p.\n", ptr);
+        return;
+    }
+
+    if (block->region == ARENA_HEAP)
+    {
+        Arena_regions[block->prev].overflow -= block->size;
+        block->magic = 0;
+        free(block);
+        return;
+    }
+
+    block->freed = TRUE;
+    Arena_regions[block->region].holes++;
+    Arena_pop_freed(&Arena_regions[block->region]);
+}
+
+// Print per region usage. Called at exit.
+void Arena_report()
+{
+    int i;
+    uint32_t total_peak = 0, total_size = 0;
+
+    fprintf(stderr, "Memory Report (bytes):\n");
+    fprintf(stderr, "%-8s %10s %10s %10s %10s\n", "Region", "Budget", "Peak", "Current", "Overflow");
+
+    for (i = 0; i < ARENA_REGIONS; i++)
+    {
+        arena_region_t* r = &Arena_regions[i];
+        fprintf(stderr, "%-8s %10u %10u %10u %10u\n", r->name, r->size, r->peak, r->used, r->overflow_peak);
+        total_peak += r->peak + r->overflow_peak;
+        total_size += r->size;
+    }
+
+    fprintf(stderr, "Total peak: %u of %u\n", total_peak, total_size);
+}
@@ -0,0 +1,64 @@
+/***************************************************************************
+    Memory Arena.
+
+    Region based allocator. Each region is sized up front and allocated
+    from as a stack. Freed blocks are reclaimed once they reach the top of
+    their region, so transient allocations (e.g. ROM loading buffers) return
+    their memory without fragmenting the heap.
+
+    Memory is reclaimed in LIFO order. A block freed out of order (e.g. an
+    XML node) stays in its region as a hole until everything above it is
+    freed. Holes are reused by later allocations that fit, but are not
+    split or merged, so a long lived buffer that is freed and allocated
+    again at a larger size strands its old block. Reuse such buffers.
+
+    Allocations that do not fit in their region fall back to the heap and
+    are recorded as overflows in the usage report.
+
+    Define ARENA_FIXED_BLOCK in globals.h to carve all regions from a single
+    static block.
+
+    Optional regions (e.g. rewind) are not part of that block. They have no
+    memory until Arena_reserve is called, which allocates them from the heap.
+
+    The arena is not thread safe. Only call it from the main thread; code
+    that can run on audio or batch worker threads must not allocate from it.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.h"
+
+enum
+{
+    ARENA_ROM,      // ROM images, LayOut data and data derived from ROMs
+    ARENA_VIDEO,    // Video buffers
+    ARENA_AUDIO,    // Audio buffers and custom music
+    ARENA_CONFIG,   // XML configuration and hi-score documents
+    ARENA_LOAD,     // Transient loading buffers
+    ARENA_REWIND,   // Rewind buffer. Only used when rewind is enabled.
+    ARENA_ROAD,     // Road geometry cache
+    ARENA_REGIONS
+};
+
+// Region budgets in bytes. Tune these for the target platform.
+#define ARENA_ROM_SIZE    0x280000
+#define ARENA_VIDEO_SIZE  0x0C0000
+#define ARENA_AUDIO_SIZE  0x040000
+#define ARENA_CONFIG_SIZE 0x010000
+#define ARENA_LOAD_SIZE   0x180000
+#define ARENA_REWIND_SIZE 0x200000 // Reserved only when rewind is enabled
+#define ARENA_ROAD_SIZE   0x050000
+
+void Arena_init();
+void Arena_destroy();
+Boolean Arena_reserve(uint8_t region, uint32_t size);
+void* Arena_alloc(uint8_t region, uint32_t size);
+void* Arena_calloc(uint8_t region, uint32_t count, uint32_t size);
+void* Arena_realloc(uint8_t region, void* ptr, uint32_t size);
+char* Arena_strdup(uint8_t region, const char* s);
+void Arena_free(void* ptr);
+void Arena_report();
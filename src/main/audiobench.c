@@ -0,0 +1,558 @@
+/***************************************************************************
+    Offline Audio Renderer & Benchmark.
+
+    Runs the sound program and sound chips without a display or audio
+    device, as fast as possible, from a script of sound commands.
+
+    The mixed chip output is written to a WAV file, which can be compared
+    against a known good render, and the time spent in each chip is
+    reported as a throughput in samples per second.
+
+    Script files contain one event per line. '#' starts a comment.
+        <frame> <command>               Queue a sound command (see engine/audio/commands.h)
+        <frame> engine <index> <value>  Set OSoundInt_engine_data[index]
+    Numbers may be decimal or hex (0x..). Events must be in frame order.
+
+    Before rendering, the mixer is checked against its scalar reference,
+    and the resampler and wav stream used by the audio output are checked
+    with a test tone.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "arena.h"
+#include "audiobench.h"
+#include "frontend/config.h"
+#include "engine/audio/OSoundInt.h"
+#include "hwaudio/mixer.h"
+#include "hwaudio/resampler.h"
+#include "sdl/wavstream.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Initial size of the event list, which doubles as needed
+#define AUDIOBENCH_EVENTS 256
+
+typedef struct
+{
+    uint32_t frame;
+    int16_t  engine;    // Engine data index, or -1 for a sound command
+    uint8_t  value;
+} audiobench_event_t;
+
+// Test tone for the resampler and wav stream checks
+#define AUDIOBENCH_TONE       1000.0
+#define AUDIOBENCH_TONE_LEVEL 12000.0
+
+// Longest mix for the mixer check
+#define AUDIOBENCH_MIX_SAMPLES 256
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t skip;          // Frames to ignore while a filter fills
+    uint32_t crossings;
+    uint32_t channel_errors;
+    int16_t  last;
+    double   energy;
+} audiobench_tone_t;
+
+static audiobench_event_t* AudioBench_events;
+static uint32_t AudioBench_event_count;
+static uint32_t AudioBench_event_capacity;
+
+// A frame of mixed output, and the same as little endian bytes
+static int16_t AudioBench_mix[(SEGAPCM_MAX_FREQUENCY / 30) * 2];
+static uint8_t AudioBench_out[(SEGAPCM_MAX_FREQUENCY / 30) * 2 * 2];
+
+Boolean AudioBench_add_event(uint32_t frame, int16_t engine, uint8_t value);
+Boolean AudioBench_default_script(uint32_t frames);
+Boolean AudioBench_load_script(const char* filename);
+void AudioBench_free_events();
+void AudioBench_write_header(FILE* f, uint32_t rate, uint32_t data_bytes);
+void AudioBench_write16(FILE* f, uint16_t v);
+void AudioBench_write32(FILE* f, uint32_t v);
+void AudioBench_report(const char* name, clock_t ticks, uint32_t samples, uint32_t rate);
+Boolean AudioBench_check_resampler(uint32_t in_rate, uint32_t out_rate);
+Boolean AudioBench_check_wavstream(const char* filename, uint32_t file_rate, uint32_t out_rate);
+Boolean AudioBench_check_mixer();
+void AudioBench_tone_add(audiobench_tone_t* t, const int16_t* samples, uint32_t frames);
+Boolean AudioBench_tone_check(audiobench_tone_t* t, const char* name, uint32_t rate, double amplitude);
+int16_t AudioBench_tone_sample(uint32_t i, uint32_t rate, double amplitude);
+
+Boolean AudioBench_add_event(uint32_t frame, int16_t engine, uint8_t value)
+{
+    if (AudioBench_event_count >= AudioBench_event_capacity)
+    {
+        uint32_t capacity = AudioBench_event_capacity ? AudioBench_event_capacity * 2 : AUDIOBENCH_EVENTS;
+        audiobench_event_t* events = (audiobench_event_t*) Arena_realloc(ARENA_LOAD, AudioBench_events, capacity * sizeof(audiobench_event_t));
+
+        if (events == NULL)
+        {
+            fprintf(stderr, "AudioBench: Unable to allocate memory for %u events.\n", capacity);
+            return FALSE;
+        }
+
+        AudioBench_events         = events;
+        AudioBench_event_capacity = capacity;
+    }
+
+    AudioBench_events[AudioBench_event_count].frame  = frame;
+    AudioBench_events[AudioBench_event_count].engine = engine;
+    AudioBench_events[AudioBench_event_count].value  = value;
+    AudioBench_event_count++;
+    return TRUE;
+}
+
+void AudioBench_free_events()
+{
+    Arena_free(AudioBench_events);
+    AudioBench_events         = NULL;
+    AudioBench_event_count    = 0;
+    AudioBench_event_capacity = 0;
+}
+
+// Music with the engine revving, and a cycle of sound effects over the top.
+// Events fall on a quarter second grid.
+Boolean AudioBench_default_script(uint32_t frames)
+{
+    static const uint8_t EFFECTS[] =
+    {
+        sound_YM_CHECKPOINT, sound_VOICE_CHECKPOINT, sound_CRASH1, sound_REBOUND,
+        sound_INIT_SLIP, sound_STOP_SLIP, sound_BEEP1, sound_SIGNAL1, sound_SIGNAL2,
+        sound_INIT_CHEERS2, sound_STOP_CHEERS, sound_CRASH2, sound_VOICE_CONGRATS,
+        sound_INIT_SAFETYZONE, sound_STOP_SAFETYZONE, sound_BEEP2, sound_PCM_WAVE,
+    };
+    const uint32_t EFFECT_COUNT = sizeof(EFFECTS) / sizeof(EFFECTS[0]);
+    const uint32_t second = Config_fps;
+    const uint32_t middle = ((frames / 2) * 4) / second; // Quarter second at or before the middle
+    uint32_t quarter, frame, fx = 0;
+    Boolean ok = TRUE;
+
+    AudioBench_event_count = 0;
+
+    ok &= AudioBench_add_event(0, -1, SOUND_MUSIC_MAGICAL);
+    ok &= AudioBench_add_event(0, sound_ENGINE_VOL, 0x3F);
+
+    for (quarter = 0; ok && (frame = (quarter * second) / 4) < frames; quarter++)
+    {
+        // Rev up and down over four seconds
+        uint32_t cycle = frame % (second * 4);
+        uint16_t pitch = (uint16_t) ((cycle < second * 2 ? cycle : (second * 4) - cycle) * 0x180 / second);
+
+        ok &= AudioBench_add_event(frame, sound_ENGINE_PITCH_H, pitch >> 8);
+        ok &= AudioBench_add_event(frame, sound_ENGINE_PITCH_L, pitch & 0xFF);
+
+        if (quarter > 0 && (quarter & 3) == 0)
+            ok &= AudioBench_add_event(frame, -1, EFFECTS[fx++ % EFFECT_COUNT]);
+
+        if (quarter == middle)
+            ok &= AudioBench_add_event(frame, -1, SOUND_MUSIC_BREEZE2);
+    }
+
+    return ok;
+}
+
+Boolean AudioBench_load_script(const char* filename)
+{
+    char line[128];
+    char token[32];
+    uint32_t frame;
+    int index, value;
+    Boolean ok = TRUE;
+    FILE* f = fopen(filename, "r");
+
+    if (f == NULL)
+    {
+        fprintf(stderr, "AudioBench: Could not open script: %s\n", filename);
+        return FALSE;
+    }
+
+    AudioBench_event_count = 0;
+
+    while (ok && fgets(line, sizeof(line), f))
+    {
+        char* comment = strchr(line, '#');
+        if (comment)
+            *comment = 0;
+
+        if (sscanf(line, "%u %31s", &frame, token) != 2)
+            continue;
+
+        if (strcmp(token, "engine") == 0)
+        {
+            if (sscanf(line, "%*u %*s %i %i", &index, &value) != 2 || index < 0 || index >= 8)
+                fprintf(stderr, "AudioBench: Bad engine event: %s", line);
+            else
+                ok = AudioBench_add_event(frame, (int16_t) index, (uint8_t) value);
+        }
+        else
+        {
+            ok = AudioBench_add_event(frame, -1, (uint8_t) strtol(token, NULL, 0));
+        }
+    }
+
+    fclose(f);
+    return ok;
+}
+
+Boolean AudioBench_run(const char* wav_filename, uint32_t seconds, const char* script_filename)
+{
+    uint32_t frame, i, next_event = 0;
+    clock_t ticks_program = 0, ticks_pcm = 0, ticks_ym = 0, ticks_mix = 0;
+    const uint32_t frames = seconds * Config_fps;
+    FILE* f;
+
+    if (!AudioBench_check_mixer() ||
+        !AudioBench_check_resampler(Config_sound.chip_rate, Config_sound.rate) ||
+        !AudioBench_check_resampler(22050, 48000) ||
+        !AudioBench_check_resampler(48000, 44100) ||
+        !AudioBench_check_wavstream(wav_filename, 32000, Config_sound.rate))
+        return FALSE;
+
+    Boolean loaded = script_filename ? AudioBench_load_script(script_filename) : AudioBench_default_script(frames);
+    if (!loaded)
+    {
+        AudioBench_free_events();
+        return FALSE;
+    }
+
+    f = fopen(wav_filename, "wb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "AudioBench: Could not create: %s\n", wav_filename);
+        AudioBench_free_events();
+        return FALSE;
+    }
+
+    OSoundInt_has_booted = TRUE;
+    OSoundInt_init();
+
+    const uint32_t rate    = Config_sound.chip_rate;
+    const uint32_t samples = SegaPCM_buffer_size;
+
+    // Header is rewritten with the final length once rendering is complete
+    AudioBench_write_header(f, rate, 0);
+
+    for (frame = 0; frame < frames; frame++)
+    {
+        clock_t start = clock();
+
+        for (; next_event < AudioBench_event_count && AudioBench_events[next_event].frame <= frame; next_event++)
+        {
+            audiobench_event_t* e = &AudioBench_events[next_event];
+            if (e->engine < 0)
+                OSoundInt_queue_sound_service(e->value);
+            else
+                OSoundInt_engine_data[e->engine] = e->value;
+        }
+
+        OSoundInt_tick();
+        clock_t end = clock();
+        ticks_program += end - start;
+
+        start = end;
+        SegaPCM_stream_update();
+        end = clock();
+        ticks_pcm += end - start;
+
+        start = end;
+        YM_stream_update();
+        end = clock();
+        ticks_ym += end - start;
+
+        // Mix, as the audio output does, and write as little endian
+        start = end;
+        int16_t* pcm_buffer = SegaPCM_get_buffer();
+        int16_t* ym_buffer  = YM_get_buffer();
+
+        Mixer_mix2(AudioBench_mix, pcm_buffer, Mixer_gain(SegaPCM_get_volume()),
+                                   ym_buffer,  Mixer_gain(YM_get_volume()), samples);
+
+        for (i = 0; i < samples; i++)
+        {
+            AudioBench_out[i * 2]     = AudioBench_mix[i] & 0xFF;
+            AudioBench_out[i * 2 + 1] = (AudioBench_mix[i] >> 8) & 0xFF;
+        }
+        fwrite(AudioBench_out, 2, samples, f);
+        ticks_mix += clock() - start;
+    }
+
+    const uint32_t total = frames * samples;
+    fseek(f, 0, SEEK_SET);
+    AudioBench_write_header(f, rate, total * sizeof(int16_t));
+    fclose(f);
+    AudioBench_free_events();
+
+    fprintf(stderr, "AudioBench: %u frames, %u stereo samples at %uHz written to %s\n", frames, total / 2, rate, wav_filename);
+    AudioBench_report("Program", ticks_program, total / 2, rate);
+    AudioBench_report("SegaPCM", ticks_pcm,     total / 2, rate);
+    AudioBench_report("YM2151",  ticks_ym,      total / 2, rate);
+    AudioBench_report("Mix/WAV", ticks_mix,     total / 2, rate);
+    AudioBench_report("Total",   ticks_program + ticks_pcm + ticks_ym + ticks_mix, total / 2, rate);
+    YM_report();
+
+    return TRUE;
+}
+
+// Measure a test tone, skipping the first frames while a filter fills.
+// The right channel is the left inverted, so the channels must stay apart, allowing for rounding.
+void AudioBench_tone_add(audiobench_tone_t* t, const int16_t* samples, uint32_t frames)
+{
+    uint32_t i;
+
+    for (i = 0; i < frames; i++, t->frames++)
+    {
+        int16_t s = samples[i * 2];
+
+        if (t->frames < t->skip)
+            continue;
+
+        if (s + samples[i * 2 + 1] < -2 || s + samples[i * 2 + 1] > 2)
+            t->channel_errors++;
+        if (t->last < 0 && s >= 0)
+            t->crossings++;
+        t->energy += (double) s * s;
+        t->last = s;
+    }
+}
+
+// The tone must come through at the expected level and pitch, to within 1%
+Boolean AudioBench_tone_check(audiobench_tone_t* t, const char* name, uint32_t rate, double amplitude)
+{
+    const uint32_t measured = t->frames - t->skip;
+    const double rms        = sqrt(t->energy / measured);
+    const double pitch      = t->crossings * (double) rate / measured;
+    const double level      = rms / (amplitude / sqrt(2.0));
+
+    Boolean ok = fabs(level - 1.0) < 0.01 && fabs(pitch - AUDIOBENCH_TONE) < AUDIOBENCH_TONE * 0.01 && t->channel_errors == 0;
+
+    fprintf(stderr, "%s: level %.1f%%, pitch %.1fHz, channel errors %u: %s\n",
+            name, 100.0 * level, pitch, t->channel_errors, ok ? "OK" : "FAILED");
+
+    return ok;
+}
+
+int16_t AudioBench_tone_sample(uint32_t i, uint32_t rate, double amplitude)
+{
+    return (int16_t) floor(amplitude * sin(2.0 * M_PI * AUDIOBENCH_TONE * i / rate) + 0.5);
+}
+
+// Resample one second of the tone, a frame at a time as the audio output does. The rate must be exact.
+Boolean AudioBench_check_resampler(uint32_t in_rate, uint32_t out_rate)
+{
+    const uint32_t block = in_rate / Config_fps;
+    audiobench_tone_t tone;
+    resampler_t r;
+    uint32_t i, in_pos = 0;
+    char name[80];
+
+    Resampler_init(&r, in_rate, out_rate, block);
+
+    int16_t* in  = (int16_t*) Arena_alloc(ARENA_LOAD, block * 2 * sizeof(int16_t));
+    int16_t* out = (int16_t*) Arena_alloc(ARENA_LOAD, Resampler_max_output(&r, block) * 2 * sizeof(int16_t));
+
+    if (in == NULL || out == NULL)
+    {
+        fprintf(stderr, "AudioBench: Unable to allocate memory for the resampler check.\n");
+        Arena_free(out);
+        Arena_free(in);
+        Resampler_destroy(&r);
+        return FALSE;
+    }
+
+    memset(&tone, 0, sizeof(tone));
+    tone.skip = ((RESAMPLER_TAPS * out_rate) / in_rate) + 1; // Output frames the filter delays by
+
+    while (in_pos + block <= in_rate)
+    {
+        for (i = 0; i < block; i++)
+        {
+            in[i * 2]     = AudioBench_tone_sample(in_pos + i, in_rate, AUDIOBENCH_TONE_LEVEL);
+            in[i * 2 + 1] = -in[i * 2];
+        }
+        in_pos += block;
+
+        AudioBench_tone_add(&tone, out, Resampler_process(&r, in, block, out));
+    }
+
+    Arena_free(out);
+    Arena_free(in);
+    Resampler_destroy(&r);
+
+    // Output frames expected for the input consumed, less the filter delay
+    const uint32_t expected = (uint32_t) (((uint64_t) in_pos * out_rate) / in_rate);
+
+    sprintf(name, "Resampler %uHz to %uHz, %u frames (expected %u)", in_rate, out_rate, tone.frames, expected);
+    Boolean ok = AudioBench_tone_check(&tone, name, out_rate, AUDIOBENCH_TONE_LEVEL);
+
+    if (tone.frames + tone.skip < expected || tone.frames > expected + 1)
+    {
+        fprintf(stderr, "Resampler %uHz to %uHz: wrong number of frames\n", in_rate, out_rate);
+        ok = FALSE;
+    }
+
+    return ok;
+}
+
+// Stream a second of the tone from a wav file for a second and a half, so it loops.
+// The file is written to filename, which the render overwrites afterwards.
+Boolean AudioBench_check_wavstream(const char* filename, uint32_t file_rate, uint32_t out_rate)
+{
+    const uint32_t block = (out_rate / Config_fps) * 2;
+    audiobench_tone_t tone;
+    wavstream_t ws;
+    uint32_t i, read;
+    char name[80];
+    FILE* f = fopen(filename, "wb");
+
+    if (f == NULL)
+    {
+        fprintf(stderr, "AudioBench: Could not create: %s\n", filename);
+        return FALSE;
+    }
+
+    AudioBench_write_header(f, file_rate, file_rate * 2 * 2);
+    for (i = 0; i < file_rate; i++)
+    {
+        int16_t s = AudioBench_tone_sample(i, file_rate, AUDIOBENCH_TONE_LEVEL);
+        AudioBench_write16(f, (uint16_t) s);
+        AudioBench_write16(f, (uint16_t) -s);
+    }
+    fclose(f);
+
+    WavStream_init(&ws, out_rate);
+    int16_t* out = (int16_t*) Arena_alloc(ARENA_LOAD, block * sizeof(int16_t));
+
+    Boolean ok = out != NULL && WavStream_open(&ws, filename);
+
+    // Playback starts on the frame after the file is opened
+    memset(&tone, 0, sizeof(tone));
+    tone.skip = block / 2;
+
+    // Read as the audio thread does, after the game thread tops the ring up each frame
+    for (read = 0; ok && read < (out_rate * 3) / 2; read += block / 2)
+    {
+        WavStream_fill(&ws);
+        WavStream_read(&ws, out, block);
+        AudioBench_tone_add(&tone, out, block / 2);
+    }
+
+    Arena_free(out);
+    WavStream_destroy(&ws);
+
+    if (!ok)
+    {
+        fprintf(stderr, "AudioBench: Could not stream: %s\n", filename);
+        return FALSE;
+    }
+
+    // Samples are halved as they are read
+    sprintf(name, "WavStream %uHz to %uHz", file_rate, out_rate);
+    return AudioBench_tone_check(&tone, name, out_rate, AUDIOBENCH_TONE_LEVEL / 2);
+}
+
+// Mixer_mix2 must match Mixer_mix2_scalar exactly, for every gain, at the limits of the
+// sample range, for lengths that leave a tail after the vector loop, and when mixing in place.
+Boolean AudioBench_check_mixer()
+{
+    static const int32_t GAINS[] = { 0, 1, 0x7F, 0x80, 0xC0, 0xFF, MIXER_UNITY };
+    static const int16_t EDGES[] = { 0, 1, -1, 255, -256, 32767, -32768, 16384, -16385 };
+    const uint32_t GAIN_COUNT = sizeof(GAINS) / sizeof(GAINS[0]);
+    const uint32_t EDGE_COUNT = sizeof(EDGES) / sizeof(EDGES[0]);
+    static int16_t a[AUDIOBENCH_MIX_SAMPLES], b[AUDIOBENCH_MIX_SAMPLES];
+    static int16_t out[AUDIOBENCH_MIX_SAMPLES], ref[AUDIOBENCH_MIX_SAMPLES];
+    uint32_t seed = 0x12345678;
+    uint32_t ga, gb, len, i, round, mismatches = 0, tests = 0;
+
+    for (round = 0; round < 4; round++)
+    {
+        // Random samples, then the edge values in every pairing
+        for (i = 0; i < AUDIOBENCH_MIX_SAMPLES; i++)
+        {
+            seed = (seed * 1103515245) + 12345;
+            a[i] = round == 0 ? EDGES[i % EDGE_COUNT]                : (int16_t) (seed >> 16);
+            b[i] = round == 0 ? EDGES[(i / EDGE_COUNT) % EDGE_COUNT] : (int16_t) seed;
+        }
+
+        for (ga = 0; ga < GAIN_COUNT; ga++)
+        {
+            for (gb = 0; gb < GAIN_COUNT; gb++)
+            {
+                for (len = 0; len <= AUDIOBENCH_MIX_SAMPLES; len += (len < 32 ? 1 : 37))
+                {
+                    Mixer_mix2_scalar(ref, a, GAINS[ga], b, GAINS[gb], len);
+
+                    Mixer_mix2(out, a, GAINS[ga], b, GAINS[gb], len);
+                    mismatches += memcmp(out, ref, len * sizeof(int16_t)) != 0;
+
+                    // In place, as the audio output mixes the wav into its mix buffer
+                    memcpy(out, a, len * sizeof(int16_t));
+                    Mixer_mix2(out, out, GAINS[ga], b, GAINS[gb], len);
+                    mismatches += memcmp(out, ref, len * sizeof(int16_t)) != 0;
+
+                    memcpy(out, b, len * sizeof(int16_t));
+                    Mixer_mix2(out, a, GAINS[ga], out, GAINS[gb], len);
+                    mismatches += memcmp(out, ref, len * sizeof(int16_t)) != 0;
+
+                    tests += 3;
+                }
+            }
+        }
+    }
+
+#ifdef __SSE2__
+    fprintf(stderr, "Mixer SSE2 against scalar: %u of %u mixes differ: %s\n", mismatches, tests, mismatches ? "FAILED" : "OK");
+#else
+    fprintf(stderr, "Mixer scalar: %u of %u mixes differ: %s\n", mismatches, tests, mismatches ? "FAILED" : "OK");
+#endif
+
+    return mismatches == 0;
+}
+
+void AudioBench_report(const char* name, clock_t ticks, uint32_t samples, uint32_t rate)
+{
+    double secs = (double) ticks / CLOCKS_PER_SEC;
+
+    if (secs <= 0)
+        fprintf(stderr, "%-8s %8.3fs\n", name, secs);
+    else
+        fprintf(stderr, "%-8s %8.3fs %12.0f samples/sec %8.1fx realtime\n", name, secs, samples / secs, (samples / secs) / rate);
+}
+
+// 16-bit stereo PCM
+void AudioBench_write_header(FILE* f, uint32_t rate, uint32_t data_bytes)
+{
+    fwrite("RIFF", 1, 4, f);
+    AudioBench_write32(f, 36 + data_bytes);
+    fwrite("WAVEfmt ", 1, 8, f);
+    AudioBench_write32(f, 16);           // Format chunk size
+    AudioBench_write16(f, 1);            // PCM
+    AudioBench_write16(f, 2);            // Channels
+    AudioBench_write32(f, rate);
+    AudioBench_write32(f, rate * 2 * 2); // Bytes per second
+    AudioBench_write16(f, 2 * 2);        // Bytes per frame
+    AudioBench_write16(f, 16);           // Bits per sample
+    fwrite("data", 1, 4, f);
+    AudioBench_write32(f, data_bytes);
+}
+
+void AudioBench_write16(FILE* f, uint16_t v)
+{
+    fputc(v & 0xFF, f);
+    fputc(v >> 8, f);
+}
+
+void AudioBench_write32(FILE* f, uint32_t v)
+{
+    AudioBench_write16(f, v & 0xFFFF);
+    AudioBench_write16(f, v >> 16);
+}
@@ -0,0 +1,19 @@
+/***************************************************************************
+    Offline Audio Renderer & Benchmark.
+
+    Runs the sound program and sound chips without a display or audio
+    device, as fast as possible, from a script of sound commands.
+
+    The mixed chip output is written to a WAV file, which can be compared
+    against a known good render, and the time spent in each chip is
+    reported as a throughput in samples per second.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.h"
+
+Boolean AudioBench_run(const char* wav_filename, uint32_t seconds, const char* script_filename);
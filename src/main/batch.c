@@ -0,0 +1,224 @@
+/***************************************************************************
+    Batch Simulation.
+
+    Runs many headless instances of the game engine, each from boot with
+    its own random seed, and reports how far each one got. With
+    ENGINE_THREADS defined in globals.h the instances are spread across
+    worker threads, otherwise they run one after another.
+
+    Engine state is thread local, so each worker runs one instance at a
+    time against its own copy. ROM data, the course selection and the
+    tilemap cache are shared, and are set up by the main thread before
+    the workers start. Nothing is rendered and the sound chips are not
+    synthesised.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <stdio.h>
+#include "main.h"
+#include "arena.h"
+#include "batch.h"
+#include "roms.h"
+#include "video.h"
+#include "sdl/input.h"
+#include "sdl/timer.h"
+#include "frontend/config.h"
+#include "engine/oinputs.h"
+#include "engine/oroad.h"
+#include "engine/ostats.h"
+#include "engine/outils.h"
+#include "engine/outrun.h"
+#include "engine/audio/OSoundInt.h"
+
+#ifdef ENGINE_THREADS
+#include <SDL.h>
+#endif
+
+#define BATCH_MAX_THREADS 64
+
+typedef struct
+{
+    uint32_t seed;
+    int8_t   stage;      // Stage reached
+    uint32_t score;
+    uint32_t road_pos;   // Position within the stage reached
+    uint32_t us;         // Time taken to run the instance
+} batch_result_t;
+
+static batch_result_t* Batch_results;
+static uint32_t Batch_instances;
+static uint32_t Batch_frames;
+static uint32_t Batch_next;          // Next instance to be claimed by a worker
+#ifdef ENGINE_THREADS
+static SDL_mutex* Batch_mutex;
+#endif
+
+void Batch_run_instance(batch_result_t* result);
+int Batch_worker(void* data);
+
+// Run instances of the game from boot for a number of frames each.
+// threads: workers to spread the instances across. 0 uses one per instance, up to BATCH_MAX_THREADS.
+// seed:    random seed of the first instance. Each instance after uses the next seed.
+Boolean Batch_run(uint32_t instances, uint32_t frames, uint32_t threads, uint32_t seed)
+{
+    uint32_t i, start;
+
+    if (instances == 0 || frames == 0)
+        return FALSE;
+
+    if (Config_engine.jap && !Roms_load_japanese_roms())
+        return FALSE;
+
+#ifdef ENGINE_THREADS
+    if (threads == 0 || threads > instances)
+        threads = instances;
+    if (threads > BATCH_MAX_THREADS)
+        threads = BATCH_MAX_THREADS;
+#else
+    if (threads > 1)
+        fprintf(stderr, "Batch: ENGINE_THREADS is not defined. Running instances on a single thread.\n");
+    threads = 1;
+#endif
+
+    Batch_results = (batch_result_t*) Arena_calloc(ARENA_LOAD, instances, sizeof(batch_result_t));
+    if (Batch_results == NULL)
+        return FALSE;
+
+    for (i = 0; i < instances; i++)
+        Batch_results[i].seed = seed + i;
+
+    Batch_instances = instances;
+    Batch_frames    = frames;
+    Batch_next      = 0;
+
+    // Select the course and fill the shared tilemap cache once, before any instance starts
+    Outrun_init();
+    cannonball_state = STATE_GAME;
+
+    start = getMicroseconds();
+
+#ifdef ENGINE_THREADS
+    SDL_Thread* workers[BATCH_MAX_THREADS];
+
+    Batch_mutex = SDL_CreateMutex();
+    if (Batch_mutex == NULL)
+    {
+        fprintf(stderr, "Batch: Could not create mutex. Running instances on a single thread.\n");
+        threads = 0;
+    }
+
+    for (i = 0; i < threads; i++)
+    {
+        workers[i] = SDL_CreateThread(Batch_worker, NULL);
+        if (workers[i] == NULL)
+        {
+            fprintf(stderr, "Batch: Could not create worker thread %u.\n", i);
+            threads = i;
+            break;
+        }
+    }
+
+    // Without any workers, run the instances here
+    if (threads == 0)
+    {
+        threads = 1;
+        Batch_worker(NULL);
+    }
+    else
+    {
+        for (i = 0; i < threads; i++)
+            SDL_WaitThread(workers[i], NULL);
+    }
+
+    SDL_DestroyMutex(Batch_mutex);
+    Batch_mutex = NULL;
+#else
+    Batch_worker(NULL);
+#endif
+
+    Outrun_batch_instance = FALSE;
+    Video_headless        = FALSE;
+
+    double secs = (double) (getMicroseconds() - start) / 1000000.0;
+    uint64_t ticks = (uint64_t) instances * frames;
+
+    for (i = 0; i < instances; i++)
+    {
+        batch_result_t* r = &Batch_results[i];
+        fprintf(stderr, "Instance %4u: seed %8u, stage %2d, road %5u, score %8x, %.3fs\n",
+                i, r->seed, r->stage + 1, r->road_pos >> 16, r->score, (double) r->us / 1000000.0);
+    }
+
+    fprintf(stderr, "Batch: %u instances of %u frames on %u threads\n", instances, frames, threads);
+    if (secs > 0)
+        fprintf(stderr, "%.3fs, %.0f ticks/sec, %.1fx realtime\n", secs, ticks / secs, (ticks / secs) / Config_fps);
+
+    Arena_free(Batch_results);
+    Batch_results = NULL;
+
+    return TRUE;
+}
+
+// Claim and run instances until none remain
+int Batch_worker(void* data)
+{
+    for (;;)
+    {
+        uint32_t instance;
+
+#ifdef ENGINE_THREADS
+        SDL_mutexP(Batch_mutex);
+        instance = Batch_next++;
+        SDL_mutexV(Batch_mutex);
+#else
+        instance = Batch_next++;
+#endif
+
+        if (instance >= Batch_instances)
+            return 0;
+
+        Batch_run_instance(&Batch_results[instance]);
+    }
+}
+
+void Batch_run_instance(batch_result_t* result)
+{
+    uint32_t frame;
+    uint32_t start = getMicroseconds();
+
+    Outrun_batch_instance = TRUE;
+    Video_headless        = TRUE;
+
+    Video_init_state();
+    Outrun_init();
+
+    // A seed of 0 selects the default generator, which is not reproducible across threads
+    outils_set_random_seed(result->seed ? result->seed : 1);
+    cannonball_frame = 0;
+
+    for (frame = 0; frame < Batch_frames; frame++)
+    {
+        // Determine whether to tick the current frame, as the main loop does
+        cannonball_frame++;
+        if (Config_fps == 30)
+            cannonball_tick_frame = 1;
+        else if (Config_fps == 60)
+            cannonball_tick_frame = cannonball_frame & 1;
+        else if (Config_fps == 120)
+            cannonball_tick_frame = (cannonball_frame & 3) == 1;
+
+        if (cannonball_tick_frame)
+            OInputs_tick(NULL);
+        OInputs_do_gear();
+        Outrun_tick(NULL, cannonball_tick_frame);
+        Input_frame_done();
+        OSoundInt_tick();
+    }
+
+    result->stage    = OStats_cur_stage;
+    result->score    = OStats_score;
+    result->road_pos = ORoad_road_pos;
+    result->us       = getMicroseconds() - start;
+}
@@ -0,0 +1,28 @@
+/***************************************************************************
+    Batch Simulation.
+
+    Runs many headless instances of the game engine, each from boot with
+    its own random seed, and reports how far each one got. With
+    ENGINE_THREADS defined in globals.h the instances are spread across
+    worker threads, otherwise they run one after another.
+
+    Limitations:
+    - Per-instance state is not held in a context struct. The engine
+      globals are marked ENGINE_LOCAL, which ENGINE_THREADS makes thread
+      local, so an instance is whatever its worker thread sees.
+    - ENGINE_THREADS can not be combined with COMPILE_SOUND_CODE, and
+      globals.h rejects it. The sound program and chip state (OSound_*,
+      SegaPCM_* and YM_*) would be thread local too, so the audio thread
+      would run against its own copy rather than the game's. A build with
+      parallel batch mode therefore has no audio output. Instances still
+      run the sound program, but the chips are not synthesised.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.h"
+
+Boolean Batch_run(uint32_t instances, uint32_t frames, uint32_t threads, uint32_t seed);
@@ -19,8 +19,9 @@ X More cars seem to be high pitched than on MAME. (Fixed - engine channel setup)
 #include <string.h>
 #include "engine/audio/osound.h"
 #include <stdio.h>
+#include "savestate.h"
 
-uint8_t OSound_command_input;
+ENGINE_LOCAL uint8_t OSound_command_input;
 
 // [+0] Unused
 // [+1] Engine pitch high
@@ -30,14 +31,14 @@ uint8_t OSound_command_input;
 // [+5] Traffic data #2 
 // [+6] Traffic data #3 
 // [+7] Traffic data #4
-uint8_t OSound_engine_data[8];
+ENGINE_LOCAL uint8_t OSound_engine_data[8];
 
 
 #define PCM_RAM_SIZE  0x100
 #define CHAN_RAM_SIZE 0x800
 
 // Internal channel format
-uint8_t chan_ram[CHAN_RAM_SIZE];
+ENGINE_LOCAL uint8_t chan_ram[CHAN_RAM_SIZE];
 
 // Size of each internal channel entry
 const static uint8_t CHAN_SIZE = 0x20;
@@ -98,26 +99,26 @@ const static uint8_t CHAN_SIZE = 0x20;
 //      |          |        l = loop   (0 = enabled, 1 = disabled)
 
 // Reference to 0xFF bytes of PCM Chip RAM
-uint8_t* pcm_ram;
+ENGINE_LOCAL uint8_t* pcm_ram;
 
 // Bit 0: Set denotes car stationary do rev sample when revs high enough
 // Bit 1: Set to denote PCM sound effect triggered.
-uint8_t sound_props;
+ENGINE_LOCAL uint8_t sound_props;
 
 // Stored Command
-uint8_t command_index;
+ENGINE_LOCAL uint8_t command_index;
 
 // F810 - F813
-uint8_t counter1, counter2, counter3, counter4;
+ENGINE_LOCAL uint8_t counter1, counter2, counter3, counter4;
 
 // Position in sequence [de]
-uint16_t pos;
+ENGINE_LOCAL uint16_t pos;
 
 // Store last command to assist program flow
-uint8_t cmd_prev;
+ENGINE_LOCAL uint8_t cmd_prev;
 
 // Store last chan ID
-uint16_t chanid_prev;
+ENGINE_LOCAL uint16_t chanid_prev;
 
 // PCM Channel Commands in RAM to send
 const static uint16_t CH09_CMDS1 = 0x570; // 0xFD70;
@@ -134,10 +135,31 @@ const static uint16_t CH11_CMDS2 = 0x588;
 // ENGINE TONE CODE
 // ------------------------------------------------------------------------
 // Used to skip the engine code 1/2 times
-uint8_t engine_counter;
+ENGINE_LOCAL uint8_t engine_counter;
 
 // Engine Channel: Selects Channel at offset 0xF800 for engine tones
-uint8_t engine_channel;
+ENGINE_LOCAL uint8_t engine_channel;
+
+// Engine tone table entry, extracted from ENGINE_ADR_TABLE in the Z80 ROM
+typedef struct
+{
+    uint16_t start;         // Wave start address
+    uint8_t end;            // Wave end address high
+    uint8_t vol;            // Volume multiplier (or pan adjustment for the Ferrari entry)
+    uint8_t pitch;          // Pitch
+} osound_engine_t;
+
+#define ENGINE_ENTRY        5    // Bytes per entry in ROM
+#define ENGINE_ENTRIES      0x51 // Indexed by revs - 1
+#define TRAFFIC_VOL_ENTRIES 0x20 // Indexed by 5 bit traffic volume entry
+
+// Tables are read from ROM once by OSound_init_tables, so the engine and traffic
+// code reads native arrays every tick rather than walking the Z80 ROM.
+static ENGINE_LOCAL osound_engine_t OSound_engine_table[ENGINE_ENTRIES];
+static ENGINE_LOCAL osound_engine_t OSound_ferrari_entry;
+static ENGINE_LOCAL uint8_t OSound_traffic_vol_table[TRAFFIC_VOL_ENTRIES];
+
+void OSound_init_tables();
 
 uint8_t OSound_pcm_r(uint16_t adr);
 void    OSound_pcm_w(uint16_t adr, uint8_t v);
@@ -180,17 +202,17 @@ void OSound_write_seq_adr(uint8_t* chan);
 // ------------------------------------------------------------------------
 void OSound_engine_process();
 void OSound_engine_process_chan(uint8_t* chan, uint8_t* pcm);
-void OSound_vol_thicken(uint16_t* pos, uint8_t* chan, uint8_t* pcm);
-uint8_t OSound_get_adjusted_vol(uint16_t* pos, uint8_t* chan);
-void OSound_engine_set_pitch(uint16_t* pos, uint8_t* pcm);
+void OSound_vol_thicken(const osound_engine_t* entry, uint8_t* chan, uint8_t* pcm);
+uint8_t OSound_get_adjusted_vol(uint8_t multiply, uint8_t* chan);
+void OSound_engine_set_pitch(const osound_engine_t* entry, uint8_t* pcm);
 void OSound_engine_mute_channel(uint8_t* chan, uint8_t* pcm, Boolean do_check);
 void OSound_unk78c7(uint8_t* chan, uint8_t* pcm);
 void OSound_ferrari_vol_pan(uint8_t* chan, uint8_t* pcm);
-uint16_t OSound_engine_get_table_adr(uint8_t* chan, uint8_t* pcm);
+const osound_engine_t* OSound_engine_get_entry(uint8_t* chan, uint8_t* pcm);
 void OSound_engine_adjust_volume(uint8_t* chan);
-uint16_t OSound_engine_set_adr(uint16_t* pos, uint8_t* chan, uint8_t* pcm);
-void OSound_engine_set_adr_end(uint16_t* pos, uint16_t loop_adr, uint8_t* chan, uint8_t* pcm);
-void OSound_engine_set_pan(uint16_t* pos, uint8_t* chan, uint8_t* pcm);
+uint16_t OSound_engine_set_adr(const osound_engine_t* entry, uint8_t* chan, uint8_t* pcm);
+void OSound_engine_set_adr_end(const osound_engine_t* entry, uint16_t loop_adr, uint8_t* chan, uint8_t* pcm);
+void OSound_engine_set_pan(const osound_engine_t* entry, uint8_t* chan, uint8_t* pcm);
 void OSound_engine_read_data(uint8_t* chan, uint8_t* pcm);
 
 // ----------------------------------------------------------------------------
@@ -238,9 +260,39 @@ void OSound_init(uint8_t* _pcm_ram)
     for (j = 0; j < 16; j++)
         pcm_ram[0x86 + (j * 8)] = 1; // Channel Active
 
+    OSound_init_tables();
     OSound_init_fm_chip();
 }
 
+// Extract the engine tone and traffic volume tables from the Z80 ROM.
+// Called on init, so the tables follow the currently loaded sound ROM.
+void OSound_init_tables()
+{
+    uint16_t i;
+
+    // Ferrari: First entry in the table. Start, End, Pan, Pitch.
+    OSound_ferrari_entry.start = RomLoader_read16_addr16(&Roms_z80, z80_adr_ENGINE_ADR_TABLE);
+    OSound_ferrari_entry.end   = RomLoader_read8_addr16(&Roms_z80, z80_adr_ENGINE_ADR_TABLE + 2);
+    OSound_ferrari_entry.vol   = RomLoader_read8_addr16(&Roms_z80, z80_adr_ENGINE_ADR_TABLE + 3);
+    OSound_ferrari_entry.pitch = RomLoader_read8_addr16(&Roms_z80, z80_adr_ENGINE_ADR_TABLE + 4);
+
+    // Engine tones indexed by revs. Start, End, Volume Multiplier.
+    // The ported routine skips the fourth byte and reads the pitch from the byte after the entry.
+    for (i = 0; i < ENGINE_ENTRIES; i++)
+    {
+        uint16_t adr = z80_adr_ENGINE_ADR_TABLE + ENGINE_ENTRY + (i * ENGINE_ENTRY);
+        OSound_engine_table[i].start = RomLoader_read16_addr16(&Roms_z80, adr);
+        OSound_engine_table[i].end   = RomLoader_read8_addr16(&Roms_z80, adr + 2);
+        OSound_engine_table[i].vol   = RomLoader_read8_addr16(&Roms_z80, adr + 3);
+        OSound_engine_table[i].pitch = RomLoader_read8_addr16(&Roms_z80, adr + 5);
+    }
+
+    // Traffic volume multiplier. Entry 0 denotes no volume and is never read.
+    OSound_traffic_vol_table[0] = 0;
+    for (i = 1; i < TRAFFIC_VOL_ENTRIES; i++)
+        OSound_traffic_vol_table[i] = RomLoader_read8_addr16(&Roms_z80, z80_adr_TRAFFIC_VOL_MULTIPLY + i - 1);
+}
+
 // Initialize FM Chip. Initalize and start Timer A.
 // Source: 0x79
 void OSound_init_fm_chip()
@@ -1650,7 +1702,7 @@ void OSound_engine_process_chan(uint8_t* chan, uint8_t* pcm)
         }
     }
     // 0x75B2
-    uint16_t engine_pos = OSound_engine_get_table_adr(chan, pcm); // hl
+    const osound_engine_t* entry = OSound_engine_get_entry(chan, pcm); // hl
     
     // Mute Engine Channel
     if (chan[ch_engines_FLAGS] & BIT_5)
@@ -1661,18 +1713,14 @@ void OSound_engine_process_chan(uint8_t* chan, uint8_t* pcm)
 
     // 0x75bc Has Start Address Been Set Already?
     // Used on start line
-    if (chan[ch_engines_FLAGS] & BIT_0)
-    {
-        engine_pos += 2;
-    }
-    else
+    if (!(chan[ch_engines_FLAGS] & BIT_0))
     {
-        uint16_t start_adr = OSound_engine_set_adr(&engine_pos, chan, pcm); // Set Start Address
-        OSound_engine_set_adr_end(&engine_pos, start_adr, chan, pcm);       // Set End Address
+        uint16_t start_adr = OSound_engine_set_adr(entry, chan, pcm); // Set Start Address
+        OSound_engine_set_adr_end(entry, start_adr, chan, pcm);       // Set End Address
     }
 
-    OSound_vol_thicken(&engine_pos, chan, pcm); // Thicken engine effect by panning left/right dependent on channel.
-    OSound_engine_set_pitch(&engine_pos, pcm);  // Set Engine Pitch from lookup table specified by hl
+    OSound_vol_thicken(entry, chan, pcm); // Thicken engine effect by panning left/right dependent on channel.
+    OSound_engine_set_pitch(entry, pcm);  // Set Engine Pitch from lookup table specified by hl
     pcm[0x86] = 0;                      // Set Active & Loop Enabled
 }
 
@@ -1734,18 +1782,16 @@ void OSound_ferrari_vol_pan(uint8_t* chan, uint8_t* pcm)
     OSound_w16(chan + ch_engines_PITCH_L, pitch_table_index);
 
     // Set PCM Sample Addresses
-    uint16_t pos = z80_adr_ENGINE_ADR_TABLE;
-    OSound_engine_set_adr(&pos, chan, pcm);
+    OSound_engine_set_adr(&OSound_ferrari_entry, chan, pcm);
 
     // Set PCM Sample End Address
-    pcm[0x6] = RomLoader_read8_addr16(&Roms_z80, ++pos);
+    pcm[0x6] = OSound_ferrari_entry.end;
 
     // Set Volume Pan
-    OSound_engine_set_pan(&pos, chan, pcm);
+    OSound_engine_set_pan(&OSound_ferrari_entry, chan, pcm);
 
     // Set Pitch
-    pos = z80_adr_ENGINE_ADR_TABLE + 4; // Set position to pitch offset
-    uint16_t pitch = RomLoader_read8_addr16(&Roms_z80, pos); // bc
+    uint16_t pitch = OSound_ferrari_entry.pitch; // bc
     pitch += OSound_r16(chan + ch_engines_PITCH_L) >> 1;
     if (pitch > 0xFF) pitch = 0xFF;
 
@@ -1760,7 +1806,7 @@ void OSound_ferrari_vol_pan(uint8_t* chan, uint8_t* pcm)
 // Set Table Index For Engine Sample Start / End Addresses
 // Table starts at ENGINE_ADR_TABLE offset in ROM.
 // Source: 0x7819
-uint16_t OSound_engine_get_table_adr(uint8_t* chan, uint8_t* pcm)
+const osound_engine_t* OSound_engine_get_entry(uint8_t* chan, uint8_t* pcm)
 {
     int16_t off = OSound_r16(pcm + 0x80) - 0x52;
     int16_t table_offset;
@@ -1780,17 +1826,16 @@ uint16_t OSound_engine_get_table_adr(uint8_t* chan, uint8_t* pcm)
     // get_adr:
     table_offset--;
 
-    const static uint8_t ENTRY = 5; // bytes per entry
-    return (z80_adr_ENGINE_ADR_TABLE + ENTRY) + (table_offset * ENTRY); // table has 54 entries
+    return &OSound_engine_table[table_offset];
 }
 
 // Setup engine addresses from table (START, LOOP)
 // Source: 0x77AD
 
 //bpset 77b0,1,{printf "start adr:%02x pos:=%02x",bc, hl; g}
-uint16_t OSound_engine_set_adr(uint16_t* pos, uint8_t* chan, uint8_t* pcm)
+uint16_t OSound_engine_set_adr(const osound_engine_t* entry, uint8_t* chan, uint8_t* pcm)
 {
-    uint16_t start_adr = RomLoader_read16_addr16(&Roms_z80, (*pos)++);
+    uint16_t start_adr = entry->start;
     OSound_w16(pcm + 0x4, start_adr); // Set Wave Start Address
 
     // TRAFFIC
@@ -1822,10 +1867,10 @@ uint16_t OSound_engine_set_adr(uint16_t* pos, uint8_t* chan, uint8_t* pcm)
 }
 
 // Source: 0x7853
-void OSound_engine_set_adr_end(uint16_t* pos, uint16_t loop_adr, uint8_t* chan, uint8_t* pcm)
+void OSound_engine_set_adr_end(const osound_engine_t* entry, uint16_t loop_adr, uint8_t* chan, uint8_t* pcm)
 {
     // Set wave end address from table
-    pcm[0x6] = RomLoader_read8_addr16(&Roms_z80, ++(*pos));
+    pcm[0x6] = entry->end;
 
     // Loop Disabled
     if (chan[ch_engines_FLAGS] & BIT_2)
@@ -1841,29 +1886,26 @@ void OSound_engine_set_adr_end(uint16_t* pos, uint16_t loop_adr, uint8_t* chan,
 
 // Thicken engine effect by panning left/right dependent on channel.
 // Source: 0x77EA
-void OSound_vol_thicken(uint16_t* pos, uint8_t* chan, uint8_t* pcm)
+void OSound_vol_thicken(const osound_engine_t* entry, uint8_t* chan, uint8_t* pcm)
 {
-    (*pos)++; // Address of volume multiplier
-
     // Odd Channels: Pan Left
     if (engine_channel & BIT_0)
     {
-        pcm[0x2] = pcm[0x82] & BIT_5 ? 0 : OSound_get_adjusted_vol(pos, chan); // left (if enabled)
+        pcm[0x2] = pcm[0x82] & BIT_5 ? 0 : OSound_get_adjusted_vol(entry->vol, chan); // left (if enabled)
         pcm[0x3] = 0; // right
     }
     // Even Channels: Pan Right
     else
     {
         pcm[0x2] = 0; // left
-        pcm[0x3] = pcm[0x83] & BIT_5 ? 0 : OSound_get_adjusted_vol(pos, chan); // right (if enabled)
+        pcm[0x3] = pcm[0x83] & BIT_5 ? 0 : OSound_get_adjusted_vol(entry->vol, chan); // right (if enabled)
     }
 }
 
 // Get Adjusted Volume
 // Source: 0x78A7
-uint8_t OSound_get_adjusted_vol(uint16_t* pos, uint8_t* chan)
+uint8_t OSound_get_adjusted_vol(uint8_t multiply, uint8_t* chan)
 {
-    uint8_t multiply =  RomLoader_read8IncP_addr16(&Roms_z80, pos);
     uint16_t vol = (chan[ch_engines_VOL1] * multiply) >> 6;
 
     if (vol > 0x3F)
@@ -1875,19 +1917,15 @@ uint8_t OSound_get_adjusted_vol(uint16_t* pos, uint8_t* chan)
 // bpset 7877,1,{printf "bc=%02x hl=%02x",bc, hl; g}
 // Set Engine Pitch From Table
 // Source: 0x7870
-void OSound_engine_set_pitch(uint16_t* pos, uint8_t* pcm)
+void OSound_engine_set_pitch(const osound_engine_t* entry, uint8_t* pcm)
 {
-    (*pos)++; // Increment to pitch entry in table
-
     uint16_t bc = OSound_r16(pcm + 0x82);
     bc >>= 2;
 
     if (bc & 0xFF00)
         bc = (bc & 0xFF00) | 0xFF;
 
-    uint16_t pitch = RomLoader_read8IncP_addr16(&Roms_z80, pos);
-
-    //std::cout << std::hex << (*pos) << std::endl;
+    uint16_t pitch = entry->pitch;
 
     // Read pitch from table
     if (bc)
@@ -1945,10 +1983,10 @@ void OSound_engine_adjust_volume(uint8_t* chan)
 // Adjust Volume and write to new memory area
 // Also write to ix (PCM Channel RAM)
 // Source: 0x76FD
-void OSound_engine_set_pan(uint16_t* pos, uint8_t* chan, uint8_t* pcm)
+void OSound_engine_set_pan(const osound_engine_t* entry, uint8_t* chan, uint8_t* pcm)
 {
     uint16_t pitch = OSound_r16(chan + ch_engines_PITCH_L) >> 1;
-    pitch += RomLoader_read8_addr16(&Roms_z80, ++(*pos));
+    pitch += entry->vol;
 
     uint16_t vol = (chan[ch_engines_VOL1] * pitch) >> 6;
 
@@ -2132,10 +2170,8 @@ void OSound_traffic_set_vol(uint8_t* pcm)
     if (!vol_entry)
         return;
 
-    uint16_t multiply = z80_adr_TRAFFIC_VOL_MULTIPLY + vol_entry - 1;
-
     // Set traffic volume multiplier
-    pcm[0x83] = RomLoader_read8_addr16(&Roms_z80, multiply);
+    pcm[0x83] = OSound_traffic_vol_table[vol_entry];
 
     if (pcm[0x83] < 0x10)
         pcm[0x82] &= ~BIT_3; // Disable Traffic Sound
@@ -2210,3 +2246,21 @@ void OSound_traffic_read_data(uint8_t* pcm)
     pcm[0x01] = vol & 7;  // Put bottom 3 bits in 01    (pan entry)
     pcm[0x00] = vol >> 3; // And remaining 5 bits in 00 (used as vol entry)
 }
+
+void OSound_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_SOUND, OSound_command_input);
+    SAVESTATE_ADD(SAVESTATE_SOUND, OSound_engine_data);
+    SAVESTATE_ADD(SAVESTATE_SOUND, chan_ram);
+    SAVESTATE_ADD(SAVESTATE_SOUND, sound_props);
+    SAVESTATE_ADD(SAVESTATE_SOUND, command_index);
+    SAVESTATE_ADD(SAVESTATE_SOUND, counter1);
+    SAVESTATE_ADD(SAVESTATE_SOUND, counter2);
+    SAVESTATE_ADD(SAVESTATE_SOUND, counter3);
+    SAVESTATE_ADD(SAVESTATE_SOUND, counter4);
+    SAVESTATE_ADD(SAVESTATE_SOUND, pos);
+    SAVESTATE_ADD(SAVESTATE_SOUND, cmd_prev);
+    SAVESTATE_ADD(SAVESTATE_SOUND, chanid_prev);
+    SAVESTATE_ADD(SAVESTATE_SOUND, engine_counter);
+    SAVESTATE_ADD(SAVESTATE_SOUND, engine_channel);
+}
@@ -204,7 +204,7 @@ enum
 
 
 // Command to process
-extern uint8_t OSound_command_input;
+extern ENGINE_LOCAL uint8_t OSound_command_input;
 
 // [+0] Unused
 // [+1] Engine pitch high
@@ -214,8 +214,9 @@ extern uint8_t OSound_command_input;
 // [+5] Traffic data #2 
 // [+6] Traffic data #3 
 // [+7] Traffic data #4
-extern uint8_t OSound_engine_data[8];
+extern ENGINE_LOCAL uint8_t OSound_engine_data[8];
 
 void OSound_init(uint8_t* pcm_ram);
 void OSound_init_fm_chip();
 void OSound_tick();
+void OSound_register_state();
@@ -12,37 +12,51 @@
 #include "engine/outrun.h"
 #include "engine/audio/OSound.h"
 #include "engine/audio/OSoundInt.h"
+#include "sdl/audio.h"
+#include "savestate.h"
 
 
 // SoundChip: Sega Custom Sample Generator
-Boolean OSoundInt_has_booted = FALSE;
-uint8_t OSoundInt_engine_data[8];
+ENGINE_LOCAL Boolean OSoundInt_has_booted = FALSE;
+ENGINE_LOCAL uint8_t OSoundInt_engine_data[8];
+
+// Engine data latched for the frame being processed by the sound program
+ENGINE_LOCAL uint8_t OSoundInt_engine_latch[8];
 
 // 4 MHz
 static const uint32_t SOUND_CLOCK = 4000000;
 
 // Reference to 0xFF bytes of PCM Chip RAM
-uint8_t OSOoundInt_pcm_ram[OSoundInt_PCM_RAM_SIZE];
+ENGINE_LOCAL uint8_t OSOoundInt_pcm_ram[OSoundInt_PCM_RAM_SIZE];
 
 // Controls what type of sound we're going to process in the interrupt routine
-uint8_t sound_counter;
+ENGINE_LOCAL uint8_t sound_counter;
 
 #define QUEUE_LENGTH 0x1F
-uint8_t queue[QUEUE_LENGTH + 1];
+ENGINE_LOCAL uint8_t queue[QUEUE_LENGTH + 1];
 
 // Number of sounds queued
-uint8_t sounds_queued;
+ENGINE_LOCAL uint8_t sounds_queued;
 
 // Positions in the queue
-uint8_t sound_head, sound_tail;
+ENGINE_LOCAL uint8_t sound_head, sound_tail;
 
 
 uint8_t OSoundInt_created_pcm = 0;
 uint8_t OSoundInt_created_ym = 0;
 
+void OSoundInt_send(uint8_t cmd, uint8_t value);
+void OSoundInt_reset_queue();
+void OSoundInt_tick_frame(const uint8_t* engine_data);
+void OSoundInt_add_to_queue(uint8_t snd);
+void OSoundInt_clear_queue();
+
 void OSoundInt_init()
 {
-    uint16_t i;
+#ifdef COMPILE_SOUND_CODE
+    // The sound chips are rebuilt below, so the audio thread must be idle
+    Audio_pause_audio();
+#endif
     if (!OSoundInt_created_pcm)
     {
         SegaPCM_Create(SOUND_CLOCK, &Roms_pcm, OSOoundInt_pcm_ram, SEGAPCM_BANK_512);
@@ -55,10 +69,24 @@ void OSoundInt_init()
         OSoundInt_created_ym = 1;
     }
 
-    SegaPCM_init(Config_fps);
-    YM_init(44100, Config_fps);
+    SegaPCM_init(Config_sound.chip_rate, Config_fps);
+    YM_render_mode = Config_sound.ym_render;
+    YM_init(Config_sound.chip_rate, Config_fps);
+
+    OSoundInt_init_state();
+
+#ifdef COMPILE_SOUND_CODE
+    Audio_resume_audio();
+#endif
+}
+
+// Reset the sound program and chip registers owned by the calling thread.
+// The chips must already have been initialized by OSoundInt_init.
+void OSoundInt_init_state()
+{
+    uint16_t i;
 
-    OSoundInt_reset();
+    OSoundInt_reset_queue();
 
     // Clear PCM Chip RAM
     for (i = 0; i < OSoundInt_PCM_RAM_SIZE; i++)
@@ -68,11 +96,50 @@ void OSoundInt_init()
         OSoundInt_engine_data[i] = 0;
 
     OSound_init(OSOoundInt_pcm_ram);
+    YM_reset();
+}
+
+// Pass a command to the sound program: via the audio thread if it is running, otherwise directly.
+void OSoundInt_send(uint8_t cmd, uint8_t value)
+{
+#ifdef COMPILE_SOUND_CODE
+    if (Audio_post_command(cmd, value, OSoundInt_engine_data))
+        return;
+#endif
+    OSoundInt_process_command(cmd, value, OSoundInt_engine_data);
+}
+
+// Run a command on the sound program side
+void OSoundInt_process_command(uint8_t cmd, uint8_t value, const uint8_t* engine_data)
+{
+    switch (cmd)
+    {
+        case OSOUNDINT_CMD_SOUND:
+            OSoundInt_add_to_queue(value);
+            break;
+
+        case OSOUNDINT_CMD_CLEAR:
+            OSoundInt_clear_queue();
+            break;
+
+        case OSOUNDINT_CMD_RESET:
+            OSoundInt_reset_queue();
+            break;
+
+        case OSOUNDINT_CMD_FRAME:
+            OSoundInt_tick_frame(engine_data);
+            break;
+    }
+}
+
+void OSoundInt_reset()
+{
+    OSoundInt_send(OSOUNDINT_CMD_RESET, 0);
 }
 
 // Clear sound queue
 // Source: 0x5086
-void OSoundInt_reset()
+void OSoundInt_reset_queue()
 {
     sound_counter = 0;
     sound_head    = 0;
@@ -82,6 +149,15 @@ void OSoundInt_reset()
 
 void OSoundInt_tick()
 {
+    OSoundInt_send(OSOUNDINT_CMD_FRAME, 0);
+}
+
+void OSoundInt_tick_frame(const uint8_t* engine_data)
+{
+    uint8_t i;
+    for (i = 0; i < 8; i++)
+        OSoundInt_engine_latch[i] = engine_data[i];
+
     if (Config_fps == 30)
     {
         OSoundInt_play_queued_sound(); // Process audio commands from main program code
@@ -138,7 +214,7 @@ void OSoundInt_play_queued_sound()
         // Process player engine sounds and passing traffic
         else
         {
-            OSound_engine_data[counter] = OSoundInt_engine_data[counter];
+            OSound_engine_data[counter] = OSoundInt_engine_latch[counter];
         }
     }
 }
@@ -151,19 +227,24 @@ void OSoundInt_add_to_queue(uint8_t snd)
     sounds_queued++;
 }
 
-void OSoundInt_queue_clear()
+void OSoundInt_clear_queue()
 {
     sound_tail = 0;
     sounds_queued = 0;
 }
 
+void OSoundInt_queue_clear()
+{
+    OSoundInt_send(OSOUNDINT_CMD_CLEAR, 0);
+}
+
 // Queue a sound in service mode
 // Used to trigger both sound effects and music
 // Source: 0x56C6
 void OSoundInt_queue_sound_service(uint8_t snd)
 {
     if (OSoundInt_has_booted)
-        OSoundInt_add_to_queue(snd);
+        OSoundInt_send(OSOUNDINT_CMD_SOUND, snd);
     else
         OSoundInt_queue_clear();
 }
@@ -187,7 +268,7 @@ void OSoundInt_queue_sound(uint8_t snd)
                 snd == SOUND_MUSIC_SPLASH || snd == SOUND_MUSIC_LASTWAVE)
                 return;
         }
-        OSoundInt_add_to_queue(snd);
+        OSoundInt_send(OSOUNDINT_CMD_SOUND, snd);
     }
     else
         OSoundInt_queue_clear();
@@ -195,3 +276,15 @@ void OSoundInt_queue_sound(uint8_t snd)
         
 }
 
+void OSoundInt_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_SOUND, OSOoundInt_pcm_ram);
+    SAVESTATE_ADD(SAVESTATE_SOUND, OSoundInt_engine_data);
+    SAVESTATE_ADD(SAVESTATE_SOUND, OSoundInt_engine_latch);
+    SAVESTATE_ADD(SAVESTATE_SOUND, OSoundInt_has_booted);
+    SAVESTATE_ADD(SAVESTATE_SOUND, queue);
+    SAVESTATE_ADD(SAVESTATE_SOUND, sound_counter);
+    SAVESTATE_ADD(SAVESTATE_SOUND, sound_head);
+    SAVESTATE_ADD(SAVESTATE_SOUND, sound_tail);
+    SAVESTATE_ADD(SAVESTATE_SOUND, sounds_queued);
+}
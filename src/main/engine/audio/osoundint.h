@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include "globals.h"
 #include "hwaudio/segapcm.h"
 #include "hwaudio/ym2151.h"
 #include "engine/audio/commands.h"
@@ -18,7 +19,7 @@
 #define OSoundInt_PCM_RAM_SIZE 0x100
 
 // Note whether the game has booted
-extern Boolean OSoundInt_has_booted;
+extern ENGINE_LOCAL Boolean OSoundInt_has_booted;
 
 // [+0] Unused
 // [+1] Engine pitch high
@@ -28,16 +29,29 @@ extern Boolean OSoundInt_has_booted;
 // [+5] Traffic data #2 
 // [+6] Traffic data #3 
 // [+7] Traffic data #4
-extern uint8_t OSoundInt_engine_data[8];
+extern ENGINE_LOCAL uint8_t OSoundInt_engine_data[8];
 
 
+// Commands passed from the game to the sound program.
+// When audio runs on its own thread, these cross over through the audio command queue.
+enum
+{
+    OSOUNDINT_CMD_SOUND,    // Queue a sound
+    OSOUNDINT_CMD_CLEAR,    // Clear the sound queue
+    OSOUNDINT_CMD_RESET,    // Reset the sound queue
+    OSOUNDINT_CMD_FRAME,    // Tick the sound program for one frame, with the engine data for that frame
+};
+
 void OSoundInt_init();
+void OSoundInt_init_state();
 void OSoundInt_reset();
 void OSoundInt_tick();
+void OSoundInt_process_command(uint8_t cmd, uint8_t value, const uint8_t* engine_data);
 
 void OSoundInt_play_queued_sound();
 void OSoundInt_queue_sound_service(uint8_t snd);
 void OSoundInt_queue_sound(uint8_t snd);
 void OSoundInt_queue_clear();
+void OSoundInt_register_state();
 
 
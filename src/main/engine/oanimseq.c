@@ -17,6 +17,7 @@
 #include "engine/oferrari.h"
 #include "engine/oinputs.h"
 #include "engine/oanimseq.h"
+#include "savestate.h"
 
 // ----------------------------------------------------------------------------
 // Animation Data Format.
@@ -39,36 +40,36 @@
 
 
 // Man at line with start flag
-oanimsprite OAnimSeq_anim_flag;
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_flag;
 
 // Ferrari Animation Sequence
-oanimsprite OAnimSeq_anim_ferrari;               // 1
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_ferrari;               // 1
 
 // Passenger Animation Sequences
-oanimsprite OAnimSeq_anim_pass1;                 // 2
-oanimsprite OAnimSeq_anim_pass2;                 // 3
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_pass1;                 // 2
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_pass2;                 // 3
 
 // End Sequence Stuff
-oanimsprite OAnimSeq_anim_obj1;                  // 4
-oanimsprite OAnimSeq_anim_obj2;                  // 5
-oanimsprite OAnimSeq_anim_obj3;                  // 6
-oanimsprite OAnimSeq_anim_obj4;                  // 7
-oanimsprite OAnimSeq_anim_obj5;                  // 8
-oanimsprite OAnimSeq_anim_obj6;                  // 9
-oanimsprite OAnimSeq_anim_obj7;                  // 10
-oanimsprite OAnimSeq_anim_obj8;                  // 10
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj1;                  // 4
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj2;                  // 5
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj3;                  // 6
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj4;                  // 7
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj5;                  // 8
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj6;                  // 9
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj7;                  // 10
+ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj8;                  // 10
 
 // End sequence to display (0-4)
-uint8_t OAnimSeq_end_seq;
+ENGINE_LOCAL uint8_t OAnimSeq_end_seq;
 
 // End Sequence Animation Position
-int16_t seq_pos;
+ENGINE_LOCAL int16_t seq_pos;
 
 // End Sequence State (0 = Init, 1 = Tick)
-uint8_t end_seq_state;
+ENGINE_LOCAL uint8_t end_seq_state;
 
 // Used for Ferrari End Animation Sequence
-Boolean ferrari_stopped;
+ENGINE_LOCAL Boolean ferrari_stopped;
 
 void OAnimSeq_init_end_sprites();
 void OAnimSeq_tick_ferrari();
@@ -747,4 +748,24 @@ Boolean OAnimSeq_read_anim_data(oanimsprite* anim)
         }
     }
     return PROCESS;
-}
\ No newline at end of file
+}
+
+void OAnimSeq_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_ferrari);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_pass1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_pass2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_obj1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_obj2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_obj3);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_obj4);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_obj5);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_obj6);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_obj7);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_obj8);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_anim_flag);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OAnimSeq_end_seq);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, end_seq_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ferrari_stopped);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, seq_pos);
+}
@@ -15,31 +15,32 @@
 
 #pragma once
 
+#include "globals.h"
 #include "oanimsprite.h"
 
 
 // Man at line with start flag
-extern oanimsprite OAnimSeq_anim_flag;
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_flag;
 
 // Ferrari Animation Sequence
-extern oanimsprite OAnimSeq_anim_ferrari;               // 1
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_ferrari;               // 1
 
 // Passenger Animation Sequences
-extern oanimsprite OAnimSeq_anim_pass1;                 // 2
-extern oanimsprite OAnimSeq_anim_pass2;                 // 3
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_pass1;                 // 2
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_pass2;                 // 3
 
 // End Sequence Stuff
-extern oanimsprite OAnimSeq_anim_obj1;                  // 4
-extern oanimsprite OAnimSeq_anim_obj2;                  // 5
-extern oanimsprite OAnimSeq_anim_obj3;                  // 6
-extern oanimsprite OAnimSeq_anim_obj4;                  // 7
-extern oanimsprite OAnimSeq_anim_obj5;                  // 8
-extern oanimsprite OAnimSeq_anim_obj6;                  // 9
-extern oanimsprite OAnimSeq_anim_obj7;                  // 10
-extern oanimsprite OAnimSeq_anim_obj8;                  // 10
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj1;                  // 4
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj2;                  // 5
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj3;                  // 6
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj4;                  // 7
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj5;                  // 8
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj6;                  // 9
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj7;                  // 10
+extern ENGINE_LOCAL oanimsprite OAnimSeq_anim_obj8;                  // 10
 
 // End sequence to display (0-4)
-extern uint8_t OAnimSeq_end_seq;
+extern ENGINE_LOCAL uint8_t OAnimSeq_end_seq;
 
 
 //void init(oentry*, oentry*, oentry*, oentry*);
@@ -49,4 +50,5 @@ void OAnimSeq_ferrari_seq();
 void OAnimSeq_anim_seq_intro(oanimsprite*);
 void OAnimSeq_init_end_seq();
 void OAnimSeq_tick_end_seq();
+void OAnimSeq_register_state();
 
@@ -45,9 +45,10 @@
 #include "engine/oinputs.h"
 #include "engine/ostats.h"
 #include "engine/otraffic.h"
+#include "savestate.h"
 
 
-int8_t last_stage;
+ENGINE_LOCAL int8_t last_stage;
 void OAttractAI_check_road();
 void OAttractAI_set_steering();
 
@@ -453,4 +454,9 @@ void OAttractAI_set_steering_bonus()
 
         OInputs_steering_adjust = steering;
     }
-}
\ No newline at end of file
+}
+
+void OAttractAI_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, last_stage);
+}
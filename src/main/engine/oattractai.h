@@ -46,4 +46,5 @@ void OAttractAI_tick_ai_enhanced();
 void OAttractAI_tick_ai();
 void OAttractAI_check_road_bonus();
 void OAttractAI_set_steering_bonus();
+void OAttractAI_register_state();
 
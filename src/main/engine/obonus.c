@@ -11,11 +11,12 @@
 #include "engine/ohud.h"
 #include "engine/outils.h"
 #include "engine/obonus.h"
+#include "savestate.h"
 
 
-int8_t OBonus_bonus_control;
-int8_t OBonus_bonus_state;
-int16_t OBonus_bonus_timer;
+ENGINE_LOCAL int8_t OBonus_bonus_control;
+ENGINE_LOCAL int8_t OBonus_bonus_state;
+ENGINE_LOCAL int16_t OBonus_bonus_timer;
 
 
 // Bonus seconds (for seconds countdown at bonus stage)
@@ -23,10 +24,10 @@ int16_t OBonus_bonus_timer;
 // Stored as hex, but should be converted to decimal for true value.
 //
 // So 0x314 would be 78.8 seconds
-int16_t bonus_secs;
+ENGINE_LOCAL int16_t bonus_secs;
 
 // Timing counter used in bonus code logic
-int16_t bonus_counter;
+ENGINE_LOCAL int16_t bonus_counter;
 
 void OBonus_init_bonus_text();
 void OBonus_blit_bonus_secs();
@@ -204,3 +205,12 @@ void OBonus_blit_bonus_secs()
     // Blit Digit 3
     OHud_blit_large_digit(&text_addr, d3);
 }
+
+void OBonus_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OBonus_bonus_control);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OBonus_bonus_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OBonus_bonus_timer);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, bonus_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, bonus_secs);
+}
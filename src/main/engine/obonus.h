@@ -13,7 +13,7 @@
 
 
 // Bonus Control    
-extern int8_t OBonus_bonus_control;
+extern ENGINE_LOCAL int8_t OBonus_bonus_control;
 enum
 {
     BONUS_DISABLE = 0x0,    // 0  = Bonus Mode Disabled
@@ -32,7 +32,7 @@ enum
 // 1 = Decrement Bonus Seconds
 // 2 = Clear Bonus Text
 // 3 = Do Not Execute Bonus Text Block
-extern int8_t OBonus_bonus_state;
+extern ENGINE_LOCAL int8_t OBonus_bonus_state;
 enum
 {
     BONUS_TEXT_INIT = 0,
@@ -42,11 +42,12 @@ enum
 };
 
 // Timer used by bonus mode logic (Added from Rev. A onwards)
-extern int16_t OBonus_bonus_timer;
+extern ENGINE_LOCAL int16_t OBonus_bonus_timer;
 
 void OBonus_init();
 
 void OBonus_do_bonus_text();
+void OBonus_register_state();
 
 
 
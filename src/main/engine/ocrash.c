@@ -26,24 +26,25 @@
 #include "engine/olevelobjs.h"
 #include "engine/outils.h"
 #include "engine/ocrash.h"
-
-
-oentry* OCrash_spr_ferrari;
-oentry* OCrash_spr_shadow;
-oentry* OCrash_spr_pass1;
-oentry* OCrash_spr_pass1s;
-oentry* OCrash_spr_pass2;
-oentry* OCrash_spr_pass2s;
-int8_t OCrash_crash_state;
-int16_t OCrash_skid_counter;
-int16_t OCrash_skid_counter_bak;
-uint8_t OCrash_spin_control1;
-uint8_t OCrash_spin_control2;
-int16_t OCrash_coll_count1;
-int16_t OCrash_coll_count2;
-int16_t OCrash_crash_counter;
-int16_t OCrash_crash_spin_count;
-int16_t OCrash_crash_z;
+#include "savestate.h"
+
+
+ENGINE_LOCAL oentry* OCrash_spr_ferrari;
+ENGINE_LOCAL oentry* OCrash_spr_shadow;
+ENGINE_LOCAL oentry* OCrash_spr_pass1;
+ENGINE_LOCAL oentry* OCrash_spr_pass1s;
+ENGINE_LOCAL oentry* OCrash_spr_pass2;
+ENGINE_LOCAL oentry* OCrash_spr_pass2s;
+ENGINE_LOCAL int8_t OCrash_crash_state;
+ENGINE_LOCAL int16_t OCrash_skid_counter;
+ENGINE_LOCAL int16_t OCrash_skid_counter_bak;
+ENGINE_LOCAL uint8_t OCrash_spin_control1;
+ENGINE_LOCAL uint8_t OCrash_spin_control2;
+ENGINE_LOCAL int16_t OCrash_coll_count1;
+ENGINE_LOCAL int16_t OCrash_coll_count2;
+ENGINE_LOCAL int16_t OCrash_crash_counter;
+ENGINE_LOCAL int16_t OCrash_crash_spin_count;
+ENGINE_LOCAL int16_t OCrash_crash_z;
 
 
 // This is the rolled Ferrari sprite, which is configured differently for
@@ -51,41 +52,41 @@ int16_t OCrash_crash_z;
 // The offsets indicate the original offsets in memory.
 
 //+1E [Word] Spins/Flips Remaining
-int16_t spinflipcount1;
+ENGINE_LOCAL int16_t spinflipcount1;
 //+22 [Word] Crash Spin/Flip Count Copy
-int16_t spinflipcount2;
+ENGINE_LOCAL int16_t spinflipcount2;
 //+24 [Word] Crash Slide Value (After Spin/Flip etc.)
-int16_t slide;
+ENGINE_LOCAL int16_t slide;
 //+26 [Word] Frame (actually an index into the Sprite format below)
-int16_t frame;
+ENGINE_LOCAL int16_t frame;
 //+28 [Long] Address of animation sequence (frame address, palette info etc.)
-uint32_t addr;
+ENGINE_LOCAL uint32_t addr;
 //+2C [Word] Camera Pan X Target (for repositioning after crash)
-int16_t camera_x_target;
+ENGINE_LOCAL int16_t camera_x_target;
 //+2E [Word] Camera Pan Increment
-int16_t camera_xinc;
+ENGINE_LOCAL int16_t camera_xinc;
 //+30 [Word] Index into movement lookup table (to set y position of car during low speed bump)
-int16_t lookup_index;
+ENGINE_LOCAL int16_t lookup_index;
 //+32 [Word] Frame to restore car to after bump routine
-int16_t frame_restore;
+ENGINE_LOCAL int16_t frame_restore;
 //+34 [Word] Used as a shift value to change y position during shunt
-int16_t shift;
+ENGINE_LOCAL int16_t shift;
 //+36 [Word] Flip Only: 0 = Fast Crash. 1 = Slow Crash.
-int16_t crash_speed;
+ENGINE_LOCAL int16_t crash_speed;
 //+38 [Word] Crash Z Increment (How much to change Crash Z Per Tick)
-int16_t OCrash_crash_zinc;
+ENGINE_LOCAL int16_t OCrash_crash_zinc;
 //+3A [Word] 0 = RHS, 1 = LHS?
-int16_t crash_side;
+ENGINE_LOCAL int16_t crash_side;
 
 // Passenger Frame to use during spin
-int16_t spin_pass_frame;
+ENGINE_LOCAL int16_t spin_pass_frame;
 
-int8_t crash_type;
+ENGINE_LOCAL int8_t crash_type;
 enum { CRASH_BUMP = 0, CRASH_SPIN = 1, CRASH_FLIP = 2 };
 
 // Delay counter after crash. 
 // Show animation (e.g. girl pointing finger, before car is repositioned)
-int16_t crash_delay;
+ENGINE_LOCAL int16_t crash_delay;
 
 void OCrash_do_crash();
 void OCrash_spin_switch(const uint16_t);
@@ -113,8 +114,8 @@ void OCrash_done(oentry*);
 void OCrash_do_shadow(oentry*, oentry*);
 
 // Pointers to functions for crash code
-void (*OCrash_function_pass1)(oentry*);
-void (*OCrash_function_pass2)(oentry*);
+ENGINE_LOCAL void (*OCrash_function_pass1)(oentry*);
+ENGINE_LOCAL void (*OCrash_function_pass2)(oentry*);
 
 void OCrash_do_crash_passengers(oentry*);
 void OCrash_flip_start(oentry*);
@@ -1541,4 +1542,42 @@ void OCrash_pass_turnhead(oentry* sprite)
     }
 
     OCrash_done(sprite);
-}
\ No newline at end of file
+}
+
+void OCrash_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_coll_count1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_coll_count2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_crash_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_crash_spin_count);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_crash_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_crash_z);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_crash_zinc);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_function_pass1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_function_pass2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_skid_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_skid_counter_bak);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_spin_control1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_spin_control2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_spr_ferrari);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_spr_pass1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_spr_pass1s);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_spr_pass2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_spr_pass2s);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OCrash_spr_shadow);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, addr);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, camera_x_target);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, camera_xinc);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, crash_delay);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, crash_side);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, crash_speed);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, crash_type);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, frame);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, frame_restore);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, lookup_index);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, shift);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, slide);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, spin_pass_frame);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, spinflipcount1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, spinflipcount2);
+}
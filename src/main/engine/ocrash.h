@@ -27,12 +27,12 @@
 
 
 // Reference to sprite used by crash code
-extern oentry* OCrash_spr_ferrari;
-extern oentry* OCrash_spr_shadow;
-extern oentry* OCrash_spr_pass1;
-extern oentry* OCrash_spr_pass1s;
-extern oentry* OCrash_spr_pass2;
-extern oentry* OCrash_spr_pass2s;
+extern ENGINE_LOCAL oentry* OCrash_spr_ferrari;
+extern ENGINE_LOCAL oentry* OCrash_spr_shadow;
+extern ENGINE_LOCAL oentry* OCrash_spr_pass1;
+extern ENGINE_LOCAL oentry* OCrash_spr_pass1s;
+extern ENGINE_LOCAL oentry* OCrash_spr_pass2;
+extern ENGINE_LOCAL oentry* OCrash_spr_pass2s;
 
 // Default value to reset skid counter to on collision
 const static uint8_t SKID_RESET = 0x14;
@@ -56,23 +56,23 @@ const static uint8_t SKID_X_ADJ = 0x18;
 // 7 = Camera Repositioned. Ready For Restart
 //
 // (Note that hitting another vehicle and skidding does not affect the crash state)
-extern int8_t OCrash_crash_state;
+extern ENGINE_LOCAL int8_t OCrash_crash_state;
 
 // Skid Counter. Set On Collision With Another Vehicle Only.
 //
 // If positive, skid to the left.
 // If negative, skid to the right.
-extern int16_t OCrash_skid_counter;
-extern int16_t OCrash_skid_counter_bak;
+extern ENGINE_LOCAL int16_t OCrash_skid_counter;
+extern ENGINE_LOCAL int16_t OCrash_skid_counter_bak;
 
 // Spin Control 1 - SPIN only
 //
 // 0 = No Spin
 // 1 = Init Spin Car
 // 2 = Spin In Progress
-extern uint8_t OCrash_spin_control1;
+extern ENGINE_LOCAL uint8_t OCrash_spin_control1;
 
-extern uint8_t OCrash_spin_control2;
+extern ENGINE_LOCAL uint8_t OCrash_spin_control2;
 
 // Increments on a per collision basis (Follows on from collision_sprite being set)
 //
@@ -80,11 +80,11 @@ extern uint8_t OCrash_spin_control2;
 //
 // coll_count1 != coll_count2 = Crash Subroutines Not Enabled
 // coll_count1 == coll_count2 = Crash Subroutines Enabled
-extern int16_t OCrash_coll_count1;
-extern int16_t OCrash_coll_count2;
+extern ENGINE_LOCAL int16_t OCrash_coll_count1;
+extern ENGINE_LOCAL int16_t OCrash_coll_count2;
 
 // Counter that increments per-frame during a crash scenario
-extern int16_t OCrash_crash_counter;
+extern ENGINE_LOCAL int16_t OCrash_crash_counter;
 
 // Denotes the spin/flip number following the crash.
 //
@@ -93,10 +93,10 @@ extern int16_t OCrash_crash_counter;
 // 2 = Crash. First Spin/Flip. 
 // 3 = Crash. Second Spin/Flip.
 // 4 = Crash. Third Spin/Flip.
-extern int16_t OCrash_crash_spin_count;
+extern ENGINE_LOCAL int16_t OCrash_crash_spin_count;
 
 // Crash Sprite Z Position
-extern int16_t OCrash_crash_z;
+extern ENGINE_LOCAL int16_t OCrash_crash_z;
 
 
 void OCrash_init(oentry* f, oentry* s, oentry* p1, oentry* p1s, oentry* p2, oentry* p2s);
@@ -104,6 +104,7 @@ Boolean OCrash_is_flip();
 void OCrash_enable();
 void OCrash_clear_crash_state();
 void OCrash_tick();
+void OCrash_register_state();
 
 
 
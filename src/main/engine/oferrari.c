@@ -28,44 +28,45 @@
 #include "engine/ostats.h"
 #include "engine/outils.h"
 #include "engine/oferrari.h"
-
-
-oentry *OFerrari_spr_ferrari;
-oentry *OFerrari_spr_pass1;
-oentry *OFerrari_spr_pass2;
-oentry *OFerrari_spr_shadow;
-uint8_t OFerrari_state; 
-uint16_t OFerrari_counter;
-int16_t OFerrari_steering_old;
-Boolean OFerrari_car_ctrl_active;
-int8_t OFerrari_car_state;
-Boolean OFerrari_auto_brake;
-uint8_t OFerrari_torque_index; 
-int16_t OFerrari_torque;
-int32_t OFerrari_revs;
-uint8_t OFerrari_rev_shift;
-uint8_t OFerrari_wheel_state;
-uint8_t OFerrari_wheel_traction;
-uint16_t OFerrari_is_slipping;
-uint8_t OFerrari_slip_sound;
-uint16_t OFerrari_car_inc_old;
-int16_t OFerrari_car_x_diff;
-int16_t OFerrari_rev_stop_flag;
-int16_t OFerrari_revs_post_stop;
-int16_t OFerrari_acc_post_stop;
-uint16_t OFerrari_rev_pitch1;
-uint16_t OFerrari_rev_pitch2;
-int16_t OFerrari_sprite_ai_counter;
-int16_t OFerrari_sprite_ai_curve;
-int16_t OFerrari_sprite_ai_x;
-int16_t OFerrari_sprite_ai_steer;
-int16_t OFerrari_sprite_car_x_bak;
-int16_t OFerrari_sprite_wheel_state;
-int16_t OFerrari_sprite_slip_copy;
-int8_t OFerrari_wheel_pal;
-int16_t OFerrari_sprite_pass_y;
-int16_t OFerrari_wheel_frame_reset;
-int16_t OFerrari_wheel_counter;
+#include "savestate.h"
+
+
+ENGINE_LOCAL oentry *OFerrari_spr_ferrari;
+ENGINE_LOCAL oentry *OFerrari_spr_pass1;
+ENGINE_LOCAL oentry *OFerrari_spr_pass2;
+ENGINE_LOCAL oentry *OFerrari_spr_shadow;
+ENGINE_LOCAL uint8_t OFerrari_state; 
+ENGINE_LOCAL uint16_t OFerrari_counter;
+ENGINE_LOCAL int16_t OFerrari_steering_old;
+ENGINE_LOCAL Boolean OFerrari_car_ctrl_active;
+ENGINE_LOCAL int8_t OFerrari_car_state;
+ENGINE_LOCAL Boolean OFerrari_auto_brake;
+ENGINE_LOCAL uint8_t OFerrari_torque_index; 
+ENGINE_LOCAL int16_t OFerrari_torque;
+ENGINE_LOCAL int32_t OFerrari_revs;
+ENGINE_LOCAL uint8_t OFerrari_rev_shift;
+ENGINE_LOCAL uint8_t OFerrari_wheel_state;
+ENGINE_LOCAL uint8_t OFerrari_wheel_traction;
+ENGINE_LOCAL uint16_t OFerrari_is_slipping;
+ENGINE_LOCAL uint8_t OFerrari_slip_sound;
+ENGINE_LOCAL uint16_t OFerrari_car_inc_old;
+ENGINE_LOCAL int16_t OFerrari_car_x_diff;
+ENGINE_LOCAL int16_t OFerrari_rev_stop_flag;
+ENGINE_LOCAL int16_t OFerrari_revs_post_stop;
+ENGINE_LOCAL int16_t OFerrari_acc_post_stop;
+ENGINE_LOCAL uint16_t OFerrari_rev_pitch1;
+ENGINE_LOCAL uint16_t OFerrari_rev_pitch2;
+ENGINE_LOCAL int16_t OFerrari_sprite_ai_counter;
+ENGINE_LOCAL int16_t OFerrari_sprite_ai_curve;
+ENGINE_LOCAL int16_t OFerrari_sprite_ai_x;
+ENGINE_LOCAL int16_t OFerrari_sprite_ai_steer;
+ENGINE_LOCAL int16_t OFerrari_sprite_car_x_bak;
+ENGINE_LOCAL int16_t OFerrari_sprite_wheel_state;
+ENGINE_LOCAL int16_t OFerrari_sprite_slip_copy;
+ENGINE_LOCAL int8_t OFerrari_wheel_pal;
+ENGINE_LOCAL int16_t OFerrari_sprite_pass_y;
+ENGINE_LOCAL int16_t OFerrari_wheel_frame_reset;
+ENGINE_LOCAL int16_t OFerrari_wheel_counter;
 
 
 
@@ -79,50 +80,50 @@ const static uint32_t CAR_BASE_INC = 0x12F;
 const static uint16_t OFFROAD_BOUNDS = 0x1F4;
 
 // Used by set_car_x
-int16_t road_width_old;
+ENGINE_LOCAL int16_t road_width_old;
 
 // -------------------------------------------------------------------------
 // Controls
 // -------------------------------------------------------------------------
     
-int16_t accel_value;
-int16_t accel_value_bak;
-int16_t brake_value;
-Boolean gear_value;
-Boolean gear_bak;
+ENGINE_LOCAL int16_t accel_value;
+ENGINE_LOCAL int16_t accel_value_bak;
+ENGINE_LOCAL int16_t brake_value;
+ENGINE_LOCAL Boolean gear_value;
+ENGINE_LOCAL Boolean gear_bak;
 
 // Trickle down adjusted acceleration values
-int16_t acc_adjust1;
-int16_t acc_adjust2;
-int16_t acc_adjust3;
+ENGINE_LOCAL int16_t acc_adjust1;
+ENGINE_LOCAL int16_t acc_adjust2;
+ENGINE_LOCAL int16_t acc_adjust3;
 
 // Trickle down brake values
-int16_t brake_adjust1;
-int16_t brake_adjust2;
-int16_t brake_adjust3;
+ENGINE_LOCAL int16_t brake_adjust1;
+ENGINE_LOCAL int16_t brake_adjust2;
+ENGINE_LOCAL int16_t brake_adjust3;
 
 // Calculated brake value to subtract from acc_burst.
-int32_t brake_subtract;
+ENGINE_LOCAL int32_t brake_subtract;
 
 // Counter. When enabled, acceleration disabled
-int8_t gear_counter;
+ENGINE_LOCAL int8_t gear_counter;
 
 // Previous rev adjustment (stored)
-int32_t rev_adjust;
+ENGINE_LOCAL int32_t rev_adjust;
     
 // -------------------------------------------------------------------------
 // Smoke
 // -------------------------------------------------------------------------
 
 // Counter for smoke after changing gear. Values over 0 result in smoke
-int16_t gear_smoke;
+ENGINE_LOCAL int16_t gear_smoke;
 
 // Similar to above
-int16_t gfx_smoke;
+ENGINE_LOCAL int16_t gfx_smoke;
 
 // Set to -1 when car sharply corners and player is steering into direction of corner
-int8_t cornering;
-int8_t cornering_old;
+ENGINE_LOCAL int8_t cornering;
+ENGINE_LOCAL int8_t cornering_old;
 
 // Rev Lookup Table. 255 Values.
 // Used to provide rev adjustment. Note that values tail off at higher speeds.
@@ -1904,3 +1905,61 @@ void OFerrari_draw_sprite(oentry* sprite)
     }
 }
 
+void OFerrari_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_acc_post_stop);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_auto_brake);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_car_ctrl_active);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_car_inc_old);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_car_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_car_x_diff);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_is_slipping);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_rev_pitch1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_rev_pitch2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_rev_shift);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_rev_stop_flag);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_revs);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_revs_post_stop);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_slip_sound);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_spr_ferrari);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_spr_pass1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_spr_pass2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_spr_shadow);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_sprite_ai_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_sprite_ai_curve);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_sprite_ai_steer);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_sprite_ai_x);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_sprite_car_x_bak);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_sprite_pass_y);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_sprite_slip_copy);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_sprite_wheel_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_steering_old);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_torque);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_torque_index);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_wheel_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_wheel_frame_reset);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_wheel_pal);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_wheel_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OFerrari_wheel_traction);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, acc_adjust1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, acc_adjust2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, acc_adjust3);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, accel_value);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, accel_value_bak);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, brake_adjust1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, brake_adjust2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, brake_adjust3);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, brake_subtract);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, brake_value);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, cornering);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, cornering_old);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, gear_bak);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, gear_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, gear_smoke);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, gear_value);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, gfx_smoke);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, rev_adjust);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, road_width_old);
+}
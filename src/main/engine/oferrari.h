@@ -23,16 +23,16 @@
 
 
 // Ferrari Sprite Object
-extern oentry *OFerrari_spr_ferrari;
+extern ENGINE_LOCAL oentry *OFerrari_spr_ferrari;
 
 // Passenger 1 Sprite Object
-extern oentry *OFerrari_spr_pass1;
+extern ENGINE_LOCAL oentry *OFerrari_spr_pass1;
 
 // Passenger 2 Sprite Object
-extern oentry *OFerrari_spr_pass2;
+extern ENGINE_LOCAL oentry *OFerrari_spr_pass2;
 
 // Ferrari Shadow Sprite Object
-extern oentry *OFerrari_spr_shadow;
+extern ENGINE_LOCAL oentry *OFerrari_spr_shadow;
 
 // -------------------------------------------------------------------------
 // Main Switch Variables
@@ -57,25 +57,25 @@ enum
 };
 
 // Which routine is in use
-extern uint8_t OFerrari_state; 
+extern ENGINE_LOCAL uint8_t OFerrari_state; 
 
 // Unused counter. Implemented on original game so could be useful for debug.
-extern uint16_t OFerrari_counter;
+extern ENGINE_LOCAL uint16_t OFerrari_counter;
 
-extern int16_t OFerrari_steering_old;
-extern Boolean OFerrari_car_ctrl_active;
+extern ENGINE_LOCAL int16_t OFerrari_steering_old;
+extern ENGINE_LOCAL Boolean OFerrari_car_ctrl_active;
     
 // Car State
 //
 // -1 = Animation Sequence (Crash / Drive In)
 // 0  = Normal
 // 1  = Smoke from wheels
-extern int8_t OFerrari_car_state;
+extern ENGINE_LOCAL int8_t OFerrari_car_state;
 
 enum { CAR_ANIM_SEQ = -1, CAR_NORMAL = 0, CAR_SMOKE = 1};
 
 // Auto breaking for end sequence
-extern Boolean OFerrari_auto_brake;
+extern ENGINE_LOCAL Boolean OFerrari_auto_brake;
 
 // Torque table index lookup
 //
@@ -86,13 +86,13 @@ extern Boolean OFerrari_auto_brake;
 // Increments between the values
 //
 // Gets set based on what gear we're in 
-extern uint8_t OFerrari_torque_index; 
-extern int16_t OFerrari_torque;
-extern int32_t OFerrari_revs;
+extern ENGINE_LOCAL uint8_t OFerrari_torque_index; 
+extern ENGINE_LOCAL int16_t OFerrari_torque;
+extern ENGINE_LOCAL int32_t OFerrari_revs;
 
 // Rev Shift Value. Normal = 1.
 // Higher values result in reaching higher revs faster!
-extern uint8_t OFerrari_rev_shift;
+extern ENGINE_LOCAL uint8_t OFerrari_rev_shift;
 
 // State of car wheels
 //
@@ -100,7 +100,7 @@ extern uint8_t OFerrari_rev_shift;
 // 1 = Left Wheel Off-Road
 // 2 = Right Wheel Off-Road
 // 3 = Both Wheels Off-Road
-extern uint8_t OFerrari_wheel_state;
+extern ENGINE_LOCAL uint8_t OFerrari_wheel_state;
 
 enum
 {
@@ -115,7 +115,7 @@ enum
 // 0 = Both Wheels Have Traction
 // 1 = One Wheel Has Traction
 // 2 = No Wheels Have Traction
-extern uint8_t OFerrari_wheel_traction;
+extern ENGINE_LOCAL uint8_t OFerrari_wheel_traction;
 
 enum
 {
@@ -125,16 +125,16 @@ enum
 };
 
 // Ferrari is slipping/skidding either after collision or round bend
-extern uint16_t OFerrari_is_slipping;
+extern ENGINE_LOCAL uint16_t OFerrari_is_slipping;
 
 // Slip Command Sent To Sound Hardware
-extern uint8_t OFerrari_slip_sound;
+extern ENGINE_LOCAL uint8_t OFerrari_slip_sound;
 
 // Stores previous value of car_increment
-extern uint16_t OFerrari_car_inc_old;
+extern ENGINE_LOCAL uint16_t OFerrari_car_inc_old;
 
 // Difference between car_x_pos and car_x_old
-extern int16_t OFerrari_car_x_diff;
+extern ENGINE_LOCAL int16_t OFerrari_car_x_diff;
 
 // -------------------------------------------------------------------------
 // Engine Stop Flag
@@ -142,59 +142,59 @@ extern int16_t OFerrari_car_x_diff;
 
 // Flag set when switching back to in-game engine, to be used with revs_post_stop
 // This is used to adjust the rev boost when returning to game
-extern int16_t OFerrari_rev_stop_flag;
+extern ENGINE_LOCAL int16_t OFerrari_rev_stop_flag;
 
 // Rev boost when we switch back to ingame engine and hand user control. 
 // Set by user being on revs before initialization.
-extern int16_t OFerrari_revs_post_stop;
+extern ENGINE_LOCAL int16_t OFerrari_revs_post_stop;
 
-extern int16_t OFerrari_acc_post_stop;
+extern ENGINE_LOCAL int16_t OFerrari_acc_post_stop;
 
 // -------------------------------------------------------------------------
 // Engine Sounds. Probably needs to be moved
 // -------------------------------------------------------------------------
 
 // Sound: Adjusted rev value (to be used to set pitch sound fx)
-extern uint16_t OFerrari_rev_pitch1;
+extern ENGINE_LOCAL uint16_t OFerrari_rev_pitch1;
 
-extern uint16_t OFerrari_rev_pitch2;
+extern ENGINE_LOCAL uint16_t OFerrari_rev_pitch2;
 
 // -------------------------------------------------------------------------
 // Ferrari Specific Values
 // -------------------------------------------------------------------------
 
 // *22 [Word] AI Curve Counter. Increments During Curve. Resets On Straight.
-extern int16_t OFerrari_sprite_ai_counter;
+extern ENGINE_LOCAL int16_t OFerrari_sprite_ai_counter;
 
 // *24 [Word] AI Curve Value. 0x96 - curve_next.
-extern int16_t OFerrari_sprite_ai_curve;
+extern ENGINE_LOCAL int16_t OFerrari_sprite_ai_curve;
 
 // *26 [Word] AI X Position Adjustment
-extern int16_t OFerrari_sprite_ai_x;
+extern ENGINE_LOCAL int16_t OFerrari_sprite_ai_x;
 
 // *28 [Word] AI Steering Adjustment
-extern int16_t OFerrari_sprite_ai_steer;
+extern ENGINE_LOCAL int16_t OFerrari_sprite_ai_steer;
     
 // *2A [Word] Car X Position Backup
-extern int16_t OFerrari_sprite_car_x_bak;
+extern ENGINE_LOCAL int16_t OFerrari_sprite_car_x_bak;
 
 // *2C [Word] Wheel State
-extern int16_t OFerrari_sprite_wheel_state;
+extern ENGINE_LOCAL int16_t OFerrari_sprite_wheel_state;
 
 // *2E [Word] Ferrari Slipping (Copy of slip counter)
-extern int16_t OFerrari_sprite_slip_copy;
+extern ENGINE_LOCAL int16_t OFerrari_sprite_slip_copy;
 
 // *39 [Byte] Wheel Palette Offset
-extern int8_t OFerrari_wheel_pal;
+extern ENGINE_LOCAL int8_t OFerrari_wheel_pal;
 
 // *3A [Word] Passenger Y Offset
-extern int16_t OFerrari_sprite_pass_y;
+extern ENGINE_LOCAL int16_t OFerrari_sprite_pass_y;
 
 // *3C [Word] Wheel Frame Counter Reset
-extern int16_t OFerrari_wheel_frame_reset;
+extern ENGINE_LOCAL int16_t OFerrari_wheel_frame_reset;
 
 // *3E [Word] Wheel Frame Counter Reset
-extern int16_t OFerrari_wheel_counter;
+extern ENGINE_LOCAL int16_t OFerrari_wheel_counter;
 
 
 void OFerrari_init(oentry*, oentry*, oentry*, oentry*);
@@ -210,5 +210,6 @@ void OFerrari_move();
 void OFerrari_do_sound_score_slip();
 void OFerrari_shake();
 void OFerrari_do_skid();
+void OFerrari_register_state();
     
 
@@ -14,44 +14,46 @@
 #include "engine/ostats.h"
 #include "engine/outils.h"
 #include "engine/ohiscore.h"
+#include "engine/outrun.h"
+#include "savestate.h"
 
-score_entry OHiScore_scores[HISCORE_NUM_SCORES];
+ENGINE_LOCAL score_entry OHiScore_scores[HISCORE_NUM_SCORES];
 
 
 const static uint16_t TILE_PROPS = 0x8030;
 
 // +C : Best OutRunners State
-uint8_t best_or_state;
+ENGINE_LOCAL uint8_t best_or_state;
 
 // +14: State of score logic
-uint8_t state;
+ENGINE_LOCAL uint8_t state;
 
 // +16: High Score Position In Table
-int8_t score_pos;
+ENGINE_LOCAL int8_t score_pos;
 
 // +17 Selected Initial (0-2)
-int8_t initial_selected;
+ENGINE_LOCAL int8_t initial_selected;
 
 // +18: Selected Letter
-int16_t letter_selected;
+ENGINE_LOCAL int16_t letter_selected;
 
 // +1A: Acceleration Value Current
-int16_t acc_curr;
+ENGINE_LOCAL int16_t acc_curr;
 
 // +1C: Acceleration Value Previous
-int16_t acc_prev;
+ENGINE_LOCAL int16_t acc_prev;
 
 // +1E: Steering Value
-int16_t steer;
+ENGINE_LOCAL int16_t steer;
 
 // +22: Flashing counter
-uint8_t flash;
+ENGINE_LOCAL uint8_t flash;
 
 // +24: Total number of minicars that have reached destination
-int8_t dest_total;
+ENGINE_LOCAL int8_t dest_total;
 
 // +26: High Score Table Display Position
-int8_t score_display_pos;
+ENGINE_LOCAL int8_t score_display_pos;
 
 enum
 {
@@ -76,7 +78,7 @@ typedef struct
 #define NO_MINICARS 7
 
 // 20 Score Entries
-minicar_entry minicars[NO_MINICARS];
+ENGINE_LOCAL minicar_entry minicars[NO_MINICARS];
 
 // Stores Laptime conversion
 // +0: Minutes Digit 1
@@ -85,7 +87,7 @@ minicar_entry minicars[NO_MINICARS];
 // +3: Seconds Digit 2
 // +4: Milliseconds Digit 1
 // +5: Milliseconds Digit 2
-uint16_t laptime[6];
+ENGINE_LOCAL uint16_t laptime[6];
 
 void OHiScore_get_score_pos();
 void OHiScore_insert_score();
@@ -341,8 +343,8 @@ void OHiScore_check_name_entry()
         // Input from controls
         OHiScore_do_input(score_adr);
         
-        // Save new score info
-        if (state == STATE_DONE)
+        // Save new score info. Batch instances share the score file, so never write it.
+        if (state == STATE_DONE && !Outrun_batch_instance)
             Config_save_scores(getScoresFilename());
     }
 }
@@ -898,3 +900,21 @@ void OHiScore_convert_lap_time(uint16_t time)
     laptime[1] = (minutes & 0xF) | TILE_PROPS;
     laptime[0] = ((minutes & 0xF0) >> 4) | TILE_PROPS;
 }
+
+void OHiScore_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OHiScore_scores);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, acc_curr);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, acc_prev);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, best_or_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, dest_total);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, flash);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, initial_selected);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, laptime);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, letter_selected);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, minicars);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, score_display_pos);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, score_pos);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, steer);
+}
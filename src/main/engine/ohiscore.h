@@ -24,7 +24,7 @@ typedef struct
 #define HISCORE_NUM_SCORES 20
     
 // 20 Score Entries
-extern score_entry OHiScore_scores[HISCORE_NUM_SCORES];
+extern ENGINE_LOCAL score_entry OHiScore_scores[HISCORE_NUM_SCORES];
 
 void OHiScore_init();
 void OHiScore_init_def_scores();
@@ -32,4 +32,5 @@ void OHiScore_tick();
 void OHiScore_setup_pal_best();
 void OHiScore_setup_road_best();
 void OHiScore_display_scores();
+void OHiScore_register_state();
 
@@ -29,43 +29,44 @@
 #include "engine/otiles.h"
 #include "engine/otraffic.h"
 #include "engine/oinitengine.h"
-
-
-int16_t OInitEngine_camera_x_off;
-Boolean OInitEngine_ingame_engine;
-int16_t OInitEngine_ingame_counter;
-uint16_t OInitEngine_rd_split_state;
-int16_t OInitEngine_road_type;
-int16_t OInitEngine_road_type_next;
-uint8_t OInitEngine_end_stage_props;
-uint32_t OInitEngine_car_increment; // NEEDS REPLACING. Implementing here as a quick hack so routine works
-int16_t OInitEngine_car_x_pos;
-int16_t OInitEngine_car_x_old;
-int8_t OInitEngine_checkpoint_marker;
-int16_t OInitEngine_road_curve;
-int16_t OInitEngine_road_curve_next;
-int8_t OInitEngine_road_remove_split;
-int8_t OInitEngine_route_selected;
-int16_t OInitEngine_change_width;
+#include "savestate.h"
+
+
+ENGINE_LOCAL int16_t OInitEngine_camera_x_off;
+ENGINE_LOCAL Boolean OInitEngine_ingame_engine;
+ENGINE_LOCAL int16_t OInitEngine_ingame_counter;
+ENGINE_LOCAL uint16_t OInitEngine_rd_split_state;
+ENGINE_LOCAL int16_t OInitEngine_road_type;
+ENGINE_LOCAL int16_t OInitEngine_road_type_next;
+ENGINE_LOCAL uint8_t OInitEngine_end_stage_props;
+ENGINE_LOCAL uint32_t OInitEngine_car_increment; // NEEDS REPLACING. Implementing here as a quick hack so routine works
+ENGINE_LOCAL int16_t OInitEngine_car_x_pos;
+ENGINE_LOCAL int16_t OInitEngine_car_x_old;
+ENGINE_LOCAL int8_t OInitEngine_checkpoint_marker;
+ENGINE_LOCAL int16_t OInitEngine_road_curve;
+ENGINE_LOCAL int16_t OInitEngine_road_curve_next;
+ENGINE_LOCAL int8_t OInitEngine_road_remove_split;
+ENGINE_LOCAL int8_t OInitEngine_route_selected;
+ENGINE_LOCAL int16_t OInitEngine_change_width;
 
 // Road width at merge point
 const static uint16_t RD_WIDTH_MERGE = 0xD4;
 
 // Road width of next section
-int16_t road_width_next;
+ENGINE_LOCAL int16_t road_width_next;
 
 // Speed at which adjustment to road section occurs
-int16_t road_width_adj;
+ENGINE_LOCAL int16_t road_width_adj;
 
-int16_t granular_rem;
+ENGINE_LOCAL int16_t granular_rem;
 
-uint16_t pos_fine_old;
+ENGINE_LOCAL uint16_t pos_fine_old;
 
 // Road Original Width. Used when adjustments are being made during road split, and end sequence initialisation
-int16_t road_width_orig;
+ENGINE_LOCAL int16_t road_width_orig;
 
 // Used by road merge logic, to control width of road
-int16_t road_width_merge;
+ENGINE_LOCAL int16_t road_width_merge;
     
 // ------------------------------------------------------------------------
 // Route Information
@@ -74,7 +75,7 @@ int16_t road_width_merge;
 // Used as part of road split code.
 // 0 = Route Info Not Updated
 // 1 = Route Info Updated
-int8_t route_updated;
+ENGINE_LOCAL int8_t route_updated;
     
 void OInitEngine_setup_stage1();
 void OInitEngine_check_road_split();
@@ -1061,4 +1062,31 @@ void OInitEngine_test_bonus_mode(Boolean do_bonus_check)
    // finalise_skid:
    if (!OCrash_skid_counter)
        OTraffic_collision_traffic = 0;
-}
\ No newline at end of file
+}
+
+void OInitEngine_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_camera_x_off);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_car_increment);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_car_x_old);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_car_x_pos);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_change_width);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_checkpoint_marker);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_end_stage_props);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_ingame_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_ingame_engine);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_rd_split_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_road_curve);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_road_curve_next);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_road_remove_split);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_road_type);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_road_type_next);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInitEngine_route_selected);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, granular_rem);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, pos_fine_old);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, road_width_adj);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, road_width_merge);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, road_width_next);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, road_width_orig);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, route_updated);
+}
@@ -17,13 +17,13 @@
 
 
 // Debug: Camera X Offset
-extern int16_t OInitEngine_camera_x_off;
+extern ENGINE_LOCAL int16_t OInitEngine_camera_x_off;
 
 // Is the in-game engine active?
-extern Boolean OInitEngine_ingame_engine;
+extern ENGINE_LOCAL Boolean OInitEngine_ingame_engine;
 
 // Time to wait before enabling ingame_engine after crash
-extern int16_t OInitEngine_ingame_counter;
+extern ENGINE_LOCAL int16_t OInitEngine_ingame_counter;
 
 // Road Split State
 // 0 = No Road Split
@@ -44,7 +44,7 @@ extern int16_t OInitEngine_ingame_counter;
 // F = Unused
 // 10 = Init Bonus Points Sequence
 // 11 = Bonus Points Sequence
-extern uint16_t OInitEngine_rd_split_state;
+extern ENGINE_LOCAL uint16_t OInitEngine_rd_split_state;
 enum {INITENGINE_SPLIT_NONE, INITENGINE_SPLIT_INIT, INITENGINE_SPLIT_CHOICE1, INITENGINE_SPLIT_CHOICE2};
 
 // Upcoming Road Type:
@@ -52,8 +52,8 @@ enum {INITENGINE_SPLIT_NONE, INITENGINE_SPLIT_INIT, INITENGINE_SPLIT_CHOICE1, IN
 // 1 = Straight road
 // 2 = Right Bend
 // 3 = Left Bend
-extern int16_t OInitEngine_road_type;
-extern int16_t OInitEngine_road_type_next;
+extern ENGINE_LOCAL int16_t OInitEngine_road_type;
+extern ENGINE_LOCAL int16_t OInitEngine_road_type_next;
 enum {INITENGINE_ROAD_NOCHANGE, INITENGINE_ROAD_STRAIGHT, INITENGINE_ROAD_RIGHT, INITENGINE_ROAD_LEFT};
 
 // End Of Stage Properties
@@ -62,9 +62,9 @@ enum {INITENGINE_ROAD_NOCHANGE, INITENGINE_ROAD_STRAIGHT, INITENGINE_ROAD_RIGHT,
 // Bit 1: Use Current Palette (Don't Bump To Next One)
 // Bit 2: Use Current Sky Palette For Fade (Don't Bump To Next One)
 // Bit 3: Loop back to stage 1
-extern uint8_t OInitEngine_end_stage_props;
+extern ENGINE_LOCAL uint8_t OInitEngine_end_stage_props;
 
-extern uint32_t OInitEngine_car_increment; // NEEDS REPLACING. Implementing here as a quick hack so routine works
+extern ENGINE_LOCAL uint32_t OInitEngine_car_increment; // NEEDS REPLACING. Implementing here as a quick hack so routine works
 
 // Car X Position              
 // 0000 = Centre of two road generators
@@ -73,34 +73,34 @@ extern uint32_t OInitEngine_car_increment; // NEEDS REPLACING. Implementing here
 //    
 // 0xxx [pos] = Road Generator 1 Position (0 - xxx from centre)
 // Fxxx [neg] = Road Generator 2 Position (0 + xxx from centre)
-extern int16_t OInitEngine_car_x_pos;
-extern int16_t OInitEngine_car_x_old;
+extern ENGINE_LOCAL int16_t OInitEngine_car_x_pos;
+extern ENGINE_LOCAL int16_t OInitEngine_car_x_old;
 
 // Checkpoint Marker
 
 // 0  = Checkpoint Not Past
 // -1 = Checkpoint Past
-extern int8_t OInitEngine_checkpoint_marker;
+extern ENGINE_LOCAL int8_t OInitEngine_checkpoint_marker;
 
 // Something to do with the increment / curve of the road
-extern int16_t OInitEngine_road_curve;
-extern int16_t OInitEngine_road_curve_next;
+extern ENGINE_LOCAL int16_t OInitEngine_road_curve;
+extern ENGINE_LOCAL int16_t OInitEngine_road_curve_next;
 
 // Road split logic handling to remove split
 // 0 = Normal Road Rendering
 // 1 = Road Has Split, Old Road now removed
-extern int8_t OInitEngine_road_remove_split;
+extern ENGINE_LOCAL int8_t OInitEngine_road_remove_split;
 
 // Route Selected
 // -1 = Left
 // 0  = Right
 // But confusingly, these values get swapped by a not instruction
-extern int8_t OInitEngine_route_selected;
+extern ENGINE_LOCAL int8_t OInitEngine_route_selected;
 
 // Road Width Change 
 // 0 = No
 // -1 = In Progress
-extern int16_t OInitEngine_change_width;
+extern ENGINE_LOCAL int16_t OInitEngine_change_width;
 
 void OInitEngine_init(int8_t debug_level);
 
@@ -113,4 +113,5 @@ void OInitEngine_set_granular_position();
 void OInitEngine_set_fine_position();
 
 void OInitEngine_init_bonus(int16_t); // moved here for debugging purposes
+void OInitEngine_register_state();
 
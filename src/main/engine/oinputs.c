@@ -11,22 +11,23 @@
 #include "engine/ocrash.h"
 #include "engine/oinputs.h"
 #include "engine/ostats.h"
+#include "savestate.h"
 
-int8_t OInputs_crash_input;
+ENGINE_LOCAL int8_t OInputs_crash_input;
 
 // Acceleration Input
-int16_t OInputs_input_acc;
+ENGINE_LOCAL int16_t OInputs_input_acc;
 
 // Steering Input
-int16_t OInputs_input_steering;
+ENGINE_LOCAL int16_t OInputs_input_steering;
 
 // Processed / Adjusted Values
-int16_t OInputs_steering_adjust;
-int16_t OInputs_acc_adjust;
-int16_t OInputs_brake_adjust;
+ENGINE_LOCAL int16_t OInputs_steering_adjust;
+ENGINE_LOCAL int16_t OInputs_acc_adjust;
+ENGINE_LOCAL int16_t OInputs_brake_adjust;
     
 // True = High Gear. False = Low Gear.
-Boolean OInputs_gear;
+ENGINE_LOCAL Boolean OInputs_gear;
 
 
 
@@ -35,19 +36,19 @@ Boolean OInputs_gear;
 // ------------------------------------------------------------------------
 
 // Amount to adjust steering per tick. (0x3 is a good test value)
-uint8_t steering_inc;
+ENGINE_LOCAL uint8_t steering_inc;
 
 // Amount to adjust acceleration per tick. (0x10 is a good test value)
-uint8_t acc_inc;
+ENGINE_LOCAL uint8_t acc_inc;
 
 // Amount to adjust brake per tick. (0x10 is a good test value)
-uint8_t brake_inc;
+ENGINE_LOCAL uint8_t brake_inc;
 
 static const int DELAY_RESET = 60;
-int delay1, delay2, delay3;
+ENGINE_LOCAL int delay1, delay2, delay3;
 
 // Coin Inputs (Only used by CannonBoard)
-Boolean coin1, coin2;
+ENGINE_LOCAL Boolean coin1, coin2;
 
 // ------------------------------------------------------------------------
 // Variables from original code
@@ -58,14 +59,14 @@ const static uint8_t STEERING_MAX = 0xB8;
 const static uint8_t STEERING_CENTRE = 0x80;
     
 // Current steering value
-int16_t steering_old;
-int16_t steering_change;
+ENGINE_LOCAL int16_t steering_old;
+ENGINE_LOCAL int16_t steering_change;
 
 const static uint8_t PEDAL_MIN = 0x30;
 const static uint8_t PEDAL_MAX = 0x90;
 
 // Brake Input
-int16_t input_brake;
+ENGINE_LOCAL int16_t input_brake;
 
 void OInputs_digital_steering();
 void OInputs_digital_pedals();
@@ -400,4 +401,26 @@ Boolean OInputs_is_analog_select()
     else
         delay3 = DELAY_RESET;
     return FALSE;
-}
\ No newline at end of file
+}
+
+void OInputs_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInputs_acc_adjust);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInputs_brake_adjust);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInputs_crash_input);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInputs_gear);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInputs_input_acc);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInputs_input_steering);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OInputs_steering_adjust);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, acc_inc);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, brake_inc);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, coin1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, coin2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, delay1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, delay2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, delay3);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, input_brake);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, steering_change);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, steering_inc);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, steering_old);
+}
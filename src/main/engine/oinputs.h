@@ -18,21 +18,21 @@ const static uint8_t INPUTS_BRAKE_THRESHOLD2 = 0xA0;
 const static uint8_t INPUTS_BRAKE_THRESHOLD3 = 0xC0;
 const static uint8_t INPUTS_BRAKE_THRESHOLD4 = 0xE0;
 
-extern int8_t OInputs_crash_input;
+extern ENGINE_LOCAL int8_t OInputs_crash_input;
 
 // Acceleration Input
-extern int16_t OInputs_input_acc;
+extern ENGINE_LOCAL int16_t OInputs_input_acc;
 
 // Steering Input
-extern int16_t OInputs_input_steering;
+extern ENGINE_LOCAL int16_t OInputs_input_steering;
 
 // Processed / Adjusted Values
-extern int16_t OInputs_steering_adjust;
-extern int16_t OInputs_acc_adjust;
-extern int16_t OInputs_brake_adjust;
+extern ENGINE_LOCAL int16_t OInputs_steering_adjust;
+extern ENGINE_LOCAL int16_t OInputs_acc_adjust;
+extern ENGINE_LOCAL int16_t OInputs_brake_adjust;
     
 // True = High Gear. False = Low Gear.
-extern Boolean OInputs_gear;
+extern ENGINE_LOCAL Boolean OInputs_gear;
 
 void OInputs_init();
 void OInputs_tick(Packet* packet);
@@ -43,4 +43,5 @@ uint8_t OInputs_do_credits();
 Boolean OInputs_is_analog_l();
 Boolean OInputs_is_analog_r();
 Boolean OInputs_is_analog_select();
+void OInputs_register_state();
 
@@ -18,12 +18,13 @@
 #include "engine/outils.h"
 #include "engine/olevelobjs.h"
 #include "engine/ostats.h"
+#include "savestate.h"
 
 
-uint16_t OLevelObjs_spray_counter;
-uint16_t OLevelObjs_spray_type;
-uint8_t OLevelObjs_collision_sprite;
-int16_t OLevelObjs_sprite_collision_counter;
+ENGINE_LOCAL uint16_t OLevelObjs_spray_counter;
+ENGINE_LOCAL uint16_t OLevelObjs_spray_type;
+ENGINE_LOCAL uint8_t OLevelObjs_collision_sprite;
+ENGINE_LOCAL int16_t OLevelObjs_sprite_collision_counter;
 
 
 // Default sprite entries for stage 1 initialization
@@ -140,6 +141,9 @@ void OLevelObjs_init_entries(uint32_t a4, const uint8_t start_index, const uint8
 
         OSprites_map_palette(sprite);    
     }
+
+    // Control bits were loaded from ROM
+    OSprites_sync_active();
 }
 
 // Setup Sprites
@@ -149,14 +153,21 @@ void OLevelObjs_init_entries(uint32_t a4, const uint8_t start_index, const uint8
 // Input: Default Zoom Value
 void OLevelObjs_setup_sprites(uint32_t z)
 {
-    uint8_t i;
+    uint8_t w, i;
     // Setup entries that have not yet been enabled
-    for (i = 0; i < OSprites_no_sprites; i++)
+    for (w = 0; w < SPRITE_ACTIVE_WORDS; w++)
     {
-        if ((OSprites_jump_table[i].control & SPRITES_ENABLE) == 0)
+        // Skip words with every entry enabled
+        if (OSprites_active[w] == 0xFFFFFFFFu)
+            continue;
+
+        for (i = w << 5; i < OSprites_no_sprites && i < (w + 1) << 5; i++)
         {
-            OLevelObjs_setup_sprite(&OSprites_jump_table[i], z);
-            return;
+            if ((OSprites_jump_table[i].control & SPRITES_ENABLE) == 0)
+            {
+                OLevelObjs_setup_sprite(&OSprites_jump_table[i], z);
+                return;
+            }
         }
     }
     //std::cout << "Need another entry" << std::endl;
@@ -182,7 +193,7 @@ void OLevelObjs_setup_sprite(oentry* sprite, uint32_t z)
     #define READ16(x) TrackLoader_read16(TrackLoader_scenerymap_data, x)
     #define READ32(x) TrackLoader_read32(TrackLoader_scenerymap_data, x)
 
-    sprite->control |= SPRITES_ENABLE; // Turn sprite on
+    OSprites_enable(sprite); // Turn sprite on
     uint32_t addr = OSprites_seg_spr_addr + OSprites_seg_spr_offset1;
 
     // Set sprite x,y (world coordinates)
@@ -312,8 +323,9 @@ void OLevelObjs_setup_sprite_routine(oentry* sprite)
 
 void OLevelObjs_do_sprite_routine()
 {
-    uint8_t i;
-    for (i = 0; i < OSprites_no_sprites; i++)
+    int16_t i;
+    // Only visit enabled entries
+    for (i = OSprites_next_active(0, OSprites_no_sprites); i >= 0; i = OSprites_next_active(i + 1, OSprites_no_sprites))
     {
         oentry* sprite = &OSprites_jump_table[i];
 
@@ -1084,5 +1096,13 @@ void OLevelObjs_hide_sprite(oentry *sprite)
 {
     sprite->z = 0;
     sprite->zoom = 0; // Hide the sprite
-    sprite->control &= ~SPRITES_ENABLE; // Disable entry in jump table
+    OSprites_disable(sprite); // Disable entry in jump table
+}
+
+void OLevelObjs_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OLevelObjs_collision_sprite);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OLevelObjs_spray_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OLevelObjs_spray_type);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OLevelObjs_sprite_collision_counter);
 }
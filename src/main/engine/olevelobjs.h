@@ -21,7 +21,7 @@
 
 
 // Spray Counter (Going Through Water).
-extern uint16_t OLevelObjs_spray_counter;
+extern ENGINE_LOCAL uint16_t OLevelObjs_spray_counter;
 
 // Wheel Spray Type
 // 00 = Water
@@ -29,16 +29,16 @@ extern uint16_t OLevelObjs_spray_counter;
 // 08 = Green Stuff
 // 0c = Pink stuff
 // 10 = Smoke
-extern uint16_t OLevelObjs_spray_type;
+extern ENGINE_LOCAL uint16_t OLevelObjs_spray_type;
 
 //	Collision With Sprite Has Ocurred
 //
 // 0 = No Collision
 // 1 = Collision (and increments for every additional collision in this crash cycle)
-extern uint8_t OLevelObjs_collision_sprite;
+extern ENGINE_LOCAL uint8_t OLevelObjs_collision_sprite;
 
 // Sprite Collision Counter (Hitting Scenery)
-extern int16_t OLevelObjs_sprite_collision_counter;
+extern ENGINE_LOCAL int16_t OLevelObjs_sprite_collision_counter;
 
 void OLevelObjs_init_startline_sprites();
 void OLevelObjs_init_timetrial_sprites();
@@ -46,3 +46,4 @@ void OLevelObjs_init_hiscore_sprites();
 void OLevelObjs_setup_sprites(uint32_t);
 void OLevelObjs_do_sprite_routine();
 void OLevelObjs_hide_sprite(oentry*);
+void OLevelObjs_register_state();
@@ -11,19 +11,20 @@
 #include "engine/osprites.h"
 #include "engine/outils.h"
 #include "engine/ologo.h"
+#include "savestate.h"
 
 
 
 // Palm Tree Frame Addresses
-uint32_t palm_frames[8];
+ENGINE_LOCAL uint32_t palm_frames[8];
 
 // Background Palette Entries
 static const uint8_t bg_pal[] = { 0x9A, 0x9B, 0x9C, 0x9D, 0x9E, 0x9A, 0x9B, 0x9C };
 	
-uint8_t entry_start;
+static ENGINE_LOCAL uint8_t entry_start;
 
 // Y Offset To Draw Logo At
-int16_t y_off;
+ENGINE_LOCAL int16_t y_off;
 	
 void OLogo_setup_sprite1();
 void OLogo_setup_sprite2();
@@ -56,6 +57,7 @@ void OLogo_enable(int16_t y)
     {
         oentry_init(&OSprites_jump_table[i], i);
     }
+    OSprites_sync_active();
 
     palm_frames[0] = Outrun_adr.sprite_logo_palm1;
     palm_frames[1] = Outrun_adr.sprite_logo_palm2;
@@ -81,7 +83,7 @@ void OLogo_disable()
     // Enable block of sprites
     for (i = entry_start; i < entry_start + 7; i++)
     {
-        OSprites_jump_table[i].control &= ~SPRITES_ENABLE;
+        OSprites_disable(&OSprites_jump_table[i]);
     }
 }
 
@@ -303,3 +305,10 @@ void OLogo_blit()
     for (i = 0; i < 7; i++)
         OSprites_do_spr_order_shadows(&OSprites_jump_table[entry_start + i]);
 }
+
+void OLogo_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, entry_start);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, palm_frames);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, y_off);
+}
@@ -14,3 +14,4 @@ void OLogo_enable(int16_t y);
 void OLogo_disable();
 void OLogo_tick();
 void OLogo_blit();
+void OLogo_register_state();
@@ -17,17 +17,18 @@
 #include "engine/otiles.h"
 #include "engine/otraffic.h"
 #include "engine/ostats.h"
+#include "savestate.h"
 
 
 // Position of Ferrari in Jump Table
 const uint8_t MAP_SPRITE_FERRARI = 25;
 
-Boolean OMap_init_sprites;
+ENGINE_LOCAL Boolean OMap_init_sprites;
 
 // Total sprite pieces that comprise course map. 3c
 const static uint8_t MAP_PIECES = 0x3C;
 
-uint8_t map_state;
+ENGINE_LOCAL uint8_t map_state;
 
 enum
 {
@@ -50,26 +51,26 @@ enum
 
 // Bit 0: 0 = Up   (Left Route)
 //        1 = Down (Right Route)
-uint8_t map_route;
+ENGINE_LOCAL uint8_t map_route;
 
 // Minimap Position (Per Segment Basis)
-int16_t map_pos;
+ENGINE_LOCAL int16_t map_pos;
 
 // Minimap Position (Final Segment)
-int16_t map_pos_final;
+ENGINE_LOCAL int16_t map_pos_final;
 
 // Map Delay Counter
-int16_t map_delay;
+ENGINE_LOCAL int16_t map_delay;
 
 // Stage counter for course map screen. [Increments]
-int16_t map_stage1;
+ENGINE_LOCAL int16_t map_stage1;
 
 // Stage counter for course map screen. [Decrements]
 // Loaded with stage, then counts down as course map logic runs.
-int16_t map_stage2;
+ENGINE_LOCAL int16_t map_stage2;
 
 // Minicar Movement Enabled (set = enabled)
-uint8_t minicar_enable;
+ENGINE_LOCAL uint8_t minicar_enable;
 
 void OMap_draw_horiz_end(oentry*);
 void OMap_draw_vert_bottom(oentry*);
@@ -199,8 +200,8 @@ void OMap_tick()
 // Render sprites only. No Logic
 void OMap_blit()
 {
-    uint8_t i;
-    for (i = 0; i <= MAP_PIECES; i++)
+    int16_t i;
+    for (i = OSprites_next_active(0, MAP_PIECES + 1); i >= 0; i = OSprites_next_active(i + 1, MAP_PIECES + 1))
     {
         oentry* sprite = &OSprites_jump_table[i];
         if (sprite->control & SPRITES_ENABLE)
@@ -300,6 +301,7 @@ void OMap_load_sprites()
 
         OSprites_map_palette(sprite);
     }
+    OSprites_sync_active();
 
    // Wide-screen hack to extend sea to edge of screen.
     if (Config_s16_x_off != 0 || Config_engine.fix_bugs)
@@ -440,3 +442,16 @@ void OMap_move_mini_car(oentry* sprite)
 
     OSprites_do_spr_order_shadows(sprite);
 }
+
+void OMap_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OMap_init_sprites);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, map_delay);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, map_pos);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, map_pos_final);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, map_route);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, map_stage1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, map_stage2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, map_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, minicar_enable);
+}
@@ -18,11 +18,12 @@
 
 
 // Load Sprites Needed for Course Map
-extern Boolean OMap_init_sprites;
+extern ENGINE_LOCAL Boolean OMap_init_sprites;
 
 void OMap_init();
 void OMap_tick();
 void OMap_blit();
 void OMap_load_sprites();
 void OMap_draw_course_map();
-void OMap_position_ferrari(uint8_t index);
\ No newline at end of file
+void OMap_position_ferrari(uint8_t index);
+void OMap_register_state();
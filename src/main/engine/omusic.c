@@ -15,14 +15,15 @@
 #include "engine/otiles.h"
 #include "engine/otraffic.h"
 #include "engine/ostats.h"
+#include "savestate.h"
 
-uint8_t OMusic_music_selected;
+ENGINE_LOCAL uint8_t OMusic_music_selected;
 
-uint16_t entry_start;
+static ENGINE_LOCAL uint16_t entry_start;
 
 // Used to preview music track
-int16_t last_music_selected;
-int8_t preview_counter;
+ENGINE_LOCAL int16_t last_music_selected;
+ENGINE_LOCAL int8_t preview_counter;
     
 void OMusic_setup_sprite1();
 void OMusic_setup_sprite2();
@@ -90,6 +91,7 @@ void OMusic_enable()
     {
         oentry_init(&OSprites_jump_table[i], i);
     }
+    OSprites_sync_active();
 
     OMusic_setup_sprite1();
     OMusic_setup_sprite2();
@@ -114,7 +116,7 @@ void OMusic_disable()
     // Disable block of sprites
     for (i = entry_start; i < entry_start + 5; i++)
     {
-        OSprites_jump_table[i].control &= ~SPRITES_ENABLE;
+        OSprites_disable(&OSprites_jump_table[i]);
     }
 
     HWTiles_set_x_clamp(HWTILES_RIGHT);
@@ -490,3 +492,12 @@ void OMusic_blit_music_select()
 	        Video_write_tile16(0x10F730, 0x0C80);
 	}
 }
+
+// The patched tilemaps are loaded from disk and are not included.
+void OMusic_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OMusic_music_selected);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, entry_start);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, last_music_selected);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, preview_counter);
+}
@@ -13,7 +13,7 @@
 
 
 // Music Track Selected By Player
-extern uint8_t OMusic_music_selected;
+extern ENGINE_LOCAL uint8_t OMusic_music_selected;
 
 Boolean OMusic_load_widescreen_map();
 void OMusic_enable();
@@ -21,6 +21,7 @@ void OMusic_disable();
 void OMusic_tick();
 void OMusic_blit();
 void OMusic_check_start();
+void OMusic_register_state();
 
 
 
@@ -26,11 +26,12 @@
 #include "engine/ohud.h"
 #include "engine/oinputs.h"
 #include "engine/ooutputs.h"
+#include "savestate.h"
 
-uint8_t OOutputs_hw_motor_control;
-uint8_t OOutputs_dig_out;
-CoinChute OOutputs_chute1;
-CoinChute OOutputs_chute2;
+ENGINE_LOCAL uint8_t OOutputs_hw_motor_control;
+ENGINE_LOCAL uint8_t OOutputs_dig_out;
+ENGINE_LOCAL CoinChute OOutputs_chute1;
+ENGINE_LOCAL CoinChute OOutputs_chute2;
 
 
 #define STATE_INIT   0
@@ -57,47 +58,47 @@ const static uint8_t LEFT_LIMIT    = 0xC1;
 const static uint8_t RIGHT_LIMIT   = 0x3C;
 
 // Motor Limit Values. Calibrated during startup.
-int16_t limit_left = 0;
-int16_t limit_right = 0;
+ENGINE_LOCAL int16_t limit_left = 0;
+ENGINE_LOCAL int16_t limit_right = 0;
 
 // Motor Centre Position. (We Fudge this for Force Feedback wheel mode.)
-int16_t motor_centre_pos;
+ENGINE_LOCAL int16_t motor_centre_pos;
 
 // Difference between input_motor and input_motor_old
-int16_t motor_x_change;
+ENGINE_LOCAL int16_t motor_x_change;
 
-uint16_t motor_state;
-Boolean motor_enabled = TRUE;
+ENGINE_LOCAL uint16_t motor_state;
+ENGINE_LOCAL Boolean motor_enabled = TRUE;
 
 // 0x11: Motor Control Value
-int8_t motor_control;
+ENGINE_LOCAL int8_t motor_control;
 // 0x12: Movement (1 = Left, -1 = Right, 0 = None)
-int8_t motor_movement;
+ENGINE_LOCAL int8_t motor_movement;
 // 0x14: Is Motor Centered
-Boolean is_centered;
+ENGINE_LOCAL Boolean is_centered;
 // 0x16: Motor X Change Latch
-int16_t motor_change_latch;
+ENGINE_LOCAL int16_t motor_change_latch;
 // 0x18: Speed
-int16_t speed;
+ENGINE_LOCAL int16_t speed;
 // 0x1A: Road Curve
-int16_t curve;
+ENGINE_LOCAL int16_t curve;
 // 0x1E: Increment counter to index motor table for off-road/crash
-int16_t vibrate_counter;
+ENGINE_LOCAL int16_t vibrate_counter;
 // 0x20: Last Motor X_Change > 8. No need to adjust further.
-Boolean was_small_change;
+ENGINE_LOCAL Boolean was_small_change;
 // 0x22: Adjusted movement value based on steering 1
-int16_t movement_adjust1;
+ENGINE_LOCAL int16_t movement_adjust1;
 // 0x24: Adjusted movement value based on steering 2
-int16_t movement_adjust2;
+ENGINE_LOCAL int16_t movement_adjust2;
 // 0x26: Adjusted movement value based on steering 3
-int16_t movement_adjust3;
+ENGINE_LOCAL int16_t movement_adjust3;
 
 // Counter control for motor tests
-int16_t counter;
+static ENGINE_LOCAL int16_t counter;
 
 // Columns for output
-uint16_t col1 = 0;
-uint16_t col2 = 0;
+ENGINE_LOCAL uint16_t col1 = 0;
+ENGINE_LOCAL uint16_t col2 = 0;
 
 
 void OOutputs_diag_left(int16_t input_motor, uint8_t hw_motor_limit);
@@ -1053,3 +1054,31 @@ void OOutputs_coin_chute_out(CoinChute* chute, Boolean insert)
         OOutputs_set_digital(chute->output_bit);
     }
 }
+
+void OOutputs_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OOutputs_chute1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OOutputs_chute2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OOutputs_dig_out);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OOutputs_hw_motor_control);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, col1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, col2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, curve);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, is_centered);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, limit_left);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, limit_right);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, motor_centre_pos);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, motor_change_latch);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, motor_control);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, motor_enabled);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, motor_movement);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, motor_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, motor_x_change);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, movement_adjust1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, movement_adjust2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, movement_adjust3);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, speed);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, vibrate_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, was_small_change);
+}
@@ -35,7 +35,7 @@ typedef struct
 // 5 = Left
 // 8 = Centre
 // B = Right
-extern uint8_t OOutputs_hw_motor_control;
+extern ENGINE_LOCAL uint8_t OOutputs_hw_motor_control;
 
 // Digital Outputs
 enum
@@ -50,10 +50,10 @@ enum
     OUTPUTS_D_SOUND      = 0x80, // bit 7 = sound enable
 };
 
-extern uint8_t OOutputs_dig_out;
+extern ENGINE_LOCAL uint8_t OOutputs_dig_out;
 
-extern CoinChute OOutputs_chute1;
-extern CoinChute OOutputs_chute2;
+extern ENGINE_LOCAL CoinChute OOutputs_chute1;
+extern ENGINE_LOCAL CoinChute OOutputs_chute2;
 
 
 void OOutputs_init();
@@ -62,4 +62,5 @@ Boolean OOutputs_calibrate_motor(int16_t input_motor, uint8_t hw_motor_limit, ui
 void OOutputs_tick(int MODE, int16_t input_motor, int16_t cabinet_type); 
 void OOutputs_set_digital(uint8_t);
 void OOutputs_clear_digital(uint8_t);
-void OOutputs_coin_chute_out(CoinChute* chute, Boolean insert);
\ No newline at end of file
+void OOutputs_coin_chute_out(CoinChute* chute, Boolean insert);
+void OOutputs_register_state();
@@ -12,12 +12,13 @@
 #include "engine/ohud.h"
 #include "engine/oinputs.h"
 #include "engine/opalette.h"
+#include "savestate.h"
 
 
-uint8_t OPalette_pal_manip_ctrl;
+ENGINE_LOCAL uint8_t OPalette_pal_manip_ctrl;
 
 // Sky Palette Manipulation Data (0x20 longs per palette, 0x1F separate palettes, then times 2 as for current/next sky on level transition)
-uint32_t pal_manip[(0x20 * 0x1F) * 2];
+ENGINE_LOCAL uint32_t pal_manip[(0x20 * 0x1F) * 2];
 
 // Palette Manipulation Area.
 //
@@ -35,25 +36,25 @@ uint32_t pal_manip[(0x20 * 0x1F) * 2];
 // +0E [word] GREEN Difference between palette entries
 // +10 [word] RED Difference between palette entries
 //(9 words per entry, 0x18 entries)
-uint16_t pal_fade[9 * 0x18];
+ENGINE_LOCAL uint16_t pal_fade[9 * 0x18];
 
 // Has new sky palette initalized (for level transitions)
 
 // Bit 0 = Set to denote that new sky palette info has been setup/copied to RAM. Cleared when bit 1 set.
 // Bit 1 = Set to indicate sky palette data should be cycled
-uint8_t sky_palette_init;
+ENGINE_LOCAL uint8_t sky_palette_init;
 
 // For palette fade manipulations
-uint8_t cycle_counter;
+ENGINE_LOCAL uint8_t cycle_counter;
 
 // Fade counter - how many steps to fade the palette by
-int16_t fade_counter;
+ENGINE_LOCAL int16_t fade_counter;
 
 // Sky Counter: Used to cycle sky palette on level transition
-uint16_t sky_palette_index;
+ENGINE_LOCAL uint16_t sky_palette_index;
 
 // Fade byte to setup (0 - 0x3F)
-uint8_t sky_fade_offset;
+ENGINE_LOCAL uint8_t sky_fade_offset;
 
 void OPalette_setup_fade_data();
 void OPalette_repack_rgb(const uint32_t);
@@ -585,3 +586,15 @@ void OPalette_setup_road_colour()
     Video_write_pal32(0x120800, TrackLoader_current_level->palr1.road);
     Video_write_pal32(0x120810, TrackLoader_current_level->palr2.road);
 }
+
+void OPalette_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OPalette_pal_manip_ctrl);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, cycle_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, fade_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, pal_fade);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, pal_manip);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, sky_fade_offset);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, sky_palette_index);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, sky_palette_init);
+}
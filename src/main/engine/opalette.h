@@ -18,7 +18,7 @@
 // Bit 0 = Set to enable/disable palette manipulation
 // Bit 1 = Set when fade difference calculated, and fade in progress
 // Bit 2 = Set when memory areas have been setup for fade
-extern uint8_t OPalette_pal_manip_ctrl;
+extern ENGINE_LOCAL uint8_t OPalette_pal_manip_ctrl;
 
 void OPalette_init();
 void OPalette_setup_sky_palette();	
@@ -31,3 +31,4 @@ void OPalette_setup_road_centre();
 void OPalette_setup_road_stripes();
 void OPalette_setup_road_side();
 void OPalette_setup_road_colour();
+void OPalette_register_state();
@@ -28,56 +28,58 @@
 #include "engine/oinitengine.h"
 
 #include "engine/oroad.h"
+#include "engine/oroadcache.h"
 #include "engine/ostats.h"
-
-
-
-uint32_t ORoad_road_pos;        // 0x6: Current Road Position (addressed as long and word)
-int16_t ORoad_tilemap_h_target; // 0xA: Tilemap H target
-int16_t ORoad_stage_lookup_off;
-uint16_t ORoad_road_p0; // 0x3A: Road Pointer 0
-uint16_t ORoad_road_p1; // 0x3C: Road Pointer 1 (Working road data)
-uint16_t ORoad_road_p2; // 0x3E: Road Pointer 2 (Chunk of road to be blitted)
-uint16_t ORoad_road_p3; // Ox40: Road Pointer 3 (Horizon Y Position)
-int16_t ORoad_road_width_bak;
-int16_t ORoad_car_x_bak;
-uint16_t ORoad_height_lookup;
-uint16_t ORoad_height_lookup_wrk;
-int32_t ORoad_road_pos_change; 
-uint8_t ORoad_road_load_end;
-uint8_t ORoad_road_ctrl;
-int8_t ORoad_road_load_split;
-int32_t ORoad_road_width;// DANGER! USED AS LONG AND WORD
-uint16_t ORoad_road_data_offset;
-int16_t ORoad_horizon_y2;
-int16_t ORoad_horizon_y_bak;
-uint16_t ORoad_pos_fine;
-int32_t ORoad_horizon_base;
-uint8_t ORoad_horizon_set;
-int16_t ORoad_road_x[ROAD_ARRAY_LENGTH];
-int16_t ORoad_road0_h[ROAD_ARRAY_LENGTH];
-int16_t ORoad_road1_h[ROAD_ARRAY_LENGTH];
-int16_t ORoad_road_unk[ROAD_ARRAY_LENGTH];
-int16_t ORoad_road_y[0x1000];
+#include "savestate.h"
+
+
+
+ENGINE_LOCAL uint32_t ORoad_road_pos;        // 0x6: Current Road Position (addressed as long and word)
+ENGINE_LOCAL int16_t ORoad_tilemap_h_target; // 0xA: Tilemap H target
+ENGINE_LOCAL int16_t ORoad_stage_lookup_off;
+ENGINE_LOCAL uint16_t ORoad_road_p0; // 0x3A: Road Pointer 0
+ENGINE_LOCAL uint16_t ORoad_road_p1; // 0x3C: Road Pointer 1 (Working road data)
+ENGINE_LOCAL uint16_t ORoad_road_p2; // 0x3E: Road Pointer 2 (Chunk of road to be blitted)
+ENGINE_LOCAL uint16_t ORoad_road_p3; // Ox40: Road Pointer 3 (Horizon Y Position)
+ENGINE_LOCAL int16_t ORoad_road_width_bak;
+ENGINE_LOCAL int16_t ORoad_car_x_bak;
+ENGINE_LOCAL uint16_t ORoad_height_lookup;
+ENGINE_LOCAL uint16_t ORoad_height_lookup_wrk;
+ENGINE_LOCAL int32_t ORoad_road_pos_change; 
+ENGINE_LOCAL uint8_t ORoad_road_load_end;
+ENGINE_LOCAL uint8_t ORoad_road_ctrl;
+ENGINE_LOCAL int8_t ORoad_road_load_split;
+ENGINE_LOCAL int32_t ORoad_road_width;// DANGER! USED AS LONG AND WORD
+ENGINE_LOCAL uint16_t ORoad_road_data_offset;
+ENGINE_LOCAL int16_t ORoad_horizon_y2;
+ENGINE_LOCAL int16_t ORoad_horizon_y_bak;
+ENGINE_LOCAL uint16_t ORoad_pos_fine;
+ENGINE_LOCAL int32_t ORoad_horizon_base;
+ENGINE_LOCAL uint8_t ORoad_horizon_set;
+ENGINE_LOCAL int16_t ORoad_road_x[ROAD_ARRAY_LENGTH];
+ENGINE_LOCAL int16_t ORoad_road0_h[ROAD_ARRAY_LENGTH];
+ENGINE_LOCAL int16_t ORoad_road1_h[ROAD_ARRAY_LENGTH];
+ENGINE_LOCAL int16_t ORoad_road_unk[ROAD_ARRAY_LENGTH];
+ENGINE_LOCAL int16_t ORoad_road_y[0x1000];
 
 
 
 // Enhancement: View Mode
-uint8_t view_mode;
+ENGINE_LOCAL uint8_t view_mode;
 
 // Enhancement: Target Horizon Adjust
-int16_t horizon_target;
+ENGINE_LOCAL int16_t horizon_target;
 
 // Enhancement: Horizon Offset, used for new view modes
-int16_t horizon_offset;
+ENGINE_LOCAL int16_t horizon_offset;
 
-uint16_t stage_loaded; // 0x4: Current Stage Backup (So we know when to load next stage road data)
+ENGINE_LOCAL uint16_t stage_loaded; // 0x4: Current Stage Backup (So we know when to load next stage road data)
 
-uint32_t road_pos_old; // 0x410: Road Position Backup
+ENGINE_LOCAL uint32_t road_pos_old; // 0x410: Road Position Backup
 
 // 60530 - [word] Distance into section of track, for height #1
 // Ranges from 0x100 - 0x1FF
-uint16_t height_start;
+ENGINE_LOCAL uint16_t height_start;
 
 // 0x536 - [word] Controls switch statement when processing road height
 //                0 = Clear Road Height Segment
@@ -86,79 +88,79 @@ uint16_t height_start;
 //                3 = 
 //                4 = 
 //                5 = Set Base Horizon
-uint16_t height_ctrl;
+ENGINE_LOCAL uint16_t height_ctrl;
 
 // 0x542: Granular Position Backup.
-uint16_t ORoad_pos_fine_old;
+ENGINE_LOCAL uint16_t ORoad_pos_fine_old;
 
 // 0x544 - [word] Difference between granular positions. 
-int16_t pos_fine_diff;
+ENGINE_LOCAL int16_t pos_fine_diff;
 
 // 0x70E - [word] Counter. Counts to 7. Denotes Interpolated track section currently being written.
-int8_t counter;
+static ENGINE_LOCAL int8_t counter;
 
 // 0x710 - Index Into Height Data (generally specifies hill type for specific section of road)
 // The results of the value will differ depending on which road height section currently on.
 // Not to be confused with 6072A, which is a much larger number.
 // Hack to see different values: wpset 60710,2,r,1,{w@60710 = 5; g;}
-int16_t height_index;
+ENGINE_LOCAL int16_t height_index;
 
 // 0x712 - [long] Final Height Value. Takes Horizon and distance into screen into account.
-int32_t height_final;
+ENGINE_LOCAL int32_t height_final;
 
 // 0x716 - [word] Increment Value For 0x710 to adjust lookup from height data
-uint16_t height_inc;
+ENGINE_LOCAL uint16_t height_inc;
 
 // 0x718 - [word] This stores the position into the current road segment we're on. 
 // Derived from the granular position and used in conjunction with road height.
 // As a hack try wpset 60718,2,r,1,{w@60718 = 0x6b5; g;}
 // you'll stall at a position on the current road segment after value is set.
-uint16_t height_step;
+ENGINE_LOCAL uint16_t height_step;
 
 // 0x71A - [word] Jump Table Control For Road Height (Read from Road Data).
-uint16_t height_ctrl2;
+ENGINE_LOCAL uint16_t height_ctrl2;
 
 // 0x71C - [long] Stores current position into road height data. This is an actual address.
-uint32_t height_addr;
+ENGINE_LOCAL uint32_t height_addr;
 
 // 0x720 - [word] Elevation Flag
-int16_t elevation;
+ENGINE_LOCAL int16_t elevation;
 enum {DOWN = -1, NO_CHANGE = 0, UP = 1};
 								 
 // 0x724 - [word] Ascend/Descent Hold
-int16_t height_delay;
+ENGINE_LOCAL int16_t height_delay;
 
 // 0x726 - [word] Speed at which to adjust height_step
-uint16_t step_adjust;
+ENGINE_LOCAL uint16_t step_adjust;
 
 // 0x728 
-uint16_t do_height_inc;
+ENGINE_LOCAL uint16_t do_height_inc;
 
 // 0x72A - [word] Distance into section of track, for height #2
 //             Ranges from 0x100 - 0x1FF
-uint16_t height_end;
+ENGINE_LOCAL uint16_t height_end;
 
 // 0x72C: Up Multiplier
-int8_t up_mult;
+ENGINE_LOCAL int8_t up_mult;
 
 // 0x72E: Down Multiplier
-int8_t down_mult;
+ENGINE_LOCAL int8_t down_mult;
 
 // 0x73A: 0 = Base Horizon Value Not Set. 1 = Value Set.
-uint32_t horizon_mod;
+ENGINE_LOCAL uint32_t horizon_mod;
 
 // 60700: Lengths of the 7 road segments 60700 - 6070D
-uint16_t section_lengths[7];
-int8_t length_offset;
-uint32_t a1_lookup;
+ENGINE_LOCAL uint16_t section_lengths[7];
+ENGINE_LOCAL int8_t length_offset;
+ENGINE_LOCAL uint32_t a1_lookup;
 
 // Registers - todo: refactor these
-int32_t change_per_entry; // [d2]
-int32_t d5_o;
-uint32_t a3_o;
-uint32_t y_addr;
-int16_t scanline;
-int32_t total_height;
+ENGINE_LOCAL int32_t change_per_entry; // [d2]
+ENGINE_LOCAL int32_t d5_o;
+ENGINE_LOCAL uint32_t a3_o;
+ENGINE_LOCAL uint32_t y_addr;
+ENGINE_LOCAL int16_t scanline;
+ENGINE_LOCAL int32_t total_height;
 
 
 // -------------------------------------------------------------------------
@@ -177,10 +179,7 @@ void ORoad_rotate_values();
 void ORoad_check_load_road();
 	
 void ORoad_setup_road_x();
-void ORoad_setup_x_data(uint32_t);
-void ORoad_set_tilemap_x(uint32_t);
 void ORoad_add_next_road_pos(uint32_t*);
-void ORoad_create_curve(int16_t*, int16_t*, int32_t, int32_t, int16_t, int16_t);
 
 void ORoad_setup_hscroll();
 void ORoad_do_road_offset(int16_t*, int16_t, Boolean);
@@ -500,8 +499,11 @@ void ORoad_setup_road_x()
         ORoad_road_data_offset = (ORoad_road_pos >> 16) << 2;
         //uint32_t addr = stage_addr + road_data_offset;
         uint32_t addr = ORoad_road_data_offset; // temporary hack for custom data
-        ORoad_set_tilemap_x(addr);
-        ORoad_setup_x_data(addr);
+        if (!ORoadCache_setup_x(ORoad_road_pos >> 16))
+        {
+            ORoad_set_tilemap_x(addr);
+            ORoad_setup_x_data(addr);
+        }
     }
     ORoad_setup_hscroll();
 }
@@ -515,7 +517,6 @@ void ORoad_setup_road_x()
 void ORoad_setup_x_data(uint32_t addr)
 {
     uint8_t i;
-    int16_t pos;
     
     const int16_t x = TrackLoader_readPath(addr)     + TrackLoader_readPath(addr + 4); // Length 1
     const int16_t y = TrackLoader_readPath(addr + 2) + TrackLoader_readPath(addr + 6); // Length 2
@@ -527,7 +528,7 @@ void ORoad_setup_x_data(uint32_t addr)
     const int16_t curve_y_dist = (y << 14) / distance;
 
     // Setup Default Straight Positions Of Road at 60800 - 608FF
-    for (i = 0; i < 0x80;)
+    for (i = 0; i < ROAD_X_STRAIGHT;)
     {
         // Set marker to ignore current road position, and use last good value
         ORoad_road_x[i++] = 0x3210;
@@ -542,12 +543,12 @@ void ORoad_setup_x_data(uint32_t addr)
     int16_t curve_inc     = 0;
     int16_t curve_inc_old = 0;
 
-    int16_t scanline = 0x37E / 2; // Index into road_x
+    int16_t scanline = ROAD_X_SCANLINE; // Index into road_x
 
     // Note this works its way from closest to the camera, further into the horizon
     // So the amount to offset x is going to increase over time
     // We sample 20 Road Positions to generate the road.
-    for (i = 0; i <= 0x20; i++)
+    for (i = 0; i < ROAD_CURVE_SAMPLES; i++)
     {
         const int32_t x_next = TrackLoader_readPath(addr)     + TrackLoader_readPath(addr + 4); // Length 1
         const int32_t y_next = TrackLoader_readPath(addr + 2) + TrackLoader_readPath(addr + 6); // Length 2
@@ -558,25 +559,36 @@ void ORoad_setup_x_data(uint32_t addr)
 
         // Calculate curve increment and end position
         ORoad_create_curve(&curve_inc, &curve_end, curve_x_total, curve_y_total, curve_x_dist, curve_y_dist);
-        int16_t curve_steps = curve_end - curve_start;
-        if (curve_steps < 0) return;
-        if (curve_steps == 0) continue; // skip_pos
+        if (!ORoad_interpolate_curve(curve_inc, curve_end, &curve_inc_old, &curve_start, &scanline))
+            return;
+    }
+}
 
-        // X Amount to increment curve by each iteration
-        int32_t xinc = (curve_inc - curve_inc_old) / curve_steps;
-        int16_t x = curve_inc_old;
+// Interpolate road_x between the previous position on the curve and the next.
+// Returns FALSE when the rest of the road should be left as it is.
 
-        for (pos = curve_start; pos <= curve_end; pos++)
-        {
-            x += xinc;              
-            if (x < -0x3200 || x > 0x3200) return;
-            ORoad_road_x[scanline] = x;           
-            if (--scanline < 0) return;
-        }
+Boolean ORoad_interpolate_curve(int16_t curve_inc, int16_t curve_end, int16_t* curve_inc_old, int16_t* curve_start, int16_t* scanline)
+{
+    int16_t pos;
+    int16_t curve_steps = curve_end - *curve_start;
+    if (curve_steps < 0) return FALSE;
+    if (curve_steps == 0) return TRUE; // skip_pos
 
-        curve_inc_old = curve_inc;
-        curve_start = curve_end;
+    // X Amount to increment curve by each iteration
+    int32_t xinc = (curve_inc - *curve_inc_old) / curve_steps;
+    int16_t x = *curve_inc_old;
+
+    for (pos = *curve_start; pos <= curve_end; pos++)
+    {
+        x += xinc;              
+        if (x < -0x3200 || x > 0x3200) return FALSE;
+        ORoad_road_x[*scanline] = x;           
+        if (--(*scanline) < 0) return FALSE;
     }
+
+    *curve_inc_old = curve_inc;
+    *curve_start   = curve_end;
+    return TRUE;
 }
 
 // Interpolates road data into a smooth curve.
@@ -1801,3 +1813,67 @@ void ORoad_copy_bg_color()
         HWRoad_write32(&dst, RomLoader_read32IncP(Roms_rom1p, &src));
     }
 }
+
+void ORoad_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_car_x_bak);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_height_lookup);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_height_lookup_wrk);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_horizon_base);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_horizon_set);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_horizon_y2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_horizon_y_bak);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_pos_fine);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_pos_fine_old);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road0_h);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road1_h);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_ctrl);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_data_offset);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_load_end);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_load_split);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_p0);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_p1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_p2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_p3);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_pos);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_pos_change);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_unk);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_width);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_width_bak);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_x);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_road_y);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_stage_lookup_off);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ORoad_tilemap_h_target);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, a1_lookup);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, a3_o);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, change_per_entry);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, d5_o);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, do_height_inc);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, down_mult);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, elevation);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, height_addr);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, height_ctrl);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, height_ctrl2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, height_delay);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, height_end);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, height_final);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, height_inc);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, height_index);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, height_start);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, height_step);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, horizon_mod);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, horizon_offset);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, horizon_target);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, length_offset);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, pos_fine_diff);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, road_pos_old);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, scanline);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, section_lengths);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, stage_loaded);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, step_adjust);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, total_height);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, up_mult);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, view_mode);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, y_addr);
+}
@@ -23,8 +23,8 @@
 
 
 
-extern uint32_t ORoad_road_pos;        // 0x6: Current Road Position (addressed as long and word)
-extern int16_t ORoad_tilemap_h_target; // 0xA: Tilemap H target
+extern ENGINE_LOCAL uint32_t ORoad_road_pos;        // 0x6: Current Road Position (addressed as long and word)
+extern ENGINE_LOCAL int16_t ORoad_tilemap_h_target; // 0xA: Tilemap H target
 
 // Stage Lookup Offset - Used to retrieve various data from in-game tables
 //
@@ -40,34 +40,34 @@ extern int16_t ORoad_tilemap_h_target; // 0xA: Tilemap H target
 // Also increments by +1 during the road split section from the values shown above.
 //
 // 0x38: Set to -8 during bonus mode section
-extern int16_t ORoad_stage_lookup_off;
+extern ENGINE_LOCAL int16_t ORoad_stage_lookup_off;
 
 // These pointers rotate and select the current chunk of road data to blit
-extern uint16_t ORoad_road_p0; // 0x3A: Road Pointer 0
-extern uint16_t ORoad_road_p1; // 0x3C: Road Pointer 1 (Working road data)
-extern uint16_t ORoad_road_p2; // 0x3E: Road Pointer 2 (Chunk of road to be blitted)
-extern uint16_t ORoad_road_p3; // Ox40: Road Pointer 3 (Horizon Y Position)
+extern ENGINE_LOCAL uint16_t ORoad_road_p0; // 0x3A: Road Pointer 0
+extern ENGINE_LOCAL uint16_t ORoad_road_p1; // 0x3C: Road Pointer 1 (Working road data)
+extern ENGINE_LOCAL uint16_t ORoad_road_p2; // 0x3E: Road Pointer 2 (Chunk of road to be blitted)
+extern ENGINE_LOCAL uint16_t ORoad_road_p3; // Ox40: Road Pointer 3 (Horizon Y Position)
 
 // 0x4C: Road Width Backup
-extern int16_t ORoad_road_width_bak;
+extern ENGINE_LOCAL int16_t ORoad_road_width_bak;
 
 // 0x4E: Car X Backup
-extern int16_t ORoad_car_x_bak;
+extern ENGINE_LOCAL int16_t ORoad_car_x_bak;
 
 // 0x66: Road Height Lookup 
-extern uint16_t ORoad_height_lookup;
+extern ENGINE_LOCAL uint16_t ORoad_height_lookup;
 
 // 0x722 - [word] Road Height Index. Working copy of 60066.
-extern uint16_t ORoad_height_lookup_wrk;
+extern ENGINE_LOCAL uint16_t ORoad_height_lookup_wrk;
 
 // 0x6C: Change in road position
-extern int32_t ORoad_road_pos_change; 
+extern ENGINE_LOCAL int32_t ORoad_road_pos_change; 
 	
 // 0x5E: Instruct CPU 1 to load end section road. Set Bit 1.
-extern uint8_t ORoad_road_load_end;
+extern ENGINE_LOCAL uint8_t ORoad_road_load_end;
 
 // 0x306: Road Control
-extern uint8_t ORoad_road_ctrl;
+extern ENGINE_LOCAL uint8_t ORoad_road_ctrl;
 enum 
 {
 	ROAD_OFF = 0,         // Both Roads Off
@@ -85,7 +85,7 @@ enum
 // This should be set to tell CPU 1 to init the road splitting code
 // 0    = Do Not Load
 // 0xFF = Load
-extern int8_t ORoad_road_load_split;
+extern ENGINE_LOCAL int8_t ORoad_road_load_split;
 
 // 0x314: Road Width
 // There are two road generators.
@@ -96,45 +96,54 @@ extern int8_t ORoad_road_load_split;
 // D4 = 6 lanes
 //
 // Once the distance is greater than F0 or so, it's obvious there are two independent roads.
-extern int32_t ORoad_road_width;// DANGER! USED AS LONG AND WORD
+extern ENGINE_LOCAL int32_t ORoad_road_width;// DANGER! USED AS LONG AND WORD
 
 // 0x420: Offset Into Road Data [Current Road Position * 4]
 // Moved from private for tracked
-extern uint16_t ORoad_road_data_offset;
+extern ENGINE_LOCAL uint16_t ORoad_road_data_offset;
 
 // 0x4F0: Start Address of Road Data For Current Stage In ROM
 // TODO - move back to being private at some stage
 //uint32_t stage_addr;
 
 // 0x510: Horizon Y Position
-extern int16_t ORoad_horizon_y2;
-extern int16_t ORoad_horizon_y_bak;
+extern ENGINE_LOCAL int16_t ORoad_horizon_y2;
+extern ENGINE_LOCAL int16_t ORoad_horizon_y_bak;
 
 // 0x53C: Granular Position. More fine than other positioning info. Used to choose road background colour.
-extern uint16_t ORoad_pos_fine;
+extern ENGINE_LOCAL uint16_t ORoad_pos_fine;
 
 // 0x732 - [long] Base Horizon Y-Offset. Adjusting this almost has the effect of raising the camera. 
 // Stage 1 is 0x240
 // Higher values = higher horizon.
 // Note: This is adjusted mid-stage for Stage 2, but remains constant for Stage 1.
-extern int32_t ORoad_horizon_base;
+extern ENGINE_LOCAL int32_t ORoad_horizon_base;
 
 // 0x736: 0 = Base Horizon Value Not Set. 1 = Value Set.
-extern uint8_t ORoad_horizon_set;
+extern ENGINE_LOCAL uint8_t ORoad_horizon_set;
 
 #define ROAD_ARRAY_LENGTH 0x200
 
 // 60800 - 60BFF: Road X-Positions [Before H-Scroll Is Applied] - Same Data For Both Roads
-extern int16_t ORoad_road_x[ROAD_ARRAY_LENGTH];
+extern ENGINE_LOCAL int16_t ORoad_road_x[ROAD_ARRAY_LENGTH];
+
+// First entry of road_x written by the curve, closest to the camera. Entries are written towards 0.
+#define ROAD_X_SCANLINE (0x37E / 2)
+
+// Entries of road_x that are reset to straight before the curve is written
+#define ROAD_X_STRAIGHT 0x80
+
+// Positions sampled along the path to build the curve
+#define ROAD_CURVE_SAMPLES 0x21
 
 // 60C00 - 60FFF: Road 0 H-Scroll Adjusted Positions
-extern int16_t ORoad_road0_h[ROAD_ARRAY_LENGTH];
+extern ENGINE_LOCAL int16_t ORoad_road0_h[ROAD_ARRAY_LENGTH];
 	
 // 61000 - 613FF: Road 1 H-Scroll Adjusted Positions
-extern int16_t ORoad_road1_h[ROAD_ARRAY_LENGTH];
+extern ENGINE_LOCAL int16_t ORoad_road1_h[ROAD_ARRAY_LENGTH];
 
 // 61400 - 617FF: Not sure what this is yet
-extern int16_t ORoad_road_unk[ROAD_ARRAY_LENGTH];
+extern ENGINE_LOCAL int16_t ORoad_road_unk[ROAD_ARRAY_LENGTH];
 
 // 61800 - 637FF: Road Y-Positions	
 //
@@ -146,7 +155,7 @@ extern int16_t ORoad_road_unk[ROAD_ARRAY_LENGTH];
 // Offset 0x400: Destination Data. Final converted data to be output to road hardware
 //
 // This format is repeated four times, due to the way values rotate through road ram
-extern int16_t ORoad_road_y[0x1000];
+extern ENGINE_LOCAL int16_t ORoad_road_y[0x1000];
 
 const static uint8_t ROAD_VIEW_ORIGINAL = 0;
 const static uint8_t ROAD_VIEW_ELEVATED = 1;
@@ -157,4 +166,10 @@ void ORoad_tick();
 uint8_t ORoad_get_view_mode();
 int16_t ORoad_get_road_y(uint16_t);
 void ORoad_set_view_mode(uint8_t, Boolean);
+void ORoad_register_state();
+
+void ORoad_setup_x_data(uint32_t);
+void ORoad_set_tilemap_x(uint32_t);
+void ORoad_create_curve(int16_t*, int16_t*, int32_t, int32_t, int16_t, int16_t);
+Boolean ORoad_interpolate_curve(int16_t curve_inc, int16_t curve_end, int16_t* curve_inc_old, int16_t* curve_start, int16_t* scanline);
 
@@ -0,0 +1,244 @@
+/***************************************************************************
+    Road Geometry Cache.
+
+    Precomputes the curve of the road ahead of every position on the
+    current road path, when the path is loaded. Each tick the road x
+    positions are then interpolated from the cached curve, rather than
+    being rebuilt from the path data.
+
+    For each position the cache holds the output of ORoad_create_curve
+    for every sample along the path, and the tilemap target. The
+    interpolation itself, and the early outs within it, are shared with
+    the original code, so the road x positions are identical.
+
+    The road height is not cached. It is driven by per-tick state, such
+    as the distance moved since the last tick, rather than the position
+    alone.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "globals.h"
+#include "arena.h"
+#include "trackloader.h"
+#include "sdl/timer.h"
+#include "engine/oroad.h"
+#include "engine/oroadcache.h"
+#include "engine/outils.h"
+#include "engine/outrun.h"
+
+// Bytes of path data read from a position to build its curve
+#define ROADCACHE_PATH_BYTES (ROAD_CURVE_SAMPLES * 8)
+
+typedef struct
+{
+    int16_t curve_inc[ROAD_CURVE_SAMPLES];
+    int16_t curve_end[ROAD_CURVE_SAMPLES];
+    int16_t tilemap_h_target;
+    uint8_t valid;          // Positions the original code would divide by zero at are not cached
+} roadcache_entry_t;
+
+uint8_t ORoadCache_mode = ROADCACHE_ON;
+uint32_t ORoadCache_compare_errors = 0;
+
+static roadcache_entry_t* ORoadCache_entries;
+static uint32_t ORoadCache_positions;  // Cached positions on the current path
+static const uint8_t* ORoadCache_path; // Path the cache was built from
+
+// Statistics
+static uint32_t ORoadCache_hits, ORoadCache_misses;
+static uint32_t ORoadCache_builds;
+static uint64_t ORoadCache_build_us;
+static uint32_t ORoadCache_build_max;
+
+void ORoadCache_build();
+Boolean ORoadCache_build_entry(roadcache_entry_t* entry, uint32_t addr);
+void ORoadCache_apply(const roadcache_entry_t* entry);
+void ORoadCache_compare(const roadcache_entry_t* entry, uint16_t pos);
+
+// Setup road x positions and the tilemap target for a road position.
+// Returns FALSE when the position is not cached, and the original code should be used.
+Boolean ORoadCache_setup_x(uint16_t pos)
+{
+    // Batch instances run on threads that can not allocate from the arena
+    if (ORoadCache_mode == ROADCACHE_OFF || Outrun_batch_instance)
+        return FALSE;
+
+    if (ORoadCache_path != TrackLoader_get_path())
+        ORoadCache_build();
+
+    if (pos >= ORoadCache_positions || !ORoadCache_entries[pos].valid)
+    {
+        ORoadCache_misses++;
+        return FALSE;
+    }
+
+    ORoadCache_hits++;
+
+    if (ORoadCache_mode == ROADCACHE_COMPARE)
+        ORoadCache_compare(&ORoadCache_entries[pos], pos);
+    else
+        ORoadCache_apply(&ORoadCache_entries[pos]);
+
+    return TRUE;
+}
+
+// Build the cache for the current path. Positions whose curve reads past the end of the path data are left out.
+void ORoadCache_build()
+{
+    uint32_t pos;
+    uint32_t start  = getMicroseconds();
+    uint32_t length = TrackLoader_path_length();
+
+    ORoadCache_path      = TrackLoader_get_path();
+    ORoadCache_positions = 0;
+
+    if (ORoadCache_entries == NULL)
+    {
+        ORoadCache_entries = (roadcache_entry_t*) Arena_alloc(ARENA_ROAD, ROAD_END_CPU1 * sizeof(roadcache_entry_t));
+        if (ORoadCache_entries == NULL)
+        {
+            fprintf(stderr, "Road Cache: Unable to allocate memory. Cache disabled.\n");
+            ORoadCache_mode = ROADCACHE_OFF;
+            return;
+        }
+    }
+
+    if (length >= ROADCACHE_PATH_BYTES)
+        ORoadCache_positions = ((length - ROADCACHE_PATH_BYTES) >> 2) + 1;
+    if (ORoadCache_positions > ROAD_END_CPU1)
+        ORoadCache_positions = ROAD_END_CPU1;
+
+    // ORoad_set_tilemap_x writes the target directly
+    int16_t tilemap_h_target = ORoad_tilemap_h_target;
+
+    for (pos = 0; pos < ORoadCache_positions; pos++)
+        ORoadCache_entries[pos].valid = ORoadCache_build_entry(&ORoadCache_entries[pos], pos << 2);
+
+    ORoad_tilemap_h_target = tilemap_h_target;
+
+    uint32_t elapsed = getMicroseconds() - start;
+    ORoadCache_builds++;
+    ORoadCache_build_us += elapsed;
+    if (elapsed > ORoadCache_build_max)
+        ORoadCache_build_max = elapsed;
+}
+
+// Mirrors ORoad_setup_x_data and ORoad_set_tilemap_x, up to the interpolation
+Boolean ORoadCache_build_entry(roadcache_entry_t* entry, uint32_t addr)
+{
+    uint8_t i;
+    uint32_t adr = addr;
+
+    // Tilemap target
+    int16_t tx = TrackLoader_readPath(adr)     + TrackLoader_readPath(adr + 4) + TrackLoader_readPath(adr + 8)  + TrackLoader_readPath(adr + 12);
+    int16_t ty = TrackLoader_readPath(adr + 2) + TrackLoader_readPath(adr + 6) + TrackLoader_readPath(adr + 10) + TrackLoader_readPath(adr + 14);
+    int16_t tx_abs = tx < 0 ? -tx : tx;
+    int16_t ty_abs = ty < 0 ? -ty : ty;
+    if (tx == 0 && !(ty_abs > tx_abs))
+        return FALSE;
+
+    ORoad_set_tilemap_x(addr);
+    entry->tilemap_h_target = ORoad_tilemap_h_target;
+
+    // Curve
+    const int16_t x = TrackLoader_readPath(addr)     + TrackLoader_readPath(addr + 4);
+    const int16_t y = TrackLoader_readPath(addr + 2) + TrackLoader_readPath(addr + 6);
+
+    const uint16_t distance = outils_isqrt((x * x) + (y * y));
+    if (distance == 0)
+        return FALSE;
+
+    const int16_t curve_x_dist = (x << 14) / distance;
+    const int16_t curve_y_dist = (y << 14) / distance;
+
+    int32_t curve_x_total = 0;
+    int32_t curve_y_total = 0;
+
+    for (i = 0; i < ROAD_CURVE_SAMPLES; i++)
+    {
+        curve_x_total += TrackLoader_readPath(addr)     + TrackLoader_readPath(addr + 4);
+        curve_y_total += TrackLoader_readPath(addr + 2) + TrackLoader_readPath(addr + 6);
+        addr += 8;
+
+        // Divisor of ORoad_create_curve
+        int32_t d2 = (((curve_x_total >> 5) * curve_x_dist) + ((curve_y_total >> 5) * curve_y_dist)) >> 7;
+        if ((d2 >> 7) + 0x410 == 0)
+            return FALSE;
+
+        ORoad_create_curve(&entry->curve_inc[i], &entry->curve_end[i], curve_x_total, curve_y_total, curve_x_dist, curve_y_dist);
+    }
+
+    return TRUE;
+}
+
+void ORoadCache_apply(const roadcache_entry_t* entry)
+{
+    uint8_t i;
+
+    ORoad_tilemap_h_target = entry->tilemap_h_target;
+
+    // Setup Default Straight Positions Of Road
+    for (i = 0; i < ROAD_X_STRAIGHT; i++)
+        ORoad_road_x[i] = 0x3210;
+
+    int16_t curve_start   = 0;
+    int16_t curve_inc_old = 0;
+    int16_t scanline      = ROAD_X_SCANLINE;
+
+    for (i = 0; i < ROAD_CURVE_SAMPLES; i++)
+    {
+        if (!ORoad_interpolate_curve(entry->curve_inc[i], entry->curve_end[i], &curve_inc_old, &curve_start, &scanline))
+            return;
+    }
+}
+
+// Run the original code and the cache from the same state, and keep the original result
+void ORoadCache_compare(const roadcache_entry_t* entry, uint16_t pos)
+{
+    int16_t before[ROAD_ARRAY_LENGTH];
+    int16_t expected[ROAD_ARRAY_LENGTH];
+    int16_t tilemap_before = ORoad_tilemap_h_target;
+    int16_t tilemap_expected;
+
+    memcpy(before, ORoad_road_x, sizeof(before));
+
+    ORoad_set_tilemap_x(pos << 2);
+    ORoad_setup_x_data(pos << 2);
+    memcpy(expected, ORoad_road_x, sizeof(expected));
+    tilemap_expected = ORoad_tilemap_h_target;
+
+    memcpy(ORoad_road_x, before, sizeof(before));
+    ORoad_tilemap_h_target = tilemap_before;
+    ORoadCache_apply(entry);
+
+    if (memcmp(expected, ORoad_road_x, sizeof(expected)) != 0 || tilemap_expected != ORoad_tilemap_h_target)
+    {
+        if (ORoadCache_compare_errors++ < 16)
+            fprintf(stderr, "Road Cache: mismatch at position %04X\n", pos);
+    }
+
+    memcpy(ORoad_road_x, expected, sizeof(expected));
+    ORoad_tilemap_h_target = tilemap_expected;
+}
+
+// Print hit rate and build cost. Called at exit.
+void ORoadCache_report()
+{
+    uint32_t lookups = ORoadCache_hits + ORoadCache_misses;
+
+    if (lookups == 0)
+        return;
+
+    fprintf(stderr, "Road Cache Report:\n");
+    fprintf(stderr, "%u hits, %u misses (%.1f%% hit rate).\n", ORoadCache_hits, ORoadCache_misses, ORoadCache_hits * 100.0 / lookups);
+    if (ORoadCache_builds)
+        fprintf(stderr, "%u builds, avg %uus, max %uus. %u bytes.\n", ORoadCache_builds,
+                (uint32_t) (ORoadCache_build_us / ORoadCache_builds), ORoadCache_build_max,
+                ROAD_END_CPU1 * (uint32_t) sizeof(roadcache_entry_t));
+    if (ORoadCache_mode == ROADCACHE_COMPARE)
+        fprintf(stderr, "%u mismatches against the original code.\n", ORoadCache_compare_errors);
+}
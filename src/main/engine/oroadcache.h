@@ -0,0 +1,29 @@
+/***************************************************************************
+    Road Geometry Cache.
+
+    Precomputes the curve of the road ahead of every position on the
+    current road path, when the path is loaded. Each tick the road x
+    positions are then interpolated from the cached curve, rather than
+    being rebuilt from the path data.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.h"
+
+enum
+{
+    ROADCACHE_OFF,      // Build the road from the path data each tick (original)
+    ROADCACHE_ON,       // Interpolate the road from the cache
+    ROADCACHE_COMPARE,  // Run both and report differences to stderr
+};
+
+// Road geometry path (ROADCACHE_OFF, ROADCACHE_ON or ROADCACHE_COMPARE)
+extern uint8_t ORoadCache_mode;
+extern uint32_t ORoadCache_compare_errors;
+
+Boolean ORoadCache_setup_x(uint16_t pos);
+void ORoadCache_report();
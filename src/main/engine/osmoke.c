@@ -11,18 +11,19 @@
 #include "engine/oferrari.h"
 #include "engine/olevelobjs.h"
 #include "engine/osmoke.h"
+#include "savestate.h"
 
 
-int8_t OSmoke_load_smoke_data;
+ENGINE_LOCAL int8_t OSmoke_load_smoke_data;
 
 // Ferrari wheel smoke type on road
-uint16_t smoke_type_onroad;
+ENGINE_LOCAL uint16_t smoke_type_onroad;
 
 // Ferrari wheel smoke type off road
-uint16_t smoke_type_offroad;
+ENGINE_LOCAL uint16_t smoke_type_offroad;
 
 // Ferrari wheel smoke type after car collision
-uint16_t smoke_type_slip;
+ENGINE_LOCAL uint16_t smoke_type_slip;
 
 void OSmoke_tick_smoke_anim(oentry*, int8_t, uint32_t);
 
@@ -364,4 +365,12 @@ void OSmoke_draw(oentry* sprite)
     
     OSprites_map_palette(sprite);
     OSprites_do_spr_order_shadows(sprite);
-}
\ No newline at end of file
+}
+
+void OSmoke_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSmoke_load_smoke_data);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, smoke_type_offroad);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, smoke_type_onroad);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, smoke_type_slip);
+}
@@ -13,9 +13,10 @@
 
 
 // Load smoke sprites for next level?
-extern int8_t OSmoke_load_smoke_data;
+extern ENGINE_LOCAL int8_t OSmoke_load_smoke_data;
 
 void OSmoke_init();
 void OSmoke_setup_smoke_sprite(Boolean);
 void OSmoke_draw_ferrari_smoke(oentry*);
 void OSmoke_draw(oentry*);
+void OSmoke_register_state();
@@ -12,6 +12,7 @@
     See license.txt for more details.
 ***************************************************************************/
 
+#include <string.h>
 #include "../trackloader.h"
 
 #include "engine/oanimseq.h"
@@ -21,21 +22,28 @@
 #include "engine/osprites.h"
 #include "engine/otraffic.h"
 #include "engine/ozoom_lookup.h"
-
-uint8_t OSprites_no_sprites;
-oentry OSprites_jump_table[JUMP_ENTRIES_TOTAL]; 
-osprite OSprites_sprite_entries[JUMP_ENTRIES_TOTAL];
-uint16_t OSprites_seg_pos;
-uint8_t OSprites_seg_total_sprites;
-uint16_t OSprites_seg_sprite_freq;
-int16_t OSprites_seg_spr_offset2;
-int16_t OSprites_seg_spr_offset1;
-uint32_t OSprites_seg_spr_addr;
-uint16_t OSprites_sprite_scroll_speed;
-int16_t OSprites_shadow_offset;
-uint16_t OSprites_sprite_count;
-uint16_t OSprites_spr_cnt_main;
-uint16_t OSprites_spr_cnt_shadow;
+#include "savestate.h"
+#include "frontend/config.h"
+#include "sdl/timer.h"
+
+ENGINE_LOCAL uint8_t OSprites_no_sprites;
+ENGINE_LOCAL oentry OSprites_jump_table[JUMP_ENTRIES_TOTAL]; 
+ENGINE_LOCAL uint32_t OSprites_active[SPRITE_ACTIVE_WORDS];
+ENGINE_LOCAL osprite OSprites_sprite_entries[SPRITE_LIST_MAX + 1];
+ENGINE_LOCAL uint16_t OSprites_seg_pos;
+ENGINE_LOCAL uint8_t OSprites_seg_total_sprites;
+ENGINE_LOCAL uint16_t OSprites_seg_sprite_freq;
+ENGINE_LOCAL int16_t OSprites_seg_spr_offset2;
+ENGINE_LOCAL int16_t OSprites_seg_spr_offset1;
+ENGINE_LOCAL uint32_t OSprites_seg_spr_addr;
+ENGINE_LOCAL uint16_t OSprites_sprite_scroll_speed;
+ENGINE_LOCAL int16_t OSprites_shadow_offset;
+ENGINE_LOCAL uint16_t OSprites_sprite_count;
+ENGINE_LOCAL uint16_t OSprites_spr_cnt_main;
+ENGINE_LOCAL uint16_t OSprites_spr_cnt_shadow;
+ENGINE_LOCAL uint64_t OSprites_sort_us;
+ENGINE_LOCAL uint16_t OSprites_peak_count;
+ENGINE_LOCAL uint32_t OSprites_dropped_frames;
 
 
 // Start of Sprite RAM
@@ -45,13 +53,13 @@ static const uint32_t SPRITE_RAM = 0x130000;
 static const uint32_t PAL_SPRITES = 0x121000;
 
 // Denote whether to swap sprite ram
-Boolean do_sprite_swap;
+ENGINE_LOCAL Boolean do_sprite_swap;
 
 // Store the next available sprite colour palette (0 - 7F)
-uint8_t spr_col_pal;
+ENGINE_LOCAL uint8_t spr_col_pal;
 
 // Stores number of palette entries to copy from rom to palram
-int16_t pal_copy_count; 
+ENGINE_LOCAL int16_t pal_copy_count; 
 
 // Palette Addresses. Used in conjunction with palette lookup table.
 // Originally stored between 0x61602 - 0x617FF in RAM
@@ -64,18 +72,28 @@ int16_t pal_copy_count;
 // Word 4: Palette RAM Destination Offset
 //
 //etc.
-uint16_t pal_addresses[0x100]; // todo: rename to pal_mapping
+ENGINE_LOCAL uint16_t pal_addresses[0x100]; // todo: rename to pal_mapping
 
 // Palette Lookup Table
-uint8_t pal_lookup[0x100];
+ENGINE_LOCAL uint8_t pal_lookup[0x100];
 
 // Converted sprite entries in RAM for hardware.
-uint8_t sprite_order[0x2000];
-uint8_t sprite_order2[0x2000];
+ENGINE_LOCAL uint8_t sprite_order[0x2000];
+ENGINE_LOCAL uint8_t sprite_order2[0x2000];
+
+// Unlimited sprites: sprites are queued with their priority, rather than
+// placed in sprite_order, which holds at most 0xE sprites per priority.
+#define SPRITE_PRIORITIES 0x200
+ENGINE_LOCAL uint8_t sprite_queue[SPRITE_LIST_MAX];
+ENGINE_LOCAL uint16_t sprite_queue_priority[SPRITE_LIST_MAX];
+ENGINE_LOCAL uint16_t sprite_queue_start[SPRITE_PRIORITIES + 1];
 
 void OSprites_sprite_control();
 void OSprites_hide_hwsprite(oentry*, osprite*);
 void OSprites_finalise_sprites();
+void OSprites_order_sprites();
+void OSprites_sort_queue();
+int16_t OSprites_next_bit(uint8_t, uint8_t, uint32_t);
 
 void OSprites_init()
 {
@@ -94,7 +112,7 @@ void OSprites_init()
     }
 
     // Reset hardware entries
-    for (i = 0; i < JUMP_ENTRIES_TOTAL; i++)
+    for (i = 0; i <= SPRITE_LIST_MAX; i++)
         osprite_init(&OSprites_sprite_entries[i]);
 
     for (i = 0; i < SPRITE_ENTRIES; i++)
@@ -122,6 +140,14 @@ void OSprites_init()
         OSprites_jump_table[i].addr = Outrun_adr.sprite_porsche; // Initial offset of traffic sprites. Will be changed.
     }
 
+    // Rush hour traffic
+    for (i = SPRITE_TRAFF_EXTRA; i < JUMP_ENTRIES_TOTAL; i++)
+    {
+        oentry_init(&OSprites_jump_table[i], i);      
+        OSprites_jump_table[i].control |= SPRITES_SHADOW;
+        OSprites_jump_table[i].addr = Outrun_adr.sprite_porsche;
+    }
+
     // ------------------------------------------------------------------------
     // Crash Sprites
     // ------------------------------------------------------------------------
@@ -177,6 +203,8 @@ void OSprites_init()
 
     spr_col_pal         = 0;
     pal_copy_count      = 0;    
+
+    OSprites_sync_active();
 }
 
 // Swap Sprite RAM And Update Palette Data
@@ -196,7 +224,92 @@ void OSprites_disable_sprites()
 {
     uint8_t i;
     for (i = 0; i < SPRITE_ENTRIES; i++)
-        OSprites_jump_table[i].control &= ~SPRITES_ENABLE;
+        OSprites_disable(&OSprites_jump_table[i]);
+}
+
+// Enable a jump table entry
+void OSprites_enable(oentry* sprite)
+{
+    const uint32_t i = (uint32_t) (sprite - OSprites_jump_table);
+
+    sprite->control |= SPRITES_ENABLE;
+    if (i < JUMP_ENTRIES_TOTAL)
+        OSprites_active[i >> 5] |= 1u << (i & 31);
+}
+
+void OSprites_disable(oentry* sprite)
+{
+    const uint32_t i = (uint32_t) (sprite - OSprites_jump_table);
+
+    sprite->control &= ~SPRITES_ENABLE;
+    if (i < JUMP_ENTRIES_TOTAL)
+        OSprites_active[i >> 5] &= ~(1u << (i & 31));
+}
+
+// Rebuild the active entries from the control bits.
+// Used after entries are written directly, for example when loaded from ROM.
+void OSprites_sync_active()
+{
+    uint16_t i;
+
+    memset(OSprites_active, 0, sizeof(OSprites_active));
+    for (i = 0; i < JUMP_ENTRIES_TOTAL; i++)
+    {
+        if (OSprites_jump_table[i].control & SPRITES_ENABLE)
+            OSprites_active[i >> 5] |= 1u << (i & 31);
+    }
+}
+
+// Returns the first enabled entry from index 'from', up to but not including 'limit'.
+// Returns -1 when there are no more.
+//
+// The active entries are read afresh on each call, so entries enabled or disabled
+// while looping are seen in the same order as a loop over every entry would see them.
+int16_t OSprites_next_active(uint8_t from, uint8_t limit)
+{
+    return OSprites_next_bit(from, limit, 0);
+}
+
+// Returns the first disabled entry from index 'from', up to but not including 'limit'.
+// Returns -1 when there are none.
+int16_t OSprites_next_inactive(uint8_t from, uint8_t limit)
+{
+    return OSprites_next_bit(from, limit, 0xFFFFFFFFu);
+}
+
+// Returns the first entry from 'from' whose active bit, once flipped by 'invert', is set
+int16_t OSprites_next_bit(uint8_t from, uint8_t limit, uint32_t invert)
+{
+    uint32_t w;
+
+    if (limit > JUMP_ENTRIES_TOTAL)
+        limit = JUMP_ENTRIES_TOTAL;
+
+    if (from >= limit)
+        return -1;
+
+    w = from >> 5;
+    uint32_t bits = (OSprites_active[w] ^ invert) & (0xFFFFFFFFu << (from & 31));
+
+    while (bits == 0)
+    {
+        if (++w >= SPRITE_ACTIVE_WORDS)
+            return -1;
+        bits = OSprites_active[w] ^ invert;
+    }
+
+#ifdef __GNUC__
+    uint32_t i = (w << 5) + __builtin_ctz(bits);
+#else
+    uint32_t i = w << 5;
+    while ((bits & 1) == 0)
+    {
+        bits >>= 1;
+        i++;
+    }
+#endif
+
+    return i < limit ? (int16_t) i : -1;
 }
 
 void OSprites_tick()
@@ -421,21 +534,32 @@ void OSprites_map_palette(oentry* spr)
 void OSprites_do_spr_order_shadows(oentry* input)
 {
     // LayOut specific fix to avoid memory crash on over populated scenery segments
-    if (OSprites_spr_cnt_main + OSprites_spr_cnt_shadow >= JUMP_ENTRIES_TOTAL)
-        return;
+    const uint16_t limit = Config_engine.unlimited_sprites ? SPRITE_LIST_MAX : JUMP_ENTRIES_ORIGINAL;
 
-    // Use priority as lookup into table. Assume we're on boundaries of 0x10
-    uint16_t priority = (input->priority & 0x1FF) << 4;
-    uint8_t bytes_to_copy = sprite_order[priority];
+    if (OSprites_spr_cnt_main + OSprites_spr_cnt_shadow >= limit)
+        return;
 
-    // Maximum number of bytes we want to copy is 0x10
-    if (bytes_to_copy < 0xE)
+    if (Config_engine.unlimited_sprites)
     {
-        bytes_to_copy++;
-        sprite_order[priority] = bytes_to_copy;
-        sprite_order[priority + bytes_to_copy + 1] = input->jump_index; // put at offset +2
+        sprite_queue[OSprites_spr_cnt_main] = input->jump_index;
+        sprite_queue_priority[OSprites_spr_cnt_main] = input->priority & 0x1FF;
         OSprites_spr_cnt_main++;
     }
+    else
+    {
+        // Use priority as lookup into table. Assume we're on boundaries of 0x10
+        uint16_t priority = (input->priority & 0x1FF) << 4;
+        uint8_t bytes_to_copy = sprite_order[priority];
+
+        // Maximum number of bytes we want to copy is 0x10
+        if (bytes_to_copy < 0xE)
+        {
+            bytes_to_copy++;
+            sprite_order[priority] = bytes_to_copy;
+            sprite_order[priority + bytes_to_copy + 1] = input->jump_index; // put at offset +2
+            OSprites_spr_cnt_main++;
+        }
+    }
 
 #if !defined (_AMIGA_)
     // Code to handle shadows under sprites
@@ -443,7 +567,7 @@ void OSprites_do_spr_order_shadows(oentry* input)
     if (!(input->control & SPRITES_SHADOW)) return;
 
     // LayOut specific fix to avoid memory crash on over populated scenery segments
-    if (OSprites_spr_cnt_main + OSprites_spr_cnt_shadow >= JUMP_ENTRIES_TOTAL)
+    if (OSprites_spr_cnt_main + OSprites_spr_cnt_shadow >= limit)
         return;
 
     input->dst_index = OSprites_spr_cnt_shadow;
@@ -495,13 +619,48 @@ void OSprites_sprite_copy()
         return;
     }
 
-    if (OSprites_spr_cnt_main + OSprites_spr_cnt_shadow > 0x7F)
+    if (!Config_engine.unlimited_sprites && OSprites_spr_cnt_main + OSprites_spr_cnt_shadow > HWSPRITES_ENTRIES - 1)
     {
+        OSprites_dropped_frames++;
         OSprites_spr_cnt_main = OSprites_spr_cnt_shadow = 0;
         OSprites_finalise_sprites();
         return;
     }
 
+    if (Outrun_profile)
+    {
+        uint32_t start = getMicroseconds();
+        OSprites_order_sprites();
+        OSprites_sort_us += getMicroseconds() - start;
+    }
+    else
+        OSprites_order_sprites();
+
+    // cont2:
+    uint16_t cnt_shadow_copy = OSprites_spr_cnt_shadow;
+
+    // next_sprite
+    for (i = 0; i < OSprites_spr_cnt_main; i++)
+    {
+        uint16_t jump_index = sprite_order2[i];
+        oentry *entry = &OSprites_jump_table[jump_index];
+        entry->dst_index = cnt_shadow_copy;
+        cnt_shadow_copy++;
+        OSprites_do_sprite(entry);
+    }
+
+    OSprites_finalise_sprites();
+}
+
+// Order the sprites queued this frame by priority, into sprite_order2
+void OSprites_order_sprites()
+{
+    if (Config_engine.unlimited_sprites)
+    {
+        OSprites_sort_queue();
+        return;
+    }
+
     uint32_t spr_cnt_main_copy = OSprites_spr_cnt_main;
 
     // look up in sprite_order
@@ -534,21 +693,24 @@ void OSprites_sprite_copy()
         // Clear number of bytes to copy
         sprite_order[src_addr] = 0; 
     }
+}
 
-    // cont2:
-    uint16_t cnt_shadow_copy = OSprites_spr_cnt_shadow;
+// Counting sort of the queued sprites by priority.
+// Sprites of equal priority keep the order they were queued in, as they do in sprite_order.
+void OSprites_sort_queue()
+{
+    uint16_t i;
+
+    memset(sprite_queue_start, 0, sizeof(sprite_queue_start));
 
-    // next_sprite
     for (i = 0; i < OSprites_spr_cnt_main; i++)
-    {
-        uint16_t jump_index = sprite_order2[i];
-        oentry *entry = &OSprites_jump_table[jump_index];
-        entry->dst_index = cnt_shadow_copy;
-        cnt_shadow_copy++;
-        OSprites_do_sprite(entry);
-    }
+        sprite_queue_start[sprite_queue_priority[i] + 1]++;
 
-    OSprites_finalise_sprites();
+    for (i = 1; i <= SPRITE_PRIORITIES; i++)
+        sprite_queue_start[i] += sprite_queue_start[i - 1];
+
+    for (i = 0; i < OSprites_spr_cnt_main; i++)
+        sprite_order2[sprite_queue_start[sprite_queue_priority[i]]++] = sprite_queue[i];
 }
 
 // Was originally labelled set_end_marker
@@ -561,6 +723,8 @@ void OSprites_sprite_copy()
 void OSprites_finalise_sprites()
 {
     OSprites_sprite_count = OSprites_spr_cnt_main + OSprites_spr_cnt_shadow;
+    if (OSprites_sprite_count > OSprites_peak_count)
+        OSprites_peak_count = OSprites_sprite_count;
     
     // Set end sprite marker
     OSprites_sprite_entries[OSprites_sprite_count].data[0] = 0xFFFF;
@@ -601,6 +765,9 @@ void OSprites_blit_sprites()
         Video_write_sprite16(&dst_addr, data[5]);
         Video_write_sprite16(&dst_addr, data[6]);
 
+        // Identify the sprite by its jump table entry, for interpolation
+        HWSprites_write_tag(i, (uint16_t) OSprites_sprite_entries[i].scratch + 1);
+
         // Allign on correct boundary
         dst_addr += 2;
     }
@@ -962,3 +1129,31 @@ void OSprites_move_sprite(oentry* sprite, uint8_t shift)
 
     sprite->z += value;
 }
+
+void OSprites_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_jump_table);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_active);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_no_sprites);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_seg_pos);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_seg_spr_addr);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_seg_spr_offset1);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_seg_spr_offset2);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_seg_sprite_freq);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_seg_total_sprites);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_shadow_offset);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_spr_cnt_main);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_spr_cnt_shadow);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_sprite_count);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_sprite_entries);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OSprites_sprite_scroll_speed);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, do_sprite_swap);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, pal_addresses);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, pal_copy_count);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, pal_lookup);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, spr_col_pal);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, sprite_order);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, sprite_queue);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, sprite_queue_priority);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, sprite_order2);
+}
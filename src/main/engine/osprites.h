@@ -17,6 +17,7 @@
 #include "oentry.h"
 #include "osprite.h"
 #include "outrun.h"
+#include "hwvideo/hwsprites.h"
 
 
 enum 
@@ -39,10 +40,16 @@ enum
 #define SPRITE_ENTRIES 0x62
     
 // This is initalized based on the config
-extern uint8_t OSprites_no_sprites;
+extern ENGINE_LOCAL uint8_t OSprites_no_sprites;
 
-// Total number of object entries, including SPRITE_ENTRIES, FERRARI, PASSENGERS, TRAFFIC etc.
-#define JUMP_ENTRIES_TOTAL          (SPRITE_ENTRIES + 24)
+// Traffic slots available for rush hour mode. The first eight are SPRITE_TRAFF1 to SPRITE_TRAFF8.
+#define TRAFFIC_SLOTS_MAX           128
+
+// Object entries of the original game, including SPRITE_ENTRIES, FERRARI, PASSENGERS, TRAFFIC etc.
+#define JUMP_ENTRIES_ORIGINAL       (SPRITE_ENTRIES + 24)
+
+// Total number of object entries, including the extra traffic slots
+#define JUMP_ENTRIES_TOTAL          (JUMP_ENTRIES_ORIGINAL + TRAFFIC_SLOTS_MAX - 8)
 
 #define SPRITE_FERRARI              (SPRITE_ENTRIES + 1)
 #define SPRITE_PASS1                (SPRITE_ENTRIES + 2)   // Passengers
@@ -68,54 +75,84 @@ extern uint8_t OSprites_no_sprites;
 
 #define SPRITE_FLAG                 (SPRITE_ENTRIES + 21)    // Flag Man
 
+#define SPRITE_TRAFF_EXTRA          JUMP_ENTRIES_ORIGINAL    // Rush Hour Traffic Entries 9 Onwards
+
 // Jump Table Sprite Entries
-extern oentry OSprites_jump_table[JUMP_ENTRIES_TOTAL]; 
+extern ENGINE_LOCAL oentry OSprites_jump_table[JUMP_ENTRIES_TOTAL]; 
+
+// Enabled jump table entries, one bit per entry.
+// Kept in step with SPRITES_ENABLE for the level objects and traffic, so loops over them can skip idle entries.
+// The other entries have their control bits written directly, and their bits should not be relied on.
+#define SPRITE_ACTIVE_WORDS ((JUMP_ENTRIES_TOTAL + 31) >> 5)
+extern ENGINE_LOCAL uint32_t OSprites_active[SPRITE_ACTIVE_WORDS];
+
+// Sprites that can be drawn in a frame when Config_engine.unlimited_sprites is set.
+// Every jump table entry, plus its shadow.
+#define SPRITE_LIST_MAX             (JUMP_ENTRIES_TOTAL * 2)
 
-// Converted sprite entries in RAM for hardware.
-extern osprite OSprites_sprite_entries[JUMP_ENTRIES_TOTAL];
+#if (SPRITE_LIST_MAX + 1) > HWSPRITES_ENTRIES_MAX
+#error "SPRITE_LIST_MAX exceeds the emulated sprite RAM. Increase HWSPRITES_ENTRIES_MAX."
+#endif
+
+// Converted sprite entries in RAM for hardware. Includes the end marker.
+extern ENGINE_LOCAL osprite OSprites_sprite_entries[SPRITE_LIST_MAX + 1];
 
 // -------------------------------------------------------------------------
 // Jump Table 2 Entries For Sprite Control
 // -------------------------------------------------------------------------
 
 // +22 [Word] Road Position For Next Segment Of Sprites
-extern uint16_t OSprites_seg_pos;
+extern ENGINE_LOCAL uint16_t OSprites_seg_pos;
 
 // +24 [Byte] Number Of Sprites In Segment  
-extern uint8_t OSprites_seg_total_sprites;
+extern ENGINE_LOCAL uint8_t OSprites_seg_total_sprites;
 
 // +26 [Word] Sprite Frequency Bitmask
-extern uint16_t OSprites_seg_sprite_freq;
+extern ENGINE_LOCAL uint16_t OSprites_seg_sprite_freq;
 
 // +28 [Word] Sprite Info Offset - Start Value. Loaded Into 2A. 
-extern int16_t OSprites_seg_spr_offset2;
+extern ENGINE_LOCAL int16_t OSprites_seg_spr_offset2;
 
 // +2A [Word] Sprite Info Offset
-extern int16_t OSprites_seg_spr_offset1;
+extern ENGINE_LOCAL int16_t OSprites_seg_spr_offset1;
 
 // +2C [Long] Sprite Info Base - Lookup for Sprite X World, Sprite Y World, Sprite Type Table Info [8 byte boundary blocks in ROM]
-extern uint32_t OSprites_seg_spr_addr;
+extern ENGINE_LOCAL uint32_t OSprites_seg_spr_addr;
 
 // -------------------------------------------------------------------------
 
 // Speed at which sprites should scroll. Depends on granular position difference.
-extern uint16_t OSprites_sprite_scroll_speed;
+extern ENGINE_LOCAL uint16_t OSprites_sprite_scroll_speed;
 
 // Shadow multiplication value (signed). Offsets the shadow from the sprite.
 // Adjusted by the tilemap horizontal scroll, so shadows change depending on how much we've scrolled left and right
-extern int16_t OSprites_shadow_offset;
+extern ENGINE_LOCAL int16_t OSprites_shadow_offset;
 
 // Number of sprites to draw for sprite drawing routine (sum of spr_cnt_main and spr_cnt_shadow).
-extern uint16_t OSprites_sprite_count;
+extern ENGINE_LOCAL uint16_t OSprites_sprite_count;
 
 // Number of sprites to draw
-extern uint16_t OSprites_spr_cnt_main;
+extern ENGINE_LOCAL uint16_t OSprites_spr_cnt_main;
 
 // Number of shadows to draw
-extern uint16_t OSprites_spr_cnt_shadow;
+extern ENGINE_LOCAL uint16_t OSprites_spr_cnt_shadow;
+
+// Profiling: time spent ordering sprites by priority, when Outrun_profile is set
+extern ENGINE_LOCAL uint64_t OSprites_sort_us;
+
+// Most sprites drawn in a single frame
+extern ENGINE_LOCAL uint16_t OSprites_peak_count;
+
+// Frames where every sprite was dropped, for exceeding the hardware limit
+extern ENGINE_LOCAL uint32_t OSprites_dropped_frames;
 
 void OSprites_init();
 void OSprites_disable_sprites();
+void OSprites_enable(oentry*);
+void OSprites_disable(oentry*);
+void OSprites_sync_active();
+int16_t OSprites_next_active(uint8_t, uint8_t);
+int16_t OSprites_next_inactive(uint8_t, uint8_t);
 void OSprites_tick();
 void OSprites_update_sprites();
 
@@ -131,4 +168,5 @@ void OSprites_set_sprite_xy(oentry*, osprite*, uint16_t, uint16_t);
 void OSprites_set_hrender(oentry*, osprite*, uint16_t, uint16_t);
 
 void OSprites_move_sprite(oentry*, uint8_t);
+void OSprites_register_state();
 
@@ -14,11 +14,12 @@
 #include "engine/outils.h"
 #include "engine/ostats.h"
 #include "engine/otraffic.h"
+#include "savestate.h"
 
 
 
 // Converted Stage Millisecond Value
-uint8_t ms_value;
+ENGINE_LOCAL uint8_t ms_value;
 
 void OStats_inc_lap_timer();
 
@@ -44,18 +45,18 @@ const static uint8_t LAP_MS_60[] =
     0x76, 0x78, 0x80, 0x81, 0x83, 0x85, 0x86, 0x88, 0x90, 0x91, 0x93, 0x95, 0x96, 0x98
 };
 
-int8_t OStats_cur_stage;
-uint32_t OStats_score;
-uint16_t OStats_route_info;
-uint16_t OStats_routes[0x8]; 
-int16_t OStats_frame_counter;
-int16_t OStats_time_counter;
-int16_t OStats_extend_play_timer;
-int16_t OStats_stage_counters[15];
-Boolean OStats_game_completed;
+ENGINE_LOCAL int8_t OStats_cur_stage;
+ENGINE_LOCAL uint32_t OStats_score;
+ENGINE_LOCAL uint16_t OStats_route_info;
+ENGINE_LOCAL uint16_t OStats_routes[0x8]; 
+ENGINE_LOCAL int16_t OStats_frame_counter;
+ENGINE_LOCAL int16_t OStats_time_counter;
+ENGINE_LOCAL int16_t OStats_extend_play_timer;
+ENGINE_LOCAL int16_t OStats_stage_counters[15];
+ENGINE_LOCAL Boolean OStats_game_completed;
 const uint8_t* OStats_lap_ms = LAP_MS_64;
-uint8_t OStats_credits;
-uint8_t OStats_stage_times[15][3];
+ENGINE_LOCAL uint8_t OStats_credits;
+ENGINE_LOCAL uint8_t OStats_stage_times[15][3];
 
 void OStats_init(Boolean ttrial)
 {
@@ -273,3 +274,19 @@ void OStats_init_next_level()
 //         '---------------------------'
 
 
+// The lap timer table follows the configured frame rate and is not included.
+void OStats_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OStats_credits);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OStats_cur_stage);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OStats_extend_play_timer);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OStats_frame_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OStats_game_completed);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OStats_route_info);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OStats_routes);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OStats_score);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OStats_stage_counters);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OStats_stage_times);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OStats_time_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, ms_value);
+}
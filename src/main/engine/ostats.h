@@ -23,10 +23,10 @@
 //                  
 // A good way to quickly see the end sequence is to set this to '4' and play 
 // through the first level.
-extern int8_t OStats_cur_stage;
+extern ENGINE_LOCAL int8_t OStats_cur_stage;
 
 // Score (Outputs Hex values directly)
-extern uint32_t OStats_score;
+extern ENGINE_LOCAL uint32_t OStats_score;
 
 // Store info on the route taken by the player
 //
@@ -41,27 +41,27 @@ extern uint32_t OStats_score;
 // Stage 5 = Road doesn't split on this stage
 //
 // So if we reach Stage 2 (left route) we do 10 + 8 = 18
-extern uint16_t OStats_route_info;
+extern ENGINE_LOCAL uint16_t OStats_route_info;
 
 // Stores route_info for each stage. Used by course map screen
 // First entry stores upcoming stage number
-extern uint16_t OStats_routes[0x8]; 
+extern ENGINE_LOCAL uint16_t OStats_routes[0x8]; 
 
 // Frame Counter Reset/Load Value.
 // Load frame counter with this value when the counter has decremented and expired.
 // Note: Values stored and used in hex.
-extern int16_t OStats_frame_counter;
+extern ENGINE_LOCAL int16_t OStats_frame_counter;
 const static int16_t OStats_frame_reset = 30; 
 
 // Time Counter (Frames). Counts downwards from 30.
 // Used in correspondence with 0x60860.
 // Note: Values stored and used in hex.
-extern int16_t OStats_time_counter;
+extern ENGINE_LOCAL int16_t OStats_time_counter;
 
 // Extend Play Timer.
 //
 // Loaded to 0x80 when EXTEND PLAY! banner should flash
-extern int16_t OStats_extend_play_timer;
+extern ENGINE_LOCAL int16_t OStats_extend_play_timer;
 
 // Time data array
 static const uint8_t STATS_TIME[] =
@@ -97,18 +97,18 @@ static const uint8_t STATS_TIME[] =
 
 // Counters that increment with each game tick.
 // Each stage has an independent counter (increased to 15 from 5 to support continuous mode)
-extern int16_t OStats_stage_counters[15];
+extern ENGINE_LOCAL int16_t OStats_stage_counters[15];
 
 // Set when game completed
-extern Boolean OStats_game_completed;
+extern ENGINE_LOCAL Boolean OStats_game_completed;
 
 extern const uint8_t* OStats_lap_ms;
 
 // Number of credits inserted
-extern uint8_t OStats_credits;
+extern ENGINE_LOCAL uint8_t OStats_credits;
 
 // Each stage has an entry for minutes, seconds and MS. (Extended to 15 from 5 to support continuous mode)
-extern uint8_t OStats_stage_times[15][3];
+extern ENGINE_LOCAL uint8_t OStats_stage_times[15][3];
 
 
 void OStats_init(Boolean);
@@ -121,4 +121,5 @@ void OStats_do_timers();
 void OStats_convert_speed_score(uint16_t);
 void OStats_update_score(uint32_t);
 void OStats_init_next_level();
+void OStats_register_state();
 
@@ -11,63 +11,96 @@
     See license.txt for more details.
 ***************************************************************************/
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "../trackloader.h"
+#include "arena.h"
 #include "engine/opalette.h"
 #include "engine/otiles.h"
+#include "savestate.h"
 
 
-uint8_t OTiles_tilemap_ctrl;
+ENGINE_LOCAL uint8_t OTiles_tilemap_ctrl;
 
 // Page to use for tilemap. Alternates between 0 and 1 dependent on stage number
 // to handle switch between tilemaps at stage end.
-int8_t page;
+ENGINE_LOCAL int8_t page;
 
 // Enhancement: Used for continuous mode
-int16_t vswap_state;
+ENGINE_LOCAL int16_t vswap_state;
 enum {VSWAP_OFF, VSWAP_SCROLL_OFF, VSWAP_SCROLL_ON};
 
-int16_t vswap_off;
+ENGINE_LOCAL int16_t vswap_off;
 
 // -----------------------------------------------------------------------
 // TILEMAP VARIABLES 
 // -----------------------------------------------------------------------
 
 // Scroll values to write to foreground & background tilemaps
-int16_t fg_h_scroll;
-int16_t bg_h_scroll;
-int16_t fg_v_scroll;
-int16_t bg_v_scroll;
+ENGINE_LOCAL int16_t fg_h_scroll;
+ENGINE_LOCAL int16_t bg_h_scroll;
+ENGINE_LOCAL int16_t fg_v_scroll;
+ENGINE_LOCAL int16_t bg_v_scroll;
 
-uint16_t fg_psel;
-uint16_t bg_psel;
+ENGINE_LOCAL uint16_t fg_psel;
+ENGINE_LOCAL uint16_t bg_psel;
 
 // + 0xC Current master tilemap scroll values
-int16_t tilemap_v_scr;
-int32_t tilemap_h_scr;
+ENGINE_LOCAL int16_t tilemap_v_scr;
+ENGINE_LOCAL int32_t tilemap_h_scr;
 
 // BG & FG Tilemap Height in Tiles
-uint16_t fg_v_tiles;
-uint16_t bg_v_tiles;
+ENGINE_LOCAL uint16_t fg_v_tiles;
+ENGINE_LOCAL uint16_t bg_v_tiles;
 
 // + 0x16 Tilemap v-scroll offset. Generally static.
-int16_t tilemap_v_off;
+ENGINE_LOCAL int16_t tilemap_v_off;
 
 // FG & BG Tilemap ROM Address [long]
-uint32_t fg_addr;
-uint32_t bg_addr;
+ENGINE_LOCAL uint32_t fg_addr;
+ENGINE_LOCAL uint32_t bg_addr;
 	
 // + 0x20: Toggle between loading palette and loading tiles
-uint8_t tilemap_setup;
+ENGINE_LOCAL uint8_t tilemap_setup;
 enum { SETUP_TILES, SETUP_PAL };
 
 // + 0x22: Clear Old Name Tables
-Boolean clear_name_tables;
+ENGINE_LOCAL Boolean clear_name_tables;
 
 // + 0x23: Set when road is splitting (used by UpdateFGPage and UpdateBGPage)
-Boolean page_split;
+ENGINE_LOCAL Boolean page_split;
 
 // + 0x24: H-Scroll Lookup Table
-uint16_t h_scroll_lookup;
+ENGINE_LOCAL uint16_t h_scroll_lookup;
+
+// -----------------------------------------------------------------------
+// DECOMPRESSED TILEMAP CACHE
+//
+// Name tables are stored RLE compressed in ROM. Rather than uncompressing
+// them at the point of a road split, each tilemap is uncompressed once and
+// stage switches become row copies into Tile RAM.
+// -----------------------------------------------------------------------
+
+// Two sets of stages (Western & Japanese), each with a FG and BG tilemap
+#define TILEMAP_CACHE_ENTRIES (STAGES * 4)
+
+// Bytes per row of a 64 column name table
+#define TILEMAP_ROW_BYTES 0x80
+
+typedef struct
+{
+    uint32_t src_addr;        // ROM address of compressed name tables
+    uint16_t v_tiles;         // Name table height in tiles
+    uint8_t  tables;          // Number of name tables
+    uint8_t* data;            // Uncompressed rows in Tile RAM byte order
+} tilemap_cache_t;
+
+tilemap_cache_t tilemap_cache[TILEMAP_CACHE_ENTRIES];
+uint8_t tilemap_cache_count;
+
+uint32_t OTiles_decompress_count;
+uint32_t OTiles_cache_bytes;
 
 // -----------------------------------------------------------------------
     
@@ -84,6 +117,11 @@ void OTiles_h_scroll_tilemaps();
 void OTiles_v_scroll_tilemaps();
 void OTiles_copy_fg_tiles(uint32_t);
 void OTiles_copy_bg_tiles(uint32_t);
+void OTiles_copy_tiles(uint32_t, uint16_t, uint8_t, uint32_t);
+void OTiles_write_tile_rows(const uint8_t*, uint16_t, uint8_t, uint32_t);
+void OTiles_decompress_tiles(uint32_t, uint16_t, uint8_t, uint8_t*);
+int16_t OTiles_cache_rows(uint16_t);
+tilemap_cache_t* OTiles_get_cache_entry(uint32_t, uint16_t, uint8_t);
 void OTiles_update_fg_page();
 void OTiles_update_bg_page();
 void OTiles_update_fg_page_split();
@@ -348,84 +386,102 @@ void OTiles_init_tilemap_props(uint16_t stage_id)
 // - Uncompress the tilemap from ROM and place into Tile RAM
 // - The FG tilemap is defined by a 128x64 virtual name table, which is itself composed of four smaller 64x32 name tables.
 //
+// The decompressed name tables are taken from the tilemap cache where possible.
+//
 // Source: 0xDCF2
 
 void OTiles_copy_fg_tiles(uint32_t dst_addr)
 {
-    uint8_t i;
-    
-    uint32_t src_addr = fg_addr;
-    uint16_t offset = 0;          // Offset into Tile RAM (e.g. the name table to use)
+    OTiles_copy_tiles(fg_addr, fg_v_tiles, 4, dst_addr);
+}
 
-    // Each tiled background is composed of 4 smaller 64x32 name tables. This counter iterates through them.
-    for (i = 0; i < 4; i++)
+// Copy Background Tiles
+// 
+// Note, this is virtually the same as the foreground method,
+// aside from only copying 3 nametables, instead of 4.
+//
+// Source: 0xDD46
+void OTiles_copy_bg_tiles(uint32_t dst_addr)
+{
+    OTiles_copy_tiles(bg_addr, bg_v_tiles, 3, dst_addr);
+}
+
+// Copy a set of decompressed name tables to Tile RAM.
+//
+// Each row is written from the bottom of the name table upwards, 64 tiles (0x80 bytes) at a time.
+void OTiles_copy_tiles(uint32_t src_addr, uint16_t v_tiles, uint8_t tables, uint32_t dst_addr)
+{
+    tilemap_cache_t* entry = OTiles_get_cache_entry(src_addr, v_tiles, tables);
+
+    // Not cached: Decompress straight from ROM.
+    // Batch instances run on threads that can not allocate from the arena.
+    if (entry == NULL)
     {
-        // next_name_table:
-        uint32_t tileram_addr = dst_addr + offset;
-        int16_t y = fg_v_tiles - 1;
+        uint32_t size = TILEMAP_ROW_BYTES * OTiles_cache_rows(v_tiles) * tables;
+        uint8_t* data = Outrun_batch_instance ? (uint8_t*) malloc(size) : (uint8_t*) Arena_alloc(ARENA_LOAD, size);
+        if (data == NULL)
+            return;
 
-        // next_tile_y:
-        do
+        OTiles_decompress_tiles(src_addr, v_tiles, tables, data);
+        OTiles_write_tile_rows(data, v_tiles, tables, dst_addr);
+
+        if (Outrun_batch_instance)
+            free(data);
+        else
+            Arena_free(data);
+        return;
+    }
+
+    OTiles_write_tile_rows(entry->data, v_tiles, tables, dst_addr);
+}
+
+void OTiles_write_tile_rows(const uint8_t* data, uint16_t v_tiles, uint8_t tables, uint32_t dst_addr)
+{
+    uint8_t t;
+    int16_t r;
+    const int16_t rows = OTiles_cache_rows(v_tiles);
+
+    for (t = 0; t < tables; t++)
+    {
+        uint32_t tileram_addr = dst_addr + (t * 0x1000);
+
+        for (r = 0; r < rows; r++)
         {
-            int16_t x = 0x3F;       // TILERAM is 0x40 Columns Wide x 8 pixels = 512
-            // next_tilex:
-            do
-            {
-                uint32_t data = RomLoader_read16IncP(&Roms_rom0, &src_addr);
+            uint32_t adr = tileram_addr & 0xFFFF;
 
-                // Compression
-                if (data == 0)
-                {
-                    uint16_t value = RomLoader_read16IncP(&Roms_rom0, &src_addr); // tile index to copy
-                    uint16_t count = RomLoader_read16IncP(&Roms_rom0, &src_addr); // number of times to copy value
-                
-                    // copy_compressed:
-                    for (i = 0; i <= count; i++)
-                    {
-                        Video_write_tile16IncP(&tileram_addr, value);
-                        if (--x < 0)
-                            break; // Break out of do/while loop to compression_done
-                    }
-                }
-                // No Compression
-                else
-                {
-                    // copy_next_word:
-                    Video_write_tile16IncP(&tileram_addr, data);
-                    --x;
-                }
-                // cont:
+            if (adr + TILEMAP_ROW_BYTES <= sizeof(HWTiles_tile_ram))
+            {
+                memcpy(&HWTiles_tile_ram[adr], data, TILEMAP_ROW_BYTES);
+            }
+            else
+            {
+                uint16_t i;
+                for (i = 0; i < TILEMAP_ROW_BYTES; i++)
+                    HWTiles_tile_ram[(adr + i) & 0xFFFF] = data[i];
             }
-            while (x >= 0);
-            // compression_done:
 
-            // Previous row in tileram (256 pixels)
-            tileram_addr -= 0x100;
+            data += TILEMAP_ROW_BYTES;
+            tileram_addr -= TILEMAP_ROW_BYTES; // Previous row in tileram
         }
-        while (--y >= 0);
-
-        offset += 0x1000; // Bytes between each name table
     }
 }
 
-// Copy Background Tiles
-// 
-// Note, this is virtually the same as the foreground method,
-// aside from only copying 3 nametables, instead of 4.
+// Uncompress name tables from ROM into a linear buffer of rows.
 //
-// Source: 0xDD46
-void OTiles_copy_bg_tiles(uint32_t dst_addr)
+// Rows are stored in the order they are written to Tile RAM (bottom row first), 
+// in Tile RAM byte order, so they can be block copied.
+void OTiles_decompress_tiles(uint32_t src_addr, uint16_t v_tiles, uint8_t tables, uint8_t* dst)
 {
-    uint8_t i;
-    uint32_t src_addr = bg_addr;
-    uint16_t offset = 0;          // Offset into Tile RAM (e.g. the name table to use)
+    uint8_t t;
+    uint16_t i;
 
-    // Each tiled background is composed of 3 smaller 64x32 name tables. This counter iterates through them.
-    for (i = 0; i < 3; i++)
+    OTiles_decompress_count++;
+
+    // Each tiled background is composed of smaller 64x32 name tables. This counter iterates through them.
+    for (t = 0; t < tables; t++)
     {
         // next_name_table:
-        uint32_t tileram_addr = dst_addr + offset;
-        int16_t y = bg_v_tiles - 1;
+        int16_t y = v_tiles - 1;
 
         // next_tile_y:
         do
@@ -434,7 +490,7 @@ void OTiles_copy_bg_tiles(uint32_t dst_addr)
             // next_tilex:
             do
             {
-                uint32_t data = RomLoader_read16IncP(&Roms_rom0, &src_addr);
+                uint16_t data = RomLoader_read16IncP(&Roms_rom0, &src_addr);
 
                 // Compression
                 if (data == 0)
@@ -445,7 +501,8 @@ void OTiles_copy_bg_tiles(uint32_t dst_addr)
                     // copy_compressed:
                     for (i = 0; i <= count; i++)
                     {
-                        Video_write_tile16IncP(&tileram_addr, value);
+                        *dst++ = (value >> 8) & 0xFF;
+                        *dst++ = value & 0xFF;
                         if (--x < 0)
                             break; // Break out of do/while loop to compression_done
                     }
@@ -454,21 +511,93 @@ void OTiles_copy_bg_tiles(uint32_t dst_addr)
                 else
                 {
                     // copy_next_word:
-                    Video_write_tile16IncP(&tileram_addr, data);
+                    *dst++ = (data >> 8) & 0xFF;
+                    *dst++ = data & 0xFF;
                     --x;
                 }
                 // cont:
             }
             while (x >= 0);
             // compression_done:
-
-            // Previous row in tileram (256 pixels)
-            tileram_addr -= 0x100;
         }
         while (--y >= 0);
+    }
+}
 
-        offset += 0x1000; // Bytes between each name table
+// Number of rows decompressed for a name table. The original routine always processes at least one row.
+int16_t OTiles_cache_rows(uint16_t v_tiles)
+{
+    return v_tiles ? v_tiles : 1;
+}
+
+// Find decompressed name tables in the cache, decompressing them on first use.
+//
+// Returns NULL if the cache is full. Batch instances only read the cache, which is shared.
+tilemap_cache_t* OTiles_get_cache_entry(uint32_t src_addr, uint16_t v_tiles, uint8_t tables)
+{
+    uint8_t i;
+    tilemap_cache_t* entry;
+
+    for (i = 0; i < tilemap_cache_count; i++)
+    {
+        entry = &tilemap_cache[i];
+        if (entry->src_addr == src_addr && entry->v_tiles == v_tiles && entry->tables == tables)
+            return entry;
+    }
+
+    if (tilemap_cache_count >= TILEMAP_CACHE_ENTRIES || Outrun_batch_instance)
+        return NULL;
+
+    entry           = &tilemap_cache[tilemap_cache_count++];
+    entry->src_addr = src_addr;
+    entry->v_tiles  = v_tiles;
+    entry->tables   = tables;
+    entry->data     = (uint8_t*) Arena_alloc(ARENA_ROM, TILEMAP_ROW_BYTES * OTiles_cache_rows(v_tiles) * tables);
+    OTiles_decompress_tiles(src_addr, v_tiles, tables, entry->data);
+    OTiles_cache_bytes += TILEMAP_ROW_BYTES * OTiles_cache_rows(v_tiles) * tables;
+    return entry;
+}
+
+// Decompress the FG & BG tilemaps of every stage into the cache.
+//
+// Called when the course is selected, so that no decompression happens during gameplay.
+// OTiles_decompress_count is reset afterwards and should remain zero from this point.
+// Batch instances rely on this having been called on the main thread before they start.
+void OTiles_precache_tilemaps()
+{
+    uint8_t i;
+
+    static const uint16_t STAGE_ORDER[] = { 0, 
+                                            0x8, 0x9, 
+                                            0x10, 0x11, 0x12, 
+                                            0x18, 0x19, 0x1A, 0x1B, 
+                                            0x20, 0x21, 0x22, 0x23, 0x24};
+
+    for (i = 0; i < STAGES; i++)
+    {
+        uint8_t offset = (RomLoader_read8(Roms_rom0p, Outrun_adr.tiles_def_lookup + STAGE_ORDER[i]) << 2) * 3;
+        uint32_t addr  = Outrun_adr.tiles_table + offset;
+
+        uint16_t fg_tiles = RomLoader_read8IncP(Roms_rom0p, &addr);
+        uint16_t bg_tiles = RomLoader_read8IncP(Roms_rom0p, &addr);
+        uint32_t fg_src   = RomLoader_read32IncP(Roms_rom0p, &addr);
+        uint32_t bg_src   = RomLoader_read32IncP(Roms_rom0p, &addr);
+
+        OTiles_get_cache_entry(fg_src, fg_tiles, 4);
+        OTiles_get_cache_entry(bg_src, bg_tiles, 3);
     }
+
+    OTiles_decompress_count = 0;
+}
+
+// Print the size of the tilemap cache, and any decompressions since it was filled. Called at exit.
+void OTiles_report()
+{
+    if (tilemap_cache_count == 0)
+        return;
+
+    fprintf(stderr, "Tilemap Cache: %u entries, %u bytes. %u decompressions after precache.\n",
+            tilemap_cache_count, OTiles_cache_bytes, OTiles_decompress_count);
 }
 
 // Source: D910
@@ -917,3 +1046,29 @@ void OTiles_set_scroll(int16_t h_scroll, int16_t v_scroll)
     fg_psel = 0xFFFF;
     bg_psel = 0xFFFF;
 }
+
+// The tilemap cache and its statistics are derived from ROM, and are not included.
+void OTiles_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OTiles_tilemap_ctrl);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, bg_addr);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, bg_h_scroll);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, bg_psel);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, bg_v_scroll);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, bg_v_tiles);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, clear_name_tables);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, fg_addr);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, fg_h_scroll);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, fg_psel);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, fg_v_scroll);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, fg_v_tiles);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, h_scroll_lookup);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, page);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, page_split);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, tilemap_h_scr);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, tilemap_setup);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, tilemap_v_off);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, tilemap_v_scr);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, vswap_off);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, vswap_state);
+}
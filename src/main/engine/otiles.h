@@ -20,10 +20,19 @@
 // 1 = Scroll Tilemap
 // 2 = Init Tilemap
 // 3 = New Tilemap Initialized - Scroll both tilemaps during tilesplit
-extern uint8_t OTiles_tilemap_ctrl;
+extern ENGINE_LOCAL uint8_t OTiles_tilemap_ctrl;
 enum { TILEMAP_CLEAR, TILEMAP_SCROLL, TILEMAP_INIT, TILEMAP_SPLIT };
 
+// Number of tilemap decompressions since the cache was last primed.
+// Should remain zero during gameplay.
+extern uint32_t OTiles_decompress_count;
+
+// Memory used by the decompressed tilemap cache
+extern uint32_t OTiles_cache_bytes;
+
 void OTiles_init();
+void OTiles_precache_tilemaps();
+void OTiles_report();
 void OTiles_set_vertical_swap();
 void OTiles_setup_palette_tilemap();
 void OTiles_setup_palette_widescreen();
@@ -34,5 +43,6 @@ void OTiles_init_tilemap_palette(uint16_t);
 void OTiles_fill_tilemap_color(uint16_t);
 void OTiles_write_tilemap_hw();
 void OTiles_set_scroll(int16_t h_scroll, int16_t v_scroll);
+void OTiles_register_state();
 
 
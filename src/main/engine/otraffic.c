@@ -18,12 +18,13 @@
 #include "engine/outils.h"
 #include "engine/ostats.h"
 #include "engine/otraffic.h"
+#include "savestate.h"
 
-uint8_t OTraffic_ai_traffic;
-uint8_t OTraffic_bonus_lhs;
-int8_t OTraffic_traffic_split;
-uint16_t OTraffic_collision_traffic;
-uint16_t OTraffic_collision_mask;
+ENGINE_LOCAL uint8_t OTraffic_ai_traffic;
+ENGINE_LOCAL uint8_t OTraffic_bonus_lhs;
+ENGINE_LOCAL int8_t OTraffic_traffic_split;
+ENGINE_LOCAL uint16_t OTraffic_collision_traffic;
+ENGINE_LOCAL uint16_t OTraffic_collision_mask;
 
 // -------------------------------------------------------------------------
 // Function Holders
@@ -36,35 +37,41 @@ enum
 };
 
 // Onscreen traffic objects
-oentry* traffic_adr[9];
+ENGINE_LOCAL oentry* traffic_adr[TRAFFIC_SLOTS_MAX + 1];
+
+// Traffic slots in use. Eight, unless rush hour is enabled.
+ENGINE_LOCAL uint8_t traffic_slots;
+
+// Rush hour: lanes traffic is indexed by, from left to right
+#define TRAFFIC_LANES 3
 
 // Maximum number of on-screen enemies
-uint8_t max_traffic;
+ENGINE_LOCAL uint8_t max_traffic;
 
 // Total speed of all traffic combined
-int16_t traffic_speed_total;
+ENGINE_LOCAL int16_t traffic_speed_total;
 
 // Average speed of traffic. Used to control wheel frames of traffic sprites.
-int16_t traffic_speed_avg;
+ENGINE_LOCAL int16_t traffic_speed_avg;
 
 // Traffic Palette Cycle. This alternates between 0 and 1.
 // Essentially changes the palette, so that the wheels on the traffic appear to be in motion.
-uint8_t traffic_pal_cycle;
+ENGINE_LOCAL uint8_t traffic_pal_cycle;
 
 // Number of traffic spawned
-int16_t traffic_count;
+ENGINE_LOCAL int16_t traffic_count;
 
 // +1E [Word] Spawn Tick Counter. Used as a somewhat unrandom way of spawning cars.
-int16_t spawn_counter;
+ENGINE_LOCAL int16_t spawn_counter;
 
 // +20 [Word] Left Hand / Right Hand Spawn Control. Controls where next car should spawn.
-int16_t spawn_location;
+ENGINE_LOCAL int16_t spawn_location;
 
 // +22 [Word] Wheel Animation Reset Value
-int16_t wheel_reset;
+ENGINE_LOCAL int16_t wheel_reset;
 
 // +24 [Word] Wheel Animation Counter
-int16_t wheel_counter;
+ENGINE_LOCAL int16_t wheel_counter;
 
 void OTraffic_spawn_car(oentry* sprite);
 void OTraffic_spawn_traffic();
@@ -74,6 +81,9 @@ void OTraffic_update_props(oentry* sprite);
 void OTraffic_set_zoom_lookup(oentry* sprite);
 void OTraffic_calculate_avg_speed(uint16_t);
 void OTraffic_check_collision(oentry* sprite);
+void OTraffic_tick_slot(oentry* sprite);
+void OTraffic_check_proximity(oentry* first, oentry* next);
+void OTraffic_traffic_logic_lanes();
 
 void OTraffic_init()
 {
@@ -83,6 +93,8 @@ void OTraffic_init()
     OTraffic_collision_traffic = 0;
     OTraffic_collision_mask    = 0;
 
+    traffic_slots = Config_engine.rush_hour ? Config_engine.rush_hour : 8;
+
     traffic_speed_total = 0;
     traffic_speed_avg   = 0;
     traffic_pal_cycle   = 0;
@@ -139,6 +151,9 @@ void OTraffic_init_stage1_traffic()
     t->z               = 0x1D004E0;
     t->type            = 0x30; 
     t->xw2             = -0x70;
+
+    // Traffic was enabled directly above
+    OSprites_sync_active();
 }
 
 // Tick Spawned Traffic Objects
@@ -153,33 +168,44 @@ void OTraffic_tick()
         OTraffic_spawn_traffic();
 
     for (i = SPRITE_TRAFF1; i <= SPRITE_TRAFF8; i++)
+        OTraffic_tick_slot(&OSprites_jump_table[i]);
+
+    // Rush hour: only slots in use are ticked
+    if (traffic_slots > 8)
     {
-        oentry* sprite = &OSprites_jump_table[i];
+        const uint8_t end = SPRITE_TRAFF_EXTRA + traffic_slots - 8;
+        int16_t j;
 
-        if (sprite->function_holder == TRAFFIC_INIT)
-        {
-            if (Outrun_game_state != GS_INGAME && Outrun_game_state != GS_ATTRACT)
-            {
-                sprite->traffic_proximity = 0;
-                OTraffic_move_spawned_sprite(sprite); // Skip collision code
-                continue;
-            }
-            sprite->traffic_orig_speed = 0xD4;
-            sprite->function_holder = TRAFFIC_ENTRY;
-        }
+        for (j = OSprites_next_active(SPRITE_TRAFF_EXTRA, end); j >= 0; j = OSprites_next_active(j + 1, end))
+            OTraffic_tick_slot(&OSprites_jump_table[j]);
+    }
+}
 
-        // Skip collision code in first section of level
-        if (sprite->function_holder == TRAFFIC_ENTRY)
+void OTraffic_tick_slot(oentry* sprite)
+{
+    if (sprite->function_holder == TRAFFIC_INIT)
+    {
+        if (Outrun_game_state != GS_INGAME && Outrun_game_state != GS_ATTRACT)
         {
-            if (ORoad_road_pos >> 16 >= 0x80)
-                sprite->function_holder = TRAFFIC_TICK;
-            else
-                OTraffic_move_spawned_sprite(sprite); // Skip collision code
+            sprite->traffic_proximity = 0;
+            OTraffic_move_spawned_sprite(sprite); // Skip collision code
+            return;
         }
+        sprite->traffic_orig_speed = 0xD4;
+        sprite->function_holder = TRAFFIC_ENTRY;
+    }
 
-        if (sprite->function_holder == TRAFFIC_TICK)
-            OTraffic_tick_spawned_sprite(sprite);
+    // Skip collision code in first section of level
+    if (sprite->function_holder == TRAFFIC_ENTRY)
+    {
+        if (ORoad_road_pos >> 16 >= 0x80)
+            sprite->function_holder = TRAFFIC_TICK;
+        else
+            OTraffic_move_spawned_sprite(sprite); // Skip collision code
     }
+
+    if (sprite->function_holder == TRAFFIC_TICK)
+        OTraffic_tick_spawned_sprite(sprite);
 }
 
 // Disable Traffic Routines
@@ -188,7 +214,10 @@ void OTraffic_disable_traffic()
 {
     uint8_t i;
     for (i = SPRITE_TRAFF1; i <= SPRITE_TRAFF8; i++)
-        OSprites_jump_table[i].control &= ~SPRITES_ENABLE;
+        OSprites_disable(&OSprites_jump_table[i]);
+
+    for (i = SPRITE_TRAFF_EXTRA; i < JUMP_ENTRIES_TOTAL; i++)
+        OSprites_disable(&OSprites_jump_table[i]);
 }
 
 // Master Function to determine when to spawn traffic
@@ -227,8 +256,8 @@ void OTraffic_spawn_traffic()
     if (traffic_count >= max_traffic)
         return;
 
-    // Use counter as a spawning delay
-    if (! (((spawn_counter - 1) ^ spawn_counter) & BIT_5) )
+    // Use counter as a spawning delay. Rush hour spawns every 4 ticks, rather than 32, to fill the extra slots.
+    if (! (((spawn_counter - 1) ^ spawn_counter) & (traffic_slots > 8 ? BIT_2 : BIT_5)) )
         return;
 
     // Spawn Traffic if possible in one of the eight slots
@@ -242,6 +271,14 @@ void OTraffic_spawn_traffic()
             return;
         }
     }
+
+    // Rush hour: first free slot after the eight
+    if (traffic_slots > 8)
+    {
+        int16_t j = OSprites_next_inactive(SPRITE_TRAFF_EXTRA, SPRITE_TRAFF_EXTRA + traffic_slots - 8);
+        if (j >= 0)
+            OTraffic_spawn_car(&OSprites_jump_table[j]);
+    }
 }
 
 // Spawn individual vehicle. Called by master function.
@@ -250,7 +287,8 @@ void OTraffic_spawn_traffic()
 // Source: 0x4BAC
 void OTraffic_spawn_car(oentry* sprite)
 {
-    sprite->control |= SPRITES_ENABLE | SPRITES_TRAFFIC_SPRITE;
+    OSprites_enable(sprite);
+    sprite->control |= SPRITES_TRAFFIC_SPRITE;
     sprite->draw_props = DRAW_BOTTOM;
     sprite->shadow = 7;     // Used as priority
     sprite->width = 0;
@@ -633,7 +671,12 @@ void OTraffic_set_zoom_lookup(oentry* sprite)
 // Source: 0x846E
 void OTraffic_set_max_traffic()
 {
-    if (Outrun_cannonball_mode == OUTRUN_MODE_ORIGINAL)
+    // Rush hour fills every slot, whatever the mode
+    if (traffic_slots > 8)
+    {
+        max_traffic = traffic_slots;
+    }
+    else if (Outrun_cannonball_mode == OUTRUN_MODE_ORIGINAL)
     {
         const static uint8_t MAX_TRAFFIC[] =
         {
@@ -676,9 +719,15 @@ void OTraffic_set_max_traffic()
 // Source: 0x7990
 void OTraffic_traffic_logic()
 {
-    uint8_t index2;
+    uint16_t index2;
     uint16_t sprite_count = OSprites_sprite_count - OSprites_spr_cnt_shadow;
     uint16_t spawned = 0; // d5
+
+    if (traffic_slots > 8)
+    {
+        OTraffic_traffic_logic_lanes();
+        return;
+    }
     
     if (!sprite_count)
     {
@@ -687,7 +736,7 @@ void OTraffic_traffic_logic()
     }
        
     oentry* first = 0;
-    uint8_t index = 0;
+    uint16_t index = 0;
     uint16_t spr_index = OSprites_spr_cnt_shadow;
 
     // Find First Traffic Entry. Note we use the hardware sprite list here to extract the original object.
@@ -721,49 +770,92 @@ void OTraffic_traffic_logic()
         {
             traffic_adr[spawned++] = next;
             next->traffic_proximity = 0;
+            OTraffic_check_proximity(first, next);
+            first = next;
+        }
+    }
 
-            uint16_t z16 = first->z >> 16;
+    OTraffic_calculate_avg_speed(spawned);
+}
 
-            if (z16 < 0x40)
-            {
-                first = next;
-                continue;
-            }
+// Compare traffic with the traffic further into the distance, and denote where they are in relation to each other.
+void OTraffic_check_proximity(oentry* first, oentry* next)
+{
+    uint16_t z16 = first->z >> 16;
 
-            z16 += (z16 >> 1) + (z16 >> 2); // [x1.75 original value]
+    if (z16 < 0x40)
+        return;
 
-            if (z16 <= next->z >> 16)   
-            {
-                first = next;
-                continue;
-            }
+    z16 += (z16 >> 1) + (z16 >> 2); // [x1.75 original value]
 
-            next->traffic_proximity |= BIT_2; // Denote entry2 is close to other traffic (z axis)
+    if (z16 <= next->z >> 16)   
+        return;
 
-            int16_t x_diff = first->xw1 - next->xw1; // d1
-            int16_t x_diff_abs = x_diff < 0 ? -x_diff : x_diff; // d0
+    next->traffic_proximity |= BIT_2; // Denote entry2 is close to other traffic (z axis)
 
-            if (x_diff_abs - 0x80 >= 0)
-            {
-                first = next;
-                continue;
-            }
+    int16_t x_diff = first->xw1 - next->xw1; // d1
+    int16_t x_diff_abs = x_diff < 0 ? -x_diff : x_diff; // d0
 
-            if (x_diff >= 0)
-            {
-                first->traffic_proximity |= BIT_1; // Entry 1: Denote traffic on RHS
-                next->traffic_proximity |= BIT_0;  // Entry 2: Denote traffic on LHS [remember x scale is reversed on outrun]
-            }
-            else
-            {
-                first->traffic_proximity |= BIT_0; // Entry 1: Denote traffic on LHS
-                next->traffic_proximity |= BIT_1;  // Entry 2: Denote traffic on RHS
-            }
+    if (x_diff_abs - 0x80 >= 0)
+        return;
 
-            // Copy car speed into entry 2 to avoid collision
-            next->traffic_near_speed = first->traffic_speed;
-            first = next;
+    if (x_diff >= 0)
+    {
+        first->traffic_proximity |= BIT_1; // Entry 1: Denote traffic on RHS
+        next->traffic_proximity |= BIT_0;  // Entry 2: Denote traffic on LHS [remember x scale is reversed on outrun]
+    }
+    else
+    {
+        first->traffic_proximity |= BIT_0; // Entry 1: Denote traffic on LHS
+        next->traffic_proximity |= BIT_1;  // Entry 2: Denote traffic on RHS
+    }
+
+    // Copy car speed into entry 2 to avoid collision
+    next->traffic_near_speed = first->traffic_speed;
+}
+
+// Rush Hour Traffic Logic
+//
+// The original logic compares each car with the car before it in z. With a road full of traffic,
+// that car is rarely in the same lane, so cars drive into each other.
+//
+// Instead, traffic is indexed by lane as it is walked in z order, which the hardware sprite list 
+// is already sorted by. Each car is compared with the nearest car ahead of it in each lane, 
+// so the cost is a single pass with at most TRAFFIC_LANES comparisons per car.
+void OTraffic_traffic_logic_lanes()
+{
+    oentry* lane_last[TRAFFIC_LANES];
+    uint16_t sprite_count = OSprites_sprite_count - OSprites_spr_cnt_shadow;
+    uint16_t spr_index = OSprites_spr_cnt_shadow;
+    uint16_t spawned = 0;
+    uint16_t i;
+    int8_t l;
+
+    for (l = 0; l < TRAFFIC_LANES; l++)
+        lane_last[l] = 0;
+
+    for (i = 0; i < sprite_count; i++)
+    {
+        oentry* next = &OSprites_jump_table[OSprites_sprite_entries[spr_index++].scratch];
+
+        if (!(next->control & SPRITES_TRAFFIC_SPRITE) || spawned >= TRAFFIC_SLOTS_MAX)
+            continue;
+
+        traffic_adr[spawned++] = next;
+        next->traffic_proximity = 0;
+
+        const int8_t lane = next->xw1 < -0x38 ? 0 : (next->xw1 > 0x38 ? 2 : 1);
+
+        // Compare the car's own lane last, so its speed is the one followed
+        for (l = 0; l < TRAFFIC_LANES; l++)
+        {
+            if (l != lane && lane_last[l])
+                OTraffic_check_proximity(lane_last[l], next);
         }
+        if (lane_last[lane])
+            OTraffic_check_proximity(lane_last[lane], next);
+
+        lane_last[lane] = next;
     }
 
     OTraffic_calculate_avg_speed(spawned);
@@ -877,3 +969,23 @@ void OTraffic_traffic_sound()
         OSoundInt_engine_data[sound_TRAFFIC1 + i] = pan | vol;
     }
 }
+
+void OTraffic_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OTraffic_ai_traffic);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OTraffic_bonus_lhs);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OTraffic_collision_mask);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OTraffic_collision_traffic);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, OTraffic_traffic_split);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, max_traffic);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, spawn_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, spawn_location);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, traffic_adr);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, traffic_count);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, traffic_pal_cycle);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, traffic_speed_avg);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, traffic_speed_total);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, traffic_slots);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, wheel_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, wheel_reset);
+}
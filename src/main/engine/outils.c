@@ -11,6 +11,7 @@
 #include "engine/ostats.h"
 
 #include <stdlib.h>
+#include "savestate.h"
 
 // Generate long random
 //
@@ -19,7 +20,7 @@
 // Output:         Long Random
 
 // Seed for random number generator
-static uint32_t rnd_seed = 0;
+static ENGINE_LOCAL uint32_t rnd_seed = 0;
 
 extern const uint8_t DEC_TO_HEX[];
 
@@ -28,6 +29,12 @@ void outils_reset_random_seed()
     rnd_seed = 0;
 }
 
+// Start the generator from a known seed, so that runs can be reproduced. 0 restores the default.
+void outils_set_random_seed(uint32_t seed)
+{
+    rnd_seed = seed;
+}
+
 uint32_t outils_random()
 {
 	// New seed value
@@ -263,3 +270,8 @@ const uint8_t DEC_TO_HEX[] =
 {
     *v = ((*v & 0xFFFF0000) >> 16) + ((*v & 0xFFFF) << 16);
 }
+
+void outils_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, rnd_seed);
+}
@@ -16,6 +16,7 @@
 extern const uint8_t DEC_TO_HEX[];
 
 void outils_reset_random_seed();
+void outils_set_random_seed(uint32_t seed);
 uint32_t outils_random();
 int32_t outils_isqrt(int32_t);
 uint16_t outils_convert16_dechex(uint16_t);
@@ -29,4 +30,5 @@ void outils_sub16(int32_t src, int32_t* dst);
 void outils_swap32(int32_t* v);
 void outils_swapU32(uint32_t* v);
 void outils_convert_counter_to_time(uint16_t counter, uint8_t* converted);
+void outils_register_state();
 
@@ -31,6 +31,8 @@
 #include "engine/otiles.h"
 #include "engine/otraffic.h"
 #include "engine/outils.h"
+#include "savestate.h"
+#include "sdl/timer.h"
 
 /*
     Known Core Engine Issues:
@@ -53,25 +55,43 @@
 
 */
 
-Boolean Outrun_freeze_timer;
-uint8_t Outrun_cannonball_mode;
+ENGINE_LOCAL Boolean Outrun_freeze_timer;
+ENGINE_LOCAL uint8_t Outrun_cannonball_mode;
 uint8_t Outrun_custom_traffic;
-time_trial_t Outrun_ttrial;
-Boolean Outrun_service_mode;
-Boolean Outrun_tick_frame;
-uint32_t Outrun_tick_counter;
-int8_t Outrun_game_state;
+ENGINE_LOCAL time_trial_t Outrun_ttrial;
+ENGINE_LOCAL Boolean Outrun_service_mode;
+ENGINE_LOCAL Boolean Outrun_tick_frame;
+ENGINE_LOCAL uint32_t Outrun_tick_counter;
+ENGINE_LOCAL int8_t Outrun_game_state;
 adr_t Outrun_adr;
 
+ENGINE_LOCAL Boolean Outrun_profile = FALSE;
+ENGINE_LOCAL Boolean Outrun_batch_instance = FALSE;
+ENGINE_LOCAL uint64_t Outrun_stage_us[OUTRUN_STAGES];
 
-uint8_t attract_view;
-int16_t attract_counter;
+// Run a stage of the tick, accumulating its time when profiling
+#define OUTRUN_STAGE(stage, call)                                       \
+    do                                                                  \
+    {                                                                   \
+        if (Outrun_profile)                                             \
+        {                                                               \
+            uint32_t stage_start = getMicroseconds();                   \
+            call;                                                       \
+            Outrun_stage_us[stage] += getMicroseconds() - stage_start;  \
+        }                                                               \
+        else                                                            \
+            call;                                                       \
+    } while (0)
+
+
+ENGINE_LOCAL uint8_t attract_view;
+ENGINE_LOCAL int16_t attract_counter;
 
 // Car Increment Backup for attract mode
-uint32_t car_inc_bak;
+ENGINE_LOCAL uint32_t car_inc_bak;
 
 // Debug to denote when fork has been chosen
-int8_t fork_chosen;
+ENGINE_LOCAL int8_t fork_chosen;
 
 void Outrun_jump_table(Packet* packet);
 void Outrun_init_jump_table();
@@ -87,7 +107,12 @@ void Outrun_init()
 {
     Outrun_freeze_timer = Outrun_cannonball_mode == OUTRUN_MODE_TTRIAL ? TRUE : Config_engine.freeze_timer;
     Video_enabled = FALSE;
-    Outrun_select_course(Config_engine.jap != 0, Config_engine.prototype != 0);
+    // The course and tilemap cache are shared. Batch instances use those set up by the main thread.
+    if (!Outrun_batch_instance)
+    {
+        Outrun_select_course(Config_engine.jap != 0, Config_engine.prototype != 0);
+        OTiles_precache_tilemaps(); // Uncompress all stage tilemaps up front
+    }
     Video_clear_text_ram();
 
     Outrun_tick_counter = 0;
@@ -101,11 +126,15 @@ void Outrun_boot()
     // Initialize default hi-score entries
     OHiScore_init_def_scores();
     // Load saved hi-score entries
-    Config_load_scores(getScoresFilename());
+    if (!Outrun_batch_instance)
+        Config_load_scores(getScoresFilename());
     OStats_init(Outrun_cannonball_mode == OUTRUN_MODE_TTRIAL);
     Outrun_init_jump_table();
     OInitEngine_init(Outrun_cannonball_mode == OUTRUN_MODE_TTRIAL ? Outrun_ttrial.level : 0);
-    OSoundInt_init();
+    if (Outrun_batch_instance)
+        OSoundInt_init_state(); // The sound chips are shared, so only reset this thread's registers
+    else
+        OSoundInt_init();
     outils_reset_random_seed(); // Ensure we match the genuine boot up of the original game each time
 }
 
@@ -138,10 +167,10 @@ void Outrun_tick(Packet* packet, Boolean tick_frame)
     // Updates V-Blank 1/2 frames
     if (Config_fps == 30 && Config_tick_fps == 30)
     {
-        Outrun_jump_table(packet);
-        ORoad_tick();
-        Outrun_vint();
-        Outrun_vint();
+        OUTRUN_STAGE(OUTRUN_STAGE_LOGIC, Outrun_jump_table(packet));
+        OUTRUN_STAGE(OUTRUN_STAGE_ROAD,  ORoad_tick());
+        OUTRUN_STAGE(OUTRUN_STAGE_VINT,  Outrun_vint());
+        OUTRUN_STAGE(OUTRUN_STAGE_VINT,  Outrun_vint());
     }
     // 30/60 FPS Hybrid. (This is the same as the original game)
     // Updates Game Logic 1/2 frames
@@ -150,24 +179,29 @@ void Outrun_tick(Packet* packet, Boolean tick_frame)
     {
         if (cannonball_tick_frame)
         {
-            Outrun_jump_table(packet);
-            ORoad_tick();
+            OUTRUN_STAGE(OUTRUN_STAGE_LOGIC, Outrun_jump_table(packet));
+            OUTRUN_STAGE(OUTRUN_STAGE_ROAD,  ORoad_tick());
         }
-        Outrun_vint();
+        OUTRUN_STAGE(OUTRUN_STAGE_VINT, Outrun_vint());
     }
     // 60 FPS. Smooth Mode.
     // Updates Game Logic 1/1 frames
     // Updates V-Blank 1/1 frames
     else
     {
-        Outrun_jump_table(packet);
-        ORoad_tick();
-        Outrun_vint();
+        OUTRUN_STAGE(OUTRUN_STAGE_LOGIC, Outrun_jump_table(packet));
+        OUTRUN_STAGE(OUTRUN_STAGE_ROAD,  ORoad_tick());
+        OUTRUN_STAGE(OUTRUN_STAGE_VINT,  Outrun_vint());
     }
 
     // Draw FPS
     if (Config_video.fps_count)
+    {
         OHud_draw_fps_counter(cannonball_fps_counter);
+#ifdef COMPILE_SOUND_CODE
+        AudioStats_draw();
+#endif
+    }
 }
 
 // Vertical Interrupt
@@ -1075,3 +1109,19 @@ void Outrun_select_course(Boolean jap, Boolean prototype)
     // Use Prototype Coconut Beach Track
     TrackLoader_stage_data[0] = prototype ? 0x3A : 0x3C;
 }
+
+// ROM addresses and configured traffic are set at boot and are not included.
+void Outrun_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, Outrun_freeze_timer);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, Outrun_cannonball_mode);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, Outrun_ttrial);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, Outrun_service_mode);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, Outrun_tick_frame);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, Outrun_tick_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, Outrun_game_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, attract_view);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, attract_counter);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, car_inc_bak);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, fork_chosen);
+}
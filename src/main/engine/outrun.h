@@ -177,10 +177,10 @@ typedef struct
 
 
 
-extern Boolean Outrun_freeze_timer;
+extern ENGINE_LOCAL Boolean Outrun_freeze_timer;
 
 // CannonBall Game Mode
-extern uint8_t Outrun_cannonball_mode;
+extern ENGINE_LOCAL uint8_t Outrun_cannonball_mode;
 
 const static uint8_t OUTRUN_MODE_ORIGINAL = 0; // Original OutRun Mode
 const static uint8_t OUTRUN_MODE_TTRIAL   = 1; // Enhanced Time Trial Mode
@@ -190,23 +190,38 @@ const static uint8_t OUTRUN_MODE_CONT     = 2; // Enhanced Continuous Mode
 extern uint8_t Outrun_custom_traffic;
 
 // Time trial data
-extern time_trial_t Outrun_ttrial;
+extern ENGINE_LOCAL time_trial_t Outrun_ttrial;
 
 // Service Mode Toggle: Not implemented yet.
-extern Boolean Outrun_service_mode;
+extern ENGINE_LOCAL Boolean Outrun_service_mode;
 
 // Tick Logic. Used when running at non-standard > 30 fps
-extern Boolean Outrun_tick_frame;
+extern ENGINE_LOCAL Boolean Outrun_tick_frame;
 
 // Tick Counter (always syncd to 30 fps to flash text and other stuff)
-extern uint32_t Outrun_tick_counter;
+extern ENGINE_LOCAL uint32_t Outrun_tick_counter;
 
 // Main game state
-extern int8_t Outrun_game_state;
+extern ENGINE_LOCAL int8_t Outrun_game_state;
 
 // Address structures
 extern adr_t Outrun_adr;
 
+// Stages of Outrun_tick. Timed when Outrun_profile is set.
+enum
+{
+    OUTRUN_STAGE_LOGIC, // Main CPU: game logic jump table
+    OUTRUN_STAGE_ROAD,  // Road CPU
+    OUTRUN_STAGE_VINT,  // Vertical interrupt: tilemaps, sprite list, palette & timers
+    OUTRUN_STAGES
+};
+
+extern ENGINE_LOCAL Boolean Outrun_profile;
+extern ENGINE_LOCAL uint64_t Outrun_stage_us[OUTRUN_STAGES];
+
+// Set on threads running a batch instance. Shared data is left to the main thread.
+extern ENGINE_LOCAL Boolean Outrun_batch_instance;
+
 
 void Outrun_init();
 void Outrun_boot();
@@ -214,4 +229,5 @@ void Outrun_tick(Packet* packet, Boolean tick_frame);
 void Outrun_vint();
 void Outrun_init_best_outrunners();
 void Outrun_select_course(Boolean jap, Boolean prototype);
+void Outrun_register_state();
 
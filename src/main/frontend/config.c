@@ -15,7 +15,9 @@
 #include "setup.h"
 #include "utils.h"
 #include "xmlutils.h"
+#include "rewind.h"
 #include "engine/ohiscore.h"
+#include "engine/osprites.h"
 #include "engine/audio/OSoundInt.h"
 
 
@@ -51,6 +53,8 @@ void Config_init()
     Config_video.scale      = 0;
     Config_video.scanlines  = 0;
     Config_video.fps        = 0;
+    Config_video.refresh    = 0;
+    Config_video.pacer      = 0;
     Config_video.fps_count  = 1;
     Config_video.widescreen = 0;
     Config_video.hires      = 0;
@@ -66,6 +70,9 @@ void Config_init()
     Config_sound.advertise   = 0;
     Config_sound.preview     = 0;
     Config_sound.fix_samples = 0;
+    Config_sound.rate        = 44100;
+    Config_sound.chip_rate   = 44100;
+    Config_sound.ym_render   = YM_RENDER_BLOCKS;
  
     Config_controls.gear          = 0;
     Config_controls.steer_speed   = 3;
@@ -136,6 +143,9 @@ void Config_init()
     Config_engine.fix_timer       = 0;
     Config_engine.layout_debug    = 0;
     Config_engine.new_attract     = 0;
+    Config_engine.rewind          = 0;
+    Config_engine.unlimited_sprites = 0;
+    Config_engine.rush_hour       = 0;
 
     // ------------------------------------------------------------------------
     // Time Trial Mode
@@ -177,11 +187,20 @@ void Config_load(const char* filename)
     Config_video.scale      = GetXMLDocValueInt(&doc, "/video/window/scale",       2); // Video Scale: Default is 2x    
     Config_video.scanlines  = GetXMLDocValueInt(&doc, "/video/scanlines",          0); // Scanlines
     Config_video.fps        = GetXMLDocValueInt(&doc, "/video/fps",                2); // Default is 60 fps
+    Config_video.refresh    = GetXMLDocValueInt(&doc, "/video/refresh",            0); // Interpolated Display Rate
+    Config_video.pacer      = GetXMLDocValueInt(&doc, "/video/pacer",              0); // Frame Pacing
     Config_video.fps_count  = GetXMLDocValueInt(&doc, "/video/fps_counter",        0); // FPS Counter
     Config_video.widescreen = GetXMLDocValueInt(&doc, "/video/widescreen",         1); // Enable Widescreen Mode
     Config_video.hires      = GetXMLDocValueInt(&doc, "/video/hires",              0); // Hi-Resolution Mode
     Config_video.filtering  = GetXMLDocValueInt(&doc, "/video/filtering",          0); // Open GL Filtering Mode
           
+    if (Config_video.refresh < 0)
+        Config_video.refresh = 0;
+    else if (Config_video.refresh > 500)
+        Config_video.refresh = 500;
+    if (Config_video.pacer < 0 || Config_video.pacer > 2)
+        Config_video.pacer = 0;
+
     Config_set_fps(Config_video.fps);
 
     // ------------------------------------------------------------------------
@@ -191,6 +210,17 @@ void Config_load(const char* filename)
     Config_sound.advertise   = GetXMLDocValueInt(&doc, "/sound/advertise",   1);
     Config_sound.preview     = GetXMLDocValueInt(&doc, "/sound/preview",     1);
     Config_sound.fix_samples = GetXMLDocValueInt(&doc, "/sound/fix_samples", 1);
+    Config_sound.rate        = GetXMLDocValueInt(&doc, "/sound/rate",        44100);
+    Config_sound.chip_rate   = GetXMLDocValueInt(&doc, "/sound/chip_rate",   0);
+    Config_sound.ym_render   = GetXMLDocValueInt(&doc, "/sound/ym_render",   YM_RENDER_BLOCKS);
+
+    // 0 runs the chips at the output rate, without resampling
+    if (Config_sound.rate < 8000 || Config_sound.rate > 48000)
+        Config_sound.rate = 44100;
+    if (Config_sound.chip_rate < 8000 || Config_sound.chip_rate > SEGAPCM_MAX_FREQUENCY)
+        Config_sound.chip_rate = Config_sound.rate;
+    if (Config_sound.ym_render < YM_RENDER_BLOCKS || Config_sound.ym_render > YM_RENDER_COMPARE)
+        Config_sound.ym_render = YM_RENDER_BLOCKS;
 
 
     // Custom Music
@@ -290,6 +320,19 @@ void Config_load(const char* filename)
     Config_engine.fix_timer       = GetXMLDocValueInt(&doc, "/engine/fix_timer",    0) != 0;
     Config_engine.layout_debug    = GetXMLDocValueInt(&doc, "/engine/layout_debug", 0) != 0;
     Config_engine.new_attract     = GetXMLDocValueInt(&doc, "/engine/new_attract", 1) != 0;
+    Config_engine.rewind          = GetXMLDocValueInt(&doc, "/engine/rewind",       0);
+    Config_engine.unlimited_sprites = GetXMLDocValueInt(&doc, "/engine/unlimited_sprites", 0) != 0;
+    Config_engine.rush_hour       = GetXMLDocValueInt(&doc, "/engine/rush_hour",    0);
+
+    if (Config_engine.rush_hour <= 8)                   Config_engine.rush_hour = 0;
+    else if (Config_engine.rush_hour > TRAFFIC_SLOTS_MAX) Config_engine.rush_hour = TRAFFIC_SLOTS_MAX;
+
+    // Rush hour traffic does not fit within the hardware sprite limit
+    if (Config_engine.rush_hour)
+        Config_engine.unlimited_sprites = TRUE;
+
+    if (Config_engine.rewind < 0)                       Config_engine.rewind = 0;
+    else if (Config_engine.rewind > REWIND_MAX_SECONDS) Config_engine.rewind = REWIND_MAX_SECONDS;
 
     // ------------------------------------------------------------------------
     // Time Trial Mode
@@ -315,6 +358,8 @@ Boolean Config_save(const char* filename)
     AddNodeInt(&saveDoc, windowNode, "scale",           Config_video.scale);
     AddNodeInt(&saveDoc, videoNode, "scanlines",        Config_video.scanlines);
     AddNodeInt(&saveDoc, videoNode, "fps",              Config_video.fps);
+    AddNodeInt(&saveDoc, videoNode, "refresh",          Config_video.refresh);
+    AddNodeInt(&saveDoc, videoNode, "pacer",            Config_video.pacer);
     AddNodeInt(&saveDoc, videoNode, "widescreen",       Config_video.widescreen);
     AddNodeInt(&saveDoc, videoNode, "hires",            Config_video.hires);
 
@@ -323,6 +368,9 @@ Boolean Config_save(const char* filename)
     AddNodeInt(&saveDoc, soundNode, "advertise",        Config_sound.advertise);
     AddNodeInt(&saveDoc, soundNode, "preview",          Config_sound.preview);
     AddNodeInt(&saveDoc, soundNode, "fix_samples",      Config_sound.fix_samples);
+    AddNodeInt(&saveDoc, soundNode, "rate",             Config_sound.rate);
+    AddNodeInt(&saveDoc, soundNode, "chip_rate",        Config_sound.chip_rate);
+    AddNodeInt(&saveDoc, soundNode, "ym_render",        Config_sound.ym_render);
 
     XMLNode* controlsNode = AddXmlFatherNode(&saveDoc, "controls");
     AddNodeInt(&saveDoc, controlsNode, "gear",            Config_controls.gear);
@@ -362,6 +410,9 @@ Boolean Config_save(const char* filename)
     AddNodeInt(&saveDoc, engineNode, "prototype",       Config_engine.prototype);
     AddNodeInt(&saveDoc, engineNode, "levelobjects",    Config_engine.level_objects);
     AddNodeInt(&saveDoc, engineNode, "new_attract",     Config_engine.new_attract);
+    AddNodeInt(&saveDoc, engineNode, "rewind",          Config_engine.rewind);
+    AddNodeInt(&saveDoc, engineNode, "unlimited_sprites", Config_engine.unlimited_sprites);
+    AddNodeInt(&saveDoc, engineNode, "rush_hour",       Config_engine.rush_hour);
 
     XMLNode* timeTrialNode = AddXmlFatherNode(&saveDoc, "time_trial");
     AddNodeInt(&saveDoc, timeTrialNode, "laps",    Config_ttrial.laps);
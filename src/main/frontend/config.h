@@ -48,6 +48,8 @@ typedef struct
     int scanlines;
     int widescreen;
     int fps;
+    int refresh;      // Display refresh rate in Hz when interpolating frames. 0 draws a frame per engine tick.
+    int pacer;        // Frame pacing (PACER_OFF, PACER_ON or PACER_REALTIME). Paces drawn frames when refresh is set.
     int fps_count;
     int hires;
     int filtering;
@@ -63,6 +65,9 @@ typedef struct
     int advertise;
     int preview;
     int fix_samples;
+    int rate;           // Output sample rate (Hz)
+    int chip_rate;      // Internal sample rate of the sound chips (Hz). Resampled to the output rate.
+    int ym_render;      // YM2151 synthesis path: YM_RENDER_BLOCKS, YM_RENDER_SAMPLES or YM_RENDER_COMPARE
     custom_music_t custom_music[4];
 #if defined (_AMIGA_)    
     int amiga_midi;
@@ -129,6 +134,9 @@ typedef struct
     Boolean fix_timer;
     Boolean layout_debug;
     int new_attract;
+    int rewind;       // Seconds of gameplay held for rewind. 0 disables rewind.
+    Boolean unlimited_sprites; // Lift the 0x7F hardware sprite limit
+    int rush_hour;    // Traffic cars in rush hour mode. 0 keeps the original eight.
 } engine_settings_t;
 
 extern menu_settings_t        Config_menu;
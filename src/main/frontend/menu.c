@@ -353,7 +353,12 @@ void Menu_tick_ui()
 
     // Draw FPS
     if (Config_video.fps_count)
+    {
         OHud_draw_fps_counter(cannonball_fps_counter);
+#ifdef COMPILE_SOUND_CODE
+        AudioStats_draw();
+#endif
+    }
 
     ORoad_tick();
 }
@@ -15,16 +15,17 @@
 #include "engine/omap.h"
 #include "engine/ostats.h"
 #include "engine/otiles.h"
+#include "savestate.h"
 
-uint8_t TTrial_state;
-int8_t TTrial_level_selected;
+ENGINE_LOCAL uint8_t TTrial_state;
+ENGINE_LOCAL int8_t TTrial_level_selected;
 
 
 // Best lap times for all 15 tracks.
 uint16_t* TTrial_best_times = Config_ttrial.best_times;
 
 // Counter converted to actual laptime
-uint8_t best_converted[3];
+ENGINE_LOCAL uint8_t best_converted[3];
 
 // Track Selection: Ferrari Position Per Track
 // This is a link to a sprite object that represents part of the course map.
@@ -126,4 +127,11 @@ void TTrial_update_best_time()
 {
     TTrial_best_times[TTrial_level_selected] = Outrun_ttrial.best_lap_counter;
     Config_save_tiletrial_scores();
-}
\ No newline at end of file
+}
+
+void TTrial_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_ENGINE, TTrial_state);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, TTrial_level_selected);
+    SAVESTATE_ADD(SAVESTATE_ENGINE, best_converted);
+}
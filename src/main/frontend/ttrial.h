@@ -9,6 +9,7 @@
 #pragma once
 
 #include "stdint.h"
+#include "globals.h"
 
 // Maximum number of laps to allow the player to race
 #define TTRIAL_MAX_LAPS 5
@@ -23,8 +24,8 @@ enum
     TTRIAL_INIT_GAME = 1,
 };
 
-extern uint8_t TTrial_state;
-extern int8_t TTrial_level_selected;
+extern ENGINE_LOCAL uint8_t TTrial_state;
+extern ENGINE_LOCAL int8_t TTrial_level_selected;
 
 enum
 {
@@ -37,4 +38,5 @@ enum
 void TTrial_init();
 int  TTrial_tick();
 void TTrial_update_best_time();
+void TTrial_register_state();
 
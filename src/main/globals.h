@@ -9,6 +9,34 @@
 // Comment out to disable SDL specific sound code
 //#define COMPILE_SOUND_CODE
 
+// Uncomment to store decoded road graphics at 2 bits per pixel.
+// Reduces the road from 256K to 64K, at the cost of unpacking each scanline.
+//#define PACKED_ROAD_GFX
+
+// Uncomment to carve all memory arenas from one static block, rather than the heap.
+//#define ARENA_FIXED_BLOCK
+
+// Uncomment to keep engine state per thread, so that batch mode can run games in parallel.
+// Requires compiler support for thread local storage.
+//#define ENGINE_THREADS
+
+// Marks a global as engine state, owned by the thread running the game.
+// ROM data, and tables derived from ROMs or configuration, are not marked and are shared.
+#ifdef ENGINE_THREADS
+    #ifdef _MSC_VER
+        #define ENGINE_LOCAL __declspec(thread)
+    #else
+        #define ENGINE_LOCAL __thread
+    #endif
+#else
+    #define ENGINE_LOCAL
+#endif
+
+// The audio thread would run the sound program against its own copy of the sound state.
+#if defined(ENGINE_THREADS) && defined(COMPILE_SOUND_CODE)
+    #error "ENGINE_THREADS can not be used with COMPILE_SOUND_CODE"
+#endif
+
 // ------------------------------------------------------------------------------------------------
 // Debug Settings
 // ------------------------------------------------------------------------------------------------
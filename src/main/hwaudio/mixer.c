@@ -0,0 +1,66 @@
+/***************************************************************************
+    Audio Mixer.
+
+    Mixes two 16-bit sample streams with a gain for each, saturating the
+    result to 16-bit. Shared by the audio output and the offline renderer.
+
+    Gains are 8.8 fixed point, where MIXER_UNITY leaves a stream unchanged.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include "hwaudio/mixer.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Convert a chip volume (0.0 to 1.0) to a mixer gain
+int32_t Mixer_gain(float volume)
+{
+    if (volume <= 0)
+        return 0;
+    if (volume >= 1.0f)
+        return MIXER_UNITY;
+    return (int32_t) (volume * MIXER_UNITY);
+}
+
+// out = saturate((a * gain_a + b * gain_b) >> 8)
+// out may be the same buffer as a or b.
+void Mixer_mix2(int16_t* out, const int16_t* a, int32_t gain_a, const int16_t* b, int32_t gain_b, uint32_t samples)
+{
+    uint32_t i = 0;
+
+#ifdef __SSE2__
+    // Interleave a and b, so a single multiply-add gives a * gain_a + b * gain_b in 32 bits,
+    // then pack back down to 16 bits with saturation.
+    const __m128i gains = _mm_set1_epi32((gain_b << 16) | (gain_a & 0xFFFF));
+
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*) (b + i));
+        __m128i lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(va, vb), gains), 8);
+        __m128i hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(va, vb), gains), 8);
+        _mm_storeu_si128((__m128i*) (out + i), _mm_packs_epi32(lo, hi));
+    }
+#endif
+
+    Mixer_mix2_scalar(out + i, a + i, gain_a, b + i, gain_b, samples - i);
+}
+
+// Reference version of Mixer_mix2, which also mixes whatever the vector loop leaves over.
+// 32-bit accumulate and clamp. Written without data dependent branches, so it can be vectorised.
+void Mixer_mix2_scalar(int16_t* out, const int16_t* a, int32_t gain_a, const int16_t* b, int32_t gain_b, uint32_t samples)
+{
+    uint32_t i;
+
+    for (i = 0; i < samples; i++)
+    {
+        int32_t v = ((a[i] * gain_a) + (b[i] * gain_b)) >> 8;
+        v = v > 32767 ? 32767 : v;
+        v = v < -32768 ? -32768 : v;
+        out[i] = (int16_t) v;
+    }
+}
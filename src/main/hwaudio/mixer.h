@@ -0,0 +1,21 @@
+/***************************************************************************
+    Audio Mixer.
+
+    Mixes two 16-bit sample streams with a gain for each, saturating the
+    result to 16-bit. Shared by the audio output and the offline renderer.
+
+    Gains are 8.8 fixed point, where MIXER_UNITY leaves a stream unchanged.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.h"
+
+#define MIXER_UNITY 0x100
+
+int32_t Mixer_gain(float volume);
+void Mixer_mix2(int16_t* out, const int16_t* a, int32_t gain_a, const int16_t* b, int32_t gain_b, uint32_t samples);
+void Mixer_mix2_scalar(int16_t* out, const int16_t* a, int32_t gain_a, const int16_t* b, int32_t gain_b, uint32_t samples);
@@ -0,0 +1,177 @@
+/***************************************************************************
+    Polyphase Resampler.
+
+    Converts the stereo output of the sound chips from their internal
+    sample rate to the output device rate, using a windowed sinc filter
+    with a precomputed bank of phases.
+
+    When both rates match, samples are copied through unchanged.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include "arena.h"
+#include "hwaudio/resampler.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Frames kept from the previous call, so the filter can span calls
+#define RESAMPLER_HELD (RESAMPLER_TAPS - 1)
+
+void Resampler_build_coeffs(resampler_t* r);
+
+void Resampler_init(resampler_t* r, uint32_t in_rate, uint32_t out_rate, uint32_t max_in)
+{
+    r->in_rate  = in_rate;
+    r->out_rate = out_rate;
+    r->max_in   = max_in;
+    r->bypass   = in_rate == out_rate;
+    r->step     = (uint32_t) (((uint64_t) in_rate << 16) / out_rate);
+    r->step_rem = (uint32_t) (((uint64_t) in_rate << 16) % out_rate);
+    r->coeffs   = NULL;
+    r->history  = NULL;
+
+    if (r->bypass)
+        return;
+
+    r->coeffs  = (int16_t*) Arena_alloc(ARENA_AUDIO, RESAMPLER_PHASES * RESAMPLER_TAPS * sizeof(int16_t));
+    r->history = (int16_t*) Arena_alloc(ARENA_AUDIO, (RESAMPLER_HELD + max_in) * 2 * sizeof(int16_t));
+
+    Resampler_build_coeffs(r);
+    Resampler_reset(r);
+}
+
+void Resampler_destroy(resampler_t* r)
+{
+    // Free in reverse order of allocation
+    Arena_free(r->history);
+    Arena_free(r->coeffs);
+    r->history = NULL;
+    r->coeffs  = NULL;
+}
+
+void Resampler_reset(resampler_t* r)
+{
+    if (r->bypass)
+        return;
+
+    memset(r->history, 0, RESAMPLER_HELD * 2 * sizeof(int16_t));
+    r->pos     = 0;
+    r->pos_rem = 0;
+}
+
+// Blackman windowed sinc, with the cutoff just below the lower of the two Nyquist frequencies.
+// Each phase is normalised to unity gain.
+void Resampler_build_coeffs(resampler_t* r)
+{
+    int p, t;
+    const double centre = (RESAMPLER_TAPS / 2) - 1;
+    const double half   = RESAMPLER_TAPS / 2;
+    double cutoff = 0.9;
+
+    if (r->out_rate < r->in_rate)
+        cutoff *= (double) r->out_rate / r->in_rate;
+
+    for (p = 0; p < RESAMPLER_PHASES; p++)
+    {
+        double taps[RESAMPLER_TAPS];
+        double sum = 0;
+        int32_t total = 0;
+
+        for (t = 0; t < RESAMPLER_TAPS; t++)
+        {
+            double x = t - centre - ((double) p / RESAMPLER_PHASES);
+            double s = x == 0 ? 1.0 : sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+            double w = 0.42 + 0.5 * cos(M_PI * x / half) + 0.08 * cos(2.0 * M_PI * x / half);
+            taps[t] = s * w;
+            sum += taps[t];
+        }
+
+        for (t = 0; t < RESAMPLER_TAPS; t++)
+        {
+            int16_t c = (int16_t) floor((taps[t] / sum) * (1 << 14) + 0.5);
+            r->coeffs[(p * RESAMPLER_TAPS) + t] = c;
+            total += c;
+        }
+
+        // Put any rounding error on the centre tap, so DC passes exactly
+        r->coeffs[(p * RESAMPLER_TAPS) + (int) centre] += (int16_t) ((1 << 14) - total);
+    }
+}
+
+// Worst case number of output frames from a call
+uint32_t Resampler_max_output(resampler_t* r, uint32_t in_frames)
+{
+    if (r->bypass)
+        return in_frames;
+
+    return (uint32_t) (((uint64_t) in_frames * r->out_rate) / r->in_rate) + 2;
+}
+
+// Resample interleaved stereo frames. Returns the number of frames written to out.
+uint32_t Resampler_process(resampler_t* r, const int16_t* in, uint32_t in_frames, int16_t* out)
+{
+    uint32_t frames = 0;
+
+    if (r->bypass)
+    {
+        memcpy(out, in, in_frames * 2 * sizeof(int16_t));
+        return in_frames;
+    }
+
+    if (in_frames > r->max_in)
+        in_frames = r->max_in;
+
+    // Append the input after the held frames
+    memcpy(r->history + (RESAMPLER_HELD * 2), in, in_frames * 2 * sizeof(int16_t));
+
+    const uint32_t available = RESAMPLER_HELD + in_frames;
+    uint32_t pos = r->pos;
+
+    while ((pos >> 16) + RESAMPLER_TAPS <= available)
+    {
+        const int16_t* src = r->history + ((pos >> 16) * 2);
+        const int16_t* c   = r->coeffs + (((pos & 0xFFFF) >> (16 - RESAMPLER_PHASE_BITS)) * RESAMPLER_TAPS);
+        int32_t acc_l = 0;
+        int32_t acc_r = 0;
+        int t;
+
+        // Fixed length multiply-accumulate with no branches, so the compiler can vectorise it
+        for (t = 0; t < RESAMPLER_TAPS; t++)
+        {
+            acc_l += src[t * 2]     * c[t];
+            acc_r += src[t * 2 + 1] * c[t];
+        }
+
+        acc_l >>= 14;
+        acc_r >>= 14;
+
+        if (acc_l > 32767) acc_l = 32767; else if (acc_l < -32768) acc_l = -32768;
+        if (acc_r > 32767) acc_r = 32767; else if (acc_r < -32768) acc_r = -32768;
+
+        out[0] = (int16_t) acc_l;
+        out[1] = (int16_t) acc_r;
+        out += 2;
+        frames++;
+
+        pos += r->step;
+        r->pos_rem += r->step_rem;
+        if (r->pos_rem >= r->out_rate)
+        {
+            r->pos_rem -= r->out_rate;
+            pos++;
+        }
+    }
+
+    // Hold the last frames for the next call, and rebase the position onto them
+    const uint32_t consumed = available - RESAMPLER_HELD;
+    memmove(r->history, r->history + (consumed * 2), RESAMPLER_HELD * 2 * sizeof(int16_t));
+    r->pos = pos - (consumed << 16);
+
+    return frames;
+}
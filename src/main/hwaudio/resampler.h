@@ -0,0 +1,43 @@
+/***************************************************************************
+    Polyphase Resampler.
+
+    Converts the stereo output of the sound chips from their internal
+    sample rate to the output device rate, using a windowed sinc filter
+    with a precomputed bank of phases.
+
+    When both rates match, samples are copied through unchanged.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.h"
+
+// Filter length in input frames
+#define RESAMPLER_TAPS       16
+
+// Number of filter phases between two input frames (2^RESAMPLER_PHASE_BITS)
+#define RESAMPLER_PHASE_BITS 8
+#define RESAMPLER_PHASES     (1 << RESAMPLER_PHASE_BITS)
+
+typedef struct
+{
+    uint32_t in_rate;
+    uint32_t out_rate;
+    uint32_t step;          // Input frames per output frame (16.16 fixed point)
+    uint32_t step_rem;      // Remainder of the step, in 1/out_rate units of the lowest bit, so the rate is exact
+    uint32_t pos;           // Position of the next output frame in the history (16.16 fixed point)
+    uint32_t pos_rem;
+    uint32_t max_in;        // Maximum input frames per call
+    Boolean  bypass;        // Rates match
+    int16_t* coeffs;        // [RESAMPLER_PHASES][RESAMPLER_TAPS], 1.14 fixed point
+    int16_t* history;       // Interleaved stereo: held frames followed by the current input
+} resampler_t;
+
+void Resampler_init(resampler_t* r, uint32_t in_rate, uint32_t out_rate, uint32_t max_in);
+void Resampler_destroy(resampler_t* r);
+void Resampler_reset(resampler_t* r);
+uint32_t Resampler_max_output(resampler_t* r, uint32_t in_frames);
+uint32_t Resampler_process(resampler_t* r, const int16_t* in, uint32_t in_frames, int16_t* out);
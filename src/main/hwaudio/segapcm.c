@@ -4,8 +4,9 @@
     This driver is based upon the MAME source code, with some minor 
     modifications to integrate it into the Cannonball framework.
 
-    Note, that I've altered this driver to output at a fixed 44,100Hz.
-    This is to avoid the need for downsampling.  
+    Note, that I've altered this driver to output directly at the internal
+    sample rate of the sound chips (44,100Hz by default), stepping through
+    the 32,000Hz samples. This avoids the need for a separate downsampler.
     
     See http://mamedev.org/source/docs/license.txt for more details.
 ***************************************************************************/
@@ -54,7 +55,9 @@
  * 
  */
 
+#include "globals.h"
 #include "hwaudio/segapcm.h"
+#include "savestate.h"
 
 
 Boolean SegaPCM_initalized;
@@ -70,40 +73,39 @@ uint32_t SegaPCM_buffer_size;
 const static uint8_t SEGAPCM_MONO             = 1;
 const static uint8_t SEGAPCM_STEREO           = 2;
 
-const static uint8_t SEGAPCM_LEFT             = 0;
-const static uint8_t SEGAPCM_RIGHT            = 1;
-
 //  Buffer size for one frame (excluding channel info)
 uint32_t SegaPCM_frame_size;
 
 // Volume of sound chip
 float SegaPCM_volume;
 
-void SegaPCM_clear_buffer();
-void SegaPCM_write_buffer(const uint8_t, uint32_t, int16_t);
-int16_t SegaPCM_read_buffer(const uint8_t, uint32_t);
-
+void SegaPCM_mix_channel(int32_t*, const uint8_t*, uint32_t*, uint32_t, uint32_t, int32_t, int32_t);
 
-#define AUDIO_FREQUENCY 44100
 
-#define PCM_BUFFER_SIZE (AUDIO_FREQUENCY / 30 /*max fps*/) * 2 /*two channels*/
+#define PCM_BUFFER_SIZE (SEGAPCM_MAX_FREQUENCY / 30 /*max fps*/) * 2 /*two channels*/
 
 // Sound buffer stream
-int16_t SegaPCM_buffer[PCM_BUFFER_SIZE]; // maximum possible buffer size.  
+ENGINE_LOCAL int16_t SegaPCM_buffer[PCM_BUFFER_SIZE]; // maximum possible buffer size.  
+
+// Stereo accumulator that channels are mixed into
+ENGINE_LOCAL int32_t SegaPCM_mix[PCM_BUFFER_SIZE];
 
 // Frames per second
 uint32_t SegaPCM_fps; 
 
 // PCM Chip Emulation
 uint8_t* SegaPCM_ram;
-uint8_t SegaPCM_low[16];
+ENGINE_LOCAL uint8_t SegaPCM_low[16];
+ENGINE_LOCAL uint8_t SegaPCM_frac[16]; // Cannonball: Extra fractional address bits for the 44,100Hz step
 uint8_t* SegaPCM_pcm_rom;
 int32_t SegaPCM_max_addr;
 int32_t SegaPCM_bankshift;
 int32_t SegaPCM_bankmask;
 int32_t SegaPCM_rgnmask;
 
-double SegaPCM_downsample;
+// Channel position is 16.16 fixed point: the 24-bit address register shifted up 8 bits.
+// A delta of 1 advances the address register by 1 at 32,000Hz.
+#define PCM_STEP(delta) (((delta) * (32000 << 8)) / SegaPCM_sample_freq)
 
 
 
@@ -137,12 +139,13 @@ void SegaPCM_Destroy()
 {
 }
 
-void SegaPCM_init(int32_t fps)
+void SegaPCM_init(int32_t rate, int32_t fps)
 {
-    SegaPCM_downsample = (32000.0 / (double) AUDIO_FREQUENCY);
+    if (rate > SEGAPCM_MAX_FREQUENCY)
+        rate = SEGAPCM_MAX_FREQUENCY;
 
     SegaPCM_fps = fps;
-    SegaPCM_sample_freq = AUDIO_FREQUENCY;
+    SegaPCM_sample_freq = rate;
     SegaPCM_channels    = SEGAPCM_STEREO;
 
     SegaPCM_frame_size =  SegaPCM_sample_freq / SegaPCM_fps;
@@ -154,7 +157,10 @@ void SegaPCM_init(int32_t fps)
 void SegaPCM_stream_update()
 {
     int ch;
-    SegaPCM_clear_buffer();
+    uint32_t i;
+
+    for (i = 0; i < SegaPCM_buffer_size; i++)
+        SegaPCM_mix[i] = 0;
 
     // loop over channels
     for (ch = 0; ch < 16; ch++)
@@ -164,25 +170,27 @@ void SegaPCM_stream_update()
         // only process active channels
         if ((regs[0x86] & 1) == 0) 
         {             
-            uint8_t *rom  = SegaPCM_pcm_rom + ((regs[0x86] & SegaPCM_bankmask) << SegaPCM_bankshift);
+            const uint8_t *rom = SegaPCM_pcm_rom + ((regs[0x86] & SegaPCM_bankmask) << SegaPCM_bankshift);
 
-            uint32_t addr = (regs[0x85] << 16) | (regs[0x84] << 8) | SegaPCM_low[ch];
-            uint32_t loop = (regs[0x05] << 16) | (regs[0x04] << 8);
+            uint32_t pos  = (regs[0x85] << 24) | (regs[0x84] << 16) | (SegaPCM_low[ch] << 8) | SegaPCM_frac[ch];
+            uint32_t loop = (regs[0x05] << 24) | (regs[0x04] << 16);
             uint8_t end   =  regs[0x06] + 1;
 
-            uint32_t i;
+            // Per frame channel setup
+            // Cannonball Change: Output at the internal sample rate. 
+            const uint32_t step = PCM_STEP(regs[7]);
 
-            // loop over samples on this channel
-            for (i = 0; i < SegaPCM_frame_size; i++) 
+            i = 0;
+            while (i < SegaPCM_frame_size)
             {
-                int8_t v = 0;
+                uint32_t count = SegaPCM_frame_size - i;
 
                 // handle looping if we've hit the end
-                if ((addr >> 16) == end) 
+                if ((pos >> 24) == end) 
                 {
                     if ((regs[0x86] & 2) == 0) 
                     {
-                        addr = loop;
+                        pos = loop;
                     } 
                     else 
                     {
@@ -191,25 +199,58 @@ void SegaPCM_stream_update()
                     }
                 }
 
-                // fetch the sample
-                v = rom[(addr >> 8) & SegaPCM_rgnmask] - 0x80;
-
-                // apply panning
-                SegaPCM_write_buffer(SEGAPCM_LEFT,  i, SegaPCM_read_buffer(SEGAPCM_LEFT,  i) + (v * regs[2]));
-                SegaPCM_write_buffer(SEGAPCM_RIGHT, i, SegaPCM_read_buffer(SEGAPCM_RIGHT, i) + (v * regs[3]));
+                // Samples until the end address is reached
+                if ((pos >> 24) == end)
+                {
+                    count = 1; // Looping within the end page: recheck after every sample
+                }
+                else if (step)
+                {
+                    const uint32_t distance = ((uint32_t) end << 24) - pos;
+                    const uint32_t to_end   = (distance / step) + ((distance % step) != 0);
+                    if (to_end < count)
+                        count = to_end;
+                }
 
-                // Advance.
-                // Cannonball Change: Output at a fixed 44,100Hz. 
-                double increment = ((double)regs[7]) * SegaPCM_downsample;
-                addr = (addr + (int) increment) & 0xffffff;
+                SegaPCM_mix_channel(SegaPCM_mix + (i * SEGAPCM_STEREO), rom, &pos, step, count, regs[2], regs[3]);
+                i += count;
             }
 
             // store back the updated address and info
-            regs[0x84] = addr >> 8;
-            regs[0x85] = addr >> 16;
-            SegaPCM_low[ch] = regs[0x86] & 1 ? 0 : addr;
+            regs[0x84] = pos >> 16;
+            regs[0x85] = pos >> 24;
+            SegaPCM_low[ch]  = regs[0x86] & 1 ? 0 : pos >> 8;
+            SegaPCM_frac[ch] = regs[0x86] & 1 ? 0 : pos;
         }
     }
+
+    // The chip output is 16-bit
+    for (i = 0; i < SegaPCM_buffer_size; i++)
+        SegaPCM_buffer[i] = (int16_t) SegaPCM_mix[i];
+}
+
+// Mix a run of samples from a single channel into the stereo accumulator.
+// The run must not cross the end address, so there are no branches in the loop.
+void SegaPCM_mix_channel(int32_t* mix, const uint8_t* rom, uint32_t* pos, uint32_t step, uint32_t count, int32_t vol_l, int32_t vol_r)
+{
+    uint32_t i;
+    uint32_t p = *pos;
+    const int32_t mask = SegaPCM_rgnmask;
+
+    for (i = 0; i < count; i++)
+    {
+        // fetch the sample
+        const int32_t v = (int8_t) (rom[(p >> 16) & mask] - 0x80);
+
+        // apply panning
+        mix[0] += v * vol_l;
+        mix[1] += v * vol_r;
+        mix += 2;
+
+        p += step;
+    }
+
+    *pos = p;
 }
 
 // Set soundchip volume (0 = Off, 10 = Loudest)
@@ -221,25 +262,19 @@ void SegaPCM_set_volume(uint8_t v)
     SegaPCM_volume = (float) (v / 10.0);
 }
 
-void SegaPCM_clear_buffer()
-{
-    uint32_t i;
-    for (i = 0; i < SegaPCM_buffer_size; i++)
-        SegaPCM_buffer[i] = 0;
-}
-
-void SegaPCM_write_buffer(const uint8_t channel, uint32_t address, int16_t value)
+float SegaPCM_get_volume()
 {
-    //buffer[channel + (address * channels)] = (int16_t) (value * volume); // Unused for now
-    SegaPCM_buffer[channel + (address * SegaPCM_channels)] = value;
+    return SegaPCM_volume;
 }
 
-int16_t SegaPCM_read_buffer(const uint8_t channel, uint32_t address)
+int16_t* SegaPCM_get_buffer()
 {
-    return SegaPCM_buffer[channel + (address * SegaPCM_channels)];
+    return SegaPCM_buffer;
 }
 
-int16_t* SegaPCM_get_buffer()
+// Channel registers live in the sound program's PCM RAM.
+void SegaPCM_register_state()
 {
-    return SegaPCM_buffer;
+    SAVESTATE_ADD(SAVESTATE_SOUND, SegaPCM_low);
+    SAVESTATE_ADD(SAVESTATE_SOUND, SegaPCM_frac);
 }
@@ -4,8 +4,9 @@
     This driver is based upon the MAME source code, with some minor 
     modifications to integrate it into the Cannonball framework.
 
-    Note, that I've altered this driver to output at a fixed 44,100Hz.
-    This is to avoid the need for downsampling.  
+    Note, that I've altered this driver to output directly at the internal
+    sample rate of the sound chips (44,100Hz by default), stepping through
+    the 32,000Hz samples. This avoids the need for a separate downsampler.
     
     See http://mamedev.org/source/docs/license.txt for more details.
 ***************************************************************************/
@@ -20,6 +21,9 @@
 // Size of the buffer (including channel info)
 extern uint32_t SegaPCM_buffer_size;
 
+// Highest supported sample rate (the YM2151 native rate is 55,930Hz)
+#define SEGAPCM_MAX_FREQUENCY 56000
+
 static const uint32_t SEGAPCM_BANK_256    = (11);
 static const uint32_t SEGAPCM_BANK_512    = (12);
 static const uint32_t SEGAPCM_BANK_12M    = (13);
@@ -32,7 +36,9 @@ static const uint32_t SEGAPCM_BANK_MASKF8 = (0xf8 << 16);
 void SegaPCM_Create(uint32_t clock, RomLoader* rom, uint8_t* ram, int32_t bank);
 void SegaPCM_Destroy();
 
-void SegaPCM_init(int32_t fps);
+void SegaPCM_init(int32_t rate, int32_t fps);
 void SegaPCM_stream_update();
 int16_t* SegaPCM_get_buffer();
 void SegaPCM_set_volume(uint8_t);
+float SegaPCM_get_volume();
+void SegaPCM_register_state();
@@ -10,11 +10,15 @@
     See http://mamedev.org/source/docs/license.txt for more details.
 ***************************************************************************/
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>  // For memset on GCC
 
+#include "globals.h"
 #include "hwaudio/ym2151.h"
+#include "arena.h"
+#include "savestate.h"
 
 
 const static uint8_t YM_MONO             = 1;
@@ -34,7 +38,7 @@ uint8_t YM_channels;
 // Size of the buffer (including channel info)
 uint32_t YM_buffer_size;
 
-Boolean YM_irq;
+ENGINE_LOCAL Boolean YM_irq;
 
 //  Buffer size for one frame (excluding channel info)
 uint32_t YM_frame_size;
@@ -42,6 +46,12 @@ uint32_t YM_frame_size;
 // Volume of sound chip
 float YM_volume;
 
+// Synthesis path (YM_RENDER_BLOCKS, YM_RENDER_SAMPLES or YM_RENDER_COMPARE)
+uint8_t YM_render_mode = YM_RENDER_BLOCKS;
+
+// Mismatches found between the block and per-sample paths in comparison mode
+uint32_t YM_compare_errors = 0;
+
 void YM_clear_buffer();
 void YM_write_buffer(const uint8_t, uint32_t, int16_t);
 int16_t YM_read_buffer(const uint8_t, uint32_t);
@@ -66,48 +76,56 @@ void YM_ym2151_reset_chip();
  signed int YM_op_calc1(YM2151Operator * OP, unsigned int env, signed int pm);
  void YM_chan_calc(unsigned int chan);
  void YM_chan7_calc();
+ void YM_advance_op_eg(YM2151Operator *op, uint32_t cnt);
  void YM_advance_eg();
+ void YM_advance_lfo();
+ void YM_advance_phase(YM2151Operator *op, int32_t pm);
  void YM_advance();
+ void YM_advance_timer_a();
+ Boolean YM_channel_idle(YM2151Operator *op);
+ void YM_stream_update_samples(uint32_t offset, uint32_t length);
+ void YM_stream_update_block(uint32_t offset, uint32_t length);
+ void YM_stream_update_compare(uint32_t length);
 
 
-signed int     chanout[8];
-signed int     m2,c1,c2;            /* Phase Modulation input for operators 2,3,4  */
-signed int     mem;                 /* one sample delay memory */
+ENGINE_LOCAL signed int     chanout[8];
+ENGINE_LOCAL signed int     m2,c1,c2;            /* Phase Modulation input for operators 2,3,4  */
+ENGINE_LOCAL signed int     mem;                 /* one sample delay memory */
 
-YM2151Operator oper[32];            /* the 32 operators */
+ENGINE_LOCAL YM2151Operator oper[32];            /* the 32 operators */
 
-uint32_t       pan[16];             /* channels output masks (0xffffffff = enable) */
+ENGINE_LOCAL uint32_t       pan[16];             /* channels output masks (0xffffffff = enable) */
 
-uint32_t       eg_cnt;              /* global envelope generator counter */
-uint32_t       eg_timer;            /* global envelope generator counter works at frequency = chipclock/64/3 */
+ENGINE_LOCAL uint32_t       eg_cnt;              /* global envelope generator counter */
+ENGINE_LOCAL uint32_t       eg_timer;            /* global envelope generator counter works at frequency = chipclock/64/3 */
 uint32_t       eg_timer_add;        /* step of eg_timer */
 uint32_t       eg_timer_overflow;   /* envelope generator timer overlfows every 3 samples (on real chip) */
 
-uint32_t       lfo_phase;           /* accumulated LFO phase (0 to 255) */
-uint32_t       lfo_timer;           /* LFO timer                        */
+ENGINE_LOCAL uint32_t       lfo_phase;           /* accumulated LFO phase (0 to 255) */
+ENGINE_LOCAL uint32_t       lfo_timer;           /* LFO timer                        */
 uint32_t       lfo_timer_add;       /* step of lfo_timer                */
-uint32_t       lfo_overflow;        /* LFO generates new output when lfo_timer reaches this value */
-uint32_t       lfo_counter;         /* LFO phase increment counter      */
-uint32_t       lfo_counter_add;     /* step of lfo_counter              */
-uint8_t        lfo_wsel;            /* LFO waveform (0-saw, 1-square, 2-triangle, 3-random noise) */
-uint8_t        amd;                 /* LFO Amplitude Modulation Depth   */
-int8_t         pmd;                 /* LFO Phase Modulation Depth       */
-uint32_t       lfa;                 /* LFO current AM output            */
-int32_t        lfp;                 /* LFO current PM output            */
+ENGINE_LOCAL uint32_t       lfo_overflow;        /* LFO generates new output when lfo_timer reaches this value */
+ENGINE_LOCAL uint32_t       lfo_counter;         /* LFO phase increment counter      */
+ENGINE_LOCAL uint32_t       lfo_counter_add;     /* step of lfo_counter              */
+ENGINE_LOCAL uint8_t        lfo_wsel;            /* LFO waveform (0-saw, 1-square, 2-triangle, 3-random noise) */
+ENGINE_LOCAL uint8_t        amd;                 /* LFO Amplitude Modulation Depth   */
+ENGINE_LOCAL int8_t         pmd;                 /* LFO Phase Modulation Depth       */
+ENGINE_LOCAL uint32_t       lfa;                 /* LFO current AM output            */
+ENGINE_LOCAL int32_t        lfp;                 /* LFO current PM output            */
 
-uint8_t        test;                /* TEST register */
-uint8_t        ct;                  /* output control pins (bit1-CT2, bit0-CT1) */
+ENGINE_LOCAL uint8_t        test;                /* TEST register */
+ENGINE_LOCAL uint8_t        ct;                  /* output control pins (bit1-CT2, bit0-CT1) */
 
-uint32_t       noise;               /* noise enable/period register (bit 7 - noise enable, bits 4-0 - noise period */
-uint32_t       noise_rng;           /* 17 bit noise shift register */
-uint32_t       noise_p;             /* current noise 'phase'*/
-uint32_t       noise_f;             /* current noise period */
+ENGINE_LOCAL uint32_t       noise;               /* noise enable/period register (bit 7 - noise enable, bits 4-0 - noise period */
+ENGINE_LOCAL uint32_t       noise_rng;           /* 17 bit noise shift register */
+ENGINE_LOCAL uint32_t       noise_p;             /* current noise 'phase'*/
+ENGINE_LOCAL uint32_t       noise_f;             /* current noise period */
 
-uint32_t       csm_req;             /* CSM  KEY ON / KEY OFF sequence request */
+ENGINE_LOCAL uint32_t       csm_req;             /* CSM  KEY ON / KEY OFF sequence request */
 
-uint32_t       irq_enable;          /* IRQ enable for timer B (bit 3) and timer A (bit 2); bit 7 - CSM mode (keyon to all slots, everytime timer A overflows) */
-uint32_t       status;              /* chip status (BUSY, IRQ Flags) */
-uint8_t        connects[8];         /* channels connections */
+ENGINE_LOCAL uint32_t       irq_enable;          /* IRQ enable for timer B (bit 3) and timer A (bit 2); bit 7 - CSM mode (keyon to all slots, everytime timer A overflows) */
+ENGINE_LOCAL uint32_t       status;              /* chip status (BUSY, IRQ Flags) */
+ENGINE_LOCAL uint8_t        connects[8];         /* channels connections */
 
 #ifdef USE_MAME_TIMERS
 /* ASG 980324 -- added for tracking timers */
@@ -117,17 +135,17 @@ uint8_t        connects[8];         /* channels connections */
     attotime   timer_B_time[256];   /* timer B times for MAME */
     int        irqlinestate;
 #else
-    uint8_t    tim_A;               /* timer A enable (0-disabled) */
-    uint8_t    tim_B;               /* timer B enable (0-disabled) */
-    int32_t    tim_A_val;           /* current value of timer A */
-    int32_t    tim_B_val;           /* current value of timer B */
+    ENGINE_LOCAL uint8_t    tim_A;               /* timer A enable (0-disabled) */
+    ENGINE_LOCAL uint8_t    tim_B;               /* timer B enable (0-disabled) */
+    ENGINE_LOCAL int32_t    tim_A_val;           /* current value of timer A */
+    ENGINE_LOCAL int32_t    tim_B_val;           /* current value of timer B */
     uint32_t   tim_A_tab[1024];     /* timer A deltas */
     uint32_t   tim_B_tab[256];      /* timer B deltas */
 #endif
-uint32_t       timer_A_index;       /* timer A index */
-uint32_t       timer_B_index;       /* timer B index */
-uint32_t       timer_A_index_old;   /* timer A previous index */
-uint32_t       timer_B_index_old;   /* timer B previous index */
+ENGINE_LOCAL uint32_t       timer_A_index;       /* timer A index */
+ENGINE_LOCAL uint32_t       timer_B_index;       /* timer B index */
+ENGINE_LOCAL uint32_t       timer_A_index_old;   /* timer A previous index */
+ENGINE_LOCAL uint32_t       timer_B_index_old;   /* timer B previous index */
 
 /*  Frequency-deltas to get the closest frequency possible.
 *   There are 11 octaves because of DT2 (max 950 cents over base frequency)
@@ -473,7 +491,8 @@ void YM_Create(float volume, uint32_t clock)
 
 void YM_Destroy()
 {
-    free(YM_buffer);
+    Arena_free(YM_buffer);
+    YM_buffer = NULL;
 }
 
 
@@ -1356,9 +1375,9 @@ void YM_init(int rate, int fps)
     YM_buffer_size = YM_frame_size * YM_channels;
 
     if (YM_initalized)
-        free(YM_buffer);
+        Arena_free(YM_buffer);
     
-    YM_buffer = (int16_t*)malloc(YM_buffer_size * sizeof(int16_t));
+    YM_buffer = (int16_t*)Arena_alloc(ARENA_AUDIO, YM_buffer_size * sizeof(int16_t));
 
     YM_initalized = TRUE;
 
@@ -1381,12 +1400,19 @@ void YM_init(int rate, int fps)
 /* this must be done _before_ a call to ym2151_reset_chip() */
     PSG->timer_A = device->machine().scheduler().timer_alloc(FUNC(timer_callback_a), PSG);
     PSG->timer_B = device->machine().scheduler().timer_alloc(FUNC(timer_callback_b), PSG);
-#else
+#endif
+    YM_reset();
+    /*logerror("YM2151[init] clock=%i sampfreq=%i\n", PSG->clock, PSG->sampfreq);*/
+}
+
+// Reset the chip state owned by the calling thread, keeping the tables built by YM_init
+void YM_reset()
+{
+#ifndef USE_MAME_TIMERS
     tim_A      = 0;
     tim_B      = 0;
 #endif
     YM_ym2151_reset_chip();
-    /*logerror("YM2151[init] clock=%i sampfreq=%i\n", PSG->clock, PSG->sampfreq);*/
 }
 
 void ym2151_shutdown()
@@ -1809,6 +1835,68 @@ rate 11 1         |
                                  --
 */
 
+// Advance the envelope of a single operator by one envelope generator tick
+void YM_advance_op_eg(YM2151Operator *op, uint32_t cnt)
+{
+    switch(op->state)
+    {
+    case EG_ATT:    /* attack phase */
+        if ( !(cnt & ((1<<op->eg_sh_ar)-1) ) )
+        {
+            op->volume += (~op->volume *
+                           (eg_inc[op->eg_sel_ar + ((cnt>>op->eg_sh_ar)&7)])
+                          ) >>4;
+
+            if (op->volume <= MIN_ATT_INDEX)
+            {
+                op->volume = MIN_ATT_INDEX;
+                op->state = EG_DEC;
+            }
+
+        }
+    break;
+
+    case EG_DEC:    /* decay phase */
+        if ( !(cnt & ((1<<op->eg_sh_d1r)-1) ) )
+        {
+            op->volume += eg_inc[op->eg_sel_d1r + ((cnt>>op->eg_sh_d1r)&7)];
+
+            if ( op->volume >= (int32_t) op->d1l )
+                op->state = EG_SUS;
+
+        }
+    break;
+
+    case EG_SUS:    /* sustain phase */
+        if ( !(cnt & ((1<<op->eg_sh_d2r)-1) ) )
+        {
+            op->volume += eg_inc[op->eg_sel_d2r + ((cnt>>op->eg_sh_d2r)&7)];
+
+            if ( op->volume >= MAX_ATT_INDEX )
+            {
+                op->volume = MAX_ATT_INDEX;
+                op->state = EG_OFF;
+            }
+
+        }
+    break;
+
+    case EG_REL:    /* release phase */
+        if ( !(cnt & ((1<<op->eg_sh_rr)-1) ) )
+        {
+            op->volume += eg_inc[op->eg_sel_rr + ((cnt>>op->eg_sh_rr)&7)];
+
+            if ( op->volume >= MAX_ATT_INDEX )
+            {
+                op->volume = MAX_ATT_INDEX;
+                op->state = EG_OFF;
+            }
+
+        }
+    break;
+    }
+}
+
 void YM_advance_eg()
 {
     YM2151Operator *op;
@@ -1827,63 +1915,7 @@ void YM_advance_eg()
         i = 32;
         do
         {
-            switch(op->state)
-            {
-            case EG_ATT:    /* attack phase */
-                if ( !(eg_cnt & ((1<<op->eg_sh_ar)-1) ) )
-                {
-                    op->volume += (~op->volume *
-                                   (eg_inc[op->eg_sel_ar + ((eg_cnt>>op->eg_sh_ar)&7)])
-                                  ) >>4;
-
-                    if (op->volume <= MIN_ATT_INDEX)
-                    {
-                        op->volume = MIN_ATT_INDEX;
-                        op->state = EG_DEC;
-                    }
-
-                }
-            break;
-
-            case EG_DEC:    /* decay phase */
-                if ( !(eg_cnt & ((1<<op->eg_sh_d1r)-1) ) )
-                {
-                    op->volume += eg_inc[op->eg_sel_d1r + ((eg_cnt>>op->eg_sh_d1r)&7)];
-
-                    if ( op->volume >= (int32_t) op->d1l )
-                        op->state = EG_SUS;
-
-                }
-            break;
-
-            case EG_SUS:    /* sustain phase */
-                if ( !(eg_cnt & ((1<<op->eg_sh_d2r)-1) ) )
-                {
-                    op->volume += eg_inc[op->eg_sel_d2r + ((eg_cnt>>op->eg_sh_d2r)&7)];
-
-                    if ( op->volume >= MAX_ATT_INDEX )
-                    {
-                        op->volume = MAX_ATT_INDEX;
-                        op->state = EG_OFF;
-                    }
-
-                }
-            break;
-
-            case EG_REL:    /* release phase */
-                if ( !(eg_cnt & ((1<<op->eg_sh_rr)-1) ) )
-                {
-                    op->volume += eg_inc[op->eg_sel_rr + ((eg_cnt>>op->eg_sh_rr)&7)];
-
-                    if ( op->volume >= MAX_ATT_INDEX )
-                    {
-                        op->volume = MAX_ATT_INDEX;
-                        op->state = EG_OFF;
-                    }
-
-                }
-            break;
-            }
+            YM_advance_op_eg(op, eg_cnt);
             op++;
             i--;
         }while (i);
@@ -1891,9 +1923,10 @@ void YM_advance_eg()
 }
 
 
-void YM_advance()
+
+// Update the LFO (AM & PM outputs) and the noise generator by one sample
+void YM_advance_lfo()
 {
-    YM2151Operator *op;
     unsigned int i;
     int a,p;
 
@@ -1992,45 +2025,50 @@ void YM_advance()
         noise_rng = (j<<16) | (noise_rng>>1);
         i--;
     }
+}
 
+// Update the phase of the four operators of a channel by one sample
+void YM_advance_phase(YM2151Operator *op, int32_t pm)
+{
+    if (op->pms)    /* only when phase modulation from LFO is enabled for this channel */
+    {
+        int32_t mod_ind = pm;        /* -128..+127 (8bits signed) */
+        if (op->pms < 6)
+            mod_ind >>= (6 - op->pms);
+        else
+            mod_ind <<= (op->pms - 5);
+
+        if (mod_ind)
+        {
+            uint32_t kc_channel =    op->kc_i + mod_ind;
+            (op+0)->phase += ( (freq[ kc_channel + (op+0)->dt2 ] + (op+0)->dt1) * (op+0)->mul ) >> 1;
+            (op+1)->phase += ( (freq[ kc_channel + (op+1)->dt2 ] + (op+1)->dt1) * (op+1)->mul ) >> 1;
+            (op+2)->phase += ( (freq[ kc_channel + (op+2)->dt2 ] + (op+2)->dt1) * (op+2)->mul ) >> 1;
+            (op+3)->phase += ( (freq[ kc_channel + (op+3)->dt2 ] + (op+3)->dt1) * (op+3)->mul ) >> 1;
+            return;
+        }
+    }
+
+    /* phase modulation from LFO is disabled or equal to zero */
+    (op+0)->phase += (op+0)->freq;
+    (op+1)->phase += (op+1)->freq;
+    (op+2)->phase += (op+2)->freq;
+    (op+3)->phase += (op+3)->freq;
+}
+
+void YM_advance()
+{
+    YM2151Operator *op;
+    unsigned int i;
+
+    YM_advance_lfo();
 
     /* phase generator */
     op = &oper[0];    /* CH 0 M1 */
     i = 8;
     do
     {
-        if (op->pms)    /* only when phase modulation from LFO is enabled for this channel */
-        {
-            int32_t mod_ind = lfp;        /* -128..+127 (8bits signed) */
-            if (op->pms < 6)
-                mod_ind >>= (6 - op->pms);
-            else
-                mod_ind <<= (op->pms - 5);
-
-            if (mod_ind)
-            {
-                uint32_t kc_channel =    op->kc_i + mod_ind;
-                (op+0)->phase += ( (freq[ kc_channel + (op+0)->dt2 ] + (op+0)->dt1) * (op+0)->mul ) >> 1;
-                (op+1)->phase += ( (freq[ kc_channel + (op+1)->dt2 ] + (op+1)->dt1) * (op+1)->mul ) >> 1;
-                (op+2)->phase += ( (freq[ kc_channel + (op+2)->dt2 ] + (op+2)->dt1) * (op+2)->mul ) >> 1;
-                (op+3)->phase += ( (freq[ kc_channel + (op+3)->dt2 ] + (op+3)->dt1) * (op+3)->mul ) >> 1;
-            }
-            else        /* phase modulation from LFO is equal to zero */
-            {
-                (op+0)->phase += (op+0)->freq;
-                (op+1)->phase += (op+1)->freq;
-                (op+2)->phase += (op+2)->freq;
-                (op+3)->phase += (op+3)->freq;
-            }
-        }
-        else            /* phase modulation from LFO is disabled */
-        {
-            (op+0)->phase += (op+0)->freq;
-            (op+1)->phase += (op+1)->freq;
-            (op+2)->phase += (op+2)->freq;
-            (op+3)->phase += (op+3)->freq;
-        }
-
+        YM_advance_phase(op, lfp);
         op+=4;
         i--;
     }while (i);
@@ -2074,40 +2112,53 @@ void YM_advance()
     }
 }
 
-/*  Generate samples for one of the YM2151's
-*
-*   'num' is the number of virtual YM2151
-*   '**buffers' is table of pointers to the buffers: left and right
-*   'length' is the number of samples that should be generated
-*/
-void YM_stream_update()
+// Timer A, advanced by one sample
+void YM_advance_timer_a()
 {
-    YM_clear_buffer();
-    uint32_t i;
-    int32_t outl,outr;
-    uint32_t length = YM_frame_size;
-
 #ifdef USE_MAME_TIMERS
         /* ASG 980324 - handled by real timers now */
 #else
-    if (tim_B)
+    if (tim_A)
     {
-        tim_B_val -= ( length << TIMER_SH );
-        if (tim_B_val<=0)
+        tim_A_val -= ( 1 << TIMER_SH );
+        if (tim_A_val <= 0)
         {
-            tim_B_val += tim_B_tab[ timer_B_index ];
-            if ( irq_enable & 0x08 )
+            tim_A_val += tim_A_tab[ timer_A_index ];
+            if (irq_enable & 0x04)
             {
                 int oldstate = status & 3;
-                status |= 2;
+                status |= 1;
                 //if ((!oldstate) && (irqhandler)) (*irqhandler)(device, 1);
                 if (oldstate==0) YM_irq = TRUE;
             }
+            if (irq_enable & 0x80)
+                csm_req = 2;    /* request KEY ON / KEY OFF sequence */
         }
     }
 #endif
+}
+
+// Clip and output a single stereo sample. Volume is applied by the mixer.
+#define YM_output_sample(i, outl, outr)                        \
+{                                                              \
+    outl >>= FINAL_SH;                                         \
+    outr >>= FINAL_SH;                                         \
+    if (outl > MAXOUT) outl = MAXOUT;                          \
+        else if (outl < MINOUT) outl = MINOUT;                 \
+    if (outr > MAXOUT) outr = MAXOUT;                          \
+        else if (outr < MINOUT) outr = MINOUT;                 \
+                                                               \
+    YM_write_buffer(YM_LEFT,  i, (int16_t) outl);              \
+    YM_write_buffer(YM_RIGHT, i, (int16_t) outr);              \
+}
+
+// Reference path: run the whole chip one sample at a time.
+void YM_stream_update_samples(uint32_t offset, uint32_t length)
+{
+    uint32_t i;
+    int32_t outl,outr;
 
-    for (i=0; i<length; i++)
+    for (i=offset; i<offset+length; i++)
     {
         YM_advance_eg();
 
@@ -2146,40 +2197,300 @@ void YM_stream_update()
         outl += (chanout[7] & pan[14]);
         outr += (chanout[7] & pan[15]);
 
-        outl >>= FINAL_SH;
-        outr >>= FINAL_SH;
-        if (outl > MAXOUT) outl = MAXOUT;
-            else if (outl < MINOUT) outl = MINOUT;
-        if (outr > MAXOUT) outr = MAXOUT;
-            else if (outr < MINOUT) outr = MINOUT;
-        
-        YM_write_buffer(YM_LEFT,  i, (int16_t) (outl * YM_volume));
-        YM_write_buffer(YM_RIGHT, i, (int16_t) (outr * YM_volume));
+        YM_output_sample(i, outl, outr);
+        YM_advance_timer_a();
+        YM_advance();
+    }
+}
+
+// A channel is idle when all four operators are off and nothing is left in its
+// feedback and delay registers. An idle channel outputs silence until keyed on.
+Boolean YM_channel_idle(YM2151Operator *op)
+{
+    return op[0].state == EG_OFF && op[1].state == EG_OFF &&
+           op[2].state == EG_OFF && op[3].state == EG_OFF &&
+           op->fb_out_prev == 0 && op->fb_out_curr == 0 && op->mem_value == 0;
+}
+
+// Block path: output identical to YM_stream_update_samples.
+//
+// The envelope counter, LFO and noise generator are global to the chip, so they are
+// stepped once per block and their per-sample values recorded. Each channel then
+// runs through the block on its own. Idle channels only have their phase advanced.
+//
+// Not valid while CSM mode is in use, as CSM keys every channel on and off mid-block.
+void YM_stream_update_block(uint32_t offset, uint32_t length)
+{
+    static int32_t  blk_outl[YM_BLOCK_SIZE];
+    static int32_t  blk_outr[YM_BLOCK_SIZE];
+    static uint32_t blk_eg_cnt[YM_BLOCK_SIZE];   // Envelope counter before this sample's ticks
+    static uint8_t  blk_eg_ticks[YM_BLOCK_SIZE]; // Envelope ticks this sample
+    static uint32_t blk_lfa[YM_BLOCK_SIZE];
+    static int32_t  blk_lfp[YM_BLOCK_SIZE];
+    static uint32_t blk_noise[YM_BLOCK_SIZE];
+
+    uint32_t i, t;
+    unsigned int chan;
+    uint32_t lfa_end, noise_rng_end;
+    int32_t lfp_end;
+
+    // Global generators
+    for (i = 0; i < length; i++)
+    {
+        blk_eg_cnt[i]   = eg_cnt;
+        blk_eg_ticks[i] = 0;
+        eg_timer += eg_timer_add;
+        while (eg_timer >= eg_timer_overflow)
+        {
+            eg_timer -= eg_timer_overflow;
+            eg_cnt++;
+            blk_eg_ticks[i]++;
+        }
+
+        blk_lfa[i]   = lfa;
+        blk_noise[i] = noise_rng;
+        YM_advance_lfo();
+        blk_lfp[i]   = lfp;
+
+        blk_outl[i] = 0;
+        blk_outr[i] = 0;
+
+        YM_advance_timer_a();
+    }
+
+    lfa_end       = lfa;
+    lfp_end       = lfp;
+    noise_rng_end = noise_rng;
+
+    // Channels
+    for (chan = 0; chan < 8; chan++)
+    {
+        YM2151Operator *op = &oper[chan*4];
+        const uint32_t pan_l = pan[chan*2];
+        const uint32_t pan_r = pan[chan*2 + 1];
+
+        if (YM_channel_idle(op))
+        {
+            if (op->pms)
+            {
+                for (i = 0; i < length; i++)
+                    YM_advance_phase(op, blk_lfp[i]);
+            }
+            else
+            {
+                (op+0)->phase += (op+0)->freq * length;
+                (op+1)->phase += (op+1)->freq * length;
+                (op+2)->phase += (op+2)->freq * length;
+                (op+3)->phase += (op+3)->freq * length;
+            }
+            continue;
+        }
+
+        for (i = 0; i < length; i++)
+        {
+            for (t = 1; t <= blk_eg_ticks[i]; t++)
+            {
+                YM_advance_op_eg(op+0, blk_eg_cnt[i] + t);
+                YM_advance_op_eg(op+1, blk_eg_cnt[i] + t);
+                YM_advance_op_eg(op+2, blk_eg_cnt[i] + t);
+                YM_advance_op_eg(op+3, blk_eg_cnt[i] + t);
+            }
+
+            lfa = blk_lfa[i];
+            chanout[chan] = 0;
+            if (chan == 7)
+            {
+                noise_rng = blk_noise[i];
+                YM_chan7_calc();
+            }
+            else
+                YM_chan_calc(chan);
+
+            blk_outl[i] += (chanout[chan] & pan_l);
+            blk_outr[i] += (chanout[chan] & pan_r);
+
+            YM_advance_phase(op, blk_lfp[i]);
+        }
+    }
+
+    lfa       = lfa_end;
+    lfp       = lfp_end;
+    noise_rng = noise_rng_end;
+
+    for (i = 0; i < length; i++)
+    {
+        int32_t outl = blk_outl[i];
+        int32_t outr = blk_outr[i];
+        YM_output_sample(offset + i, outl, outr);
+    }
+}
+
+// Chip state that changes while generating samples. Used by the comparison mode.
+typedef struct
+{
+    YM2151Operator oper[32];
+    signed int chanout[8];
+    uint32_t eg_cnt, eg_timer;
+    uint32_t lfo_phase, lfo_timer, lfo_counter, lfa;
+    int32_t  lfp;
+    uint32_t noise_rng, noise_p;
+    uint32_t csm_req, status;
+#ifndef USE_MAME_TIMERS
+    int32_t  tim_A_val, tim_B_val;
+#endif
+    Boolean  irq;
+} ym_state_t;
+
+void YM_save_state(ym_state_t* st)
+{
+    memcpy(st->oper, oper, sizeof(oper));
+    memcpy(st->chanout, chanout, sizeof(chanout));
+    st->eg_cnt      = eg_cnt;
+    st->eg_timer    = eg_timer;
+    st->lfo_phase   = lfo_phase;
+    st->lfo_timer   = lfo_timer;
+    st->lfo_counter = lfo_counter;
+    st->lfa         = lfa;
+    st->lfp         = lfp;
+    st->noise_rng   = noise_rng;
+    st->noise_p     = noise_p;
+    st->csm_req     = csm_req;
+    st->status      = status;
+#ifndef USE_MAME_TIMERS
+    st->tim_A_val   = tim_A_val;
+    st->tim_B_val   = tim_B_val;
+#endif
+    st->irq         = YM_irq;
+}
+
+void YM_load_state(ym_state_t* st)
+{
+    memcpy(oper, st->oper, sizeof(oper));
+    memcpy(chanout, st->chanout, sizeof(chanout));
+    eg_cnt      = st->eg_cnt;
+    eg_timer    = st->eg_timer;
+    lfo_phase   = st->lfo_phase;
+    lfo_timer   = st->lfo_timer;
+    lfo_counter = st->lfo_counter;
+    lfa         = st->lfa;
+    lfp         = st->lfp;
+    noise_rng   = st->noise_rng;
+    noise_p     = st->noise_p;
+    csm_req     = st->csm_req;
+    status      = st->status;
+#ifndef USE_MAME_TIMERS
+    tim_A_val   = st->tim_A_val;
+    tim_B_val   = st->tim_B_val;
+#endif
+    YM_irq      = st->irq;
+}
+
+// Generate the frame with the per-sample path, then regenerate it with the block path
+// from the same starting state. Any difference in output or operator state is reported.
+void YM_stream_update_compare(uint32_t length)
+{
+    static ym_state_t start, reference;
+    static int16_t* ref_buffer = NULL;
+    static uint32_t ref_size   = 0;
+    uint32_t i, offset;
+
+    if (ref_size < YM_buffer_size)
+    {
+        Arena_free(ref_buffer);
+        ref_buffer = (int16_t*) Arena_alloc(ARENA_AUDIO, YM_buffer_size * sizeof(int16_t));
+        ref_size   = YM_buffer_size;
+    }
+
+    YM_save_state(&start);
+    YM_stream_update_samples(0, length);
+    memcpy(ref_buffer, YM_buffer, length * YM_channels * sizeof(int16_t));
+    YM_save_state(&reference);
+
+    YM_load_state(&start);
+    for (offset = 0; offset < length; offset += YM_BLOCK_SIZE)
+        YM_stream_update_block(offset, (length - offset) < YM_BLOCK_SIZE ? (length - offset) : YM_BLOCK_SIZE);
+
+    for (i = 0; i < length * YM_channels; i++)
+    {
+        if (ref_buffer[i] != YM_buffer[i])
+        {
+            YM_compare_errors++;
+            fprintf(stderr, "YM2151: Block output differs at sample %d (%d != %d)\n", i / YM_channels, YM_buffer[i], ref_buffer[i]);
+            break;
+        }
+    }
+
+    for (i = 0; i < 32; i++)
+    {
+        if (memcmp(&reference.oper[i], &oper[i], sizeof(YM2151Operator)) != 0)
+        {
+            YM_compare_errors++;
+            fprintf(stderr, "YM2151: Block operator %d state differs\n", i);
+            break;
+        }
+    }
+
+    // Continue from the reference
+    memcpy(YM_buffer, ref_buffer, length * YM_channels * sizeof(int16_t));
+    YM_load_state(&reference);
+}
+
+/*  Generate samples for one of the YM2151's
+*
+*   'num' is the number of virtual YM2151
+*   '**buffers' is table of pointers to the buffers: left and right
+*   'length' is the number of samples that should be generated
+*/
+void YM_stream_update()
+{
+    YM_clear_buffer();
+    uint32_t offset;
+    uint32_t length = YM_frame_size;
 
 #ifdef USE_MAME_TIMERS
         /* ASG 980324 - handled by real timers now */
 #else
-        /* calculate timer A */
-        if (tim_A)
+    if (tim_B)
+    {
+        tim_B_val -= ( length << TIMER_SH );
+        if (tim_B_val<=0)
         {
-            tim_A_val -= ( 1 << TIMER_SH );
-            if (tim_A_val <= 0)
+            tim_B_val += tim_B_tab[ timer_B_index ];
+            if ( irq_enable & 0x08 )
             {
-                tim_A_val += tim_A_tab[ timer_A_index ];
-                if (irq_enable & 0x04)
-                {
-                    int oldstate = status & 3;
-                    status |= 1;
-                    //if ((!oldstate) && (irqhandler)) (*irqhandler)(device, 1);
-                    if (oldstate==0) YM_irq = TRUE;
-                }
-                if (irq_enable & 0x80)
-                    csm_req = 2;    /* request KEY ON / KEY OFF sequence */
+                int oldstate = status & 3;
+                status |= 2;
+                //if ((!oldstate) && (irqhandler)) (*irqhandler)(device, 1);
+                if (oldstate==0) YM_irq = TRUE;
             }
         }
+    }
 #endif
-        YM_advance();
+
+    // CSM mode keys channels on and off at sample granularity
+    if (YM_render_mode == YM_RENDER_SAMPLES || (irq_enable & 0x80) || csm_req)
+    {
+        YM_stream_update_samples(0, length);
+    }
+    else if (YM_render_mode == YM_RENDER_COMPARE)
+    {
+        YM_stream_update_compare(length);
     }
+    else
+    {
+        for (offset = 0; offset < length; offset += YM_BLOCK_SIZE)
+            YM_stream_update_block(offset, (length - offset) < YM_BLOCK_SIZE ? (length - offset) : YM_BLOCK_SIZE);
+    }
+}
+
+// Print the result of comparing the two synthesis paths. Called at exit.
+void YM_report()
+{
+    if (YM_render_mode != YM_RENDER_COMPARE)
+        return;
+
+    fprintf(stderr, "YM2151 Report:\n");
+    fprintf(stderr, "%u mismatches between block and per-sample synthesis.\n", YM_compare_errors);
 }
 
 // Set soundchip volume (0 = Off, 10 = Loudest)
@@ -2191,6 +2502,11 @@ void YM_set_volume(uint8_t v)
     YM_volume = (float) (v / 10.0);
 }
 
+float YM_get_volume()
+{
+    return YM_volume;
+}
+
 void YM_clear_buffer()
 {
     uint32_t i;
@@ -2213,3 +2529,48 @@ int16_t* YM_get_buffer()
 {
     return YM_buffer;
 }
+
+// Register state and timers. Lookup tables are built at init and are not included.
+void YM_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_SOUND, oper);
+    SAVESTATE_ADD(SAVESTATE_SOUND, chanout);
+    SAVESTATE_ADD(SAVESTATE_SOUND, m2);
+    SAVESTATE_ADD(SAVESTATE_SOUND, c1);
+    SAVESTATE_ADD(SAVESTATE_SOUND, c2);
+    SAVESTATE_ADD(SAVESTATE_SOUND, mem);
+    SAVESTATE_ADD(SAVESTATE_SOUND, pan);
+    SAVESTATE_ADD(SAVESTATE_SOUND, eg_cnt);
+    SAVESTATE_ADD(SAVESTATE_SOUND, eg_timer);
+    SAVESTATE_ADD(SAVESTATE_SOUND, lfo_phase);
+    SAVESTATE_ADD(SAVESTATE_SOUND, lfo_timer);
+    SAVESTATE_ADD(SAVESTATE_SOUND, lfo_overflow);
+    SAVESTATE_ADD(SAVESTATE_SOUND, lfo_counter);
+    SAVESTATE_ADD(SAVESTATE_SOUND, lfo_counter_add);
+    SAVESTATE_ADD(SAVESTATE_SOUND, lfo_wsel);
+    SAVESTATE_ADD(SAVESTATE_SOUND, amd);
+    SAVESTATE_ADD(SAVESTATE_SOUND, pmd);
+    SAVESTATE_ADD(SAVESTATE_SOUND, lfa);
+    SAVESTATE_ADD(SAVESTATE_SOUND, lfp);
+    SAVESTATE_ADD(SAVESTATE_SOUND, test);
+    SAVESTATE_ADD(SAVESTATE_SOUND, ct);
+    SAVESTATE_ADD(SAVESTATE_SOUND, noise);
+    SAVESTATE_ADD(SAVESTATE_SOUND, noise_rng);
+    SAVESTATE_ADD(SAVESTATE_SOUND, noise_p);
+    SAVESTATE_ADD(SAVESTATE_SOUND, noise_f);
+    SAVESTATE_ADD(SAVESTATE_SOUND, csm_req);
+    SAVESTATE_ADD(SAVESTATE_SOUND, irq_enable);
+    SAVESTATE_ADD(SAVESTATE_SOUND, status);
+    SAVESTATE_ADD(SAVESTATE_SOUND, connects);
+#ifndef USE_MAME_TIMERS
+    SAVESTATE_ADD(SAVESTATE_SOUND, tim_A);
+    SAVESTATE_ADD(SAVESTATE_SOUND, tim_B);
+    SAVESTATE_ADD(SAVESTATE_SOUND, tim_A_val);
+    SAVESTATE_ADD(SAVESTATE_SOUND, tim_B_val);
+#endif
+    SAVESTATE_ADD(SAVESTATE_SOUND, timer_A_index);
+    SAVESTATE_ADD(SAVESTATE_SOUND, timer_B_index);
+    SAVESTATE_ADD(SAVESTATE_SOUND, timer_A_index_old);
+    SAVESTATE_ADD(SAVESTATE_SOUND, timer_B_index_old);
+    SAVESTATE_ADD(SAVESTATE_SOUND, YM_irq);
+}
@@ -69,14 +69,32 @@ typedef struct
 } YM2151Operator;
 
 
+// Synthesis paths
+enum
+{
+    YM_RENDER_BLOCKS,   // Per-channel sample blocks, skipping idle channels
+    YM_RENDER_SAMPLES,  // Whole chip one sample at a time (reference)
+    YM_RENDER_COMPARE,  // Run both and report differences to stderr
+};
+
+// Samples processed per channel block
+#define YM_BLOCK_SIZE 256
+
+extern uint8_t YM_render_mode;
+extern uint32_t YM_compare_errors;
+
 void YM_Create(float volume, uint32_t clock);
 void YM_Destroy();
 
 void YM_init(int rate, int fps);
+void YM_reset();
 void YM_stream_update();
 int16_t* YM_get_buffer();
 void YM_set_volume(uint8_t);
+float YM_get_volume();
 
 void YM_write_reg(int r, int v);
 uint32_t YM_read_status();
+void YM_register_state();
+void YM_report();
 
@@ -1,8 +1,10 @@
+#include "Video.h"
 #include "hwvideo/hwroad.h"
 #include "globals.h"
 #include "frontend/config.h"
 
 #include <string.h>
+#include "savestate.h"
 
 /***************************************************************************
     Video Emulation: OutRun Road Rendering Hardware.
@@ -107,20 +109,68 @@
  *
  *******************************************************************************************/
 
-uint8_t HWRoad_road_control;
-uint16_t HWRoad_color_offset1;
-uint16_t HWRoad_color_offset2;
-uint16_t HWRoad_color_offset3;
-int32_t HWRoad_x_offset;
-
-// Decoded road graphics
-uint8_t HWRoad_roads[0x40200];
+ENGINE_LOCAL uint8_t HWRoad_road_control;
+ENGINE_LOCAL uint16_t HWRoad_color_offset1;
+ENGINE_LOCAL uint16_t HWRoad_color_offset2;
+ENGINE_LOCAL uint16_t HWRoad_color_offset3;
+ENGINE_LOCAL int32_t HWRoad_x_offset;
+
+// Road graphics: 512 lines of 512 pixels, plus a dummy line
+#define ROAD_LINES       ((256 * 2) + 1)
+#define ROAD_LINE_PIXELS 512
+#define ROAD_DUMMY_LINE  (256 * 2)
+
+#ifdef PACKED_ROAD_GFX
+// Decoded road graphics: 2 bits per pixel, 4 pixels per byte (leftmost pixel in the top bits)
+#define ROAD_LINE_BYTES (ROAD_LINE_PIXELS / 4)
+uint8_t HWRoad_roads[ROAD_LINES * ROAD_LINE_BYTES];
+
+// Centre stripe side table. Bit n set denotes pixel (248 + n) of the line is centre stripe.
+uint8_t HWRoad_stripes[ROAD_LINES];
+
+// Expand one packed byte to 4 pixels
+uint8_t HWRoad_unpack_lut[256][4];
+#else
+// Decoded road graphics: 1 byte per pixel
+uint8_t HWRoad_roads[ROAD_LINES * ROAD_LINE_PIXELS];
+#endif
+
+#ifdef PACKED_ROAD_GFX
+// Scanline buffers for unpacked road 0 and road 1 data
+uint8_t HWRoad_line0[ROAD_LINE_PIXELS];
+uint8_t HWRoad_line1[ROAD_LINE_PIXELS];
+#define ROAD_LINE_BUF0 HWRoad_line0
+#define ROAD_LINE_BUF1 HWRoad_line1
+#else
+// Lines are read in place
+#define ROAD_LINE_BUF0 NULL
+#define ROAD_LINE_BUF1 NULL
+#endif
 
 // Two halves of RAM
-uint16_t HWRoad_ram[ROAD_RAM_SIZE / 2];
-uint16_t HWRoad_ramBuff[ROAD_RAM_SIZE / 2];
+ENGINE_LOCAL uint16_t HWRoad_banks[2][ROAD_RAM_SIZE / 2];
+
+// Back buffer written by the engine, and front buffer published to the renderer.
+// Swapping exchanges the pointers, rather than the contents.
+// Set by HWRoad_init_state, as thread local addresses are not constant.
+ENGINE_LOCAL uint16_t* HWRoad_ram;
+ENGINE_LOCAL uint16_t* HWRoad_ramBuff;
+
+// Interpolation: horizontal scroll of both roads in the front buffer before the last engine step
+#define ROAD_HSCROLL_START 0x200
+#define ROAD_HSCROLL_END   0x600
+#define ROAD_INTERP_MAX_DELTA 0x100 // Larger moves are a new scanline rather than the road moving
+static uint16_t HWRoad_interp_hscroll[ROAD_HSCROLL_END - ROAD_HSCROLL_START];
+
+// Front buffer published by the last swap. Shared between threads, unlike the banks.
+static const uint16_t* HWRoad_front;
+
+// The renderer's own bank, copied from the front buffer by HWRoad_snapshot, so the
+// engine is free to reuse the front buffer as its back buffer while a frame is rendered.
+static uint16_t HWRoad_render_ram[ROAD_RAM_SIZE / 2];
 
 void HWRoad_decode_road(const uint8_t*);
+uint8_t* HWRoad_get_line(uint32_t, uint8_t*);
 void HWRoad_render_background_lores(uint16_t*);
 void HWRoad_render_foreground_lores(uint16_t*);
 void HWRoad_render_background_hires(uint16_t*);
@@ -129,14 +179,27 @@ void HWRoad_render_foreground_hires(uint16_t*);
 void (*HWRoad_render_background)(uint16_t*);
 void (*HWRoad_render_foreground)(uint16_t*);
 
-// Convert road to a more useable format
-void HWRoad_init(const uint8_t* src_road, const Boolean hires)
+// Reset the road hardware owned by the calling thread
+void HWRoad_init_state()
 {
+    HWRoad_ram     = HWRoad_banks[0];
+    HWRoad_ramBuff = HWRoad_banks[1];
+
+    Video_lock_banks();
+    HWRoad_publish();
+    Video_unlock_banks();
+
     HWRoad_road_control = 0;
     HWRoad_color_offset1 = 0x400;
     HWRoad_color_offset2 = 0x420;
     HWRoad_color_offset3 = 0x780;
     HWRoad_x_offset = 0;
+}
+
+// Convert road to a more useable format
+void HWRoad_init(const uint8_t* src_road, const Boolean hires)
+{
+    HWRoad_init_state();
 
     if (src_road)
         HWRoad_decode_road(src_road);
@@ -179,9 +242,39 @@ void HWRoad_init(const uint8_t* src_road, const Boolean hires)
 void HWRoad_decode_road(const uint8_t* src_road)
 {
     int y,x,i;
+
+#ifdef PACKED_ROAD_GFX
+    for (i = 0; i < 256; i++)
+    {
+        HWRoad_unpack_lut[i][0] = (i >> 6) & 3;
+        HWRoad_unpack_lut[i][1] = (i >> 4) & 3;
+        HWRoad_unpack_lut[i][2] = (i >> 2) & 3;
+        HWRoad_unpack_lut[i][3] = (i >> 0) & 3;
+    }
+#endif
+
     for (y = 0; y < 256 * 2; y++) 
     {
         const int src = ((y & 0xff) * 0x40 + (y >> 8) * 0x8000) % HWRoad_rom_size; // tempGfx
+
+#ifdef PACKED_ROAD_GFX
+        uint8_t* dst = HWRoad_roads + (y * ROAD_LINE_BYTES);
+        HWRoad_stripes[y] = 0;
+
+        // loop over columns
+        for (x = 0; x < 512; x++) 
+        {
+            uint8_t pix = (((src_road[src + (x / 8)] >> (~x & 7)) & 1) << 0) | (((src_road[src + (x / 8 + 0x4000)] >> (~x & 7)) & 1) << 1);
+
+            if ((x & 3) == 0)
+                dst[x >> 2] = 0;
+            dst[x >> 2] |= pix << ((3 - (x & 3)) << 1);
+
+            // mark road data in the "stripe" area in the side table
+            if (x >= 256 - 8 && x < 256 && pix == 3)
+                HWRoad_stripes[y] |= 1 << (x - (256 - 8));
+        }
+#else
         const int dst = y * 512; // System16Roads
 
         // loop over columns
@@ -193,13 +286,53 @@ void HWRoad_decode_road(const uint8_t* src_road)
             if (x >= 256 - 8 && x < 256 && HWRoad_roads[dst + x] == 3)
                 HWRoad_roads[dst + x] |= 4;
         }
+#endif
     }
 
     // set up a dummy road in the last entry
+#ifdef PACKED_ROAD_GFX
+    for (i = 0; i < ROAD_LINE_BYTES; i++) 
+    {
+        HWRoad_roads[ROAD_DUMMY_LINE * ROAD_LINE_BYTES + i] = 0xFF;
+    }
+    HWRoad_stripes[ROAD_DUMMY_LINE] = 0;
+#else
     for (i = 0; i < 512; i++) 
     {
-        HWRoad_roads[256 * 2 * 512 + i] = 3;
+        HWRoad_roads[ROAD_DUMMY_LINE * 512 + i] = 3;
     }
+#endif
+}
+
+// Return the 512 decoded pixels of a road line.
+// With packed road graphics, the line is unpacked into the supplied scanline buffer.
+// Otherwise the buffer is not used, and may be NULL.
+uint8_t* HWRoad_get_line(uint32_t line, uint8_t* buf)
+{
+#ifdef PACKED_ROAD_GFX
+    int i;
+    const uint8_t* src = HWRoad_roads + (line * ROAD_LINE_BYTES);
+    uint8_t* dst = buf;
+
+    for (i = 0; i < ROAD_LINE_BYTES; i++)
+    {
+        memcpy(dst, HWRoad_unpack_lut[src[i]], 4);
+        dst += 4;
+    }
+
+    // Apply centre stripe
+    if (HWRoad_stripes[line])
+    {
+        for (i = 0; i < 8; i++)
+        {
+            if (HWRoad_stripes[line] & (1 << i))
+                buf[256 - 8 + i] |= 4;
+        }
+    }
+    return buf;
+#else
+    return HWRoad_roads + (line * ROAD_LINE_PIXELS);
+#endif
 }
 
 // Writes go to RAM, but we read from the RAM Buffer.
@@ -223,19 +356,18 @@ void HWRoad_write32(uint32_t* adr, const uint32_t data)
     *adr += 4;
 }
 
+// Publish road RAM to the renderer by swapping the halves.
+// The previous front buffer becomes the new back buffer.
 uint16_t HWRoad_read_road_control()
 {
-    uint16_t i;
-    uint32_t *src = (uint32_t *)HWRoad_ram;
-    uint32_t *dst = (uint32_t *)HWRoad_ramBuff;
+    uint16_t* temp;
 
-    // swap the halves of the road RAM
-    for (i = 0; i < ROAD_RAM_SIZE/4; i++)
-    {
-        uint32_t temp = *src;
-        *src++ = *dst;
-        *dst++ = temp;
-    }
+    Video_lock_banks();
+    temp           = HWRoad_ram;
+    HWRoad_ram     = HWRoad_ramBuff;
+    HWRoad_ramBuff = temp;
+    HWRoad_publish();
+    Video_unlock_banks();
 
     return 0xffff;
 }
@@ -245,6 +377,47 @@ void HWRoad_write_road_control(const uint8_t road_control)
     HWRoad_road_control = road_control;
 }
 
+// Give the renderer the address of the front buffer. Called with the banks locked.
+// Threads without a display don't publish, as nothing renders their banks.
+void HWRoad_publish()
+{
+    if (!Video_headless)
+        HWRoad_front = HWRoad_ramBuff;
+}
+
+// Copy the front buffer to render the next frame from. Called with the banks locked.
+void HWRoad_snapshot()
+{
+    if (HWRoad_front)
+        memcpy(HWRoad_render_ram, HWRoad_front, sizeof(HWRoad_render_ram));
+}
+
+// Record the horizontal scroll in the front buffer. Called before each engine step.
+void HWRoad_interp_capture()
+{
+    memcpy(HWRoad_interp_hscroll, HWRoad_ramBuff + ROAD_HSCROLL_START, sizeof(HWRoad_interp_hscroll));
+}
+
+// Move the horizontal scroll of each entry in the snapshot between its recorded value and its current value.
+// alpha: distance between the two, from 0 to VIDEO_INTERP_ONE.
+void HWRoad_interp_begin(const uint16_t alpha)
+{
+    int i;
+
+    for (i = ROAD_HSCROLL_START; i < ROAD_HSCROLL_END; i++)
+    {
+        const uint16_t cur  = HWRoad_render_ram[i];
+        const uint16_t prev = HWRoad_interp_hscroll[i - ROAD_HSCROLL_START];
+
+        // Scroll is 12 bits and wraps
+        int32_t delta = ((cur - prev + 0x800) & 0xfff) - 0x800;
+        if (delta < -ROAD_INTERP_MAX_DELTA || delta > ROAD_INTERP_MAX_DELTA)
+            continue;
+
+        HWRoad_render_ram[i] = (cur & 0xf000) | ((prev + ((delta * alpha) >> VIDEO_INTERP_SHIFT)) & 0xfff);
+    }
+}
+
 // ------------------------------------------------------------------------------------------------
 // Road Rendering: Lores Version
 // ------------------------------------------------------------------------------------------------
@@ -253,7 +426,7 @@ void HWRoad_write_road_control(const uint8_t road_control)
 void HWRoad_render_background_lores(uint16_t* pixels)
 {
     int x, y;
-    uint16_t* roadram = HWRoad_ramBuff;
+    uint16_t* roadram = HWRoad_render_ram;
 
     for (y = 0; y < S16_HEIGHT; y++) 
     {
@@ -306,7 +479,7 @@ void HWRoad_render_background_lores(uint16_t* pixels)
 void HWRoad_render_foreground_lores(uint16_t* pixels)
 {
     int x, y;
-    uint16_t* roadram = HWRoad_ramBuff;
+    uint16_t* roadram = HWRoad_render_ram;
     
     for (y = 0; y < S16_HEIGHT; y++) 
     {
@@ -333,12 +506,12 @@ void HWRoad_render_foreground_lores(uint16_t* pixels)
         int32_t bgcolor; // 8 bits
 
         // get road 0 data
-        src0   = ((data0 & 0x800) != 0) ? HWRoad_roads + 256 * 2 * 512 : (HWRoad_roads + (0x000 + ((data0 >> 1) & 0xff)) * 512);
+        src0   = HWRoad_get_line(((data0 & 0x800) != 0) ? ROAD_DUMMY_LINE : (0x000 + ((data0 >> 1) & 0xff)), ROAD_LINE_BUF0);
         hpos0  = roadram[0x200 + (((HWRoad_road_control & 4) != 0) ? y : (data0 & 0x1ff))] & 0xfff;
         color0 = roadram[0x600 + (((HWRoad_road_control & 4) != 0) ? y : (data0 & 0x1ff))];
 
         // get road 1 data
-        src1   = ((data1 & 0x800) != 0) ? HWRoad_roads + 256 * 2 * 512 : (HWRoad_roads + (0x100 + ((data1 >> 1) & 0xff)) * 512);
+        src1   = HWRoad_get_line(((data1 & 0x800) != 0) ? ROAD_DUMMY_LINE : (0x100 + ((data1 >> 1) & 0xff)), ROAD_LINE_BUF1);
         hpos1  = roadram[0x400 + (((HWRoad_road_control & 4) != 0) ? (0x100 + y) : (data1 & 0x1ff))] & 0xfff;
         color1 = roadram[0x600 + (((HWRoad_road_control & 4) != 0) ? (0x100 + y) : (data1 & 0x1ff))];
 
@@ -431,7 +604,7 @@ void HWRoad_render_foreground_lores(uint16_t* pixels)
 void HWRoad_render_background_hires(uint16_t* pixels)
 {
     int x, y;
-    uint16_t* roadram = HWRoad_ramBuff;
+    uint16_t* roadram = HWRoad_render_ram;
 
     for (y = 0; y < Config_s16_height; y += 2) 
     {
@@ -490,7 +663,7 @@ void HWRoad_render_background_hires(uint16_t* pixels)
 void HWRoad_render_foreground_hires(uint16_t* pixels)
 {
     int x, y, yy;
-    uint16_t* roadram = HWRoad_ramBuff;
+    uint16_t* roadram = HWRoad_render_ram;
     
     uint16_t color_table[32];
     int32_t color0, color1;
@@ -541,7 +714,7 @@ void HWRoad_render_foreground_hires(uint16_t* pixels)
                 data0      = (data0      >> 1) & 0xFF;
                 data0_next = (data0_next >> 1) & 0xFF;
                 int32_t diff = (data0 + ((data0_next - data0) >> 1)) & 0xFF;
-                src0 = (HWRoad_roads + (0x000 + diff) * 512);
+                src0 = HWRoad_get_line(0x000 + diff, ROAD_LINE_BUF0);
                 hpos0 = (hpos0 + ((hpos0_next - hpos0) >> 1)) & 0xFFF;
             }
             // Interpolate road 2 source position
@@ -550,7 +723,7 @@ void HWRoad_render_foreground_hires(uint16_t* pixels)
                 data1      = (data1      >> 1) & 0xFF;
                 data1_next = (data1_next >> 1) & 0xFF;
                 int32_t diff = (data1 + ((data1_next - data1) >> 1)) & 0xFF;
-                src1 = (HWRoad_roads + (0x100 + diff) * 512);
+                src1 = HWRoad_get_line(0x100 + diff, ROAD_LINE_BUF1);
                 hpos1 = (hpos1 + ((hpos1_next - hpos1) >> 1)) & 0xFFF;
             }     
         }
@@ -580,9 +753,9 @@ void HWRoad_render_foreground_hires(uint16_t* pixels)
         }
         
         if (src0 == NULL)
-            src0 = ((data0 & 0x800) != 0) ? HWRoad_roads + 256 * 2 * 512 : (HWRoad_roads + (0x000 + ((data0 >> 1) & 0xff)) * 512);
+            src0 = HWRoad_get_line(((data0 & 0x800) != 0) ? ROAD_DUMMY_LINE : (0x000 + ((data0 >> 1) & 0xff)), ROAD_LINE_BUF0);
         if (src1 == NULL)
-            src1 = ((data1 & 0x800) != 0) ? HWRoad_roads + 256 * 2 * 512 : (HWRoad_roads + (0x100 + ((data1 >> 1) & 0xff)) * 512);
+            src1 = HWRoad_get_line(((data1 & 0x800) != 0) ? ROAD_DUMMY_LINE : (0x100 + ((data1 >> 1) & 0xff)), ROAD_LINE_BUF1);
 
         // Shift road dependent on whether we are in widescreen mode or not
         uint16_t s16_x = 0x5f8 + Config_s16_x_off;
@@ -660,3 +833,14 @@ void HWRoad_render_foreground_hires(uint16_t* pixels)
     } // end for
 }
 
+void HWRoad_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWRoad_banks);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWRoad_ram);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWRoad_ramBuff);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWRoad_road_control);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWRoad_color_offset1);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWRoad_color_offset2);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWRoad_color_offset3);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWRoad_x_offset);
+}
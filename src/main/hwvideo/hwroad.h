@@ -7,12 +7,18 @@
 #define HWRoad_rom_size 0x8000
 
 void HWRoad_init(const uint8_t*, const Boolean hires);
+void HWRoad_init_state();
 void HWRoad_write16(uint32_t adr, const uint16_t data);
 void HWRoad_write16IncP(uint32_t* adr, const uint16_t data);
 void HWRoad_write32(uint32_t* adr, const uint32_t data);
 uint16_t HWRoad_read_road_control();
 void HWRoad_write_road_control(const uint8_t);
+void HWRoad_publish();
+void HWRoad_snapshot();
+void HWRoad_interp_capture();
+void HWRoad_interp_begin(const uint16_t alpha);
 
 extern void (*HWRoad_render_background)(uint16_t*);
 extern void (*HWRoad_render_foreground)(uint16_t*);
+void HWRoad_register_state();
   
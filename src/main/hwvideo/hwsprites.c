@@ -1,7 +1,9 @@
+#include <string.h>
 #include "Video.h"
 #include "hwvideo/hwsprites.h"
 #include "globals.h"
 #include "frontend/config.h"
+#include "savestate.h"
 
 /***************************************************************************
     Video Emulation: OutRun Sprite Rendering Hardware.
@@ -49,23 +51,65 @@
  *******************************************************************************************/
 
 // Clip values.
-uint16_t HWSprites_x1, HWSprites_x2;
+ENGINE_LOCAL uint16_t HWSprites_x1, HWSprites_x2;
 
-// 128 sprites, 16 bytes each (0x400)
-#define SPRITE_RAM_SIZE (128 * 8)
+// Sprites are 16 bytes each. The list ends at the first entry with the end marker set.
+#define SPRITE_RAM_SIZE (HWSPRITES_ENTRIES_MAX * 8)
 #define SPRITES_LENGTH (0x100000 >> 2)
 #define COLOR_BASE 0x800
 
 uint32_t sprites[SPRITES_LENGTH]; // Converted sprites
     
 // Two halves of RAM
-uint16_t ram[SPRITE_RAM_SIZE];
-uint16_t ramBuff[SPRITE_RAM_SIZE];
+ENGINE_LOCAL uint16_t HWSprites_banks[2][SPRITE_RAM_SIZE];
+
+// Back buffer written by the engine, and front buffer published to the renderer.
+// Swapping exchanges the pointers, rather than the contents.
+// Set by HWSprites_init_state, as thread local addresses are not constant.
+ENGINE_LOCAL uint16_t* ram;
+ENGINE_LOCAL uint16_t* ramBuff;
+
+// Identity of the sprite held by each entry, so entries can be matched between
+// frames when interpolating. 0 is no identity. Swapped with the sprite RAM.
+ENGINE_LOCAL uint16_t HWSprites_tag_banks[2][HWSPRITES_ENTRIES_MAX];
+ENGINE_LOCAL uint16_t* tags;
+ENGINE_LOCAL uint16_t* tagsBuff;
+
+// Interpolation: position of each identity in the front buffer before the last engine step
+#define INTERP_MAX_DELTA 0x80 // Larger moves are a different sprite reusing the identity
+static Boolean  interp_valid[HWSPRITES_ENTRIES_MAX];
+static uint16_t interp_top[HWSPRITES_ENTRIES_MAX];
+static uint16_t interp_xpos[HWSPRITES_ENTRIES_MAX];
+
+// Front buffer published by the last swap. Unlike the banks these are shared
+// between threads, so a render thread can find the engine's front buffer.
+static const uint16_t* HWSprites_front;
+static const uint16_t* HWSprites_front_tags;
+
+// The renderer's own bank, copied from the front buffer by HWSprites_snapshot.
+// The renderer writes to it, and the engine is free to reuse the front buffer
+// as its back buffer while a frame is rendered.
+static uint16_t renderRam[SPRITE_RAM_SIZE];
+static uint16_t renderTags[HWSPRITES_ENTRIES_MAX];
+
+// Reset the sprite hardware owned by the calling thread
+void HWSprites_init_state()
+{
+    ram      = HWSprites_banks[0];
+    ramBuff  = HWSprites_banks[1];
+    tags     = HWSprites_tag_banks[0];
+    tagsBuff = HWSprites_tag_banks[1];
+    HWSprites_reset();
+
+    Video_lock_banks();
+    HWSprites_publish();
+    Video_unlock_banks();
+}
 
 void HWSprites_init(const uint8_t* src_sprites)
 {
     uint32_t i;
-    HWSprites_reset();
+    HWSprites_init_state();
 
     if (src_sprites)
     {
@@ -94,6 +138,13 @@ void HWSprites_reset()
         ram[i] = 0;
         ramBuff[i] = 0;
     }
+
+    for (i = 0; i < HWSPRITES_ENTRIES_MAX; i++)
+    {
+        tags[i] = 0;
+        tagsBuff[i] = 0;
+        interp_valid[i] = FALSE;
+    }
 }
 
 // Clip areas of the screen in wide-screen mode
@@ -134,19 +185,101 @@ void HWSprites_write(const uint16_t adr, const uint16_t data)
     ram[adr >> 1] = data;
 }
 
-// Copy back buffer to main ram, ready for blit
+// Set the identity of the sprite in a back buffer entry
+void HWSprites_write_tag(const uint16_t entry, const uint16_t tag)
+{
+    tags[entry & (HWSPRITES_ENTRIES_MAX - 1)] = tag;
+}
+
+// Publish back buffer to the renderer, ready for blit.
+// The previous front buffer becomes the new back buffer.
 void HWSprites_swap()
+{
+    uint16_t* temp;
+
+    Video_lock_banks();
+    temp     = ram;
+    ram      = ramBuff;
+    ramBuff  = temp;
+    temp     = tags;
+    tags     = tagsBuff;
+    tagsBuff = temp;
+    HWSprites_publish();
+    Video_unlock_banks();
+}
+
+// Give the renderer the address of the front buffer. Called with the banks locked.
+// Threads without a display don't publish, as nothing renders their banks.
+void HWSprites_publish()
+{
+    if (Video_headless)
+        return;
+
+    HWSprites_front      = ramBuff;
+    HWSprites_front_tags = tagsBuff;
+}
+
+// Copy the front buffer to render the next frame from, up to the end of the list.
+// Called with the banks locked.
+void HWSprites_snapshot()
 {
     uint16_t i;
-    uint16_t *src = (uint16_t *)ram;
-    uint16_t *dst = (uint16_t *)ramBuff;
 
-    // swap the halves of the road RAM
-    for (i = 0; i < SPRITE_RAM_SIZE; i++)
+    renderRam[0] = 0x8000;
+    if (HWSprites_front == NULL)
+        return;
+
+    for (i = 0; i < HWSPRITES_ENTRIES_MAX; i++)
     {
-        uint16_t temp = *src;
-        *src++ = *dst;
-        *dst++ = temp;
+        memcpy(&renderRam[i << 3], &HWSprites_front[i << 3], 8 * sizeof(uint16_t));
+        renderTags[i] = HWSprites_front_tags[i];
+        if ((renderRam[i << 3] & 0x8000) != 0) break;
+    }
+}
+
+// Record the position of each sprite in the front buffer. Called before each engine step.
+void HWSprites_interp_capture()
+{
+    uint16_t i;
+
+    for (i = 0; i < HWSPRITES_ENTRIES_MAX; i++)
+        interp_valid[i] = FALSE;
+
+    for (i = 0; i < HWSPRITES_ENTRIES_MAX; i++)
+    {
+        const uint16_t* entry = &ramBuff[i << 3];
+        const uint16_t tag = tagsBuff[i];
+
+        if ((entry[0] & 0x8000) != 0) break;
+        if (tag == 0 || tag >= HWSPRITES_ENTRIES_MAX || (entry[0] & 0x5000) != 0) continue;
+
+        interp_valid[tag] = TRUE;
+        interp_top[tag]   = entry[0] & 0x1ff;
+        interp_xpos[tag]  = entry[6];
+    }
+}
+
+// Move each sprite in the snapshot between its recorded position and its current position.
+// alpha: distance between the two, from 0 to VIDEO_INTERP_ONE.
+void HWSprites_interp_begin(const uint16_t alpha)
+{
+    uint16_t i;
+
+    for (i = 0; i < HWSPRITES_ENTRIES_MAX; i++)
+    {
+        uint16_t* entry = &renderRam[i << 3];
+        const uint16_t tag = renderTags[i];
+
+        if ((entry[0] & 0x8000) != 0) break;
+        if (tag == 0 || tag >= HWSPRITES_ENTRIES_MAX || !interp_valid[tag]) continue;
+
+        int32_t dy = (int32_t) (entry[0] & 0x1ff) - interp_top[tag];
+        int32_t dx = (int32_t) entry[6] - interp_xpos[tag];
+        if (dy < -INTERP_MAX_DELTA || dy > INTERP_MAX_DELTA || dx < -INTERP_MAX_DELTA || dx > INTERP_MAX_DELTA)
+            continue;
+
+        entry[0] = (entry[0] & ~0x1ff) | ((interp_top[tag] + ((dy * alpha) >> VIDEO_INTERP_SHIFT)) & 0x1ff);
+        entry[6] = interp_xpos[tag] + ((dx * alpha) >> VIDEO_INTERP_SHIFT);
     }
 }
 
@@ -174,28 +307,28 @@ void HWSprites_render(const uint8_t priority)
     for (data = 0; data < SPRITE_RAM_SIZE; data += 8) 
     {
         // stop when we hit the end of sprite list
-        if ((ramBuff[data+0] & 0x8000) != 0) break;
+        if ((renderRam[data+0] & 0x8000) != 0) break;
 
-        uint32_t sprpri  = 1 << ((ramBuff[data+3] >> 12) & 3);
+        uint32_t sprpri  = 1 << ((renderRam[data+3] >> 12) & 3);
         if (sprpri != priority) continue;
 
         // if hidden, or top greater than/equal to bottom, or invalid bank, punt
-        int16_t hide    = (ramBuff[data+0] & 0x5000);
-        int32_t height  = (ramBuff[data+5] >> 8) + 1;       
+        int16_t hide    = (renderRam[data+0] & 0x5000);
+        int32_t height  = (renderRam[data+5] >> 8) + 1;       
         if (hide != 0 || height == 0) continue;
         
-        int16_t bank    = (ramBuff[data+0] >> 9) & 7;
-        int32_t top     = (ramBuff[data+0] & 0x1ff) - 0x100;
-        uint32_t addr    = ramBuff[data+1];
-        int32_t pitch  = ((ramBuff[data+2] >> 1) | ((ramBuff[data+4] & 0x1000) << 3)) >> 8;
-        int32_t xpos    =  ramBuff[data+6]; // moved from original structure to accomodate widescreen
-        uint8_t shadow  = (ramBuff[data+3] >> 14) & 1;
-        int32_t vzoom    = ramBuff[data+3] & 0x7ff;
-        int32_t ydelta = ((ramBuff[data+4] & 0x8000) != 0) ? 1 : -1;
-        int32_t flip   = (~ramBuff[data+4] >> 14) & 1;
-        int32_t xdelta = ((ramBuff[data+4] & 0x2000) != 0) ? 1 : -1;
-        int32_t hzoom    = ramBuff[data+4] & 0x7ff;     
-        int32_t color   = COLOR_BASE + ((ramBuff[data+5] & 0x7f) << 4);
+        int16_t bank    = (renderRam[data+0] >> 9) & 7;
+        int32_t top     = (renderRam[data+0] & 0x1ff) - 0x100;
+        uint32_t addr    = renderRam[data+1];
+        int32_t pitch  = ((renderRam[data+2] >> 1) | ((renderRam[data+4] & 0x1000) << 3)) >> 8;
+        int32_t xpos    =  renderRam[data+6]; // moved from original structure to accomodate widescreen
+        uint8_t shadow  = (renderRam[data+3] >> 14) & 1;
+        int32_t vzoom    = renderRam[data+3] & 0x7ff;
+        int32_t ydelta = ((renderRam[data+4] & 0x8000) != 0) ? 1 : -1;
+        int32_t flip   = (~renderRam[data+4] >> 14) & 1;
+        int32_t xdelta = ((renderRam[data+4] & 0x2000) != 0) ? 1 : -1;
+        int32_t hzoom    = renderRam[data+4] & 0x7ff;     
+        int32_t color   = COLOR_BASE + ((renderRam[data+5] & 0x7f) << 4);
         int32_t x, y, ytarget, yacc = 0, pix;
             
         // adjust X coordinate
@@ -206,7 +339,7 @@ void HWSprites_render(const uint8_t priority)
         xpos -= 0xbe;
 
         // initialize the end address to the start address
-        ramBuff[data+7] = addr;
+        renderRam[data+7] = addr;
 
         // clamp to within the memory region size
         if (numbanks)
@@ -246,11 +379,11 @@ void HWSprites_render(const uint8_t priority)
                 if (flip == 0)
                 {
                     // start at the word before because we preincrement below
-                    ramBuff[data+7] = (addr - 1);
+                    renderRam[data+7] = (addr - 1);
 
                     for (x = xpos; (xdelta > 0 && x < Config_s16_width) || (xdelta < 0 && x >= 0); )
                     {
-                        uint32_t pixels = spritedata[++ramBuff[data+7]]; // Add to base sprite data the vzoom value
+                        uint32_t pixels = spritedata[++renderRam[data+7]]; // Add to base sprite data the vzoom value
 
                         // draw four pixels
                         pix = (pixels >> 28) & 0xf; while (xacc < 0x200) { HWSprites_draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
@@ -271,11 +404,11 @@ void HWSprites_render(const uint8_t priority)
                 else
                 {
                     // start at the word after because we predecrement below
-                    ramBuff[data+7] = (addr + 1);
+                    renderRam[data+7] = (addr + 1);
 
                     for (x = xpos; (xdelta > 0 && x < Config_s16_width) || (xdelta < 0 && x >= 0); )
                     {
-                        uint32_t pixels = spritedata[--ramBuff[data+7]];
+                        uint32_t pixels = spritedata[--renderRam[data+7]];
 
                         // draw four pixels
                         pix = (pixels >>  0) & 0xf; while (xacc < 0x200) { HWSprites_draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
@@ -300,3 +433,10 @@ void HWSprites_render(const uint8_t priority)
         }
     }
 }
+
+void HWSprites_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWSprites_banks);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, ram);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, ramBuff);
+}
@@ -2,12 +2,26 @@
 
 #include "stdint.h"
 
+// Sprites held by the original sprite RAM
+#define HWSPRITES_ENTRIES     128
+
+// Sprites held by the emulated sprite RAM. The extra entries are only used
+// when Config_engine.unlimited_sprites is set.
+#define HWSPRITES_ENTRIES_MAX 512
+
 void HWSprites_init(const uint8_t*);
+void HWSprites_init_state();
 void HWSprites_reset();
 void HWSprites_set_x_clip(Boolean);
 void HWSprites_swap();
+void HWSprites_publish();
+void HWSprites_snapshot();
 uint8_t HWSprites_read(const uint16_t adr);
 void HWSprites_write(const uint16_t adr, const uint16_t data);
+void HWSprites_write_tag(const uint16_t entry, const uint16_t tag);
+void HWSprites_interp_capture();
+void HWSprites_interp_begin(const uint16_t alpha);
 void HWSprites_render(const uint8_t);
+void HWSprites_register_state();
 
 
@@ -1,9 +1,13 @@
 #include "globals.h"
 #include "romloader.h"
+#include "arena.h"
+#include "Video.h"
 #include "hwvideo/hwtiles.h"
 #include "frontend/config.h"
 
+#include <stdlib.h>
 #include <string.h>
+#include "savestate.h"
 
 /***************************************************************************
     Video Emulation: OutRun Tilemap Hardware.
@@ -76,26 +80,40 @@
  *
  *******************************************************************************************/
 
-uint8_t HWTiles_text_ram[0x1000]; // Text RAM
-uint8_t HWTiles_tile_ram[0x10000]; // Tile RAM
+ENGINE_LOCAL uint8_t HWTiles_text_ram[0x1000]; // Text RAM
+ENGINE_LOCAL uint8_t HWTiles_tile_ram[0x10000]; // Tile RAM
 
-int16_t HWTiles_x_clamp;
+ENGINE_LOCAL int16_t HWTiles_x_clamp;
     
 // S16 Width, ignoring widescreen related scaling.
 uint16_t HWTiles_s16_width_noscale;
 
 #define TILES_LENGTH 0x10000
 uint32_t HWTiles_tiles[TILES_LENGTH];        // Converted tiles
-uint32_t HWTiles_tiles_backup[TILES_LENGTH]; // Converted tiles (backup without patch)
 
-uint16_t HWTiles_page[4];
-uint16_t HWTiles_scroll_x[4];
-uint16_t HWTiles_scroll_y[4];
+ENGINE_LOCAL uint16_t HWTiles_page[4];
+ENGINE_LOCAL uint16_t HWTiles_scroll_x[4];
+ENGINE_LOCAL uint16_t HWTiles_scroll_y[4];
 
-uint8_t HWTiles_tile_banks[2] = { 0, 1 };
+// Interpolation: scroll values before the last engine step
+#define TILES_INTERP_MAX_DELTA 0x40 // Larger moves are a change of tilemap rather than scrolling
+static uint16_t HWTiles_interp_x[4];
+static uint16_t HWTiles_interp_y[4];
+
+ENGINE_LOCAL uint8_t HWTiles_tile_banks[2] = { 0, 1 };
 
 static const uint16_t NUM_TILES = 0x2000; // Length of graphic rom / 24
 static const uint16_t TILEMAP_COLOUR_OFFSET = 0x1c00;
+
+// Tile patch overlay.
+// Patched tiles are stored separately, so the converted tiles never need to be backed up.
+// A non-zero slot redirects a tile to (slot - 1) in the overlay.
+uint16_t HWTiles_patch_slot[0x2000];
+uint32_t* HWTiles_patch_data = NULL;  // Overlay tile data (8 longs per tile)
+uint16_t* HWTiles_patch_list = NULL;  // Tile indexes that have been patched
+uint16_t HWTiles_patch_count = 0;
+
+uint32_t* HWTiles_get_tile(uint16_t);
     
 void (*HWTiles_render8x8_tile_mask)(
     uint16_t *buf,
@@ -196,7 +214,7 @@ void HWTiles_init(uint8_t* src_tiles, const Boolean hires)
             }
             HWTiles_tiles[i] = val; // Store converted value
         }
-        memcpy(HWTiles_tiles_backup, HWTiles_tiles, TILES_LENGTH * sizeof(uint32_t));
+        HWTiles_restore_tiles();
     }
     
     if (hires)
@@ -213,29 +231,78 @@ void HWTiles_init(uint8_t* src_tiles, const Boolean hires)
     }
 }
 
+// Patch tiles with replacement graphics (e.g. Widescreen Music Select Tilemap)
+//
+// Patch Format: [word] tile index, followed by 8 longs of converted tile data.
 void HWTiles_patch_tiles(RomLoader* patch)
 {
-    memcpy(HWTiles_tiles_backup, HWTiles_tiles, TILES_LENGTH * sizeof(uint32_t));
-
     uint32_t i;
+    const uint32_t ENTRY_LENGTH = sizeof(uint16_t) + (8 * sizeof(uint32_t));
+    const uint16_t max_tiles = patch->length / ENTRY_LENGTH;
+
+    HWTiles_restore_tiles();
 
-    for (i = 0; i < patch->length;)
+    HWTiles_patch_data = (uint32_t*) Arena_alloc(ARENA_VIDEO, max_tiles * 8 * sizeof(uint32_t));
+    HWTiles_patch_list = (uint16_t*) Arena_alloc(ARENA_VIDEO, max_tiles * sizeof(uint16_t));
+
+    for (i = 0; i + ENTRY_LENGTH <= patch->length;)
     {
-        uint32_t tile_index =         RomLoader_read16IncP(patch, &i) << 3;
-        HWTiles_tiles[tile_index++] = RomLoader_read32IncP(patch, &i);
-        HWTiles_tiles[tile_index++] = RomLoader_read32IncP(patch, &i);
-        HWTiles_tiles[tile_index++] = RomLoader_read32IncP(patch, &i);
-        HWTiles_tiles[tile_index++] = RomLoader_read32IncP(patch, &i);
-        HWTiles_tiles[tile_index++] = RomLoader_read32IncP(patch, &i);
-        HWTiles_tiles[tile_index++] = RomLoader_read32IncP(patch, &i);
-        HWTiles_tiles[tile_index++] = RomLoader_read32IncP(patch, &i);
-        HWTiles_tiles[tile_index++] = RomLoader_read32IncP(patch, &i);
+        uint16_t tile = RomLoader_read16IncP(patch, &i);
+        uint16_t slot;
+        uint32_t* dst;
+        int y;
+
+        if (tile >= NUM_TILES)
+        {
+            i += 8 * sizeof(uint32_t);
+            continue;
+        }
+
+        // Tiles patched more than once reuse their slot
+        if (HWTiles_patch_slot[tile])
+        {
+            slot = HWTiles_patch_slot[tile] - 1;
+        }
+        else
+        {
+            slot = HWTiles_patch_count++;
+            HWTiles_patch_list[slot] = tile;
+            HWTiles_patch_slot[tile] = slot + 1;
+        }
+
+        dst = HWTiles_patch_data + (slot << 3);
+        for (y = 0; y < 8; y++)
+            dst[y] = RomLoader_read32IncP(patch, &i);
     }
 }
 
+// Remove patched tiles. Only the patched entries need to be touched.
 void HWTiles_restore_tiles()
 {
-    memcpy(HWTiles_tiles, HWTiles_tiles_backup, TILES_LENGTH * sizeof(uint32_t));
+    uint16_t i;
+    for (i = 0; i < HWTiles_patch_count; i++)
+        HWTiles_patch_slot[HWTiles_patch_list[i]] = 0;
+
+    HWTiles_patch_count = 0;
+
+    if (HWTiles_patch_data)
+    {
+        Arena_free(HWTiles_patch_data);
+        HWTiles_patch_data = NULL;
+    }
+
+    if (HWTiles_patch_list)
+    {
+        Arena_free(HWTiles_patch_list);
+        HWTiles_patch_list = NULL;
+    }
+}
+
+// Return converted tile data, taking patched tiles into account
+uint32_t* HWTiles_get_tile(uint16_t nTileNumber)
+{
+    const uint16_t slot = HWTiles_patch_slot[nTileNumber];
+    return slot ? HWTiles_patch_data + ((slot - 1) << 3) : HWTiles_tiles + (nTileNumber << 3);
 }
 
 // Set Tilemap X Clamp
@@ -274,6 +341,44 @@ void HWTiles_update_tile_values()
     }
 }
 
+// Record the scroll values. Called before each engine step.
+void HWTiles_interp_capture()
+{
+    int i;
+    for (i = 0; i < 4; i++)
+    {
+        HWTiles_interp_x[i] = ((HWTiles_text_ram[0xe98 + (i * 2) + 0] << 8) | HWTiles_text_ram[0xe98 + (i * 2) + 1]);
+        HWTiles_interp_y[i] = ((HWTiles_text_ram[0xe90 + (i * 2) + 0] << 8) | HWTiles_text_ram[0xe90 + (i * 2) + 1]);
+    }
+}
+
+// Move a scroll value between its recorded value and its current value.
+// Values that wrap at mask, or that select per row or column scrolling, are left as they are.
+static uint16_t HWTiles_interp_scroll(uint16_t cur, uint16_t prev, uint16_t mask, uint16_t alpha)
+{
+    if (((cur | prev) & 0x8000) != 0)
+        return cur;
+
+    const int32_t half = (mask + 1) >> 1;
+    int32_t delta = ((cur - prev + half) & mask) - half;
+    if (delta < -TILES_INTERP_MAX_DELTA || delta > TILES_INTERP_MAX_DELTA)
+        return cur;
+
+    return (cur & ~mask) | ((prev + ((delta * alpha) >> VIDEO_INTERP_SHIFT)) & mask);
+}
+
+// Interpolate the scroll values read by HWTiles_update_tile_values
+// alpha: distance between the recorded and current values, from 0 to VIDEO_INTERP_ONE.
+void HWTiles_interp_apply(const uint16_t alpha)
+{
+    int i;
+    for (i = 0; i < 4; i++)
+    {
+        HWTiles_scroll_x[i] = HWTiles_interp_scroll(HWTiles_scroll_x[i], HWTiles_interp_x[i], 0x3ff, alpha);
+        HWTiles_scroll_y[i] = HWTiles_interp_scroll(HWTiles_scroll_y[i], HWTiles_interp_y[i], 0x1ff, alpha);
+    }
+}
+
 // A quick and dirty debug function to display the contents of tile memory.
 void HWTiles_render_all_tiles(uint16_t* buf)
 {
@@ -416,7 +521,7 @@ void HWTiles_render8x8_tile_mask_lores(
 {
     int y;
     uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
-    uint32_t* pTileData = HWTiles_tiles + (nTileNumber << 3);
+    uint32_t* pTileData = HWTiles_get_tile(nTileNumber);
     buf += (StartY * Config_s16_width) + StartX;
 
     for (y = 0; y < 8; y++) 
@@ -460,7 +565,7 @@ void HWTiles_render8x8_tile_mask_clip_lores(
 {
     int y;
     uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
-    uint32_t* pTileData = HWTiles_tiles + (nTileNumber << 3);
+    uint32_t* pTileData = HWTiles_get_tile(nTileNumber);
     buf += (StartY * Config_s16_width) + StartX;
 
     for (y = 0; y < 8; y++) 
@@ -512,7 +617,7 @@ void HWTiles_render8x8_tile_mask_hires(
 {
     int y;
     uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
-    uint32_t* pTileData = HWTiles_tiles + (nTileNumber << 3);
+    uint32_t* pTileData = HWTiles_get_tile(nTileNumber);
     buf += ((StartY << 1) * Config_s16_width) + (StartX << 1);
     
     for (y = 0; y < 8; y++) 
@@ -556,7 +661,7 @@ void HWTiles_render8x8_tile_mask_clip_hires(
 {
     int y;
     uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
-    uint32_t* pTileData = HWTiles_tiles + (nTileNumber << 3);
+    uint32_t* pTileData = HWTiles_get_tile(nTileNumber);
     buf += ((StartY << 1) * Config_s16_width) + (StartX << 1);
 
     for (y = 0; y < 8; y++) 
@@ -596,3 +701,14 @@ void HWTiles_set_pixel_x4(uint16_t *buf, uint32_t data)
 {
     buf[0] = buf[1] = buf[0  + Config_s16_width] = buf[1 + Config_s16_width] = data;
 }
+
+// Decoded tiles and tile patches are derived from ROM and are not included.
+void HWTiles_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWTiles_text_ram);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWTiles_tile_ram);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWTiles_page);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWTiles_scroll_x);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWTiles_scroll_y);
+    SAVESTATE_ADD(SAVESTATE_VIDEO, HWTiles_tile_banks);
+}
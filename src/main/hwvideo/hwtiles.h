@@ -10,8 +10,8 @@ enum
     HWTILES_CENTRE,
 };
 
-extern uint8_t HWTiles_text_ram[0x1000]; // Text RAM
-extern uint8_t HWTiles_tile_ram[0x10000]; // Tile RAM
+extern ENGINE_LOCAL uint8_t HWTiles_text_ram[0x1000]; // Text RAM
+extern ENGINE_LOCAL uint8_t HWTiles_tile_ram[0x10000]; // Tile RAM
 
 void HWTiles_Create(void);
 void HWTiles_Destroy(void);
@@ -21,6 +21,9 @@ void HWTiles_patch_tiles(RomLoader* patch);
 void HWTiles_restore_tiles();
 void HWTiles_set_x_clamp(const uint16_t);
 void HWTiles_update_tile_values();
+void HWTiles_interp_capture();
+void HWTiles_interp_apply(const uint16_t alpha);
 void HWTiles_render_tile_layer(uint16_t*, uint8_t, uint8_t);
 void HWTiles_render_text_layer(uint16_t*, uint8_t);
 void HWTiles_render_all_tiles(uint16_t*);
+void HWTiles_register_state();
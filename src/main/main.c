@@ -14,8 +14,15 @@
 // SDL Specific Code
 #include "sdl/timer.h"
 #include "sdl/input.h"
+#include "sdl/pacer.h"
 #include "Video.h"
 
+#include "arena.h"
+#include "audiobench.h"
+#include "savestate.h"
+#include "rewind.h"
+#include "turbo.h"
+#include "batch.h"
 #include "romloader.h"
 #include "trackloader.h"
 #include "stdint.h"
@@ -29,12 +36,14 @@
 #include "engine/oinputs.h"
 #include "engine/ooutputs.h"
 #include "engine/omusic.h"
+#include "engine/oroadcache.h"
+#include "engine/otiles.h"
 
 // Initialize Shared Variables
 int    cannonball_state       = STATE_BOOT;
 double cannonball_frame_ms    = 0;
-int    cannonball_frame       = 0;
-Boolean   cannonball_tick_frame  = TRUE;
+ENGINE_LOCAL int    cannonball_frame       = 0;
+ENGINE_LOCAL Boolean   cannonball_tick_frame  = TRUE;
 int    cannonball_fps_counter = 0;
 
 
@@ -49,10 +58,17 @@ static void quit_func(int code)
 {
 #ifdef COMPILE_SOUND_CODE
     Audio_stop_audio();
+    AudioStats_dump(stderr);
 #endif
     I_CAMD_StopSong();
     I_CAMD_ShutdownMusic();
     Input_close();
+    Rewind_report();
+    ORoadCache_report();
+    OTiles_report();
+    YM_report();
+    Pacer_report();
+    Arena_report();
     //SDL_Quit();
     exit(code);
 }
@@ -105,7 +121,8 @@ static void process_events(void)
 // Pause Engine
 Boolean pause_engine;
 
-static void tick()
+// Run the engine for one frame at Config_fps
+static void tick_engine()
 {
     cannonball_frame++;
 
@@ -139,7 +156,18 @@ static void tick()
             if (Input_has_pressed(INPUT_MENU))
                 cannonball_state = STATE_INIT_MENU;
 
-            if (!pause_engine || Input_has_pressed(INPUT_STEP))
+            // Step backwards through recorded frames while rewind is held
+            if (Rewind_enabled && Input_is_pressed(INPUT_REWIND))
+            {
+                Rewind_step_back();
+                Input_frame_done(); // Denote keys read
+
+                #ifdef COMPILE_SOUND_CODE
+                // Tick SDL Audio
+                Audio_tick();
+                #endif
+            }
+            else if (!pause_engine || Input_has_pressed(INPUT_STEP))
             {
                 Outrun_tick(packet, cannonball_tick_frame);
                 Input_frame_done(); // Denote keys read
@@ -150,6 +178,8 @@ static void tick()
                 // Tick SDL Audio
                 Audio_tick();
                 #endif
+
+                Rewind_capture();
             }
             else
             {                
@@ -167,6 +197,7 @@ static void tick()
             {
                 pause_engine = FALSE;
                 Outrun_init();
+                Rewind_reset();
                 cannonball_state = STATE_GAME;
             }
             break;
@@ -191,6 +222,11 @@ static void tick()
             cannonball_state = STATE_MENU;
             break;
     }
+}
+
+static void tick()
+{
+    tick_engine();
 
     // Draw SDL Video
     Video_draw_frame();  
@@ -215,23 +251,104 @@ static void main_loop()
     {
         Timer_start(&frame_time);
         tick();
+
+        if (Config_video.pacer)
+        {
+            #ifdef COMPILE_SOUND_CODE
+            Pacer_wait(cannonball_frame_ms * 1000.0 * Audio_adjust_speed());
+            #else
+            Pacer_wait(cannonball_frame_ms * 1000.0);
+            #endif
+        }
+        else
+        {
+            #ifdef COMPILE_SOUND_CODE
+            deltatime += (cannonball_frame_ms * Audio_adjust_speed());
+            #else
+            deltatime += cannonball_frame_ms;
+            #endif
+            deltaintegral  = (int) deltatime;
+            t = Timer_get_ticks(&frame_time);
+
+            // Cap Frame Rate: Sleep Remaining Frame Time
+            if (t < deltatime)
+            {
+                sleep((Uint32) (deltatime - t));
+            }
+
+            deltatime -= deltaintegral;
+        }
+
+        if (Config_video.fps_count)
+        {
+            frame++;
+            // One second has elapsed
+            if (Timer_get_ticks(&fps_count) >= 1000)
+            {
+                cannonball_fps_counter = frame;
+                frame       = 0;
+                Timer_start(&fps_count);
+            }
+        }
+    }
+
+    quit_func(0);
+}
+
+// Engine steps run to catch up after a stall, before time is dropped
+#define FIXED_MAX_STEPS 8
+
+// Run the engine at a fixed step of Config_fps, and draw frames at the display
+// refresh rate. Each frame is interpolated between the last two engine steps.
+static void main_loop_fixed()
+{
+    // FPS Counter (If Enabled)
+    Timer fps_count;
+    int frame = 0;
+    Timer_init(&fps_count);
+    Timer_start(&fps_count);
+
+    double accumulator = 0;
+    uint32_t last = getMicroseconds();
+
+    while (cannonball_state != STATE_QUIT)
+    {
+        uint32_t frame_start = getMicroseconds();
+        double frame_us = 1000000.0 / Config_video.refresh;
+
         #ifdef COMPILE_SOUND_CODE
-        deltatime += (cannonball_frame_ms * Audio_adjust_speed());
+        double step_us = cannonball_frame_ms * 1000.0 * Audio_adjust_speed();
         #else
-        deltatime += cannonball_frame_ms;
+        double step_us = cannonball_frame_ms * 1000.0;
         #endif
-        deltaintegral  = (int) deltatime;
-        t = Timer_get_ticks(&frame_time);
 
-        // Cap Frame Rate: Sleep Remaining Frame Time
-       
-       // Cap Frame Rate: Sleep Remaining Frame Time
-        if (t < deltatime)
+        accumulator += (double) (frame_start - last);
+        last = frame_start;
+        if (accumulator > step_us * FIXED_MAX_STEPS)
+            accumulator = step_us * FIXED_MAX_STEPS;
+
+        while (accumulator >= step_us && cannonball_state != STATE_QUIT)
         {
-            sleep((Uint32) (deltatime - t));
+            Video_interp_capture();
+            tick_engine();
+            accumulator -= step_us;
+        }
+
+        Video_interp_alpha = (uint16_t) ((accumulator * VIDEO_INTERP_ONE) / step_us);
+        Video_draw_frame();
+
+        // Cap Frame Rate: Wait for the next refresh deadline, or sleep the remaining frame time.
+        // The pacer runs at the display rate here, as engine steps are driven by the accumulator.
+        if (Config_video.pacer)
+        {
+            Pacer_wait(frame_us);
+        }
+        else
+        {
+            uint32_t t = getMicroseconds() - frame_start;
+            if (t + 1000 < frame_us)
+                sleep((Uint32) ((frame_us - t) / 1000.0));
         }
-        
-        deltatime -= deltaintegral;
 
         if (Config_video.fps_count)
         {
@@ -259,13 +376,49 @@ int main(int argc, char* argv[])
     //}
 
     initTimer();
+
+    // Reserve memory regions before anything is loaded
+    Arena_init();
+
+    SaveState_init();
+
+    // Time save state snapshot and restore: -savebench [iterations]
+    if (argc >= 2 && strcmp(argv[1], "-savebench") == 0)
+    {
+        SaveState_benchmark(argc >= 3 ? atoi(argv[2]) : 1000);
+        return 0;
+    }
     
     TrackLoader_Create();
 
 
+    // Offline audio render: -audiobench <output.wav> [seconds] [script]
+    const char* audiobench_wav = NULL;
+
+    // Headless simulation at maximum speed: -turbo <frames> [render every N frames] [audio]
+    uint32_t turbo_frames = 0;
+
+    // Headless instances in parallel: -batch <instances> <frames> [threads] [seed]
+    uint32_t batch_instances = 0;
+
     // Load LayOut File
     Boolean loaded = FALSE;
-    if (argc == 3 && strcmp(argv[1], "-file") == 0)
+    if (argc >= 3 && strcmp(argv[1], "-audiobench") == 0)
+    {
+        audiobench_wav = argv[2];
+        loaded = Roms_load_revb_roms();
+    }
+    else if (argc >= 3 && strcmp(argv[1], "-turbo") == 0)
+    {
+        turbo_frames = atoi(argv[2]);
+        loaded = Roms_load_revb_roms();
+    }
+    else if (argc >= 4 && strcmp(argv[1], "-batch") == 0)
+    {
+        batch_instances = atoi(argv[2]);
+        loaded = Roms_load_revb_roms();
+    }
+    else if (argc == 3 && strcmp(argv[1], "-file") == 0)
     {
         if (TrackLoader_set_layout_track(argv[2]))
         {
@@ -285,6 +438,17 @@ int main(int argc, char* argv[])
     {
         // Load XML Config
         Config_load(FILENAME_CONFIG);
+
+        // Render audio headless, then exit
+        if (audiobench_wav)
+        {
+            if (Config_sound.fix_samples)
+                Roms_load_pcm_rom(TRUE);
+
+            Boolean ok = AudioBench_run(audiobench_wav, argc >= 4 ? atoi(argv[3]) : 60, argc >= 5 ? argv[4] : NULL);
+            Arena_report();
+            return ok ? 0 : 1;
+        }
          
         I_CAMD_InitMusic();
  
@@ -305,18 +469,42 @@ int main(int argc, char* argv[])
         if (!Video_init(&Config_video))
             quit_func(1);
 
+        // Initalize controls
+        Input_init(Config_controls.pad_id,
+                   Config_controls.keyconfig, Config_controls.padconfig, 
+                   Config_controls.analog,    Config_controls.axis, Config_controls.asettings);
+
+        // Run the simulation without an audio device, then exit
+        if (turbo_frames)
+        {
+            Boolean ok = Turbo_run(turbo_frames, argc >= 4 ? atoi(argv[3]) : 0, argc >= 5 && atoi(argv[4]) != 0);
+            Arena_report();
+            return ok ? 0 : 1;
+        }
+
+        if (batch_instances)
+        {
+            Boolean ok = Batch_run(batch_instances, atoi(argv[3]), argc >= 5 ? atoi(argv[4]) : 0, argc >= 6 ? atoi(argv[5]) : 1);
+            Arena_report();
+            return ok ? 0 : 1;
+        }
+
 #ifdef COMPILE_SOUND_CODE
         Audio_init();
 #endif
+        Rewind_init(Config_engine.rewind);
+
         cannonball_state = Config_menu.enabled ? STATE_INIT_MENU : STATE_INIT_GAME;
 
-        // Initalize controls
-        Input_init(Config_controls.pad_id,
-                   Config_controls.keyconfig, Config_controls.padconfig, 
-                   Config_controls.analog,    Config_controls.axis, Config_controls.asettings);
 
+        Pacer_init(Config_video.pacer);
+        Pacer_start();
 
-        main_loop();  // Loop until we quit the app
+        // Loop until we quit the app
+        if (Config_video.refresh)
+            main_loop_fixed();
+        else
+            main_loop();
     }
     else
     {
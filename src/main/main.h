@@ -9,10 +9,10 @@
 
 
 // Frame counter
-extern int cannonball_frame;
+extern ENGINE_LOCAL int cannonball_frame;
 
 // Tick Logic. Used when running at non-standard > 30 fps
-extern Boolean cannonball_tick_frame;
+extern ENGINE_LOCAL Boolean cannonball_tick_frame;
 
 // Millisecond Time Per Frame
 extern double cannonball_frame_ms;
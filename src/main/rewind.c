@@ -0,0 +1,348 @@
+/***************************************************************************
+    Rewind.
+
+    Keeps the last few seconds of gameplay as a ring of save states, so
+    the game can be stepped backwards a frame at a time.
+
+    Every REWIND_KEYFRAME frames a keyframe is stored. Other frames are
+    stored as the XOR against the previous keyframe, which is mostly
+    zero, run length encoded. Frames are evicted oldest first, a
+    keyframe and its deltas at a time, when the ring runs out of frames
+    or memory.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "globals.h"
+#include "arena.h"
+#include "savestate.h"
+#include "rewind.h"
+#include "sdl/timer.h"
+#include "frontend/config.h"
+
+// Encoded frames are a series of runs, in 32-bit words:
+//   [header] zero words in bits 0-15, literal words in bits 16-31
+//   [literal words] XOR of the state against the keyframe
+// A keyframe is encoded against zero. A run covers at least as many words
+// as it stores unless it is the first, the last or hits REWIND_RUN_MAX,
+// so the encoded size is bounded by:
+#define REWIND_BOUND(words) (((words) + 2 * (((words) >> 16) + 2)) * 4)
+#define REWIND_RUN_MAX 0xFFFF
+
+#define REWIND_NONE 0xFFFFFFFF
+
+typedef struct
+{
+    uint32_t offset;        // Offset of the encoded frame in the pool
+    uint32_t size;          // Encoded size in bytes
+    Boolean keyframe;
+} rewind_frame_t;
+
+Boolean Rewind_enabled = FALSE;
+
+static uint32_t* Rewind_state;      // Current snapshot
+static uint32_t* Rewind_key;        // Keyframe that deltas are taken against
+static uint32_t Rewind_words;       // Snapshot size in words
+static uint32_t Rewind_key_slot;    // Frame slot Rewind_key was decoded from
+
+static uint8_t* Rewind_pool;        // Encoded frames, used as a ring
+static uint32_t Rewind_pool_size;
+static uint32_t Rewind_head;        // Offset the next frame is written at
+
+static rewind_frame_t* Rewind_frames;
+static uint32_t Rewind_capacity;    // Allocated frame slots
+static uint32_t Rewind_limit;       // Frames held at the current frame rate
+static uint32_t Rewind_first;       // Slot of the oldest frame
+static uint32_t Rewind_count;
+static uint32_t Rewind_group;       // Frames in the newest keyframe group
+
+// Statistics
+static uint32_t Rewind_seconds;
+static uint32_t Rewind_keys, Rewind_deltas;
+static uint64_t Rewind_key_bytes, Rewind_delta_bytes;
+static uint64_t Rewind_capture_us;
+static uint32_t Rewind_capture_max;
+
+uint32_t Rewind_encode(uint32_t* dst, const uint32_t* state, const uint32_t* key);
+void Rewind_decode(const uint32_t* src, uint32_t* dst);
+uint32_t Rewind_alloc(uint32_t size);
+void Rewind_evict_group();
+void Rewind_drop_newest();
+uint32_t Rewind_slot(uint32_t index);
+
+void Rewind_init(uint32_t seconds)
+{
+    if (seconds == 0 || Rewind_enabled)
+        return;
+
+    if (seconds > REWIND_MAX_SECONDS)
+        seconds = REWIND_MAX_SECONDS;
+
+    SaveState_init();
+
+    Rewind_seconds  = seconds;
+    Rewind_words    = (SaveState_size() + 3) >> 2;
+    Rewind_capacity = (seconds * 60) + REWIND_KEYFRAME;
+
+    uint32_t state_bytes = Rewind_words * sizeof(uint32_t);
+    uint32_t frame_bytes = Rewind_capacity * sizeof(rewind_frame_t);
+    uint32_t overhead    = (2 * state_bytes) + frame_bytes + 256; // Includes arena block headers
+
+    if (ARENA_REWIND_SIZE < overhead + (2 * REWIND_BOUND(Rewind_words)))
+    {
+        fprintf(stderr, "Rewind: %u bytes of memory is not enough to hold a save state. Rewind disabled.\n", ARENA_REWIND_SIZE);
+        return;
+    }
+
+    // The region is only reserved once rewind is known to be enabled
+    if (!Arena_reserve(ARENA_REWIND, ARENA_REWIND_SIZE))
+    {
+        fprintf(stderr, "Rewind: Unable to reserve memory. Rewind disabled.\n");
+        return;
+    }
+
+    Rewind_state     = (uint32_t*) Arena_calloc(ARENA_REWIND, Rewind_words, sizeof(uint32_t));
+    Rewind_key       = (uint32_t*) Arena_calloc(ARENA_REWIND, Rewind_words, sizeof(uint32_t));
+    Rewind_frames    = (rewind_frame_t*) Arena_alloc(ARENA_REWIND, frame_bytes);
+    Rewind_pool_size = (ARENA_REWIND_SIZE - overhead) & ~3;
+    Rewind_pool      = (uint8_t*) Arena_alloc(ARENA_REWIND, Rewind_pool_size);
+
+    Rewind_enabled = TRUE;
+    Rewind_reset();
+}
+
+// Forget all frames. Called when a new game starts.
+void Rewind_reset()
+{
+    if (!Rewind_enabled)
+        return;
+
+    Rewind_limit = (Rewind_seconds * Config_fps) + REWIND_KEYFRAME;
+    if (Rewind_limit > Rewind_capacity)
+        Rewind_limit = Rewind_capacity;
+
+    Rewind_first    = 0;
+    Rewind_count    = 0;
+    Rewind_group    = 0;
+    Rewind_head     = 0;
+    Rewind_key_slot = REWIND_NONE;
+}
+
+uint32_t Rewind_slot(uint32_t index)
+{
+    return (Rewind_first + index) % Rewind_capacity;
+}
+
+// Capture the state at the end of this frame
+void Rewind_capture()
+{
+    if (!Rewind_enabled)
+        return;
+
+    uint32_t start = getMicroseconds();
+
+    SaveState_save((uint8_t*) Rewind_state, Rewind_words * sizeof(uint32_t));
+
+    if (Rewind_count >= Rewind_limit)
+        Rewind_evict_group();
+
+    uint32_t offset = Rewind_alloc(REWIND_BOUND(Rewind_words));
+
+    // Start a new group when the last is full, or was evicted to make room
+    Boolean keyframe = Rewind_count == 0 || Rewind_group >= REWIND_KEYFRAME;
+    if (keyframe)
+        memset(Rewind_key, 0, Rewind_words * sizeof(uint32_t));
+
+    uint32_t size = Rewind_encode((uint32_t*) (Rewind_pool + offset), Rewind_state, Rewind_key);
+    uint32_t slot = Rewind_slot(Rewind_count++);
+
+    Rewind_frames[slot].offset   = offset;
+    Rewind_frames[slot].size     = size;
+    Rewind_frames[slot].keyframe = keyframe;
+    Rewind_head = offset + size;
+
+    if (keyframe)
+    {
+        memcpy(Rewind_key, Rewind_state, Rewind_words * sizeof(uint32_t));
+        Rewind_key_slot = slot;
+        Rewind_group    = 1;
+        Rewind_keys++;
+        Rewind_key_bytes += size;
+    }
+    else
+    {
+        Rewind_group++;
+        Rewind_deltas++;
+        Rewind_delta_bytes += size;
+    }
+
+    uint32_t elapsed = getMicroseconds() - start;
+    Rewind_capture_us += elapsed;
+    if (elapsed > Rewind_capture_max)
+        Rewind_capture_max = elapsed;
+}
+
+// Restore the frame before the newest, discarding the newest.
+// Returns FALSE when there is nothing older to go back to.
+Boolean Rewind_step_back()
+{
+    if (!Rewind_enabled || Rewind_count < 2)
+        return FALSE;
+
+    Rewind_drop_newest();
+
+    // Find the keyframe of the frame being restored
+    uint32_t index = Rewind_count - 1;
+    uint32_t key   = index;
+    while (!Rewind_frames[Rewind_slot(key)].keyframe)
+        key--;
+
+    uint32_t key_slot = Rewind_slot(key);
+    if (Rewind_key_slot != key_slot)
+    {
+        memset(Rewind_key, 0, Rewind_words * sizeof(uint32_t));
+        Rewind_decode((uint32_t*) (Rewind_pool + Rewind_frames[key_slot].offset), Rewind_key);
+        Rewind_key_slot = key_slot;
+    }
+
+    memcpy(Rewind_state, Rewind_key, Rewind_words * sizeof(uint32_t));
+    if (index != key)
+        Rewind_decode((uint32_t*) (Rewind_pool + Rewind_frames[Rewind_slot(index)].offset), Rewind_state);
+
+    // Recording continues from here
+    Rewind_group = index - key + 1;
+
+    return SaveState_load((const uint8_t*) Rewind_state, Rewind_words * sizeof(uint32_t));
+}
+
+uint32_t Rewind_encode(uint32_t* dst, const uint32_t* state, const uint32_t* key)
+{
+    uint32_t* out = dst;
+    uint32_t i = 0;
+    const uint32_t words = Rewind_words;
+
+    while (i < words)
+    {
+        uint32_t zeros = 0, literals = 0;
+
+        while (i < words && zeros < REWIND_RUN_MAX && state[i] == key[i])
+        {
+            zeros++;
+            i++;
+        }
+
+        uint32_t* header = out++;
+
+        while (i < words && literals < REWIND_RUN_MAX && state[i] != key[i])
+        {
+            *out++ = state[i] ^ key[i];
+            literals++;
+            i++;
+        }
+
+        *header = zeros | (literals << 16);
+    }
+
+    return (uint32_t) (out - dst) * sizeof(uint32_t);
+}
+
+// XOR an encoded frame into dst
+void Rewind_decode(const uint32_t* src, uint32_t* dst)
+{
+    uint32_t i = 0;
+
+    while (i < Rewind_words)
+    {
+        uint32_t header   = *src++;
+        uint32_t literals = header >> 16;
+
+        i += header & 0xFFFF;
+
+        while (literals--)
+            dst[i++] ^= *src++;
+    }
+}
+
+// Find room for a frame of up to size bytes after the newest, evicting the oldest frames as required.
+// Frames are never split, so when the end of the pool is reached writing wraps to the start.
+uint32_t Rewind_alloc(uint32_t size)
+{
+    for (;;)
+    {
+        if (Rewind_count == 0)
+        {
+            Rewind_head = 0;
+            return 0;
+        }
+
+        uint32_t tail = Rewind_frames[Rewind_first].offset;
+
+        // Frames lie between tail and head
+        if (Rewind_head > tail)
+        {
+            if (Rewind_pool_size - Rewind_head >= size)
+                return Rewind_head;
+
+            if (tail >= size)
+                return 0;
+        }
+        // Frames have wrapped. Free space lies between head and tail.
+        else if (tail - Rewind_head >= size)
+        {
+            return Rewind_head;
+        }
+
+        Rewind_evict_group();
+    }
+}
+
+// Evict the oldest keyframe and the deltas that depend on it
+void Rewind_evict_group()
+{
+    do
+    {
+        if (Rewind_first == Rewind_key_slot)
+            Rewind_key_slot = REWIND_NONE;
+
+        Rewind_first = (Rewind_first + 1) % Rewind_capacity;
+        Rewind_count--;
+    }
+    while (Rewind_count > 0 && !Rewind_frames[Rewind_first].keyframe);
+
+    if (Rewind_count == 0)
+        Rewind_group = 0;
+}
+
+void Rewind_drop_newest()
+{
+    uint32_t slot = Rewind_slot(--Rewind_count);
+
+    if (slot == Rewind_key_slot)
+        Rewind_key_slot = REWIND_NONE;
+
+    Rewind_head = Rewind_frames[slot].offset;
+}
+
+// Print memory use and capture cost. Called at exit.
+void Rewind_report()
+{
+    uint32_t frames = Rewind_keys + Rewind_deltas;
+
+    if (!Rewind_enabled || frames == 0)
+        return;
+
+    uint64_t bytes     = Rewind_key_bytes + Rewind_delta_bytes;
+    uint32_t per_frame = (uint32_t) (bytes / frames);
+
+    fprintf(stderr, "Rewind Report:\n");
+    fprintf(stderr, "Holding %u frames in a %u byte pool. Save state %u bytes.\n",
+            Rewind_count, Rewind_pool_size, Rewind_words * (uint32_t) sizeof(uint32_t));
+    fprintf(stderr, "Keyframe avg %u bytes, delta avg %u bytes, %u bytes per second.\n",
+            Rewind_keys   ? (uint32_t) (Rewind_key_bytes / Rewind_keys) : 0,
+            Rewind_deltas ? (uint32_t) (Rewind_delta_bytes / Rewind_deltas) : 0,
+            per_frame * Config_fps);
+    fprintf(stderr, "Capture avg %uus, max %uus.\n", (uint32_t) (Rewind_capture_us / frames), Rewind_capture_max);
+}
@@ -0,0 +1,33 @@
+/***************************************************************************
+    Rewind.
+
+    Keeps the last few seconds of gameplay as a ring of save states, so
+    the game can be stepped backwards a frame at a time.
+
+    Every REWIND_KEYFRAME frames a keyframe is stored. Other frames are
+    stored as the XOR against the previous keyframe, which is mostly
+    zero, run length encoded. Frames are evicted oldest first, a
+    keyframe and its deltas at a time, when the ring runs out of frames
+    or memory.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.h"
+
+// Frames between keyframes
+#define REWIND_KEYFRAME 60
+
+// Longest rewind in seconds
+#define REWIND_MAX_SECONDS 60
+
+extern Boolean Rewind_enabled;
+
+void Rewind_init(uint32_t seconds);
+void Rewind_reset();
+void Rewind_capture();
+Boolean Rewind_step_back();
+void Rewind_report();
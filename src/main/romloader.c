@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include "stdint.h"
 #include "romloader.h"
+#include "arena.h"
 #include "thirdparty/crc/crc.h"
 
 #ifdef __APPLE__
@@ -21,6 +22,8 @@
 int RomLoader_filesize(const char* filename)
 {
     FILE* file = fopen(filename, "rb");
+    if (!file)
+        return 0;
     fseek(file, 0L, SEEK_END);
     uint32_t size = ftell(file);
     fclose(file);
@@ -30,18 +33,22 @@ int RomLoader_filesize(const char* filename)
 void RomLoader_create(RomLoader* romLoader)
 {
     romLoader->loaded = FALSE;
+    romLoader->rom    = NULL;
+    romLoader->region = ARENA_ROM;
 }
 
-void RomLoader_init(RomLoader* romLoader, uint32_t length)
+void RomLoader_init(RomLoader* romLoader, uint32_t length, uint8_t region)
 {
     romLoader->length = length;
-    romLoader->rom = (uint8_t*)malloc(length);
+    romLoader->region = region;
+    romLoader->rom = (uint8_t*)Arena_alloc(region, length);
     crcInit();
 }
 
 void RomLoader_unload(RomLoader* romLoader)
 {
-    free(romLoader->rom);
+    Arena_free(romLoader->rom);
+    romLoader->rom = NULL;
 }
 
 int maxsize = 0;
@@ -79,7 +86,14 @@ int RomLoader_load(RomLoader* romLoader, const char* filename, const int offset,
     }
 
     // Read file
-    char* buffer = (char*) malloc(length);
+    char* buffer = (char*) Arena_alloc(ARENA_LOAD, length);
+    if (!buffer || !romLoader->rom)
+    {
+        Arena_free(buffer);
+        fclose(file);
+        romLoader->loaded = FALSE;
+        return 1; // fail
+    }
     int read = fread(buffer, length, 1, file);
 
     crc computed_crc = crcSlow(buffer, length);
@@ -96,7 +110,7 @@ int RomLoader_load(RomLoader* romLoader, const char* filename, const int offset,
     }
 
     // Clean Up
-    free(buffer);
+    Arena_free(buffer);
     fclose(file);
     romLoader->loaded = TRUE;
     return 0; // success
@@ -135,7 +149,13 @@ int RomLoader_load_binary(RomLoader* romLoader, const char* filename)
     romLoader->length = RomLoader_filesize(filename);
 
     // Read file
-    char* buffer = (char*)malloc(romLoader->length);
+    char* buffer = (char*)Arena_alloc(romLoader->region, romLoader->length);
+    if (!buffer)
+    {
+        fclose(file);
+        romLoader->loaded = FALSE;
+        return 1; // fail
+    }
     fread(buffer, romLoader->length, 1, file);
     romLoader->rom = (uint8_t*) buffer;
 
@@ -26,11 +26,14 @@ typedef struct
 
     // Successfully loaded
     Boolean loaded;
+
+    // Memory arena region the rom is allocated from
+    uint8_t region;
 } RomLoader;
 
 
 void RomLoader_create(RomLoader* romLoader);
-void RomLoader_init(RomLoader* romLoader, uint32_t);
+void RomLoader_init(RomLoader* romLoader, uint32_t, uint8_t region);
 int RomLoader_load(RomLoader* romLoader, const char* filename, const int offset, const int length, const int expected_crc, const uint8_t mode/* = NORMAL*/);
 int RomLoader_load_binary(RomLoader* romLoader, const char* filename);
 void RomLoader_unload(RomLoader* romLoader);
@@ -7,6 +7,7 @@
 
 #include "stdint.h"
 #include "roms.h"
+#include "arena.h"
 
 RomLoader Roms_rom0;
 RomLoader Roms_rom1;
@@ -30,7 +31,7 @@ Boolean Roms_load_revb_roms()
     int status = 0;
 
     // Load Master CPU ROMs
-    RomLoader_init(&Roms_rom0, 0x40000);
+    RomLoader_init(&Roms_rom0, 0x40000, ARENA_ROM);
     status += RomLoader_load(&Roms_rom0, "roms/epr-10381a.132", 0x20000, 0x10000, 0xbe8c412b, ROMLOADER_INTERLEAVE2);
     
     // Try alternate filename for this rom
@@ -45,14 +46,14 @@ Boolean Roms_load_revb_roms()
     status += RomLoader_load(&Roms_rom0, "roms/epr-10382b.118", 0x00001, 0x10000, 0xc4c3fa1a, ROMLOADER_INTERLEAVE2);
 
     // Load Slave CPU ROMs
-    RomLoader_init(&Roms_rom1, 0x40000);
+    RomLoader_init(&Roms_rom1, 0x40000, ARENA_ROM);
     status += RomLoader_load(&Roms_rom1, "roms/epr-10327a.76", 0x00000, 0x10000, 0xe28a5baf, ROMLOADER_INTERLEAVE2);
     status += RomLoader_load(&Roms_rom1, "roms/epr-10329a.58", 0x00001, 0x10000, 0xda131c81, ROMLOADER_INTERLEAVE2);
     status += RomLoader_load(&Roms_rom1, "roms/epr-10328a.75", 0x20000, 0x10000, 0xd5ec5e5d, ROMLOADER_INTERLEAVE2);
     status += RomLoader_load(&Roms_rom1, "roms/epr-10330a.57", 0x20001, 0x10000, 0xba9ec82a, ROMLOADER_INTERLEAVE2);
 
     // Load Non-Interleaved Tile ROMs
-    RomLoader_init(&Roms_tiles, 0x30000);
+    RomLoader_init(&Roms_tiles, 0x30000, ARENA_LOAD);
     status += RomLoader_load(&Roms_tiles, "roms/opr-10268.99",  0x00000, 0x08000, 0x95344b04, ROMLOADER_NORMAL);
     status += RomLoader_load(&Roms_tiles, "roms/opr-10232.102", 0x08000, 0x08000, 0x776ba1eb, ROMLOADER_NORMAL);
     status += RomLoader_load(&Roms_tiles, "roms/opr-10267.100", 0x10000, 0x08000, 0xa85bb823, ROMLOADER_NORMAL);
@@ -61,12 +62,12 @@ Boolean Roms_load_revb_roms()
     status += RomLoader_load(&Roms_tiles, "roms/opr-10230.104", 0x28000, 0x08000, 0x686f5e50, ROMLOADER_NORMAL);
 
     // Load Non-Interleaved Road ROMs (2 identical roms, 1 for each road)
-    RomLoader_init(&Roms_road, 0x10000);
+    RomLoader_init(&Roms_road, 0x10000, ARENA_LOAD);
     status += RomLoader_load(&Roms_road, "roms/opr-10185.11", 0x000000, 0x08000, 0x22794426, ROMLOADER_NORMAL);
     status += RomLoader_load(&Roms_road, "roms/opr-10186.47", 0x008000, 0x08000, 0x22794426, ROMLOADER_NORMAL);
 
     // Load Interleaved Sprite ROMs
-    RomLoader_init(&Roms_sprites, 0x100000);
+    RomLoader_init(&Roms_sprites, 0x100000, ARENA_LOAD);
     status += RomLoader_load(&Roms_sprites, "roms/mpr-10371.9",  0x000000, 0x20000, 0x7cc86208, ROMLOADER_INTERLEAVE4);
     status += RomLoader_load(&Roms_sprites, "roms/mpr-10373.10", 0x000001, 0x20000, 0xb0d26ac9, ROMLOADER_INTERLEAVE4);
     status += RomLoader_load(&Roms_sprites, "roms/mpr-10375.11", 0x000002, 0x20000, 0x59b60bd7, ROMLOADER_INTERLEAVE4);
@@ -77,11 +78,11 @@ Boolean Roms_load_revb_roms()
     status += RomLoader_load(&Roms_sprites, "roms/mpr-10378.16", 0x080003, 0x20000, 0xa1062984, ROMLOADER_INTERLEAVE4);
 
     // Load Z80 Sound ROM
-    RomLoader_init(&Roms_z80, 0x10000);
+    RomLoader_init(&Roms_z80, 0x10000, ARENA_ROM);
     status += RomLoader_load(&Roms_z80, "roms/epr-10187.88", 0x0000, 0x08000, 0xa10abaa9, ROMLOADER_NORMAL);
 
     // Load Sega PCM Chip Samples
-    RomLoader_init(&Roms_pcm, 0x60000);
+    RomLoader_init(&Roms_pcm, 0x60000, ARENA_ROM);
     status += RomLoader_load(&Roms_pcm, "roms/opr-10193.66", 0x00000, 0x08000, 0xbcd10dde, ROMLOADER_NORMAL);
     status += RomLoader_load(&Roms_pcm, "roms/opr-10192.67", 0x10000, 0x08000, 0x770f1270, ROMLOADER_NORMAL);
     status += RomLoader_load(&Roms_pcm, "roms/opr-10191.68", 0x20000, 0x08000, 0x20a284ab, ROMLOADER_NORMAL);
@@ -98,8 +99,8 @@ Boolean Roms_load_japanese_roms()
     // Only attempt to initalize the arrays once.
     if (jap_rom_status == -1)
     {
-        RomLoader_init(&Roms_j_rom0, 0x40000);
-        RomLoader_init(&Roms_j_rom1, 0x40000);
+        RomLoader_init(&Roms_j_rom0, 0x40000, ARENA_ROM);
+        RomLoader_init(&Roms_j_rom1, 0x40000, ARENA_ROM);
     }
 
     // If incremented, a rom has failed to load.
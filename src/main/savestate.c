@@ -0,0 +1,282 @@
+/***************************************************************************
+    Save State.
+
+    Snapshot and restore of the whole engine: the game code globals,
+    the video hardware RAM and the sound program & sound chip state.
+
+    Each module registers its globals with SaveState_add, from its own
+    register_state function. A snapshot is every registered block copied
+    back to back into one contiguous blob, preceded by a header. The
+    header records a hash of the registry layout, so a blob is rejected
+    if the registry has changed since it was captured.
+
+    Blobs contain raw pointers, so they are only valid for the lifetime
+    of the process that captured them.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "globals.h"
+#include "arena.h"
+#include "savestate.h"
+#include "video.h"
+
+#include "engine/oanimseq.h"
+#include "engine/oattractai.h"
+#include "engine/obonus.h"
+#include "engine/ocrash.h"
+#include "engine/oferrari.h"
+#include "engine/ohiscore.h"
+#include "engine/oinitengine.h"
+#include "engine/oinputs.h"
+#include "engine/olevelobjs.h"
+#include "engine/ologo.h"
+#include "engine/omap.h"
+#include "engine/omusic.h"
+#include "engine/ooutputs.h"
+#include "engine/opalette.h"
+#include "engine/oroad.h"
+#include "engine/osmoke.h"
+#include "engine/osprites.h"
+#include "engine/ostats.h"
+#include "engine/otiles.h"
+#include "engine/otraffic.h"
+#include "engine/outils.h"
+#include "engine/outrun.h"
+#include "frontend/ttrial.h"
+
+#include "engine/audio/osound.h"
+#include "engine/audio/osoundint.h"
+#include "hwaudio/segapcm.h"
+#include "hwaudio/ym2151.h"
+
+#ifdef COMPILE_SOUND_CODE
+#include "sdl/audio.h"
+#endif
+
+#define SAVESTATE_MAGIC 0x53534243 // 'CBSS'
+
+typedef struct
+{
+    const char* name;
+    void* data;
+    uint32_t size;
+    uint8_t group;
+} savestate_entry_t;
+
+static savestate_entry_t SaveState_entries[SAVESTATE_MAX_ENTRIES];
+static uint32_t SaveState_count  = 0;
+static uint32_t SaveState_bytes  = sizeof(savestate_header_t);
+static uint32_t SaveState_layout = 2166136261u; // FNV-1a offset basis
+static Boolean SaveState_initialized = FALSE;
+
+void SaveState_hash(const void* data, uint32_t length);
+void SaveState_lock();
+void SaveState_unlock();
+
+// Build the registry. Every module that holds engine state registers its globals here.
+void SaveState_init()
+{
+    if (SaveState_initialized)
+        return;
+
+    // Game Code
+    OAnimSeq_register_state();
+    OAttractAI_register_state();
+    OBonus_register_state();
+    OCrash_register_state();
+    OFerrari_register_state();
+    OHiScore_register_state();
+    OInitEngine_register_state();
+    OInputs_register_state();
+    OLevelObjs_register_state();
+    OLogo_register_state();
+    OMap_register_state();
+    OMusic_register_state();
+    OOutputs_register_state();
+    OPalette_register_state();
+    ORoad_register_state();
+    OSmoke_register_state();
+    OSprites_register_state();
+    OStats_register_state();
+    OTiles_register_state();
+    OTraffic_register_state();
+    outils_register_state();
+    Outrun_register_state();
+    TTrial_register_state();
+
+    // Video Hardware
+    Video_register_state();
+    HWTiles_register_state();
+    HWSprites_register_state();
+    HWRoad_register_state();
+
+    // Sound Program & Sound Hardware
+    OSound_register_state();
+    OSoundInt_register_state();
+    SegaPCM_register_state();
+    YM_register_state();
+
+    SaveState_initialized = TRUE;
+}
+
+void SaveState_add(const char* name, void* data, uint32_t size, uint8_t group)
+{
+    if (SaveState_count >= SAVESTATE_MAX_ENTRIES)
+    {
+        fprintf(stderr, "Save State: Too many entries. %s not registered.\n", name);
+        return;
+    }
+
+    savestate_entry_t* e = &SaveState_entries[SaveState_count++];
+    e->name  = name;
+    e->data  = data;
+    e->size  = size;
+    e->group = group;
+
+    SaveState_bytes += size;
+    SaveState_hash(name, strlen(name));
+    SaveState_hash(&size, sizeof(size));
+}
+
+void SaveState_hash(const void* data, uint32_t length)
+{
+    const uint8_t* p = (const uint8_t*) data;
+
+    while (length--)
+    {
+        SaveState_layout ^= *p++;
+        SaveState_layout *= 16777619u; // FNV prime
+    }
+}
+
+// Size of a snapshot in bytes
+uint32_t SaveState_size()
+{
+    return SaveState_bytes;
+}
+
+// Sound state belongs to the audio thread and the sprite & road banks are read by
+// the renderer, so both are held still while the snapshot is copied.
+void SaveState_lock()
+{
+#ifdef COMPILE_SOUND_CODE
+    Audio_lock_state();
+#endif
+    Video_lock_banks();
+}
+
+void SaveState_unlock()
+{
+    Video_unlock_banks();
+#ifdef COMPILE_SOUND_CODE
+    Audio_unlock_state();
+#endif
+}
+
+// Capture a snapshot into blob, which must be at least SaveState_size() bytes.
+Boolean SaveState_save(uint8_t* blob, uint32_t size)
+{
+    uint32_t i;
+
+    if (blob == NULL || size < SaveState_bytes)
+        return FALSE;
+
+    savestate_header_t* header = (savestate_header_t*) blob;
+    header->magic   = SAVESTATE_MAGIC;
+    header->version = SAVESTATE_VERSION;
+    header->layout  = SaveState_layout;
+    header->size    = SaveState_bytes;
+    blob += sizeof(savestate_header_t);
+
+    SaveState_lock();
+    for (i = 0; i < SaveState_count; i++)
+    {
+        memcpy(blob, SaveState_entries[i].data, SaveState_entries[i].size);
+        blob += SaveState_entries[i].size;
+    }
+    SaveState_unlock();
+
+    return TRUE;
+}
+
+// Restore a snapshot. Returns FALSE, leaving the engine untouched, if the blob does not match the registry.
+Boolean SaveState_load(const uint8_t* blob, uint32_t size)
+{
+    uint32_t i;
+    Boolean video = FALSE;
+
+    if (blob == NULL || size < sizeof(savestate_header_t))
+        return FALSE;
+
+    const savestate_header_t* header = (const savestate_header_t*) blob;
+
+    if (header->magic   != SAVESTATE_MAGIC   ||
+        header->version != SAVESTATE_VERSION ||
+        header->layout  != SaveState_layout  ||
+        header->size    != SaveState_bytes   ||
+        size < SaveState_bytes)
+    {
+        fprintf(stderr, "Save State: Snapshot does not match this build.\n");
+        return FALSE;
+    }
+
+    blob += sizeof(savestate_header_t);
+
+    SaveState_lock();
+    for (i = 0; i < SaveState_count; i++)
+    {
+        memcpy(SaveState_entries[i].data, blob, SaveState_entries[i].size);
+        blob += SaveState_entries[i].size;
+        video |= SaveState_entries[i].group == SAVESTATE_VIDEO;
+    }
+
+    // The restored bank pointers may have swapped which bank is the front buffer
+    if (video)
+    {
+        HWSprites_publish();
+        HWRoad_publish();
+    }
+    SaveState_unlock();
+
+    // The renderer keeps a converted copy of palette RAM
+    if (video)
+        Video_restore_palette();
+
+    return TRUE;
+}
+
+// Time snapshot and restore. Both need to run well inside a frame.
+void SaveState_benchmark(uint32_t iterations)
+{
+    uint32_t i;
+
+    if (iterations == 0)
+        iterations = 1;
+
+    SaveState_init();
+
+    uint8_t* blob = (uint8_t*) Arena_alloc(ARENA_LOAD, SaveState_bytes);
+    if (blob == NULL)
+        return;
+
+    clock_t start = clock();
+    for (i = 0; i < iterations; i++)
+        SaveState_save(blob, SaveState_bytes);
+    clock_t saved = clock();
+    for (i = 0; i < iterations; i++)
+        SaveState_load(blob, SaveState_bytes);
+    clock_t loaded = clock();
+
+    double save_us = (double) (saved - start)  * 1000000.0 / CLOCKS_PER_SEC / iterations;
+    double load_us = (double) (loaded - saved) * 1000000.0 / CLOCKS_PER_SEC / iterations;
+
+    fprintf(stderr, "Save State: %u bytes in %u blocks.\n", SaveState_bytes, SaveState_count);
+    fprintf(stderr, "Save %.1fus, Load %.1fus (average of %u).\n", save_us, load_us, iterations);
+
+    Arena_free(blob);
+}
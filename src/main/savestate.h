@@ -0,0 +1,54 @@
+/***************************************************************************
+    Save State.
+
+    Snapshot and restore of the whole engine: the game code globals,
+    the video hardware RAM and the sound program & sound chip state.
+
+    Each module registers its globals with SaveState_add, from its own
+    register_state function. A snapshot is every registered block copied
+    back to back into one contiguous blob, preceded by a header. The
+    header records a hash of the registry layout, so a blob is rejected
+    if the registry has changed since it was captured.
+
+    Blobs contain raw pointers, so they are only valid for the lifetime
+    of the process that captured them. With ENGINE_THREADS the registered
+    addresses are those of the thread that called SaveState_init.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.h"
+
+// Increment when the meaning of registered data changes without its layout changing
+#define SAVESTATE_VERSION 1
+
+// Maximum number of registered blocks
+#define SAVESTATE_MAX_ENTRIES 512
+
+enum
+{
+    SAVESTATE_ENGINE,   // Game code globals
+    SAVESTATE_VIDEO,    // Tile, text, sprite & road RAM and palette
+    SAVESTATE_SOUND,    // Sound program and sound chips. Owned by the audio thread.
+};
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t layout;    // Hash of registered names and sizes
+    uint32_t size;      // Total size of the blob, including this header
+} savestate_header_t;
+
+// Register a global variable or array
+#define SAVESTATE_ADD(group, var) SaveState_add(#var, &(var), sizeof(var), group)
+
+void SaveState_init();
+void SaveState_add(const char* name, void* data, uint32_t size, uint8_t group);
+uint32_t SaveState_size();
+Boolean SaveState_save(uint8_t* blob, uint32_t size);
+Boolean SaveState_load(const uint8_t* blob, uint32_t size);
+void SaveState_benchmark(uint32_t iterations);
@@ -9,6 +9,10 @@
     
     In order to achieve seamless audio, when audio is enabled the framerate
     is adjusted to essentially sync the video to the audio output.
+
+    Sound generation runs on a dedicated audio thread. The game thread
+    passes sound commands and engine data to it through a lock-free queue,
+    so it never waits on the audio device.
     
     This is based upon code from the Atari800 emulator project.
     Copyright (c) 1998-2008 Atari800 development team
@@ -16,6 +20,12 @@
 
 #include <SDL.h>
 #include "sdl/audio.h"
+#include "arena.h"
+#include "spsc.h"
+#include "hwaudio/resampler.h"
+#include "hwaudio/mixer.h"
+#include "sdl/wavstream.h"
+#include "sdl/timer.h"
 #include "frontend/config.h" // fps
 #include "engine/audio/OSoundInt.h"
 
@@ -25,8 +35,9 @@
 
 Boolean Audio_sound_enabled;
 
-// Sample Rate. Can't be changed easily for now, due to lack of SDL resampling.
-const uint32_t FREQ = 44100;
+// Output Sample Rate. Requested from the config, then set to the rate the device opened at.
+// The sound chips run at Config_sound.chip_rate and are resampled to this rate.
+static uint32_t FREQ = 44100;
 
 // Stereo. Could be changed, requires some recoding.
 const uint32_t CHANNELS = 2;
@@ -43,34 +54,82 @@ static int SND_DELAY = 20;
 
 // allowed "spread" between too many and too few samples in the buffer (ms)
 static int SND_SPREAD = 7;
+
+// Speed correction applied when the buffer is SND_SPREAD/2 away from its target, and the maximum correction.
+static const double RATE_GAIN  = 0.05;
+static const double RATE_LIMIT = 0.10;
     
-// Buffer used to mix PCM and YM channels together
+// Buffer used to mix PCM and YM channels together, at the chip rate
+int16_t* Audio_chip_buffer;
+
+// Buffer used to mix the resampled chips with the wav, at the output rate
 uint16_t* Audio_mix_buffer;
+static uint32_t Audio_mix_size;    // Capacity in samples
+static uint32_t Audio_mix_samples; // Samples produced by the last frame
 
-struct wav_t Audio_wavfile;
+static resampler_t Audio_resampler;
 
-// Estimated gap
-int Audio_gap_est;
+// Custom music, streamed from disk
+static wavstream_t Audio_wavstream;
+int16_t* Audio_wav_buffer;
 
-// Cumulative audio difference
-double Audio_avg_gap;
+// Smoothed buffer occupancy (samples)
+double Audio_avg_fill;
 
 void Audio_clear_buffers();
-void Audio_pause_audio();
-void Audio_resume_audio();
+void Audio_render_frame();
+Boolean Audio_write_frame();
+void Audio_start_thread();
+void Audio_stop_thread();
+int Audio_thread_main(void* data);
+Boolean Audio_has_room();
+Boolean Audio_is_behind();
+
+/* ----------------------------------------------------------------------------
+   Audio Thread & Command Queue
+   ----------------------------------------------------------------------------*/
+
+// Number of commands that can be queued. Must be a power of two.
+#define AUDIO_CMD_QUEUE 256
+
+// Frames the audio thread may fall behind the game before it stops waiting
+// for the device, and renders and discards frames to catch up
+#define AUDIO_MAX_BACKLOG 4
+
+typedef struct
+{
+    uint8_t cmd;            // OSOUNDINT_CMD_*
+    uint8_t value;
+    uint8_t engine_data[8]; // Engine data at the time the command was posted
+} audio_cmd_t;
+
+static audio_cmd_t Audio_cmd_queue[AUDIO_CMD_QUEUE];
+static spsc_t Audio_cmd_spsc;
+
+static SDL_Thread* Audio_thread = NULL;
+static SDL_sem* Audio_wake_sem  = NULL; // Posted on new commands and when the callback frees space
+static SDL_mutex* Audio_state_mutex = NULL; // Held by the audio thread while it runs the sound program and chips
+static volatile Boolean Audio_thread_quit;
+
+// Frame commands posted by the game thread, and completed by the audio thread
+static volatile uint32_t Audio_frames_posted;
+static volatile uint32_t Audio_frames_done;
+
+// Synthesis times of the last frame, for telemetry
+static uint32_t Audio_pcm_us, Audio_ym_us, Audio_mix_us;
 
 
 /* ----------------------------------------------------------------------------
    SDL Sound Implementation & Callback Function
    ----------------------------------------------------------------------------*/
 
-// Note that these variables are accessed by two separate threads.
-uint8_t* dsp_buffer;
-static int dsp_buffer_bytes;
-static int dsp_write_pos;
-static int dsp_read_pos;
-static int callbacktick;     // tick at which callback occured
-static int bytes_per_sample; // Number of bytes per sample entry (usually 4 bytes if stereo and 16-bit sound)
+// Output ring buffer of interleaved 16-bit samples.
+// Written by the audio thread and read by the callback, without locking. Indices are in samples.
+static int16_t* Audio_ring;
+static spsc_t Audio_ring_spsc;
+
+// The device is unpaused once the first frame is queued, so the silence queued ahead of it isn't drained early
+static Boolean Audio_device_running;
 
 // SDL Audio Callback Function
 extern void fill_audio(void *udata, Uint8 *stream, int len);
@@ -79,26 +138,26 @@ extern void fill_audio(void *udata, Uint8 *stream, int len);
 
 void Audio_init()
 {
+    AudioStats_reset();
+
     if (Config_sound.enabled)
         Audio_start_audio();
 }
 
 void Audio_start_audio()
 {
-    
-    /*
     if (!Audio_sound_enabled)
     {
         if(SDL_Init(SDL_INIT_AUDIO) == -1) 
         {
-            fprintf(stderr, "Error initalizing audio: %d\n");        
+            fprintf(stderr, "Error initalizing audio: %s\n", SDL_GetError());
             return;
         }
 
         // SDL Audio Properties
         SDL_AudioSpec desired, obtained;
 
-        desired.freq     = FREQ;
+        desired.freq     = Config_sound.rate;
         desired.format   = AUDIO_S16SYS;
         desired.channels = CHANNELS;
         desired.samples  = SAMPLES;
@@ -107,72 +166,85 @@ void Audio_start_audio()
 
         if (SDL_OpenAudio(&desired, &obtained) == -1)
         {
-            fprintf(stderr, "Error initalizing audio: %d\n", SDL_GetError());
+            fprintf(stderr, "Error initalizing audio: %s\n", SDL_GetError());
             return;
         }
 
-        if (desired.samples != obtained.samples)
+        if (desired.samples != obtained.samples || obtained.channels != CHANNELS || obtained.format != AUDIO_S16SYS)
         {
-            fprintf(stderr, "Error initalizing audio: ample rate not supported.\n");
+            fprintf(stderr, "Error initalizing audio: buffer size or format not supported.\n");
+            SDL_CloseAudio();
             return;
         }
 
-        bytes_per_sample = CHANNELS * (BITS / 8);
+        FREQ = obtained.freq;
 
         // Start Audio
         Audio_sound_enabled = TRUE;
 
-        // how many fragments in the dsp buffer
-        const int DSP_BUFFER_FRAGS = 5;
+        // how many fragments in the ring buffer, rounded up to a power of two
+        const int RING_BUFFER_FRAGS = 5;
         int specified_delay_samps = (FREQ * SND_DELAY) / 1000;
-        int dsp_buffer_samps = SAMPLES * DSP_BUFFER_FRAGS + specified_delay_samps;
-        dsp_buffer_bytes = CHANNELS * dsp_buffer_samps * (BITS / 8);
-        dsp_buffer = (uint8_t*)malloc(dsp_buffer_bytes);
-
-        // Create Buffer For Mixing
-        uint16_t buffer_size = (FREQ / Config_fps) * CHANNELS;
-        Audio_mix_buffer = (uint16_t*)malloc(buffer_size * sizeof(uint16_t));
+        uint32_t ring_samps = 1;
+        while (ring_samps < (SAMPLES * RING_BUFFER_FRAGS + specified_delay_samps) * CHANNELS)
+            ring_samps <<= 1;
+        Spsc_init(&Audio_ring_spsc, ring_samps);
+        Audio_ring = (int16_t*)Arena_alloc(ARENA_AUDIO, ring_samps * sizeof(int16_t));
+
+        // Create Buffers For Mixing
+        uint32_t chip_frames = Config_sound.chip_rate / Config_fps;
+        Audio_chip_buffer = (int16_t*)Arena_alloc(ARENA_AUDIO, chip_frames * CHANNELS * sizeof(int16_t));
+        Resampler_init(&Audio_resampler, Config_sound.chip_rate, FREQ, chip_frames);
+        Audio_mix_size = Resampler_max_output(&Audio_resampler, chip_frames) * CHANNELS;
+        Audio_mix_buffer = (uint16_t*)Arena_alloc(ARENA_AUDIO, Audio_mix_size * sizeof(uint16_t));
+        Audio_wav_buffer = (int16_t*)Arena_alloc(ARENA_AUDIO, Audio_mix_size * sizeof(int16_t));
+        WavStream_init(&Audio_wavstream, FREQ);
 
         Audio_clear_buffers();
         Audio_clear_wav();
 
-        SDL_PauseAudio(0);
+        Audio_start_thread();
     }
-    
-    */
-    
-    Audio_sound_enabled = TRUE;
 }
 
+// Called with the callback paused
 void Audio_clear_buffers()
 {
-    dsp_read_pos  = 0;
     int specified_delay_samps = (FREQ * SND_DELAY) / 1000;
-    dsp_write_pos = (specified_delay_samps+SAMPLES) * bytes_per_sample;
-    Audio_avg_gap = 0.0;
-    Audio_gap_est = 0;
 
-    for (int i = 0; i < dsp_buffer_bytes; i++)
-        dsp_buffer[i] = 0;
+    for (uint32_t i = 0; i < Audio_ring_spsc.size; i++)
+        Audio_ring[i] = 0;
 
-    uint16_t buffer_size = (FREQ / Config_fps) * CHANNELS;
-    for (int i = 0; i < buffer_size; i++)
+    // Start with the target latency of silence queued
+    Spsc_reset(&Audio_ring_spsc);
+    Spsc_push(&Audio_ring_spsc, (specified_delay_samps + SAMPLES) * CHANNELS);
+    Audio_avg_fill = -1.0;
+
+    for (uint32_t i = 0; i < Audio_mix_size; i++)
         Audio_mix_buffer[i] = 0;
+    Audio_mix_samples = 0;
+
+    Resampler_reset(&Audio_resampler);
 
-    callbacktick = 0;
+    Audio_device_running = FALSE;
 }
 
 void Audio_stop_audio()
 {
     if (Audio_sound_enabled)
     {
+        Audio_stop_thread();
         Audio_sound_enabled = FALSE;
 
         SDL_PauseAudio(1);
         SDL_CloseAudio();
 
-        free(dsp_buffer);
-        free(Audio_mix_buffer);
+        WavStream_destroy(&Audio_wavstream);
+        Arena_free(Audio_wav_buffer);
+        Arena_free(Audio_mix_buffer);
+        Resampler_destroy(&Audio_resampler);
+        Arena_free(Audio_chip_buffer);
+        Arena_free(Audio_ring);
     }
 }
 
@@ -180,6 +252,7 @@ void Audio_pause_audio()
 {
     if (Audio_sound_enabled)
     {
+        Audio_stop_thread();
         SDL_PauseAudio(1);
     }
 }
@@ -189,217 +262,306 @@ void Audio_resume_audio()
     if (Audio_sound_enabled)
     {
         Audio_clear_buffers();
-        SDL_PauseAudio(0);
+        Audio_start_thread();
     }
 }
 
-// Called every frame to update the audio
-void Audio_tick()
+void Audio_start_thread()
+{
+    if (Audio_thread != NULL)
+        return;
+
+    Spsc_init(&Audio_cmd_spsc, AUDIO_CMD_QUEUE);
+
+    if (Audio_wake_sem == NULL)
+        Audio_wake_sem = SDL_CreateSemaphore(0);
+
+    if (Audio_state_mutex == NULL)
+        Audio_state_mutex = SDL_CreateMutex();
+
+    Audio_thread_quit   = FALSE;
+    Audio_frames_posted = 0;
+    Audio_frames_done   = 0;
+    Audio_thread = SDL_CreateThread(Audio_thread_main, NULL);
+
+    if (Audio_thread == NULL)
+        fprintf(stderr, "Warning: Could not create audio thread. Generating audio on the game thread.\n");
+}
+
+void Audio_stop_thread()
+{
+    audio_cmd_t* c;
+
+    if (Audio_thread == NULL)
+        return;
+
+    Audio_thread_quit = TRUE;
+    SDL_SemPost(Audio_wake_sem);
+    SDL_WaitThread(Audio_thread, NULL);
+    Audio_thread = NULL;
+
+    // Apply outstanding sound commands, so none are lost. Frames are not rendered.
+    while (Spsc_used(&Audio_cmd_spsc))
+    {
+        c = &Audio_cmd_queue[Spsc_read_index(&Audio_cmd_spsc)];
+        if (c->cmd != OSOUNDINT_CMD_FRAME)
+            OSoundInt_process_command(c->cmd, c->value, c->engine_data);
+        Spsc_pop(&Audio_cmd_spsc, 1);
+    }
+}
+
+// Queue a command for the audio thread. Called from the game thread.
+// Returns FALSE if the audio thread is not running, in which case the caller should run the command itself.
+//
+// Commands are never dropped. The audio thread discards frames once it falls AUDIO_MAX_BACKLOG
+// frames behind, so the queue drains as fast as the chips can be run. It only fills if the
+// audio thread is starved of CPU, and then the game thread waits for space.
+Boolean Audio_post_command(uint8_t cmd, uint8_t value, const uint8_t* engine_data)
+{
+    audio_cmd_t* c;
+
+    if (Audio_thread == NULL)
+        return FALSE;
+
+    if (Spsc_free(&Audio_cmd_spsc) == 0)
+    {
+        AudioStats.cmd_waits++;
+        while (Spsc_free(&Audio_cmd_spsc) == 0)
+        {
+            SDL_SemPost(Audio_wake_sem);
+            SDL_Delay(1);
+        }
+    }
+
+    c = &Audio_cmd_queue[Spsc_write_index(&Audio_cmd_spsc)];
+    c->cmd   = cmd;
+    c->value = value;
+    memcpy(c->engine_data, engine_data, sizeof(c->engine_data));
+    Spsc_push(&Audio_cmd_spsc, 1);
+
+    if (cmd == OSOUNDINT_CMD_FRAME)
+        Audio_frames_posted++;
+
+    SDL_SemPost(Audio_wake_sem);
+    return TRUE;
+}
+
+// Sound program and chip state is owned by the audio thread.
+// Other threads hold this lock to access it, e.g. to take a save state.
+void Audio_lock_state()
 {
-    int bytes_written = 0;
-    int newpos;
-    double bytes_per_ms;
+    if (Audio_state_mutex)
+        SDL_mutexP(Audio_state_mutex);
+}
+
+void Audio_unlock_state()
+{
+    if (Audio_state_mutex)
+        SDL_mutexV(Audio_state_mutex);
+}
+
+// Is there room in the output buffer for another frame of audio?
+Boolean Audio_has_room()
+{
+    return Spsc_free(&Audio_ring_spsc) >= Audio_mix_size;
+}
+
+// Has the audio thread fallen too far behind the game to wait for the device?
+Boolean Audio_is_behind()
+{
+    return Audio_frames_posted - Audio_frames_done > AUDIO_MAX_BACKLOG;
+}
+
+int Audio_thread_main(void* data)
+{
+    audio_cmd_t* c;
+
+    while (!Audio_thread_quit)
+    {
+        if (Spsc_used(&Audio_cmd_spsc) == 0)
+        {
+            SDL_SemWaitTimeout(Audio_wake_sem, 10);
+            continue;
+        }
+
+        c = &Audio_cmd_queue[Spsc_read_index(&Audio_cmd_spsc)];
+
+        if (c->cmd == OSOUNDINT_CMD_FRAME)
+        {
+            // Wait for the callback to make space, rather than overwriting unplayed audio
+            if (!Audio_has_room() && !Audio_is_behind())
+                AudioStats.overflow_waits++;
+
+            while (!Audio_has_room() && !Audio_is_behind())
+            {
+                if (Audio_thread_quit)
+                    return 0;
+                SDL_SemWaitTimeout(Audio_wake_sem, 10);
+            }
+
+            Audio_lock_state();
+            OSoundInt_process_command(c->cmd, c->value, c->engine_data);
+            Audio_render_frame();
+            Audio_unlock_state();
+
+            // When behind, the sound program still runs, but the output is discarded
+            if (!Audio_write_frame())
+                AudioStats.dropped_frames++;
+            Audio_frames_done++;
+        }
+        else
+        {
+            Audio_lock_state();
+            OSoundInt_process_command(c->cmd, c->value, c->engine_data);
+            Audio_unlock_state();
+        }
+
+        Spsc_pop(&Audio_cmd_spsc, 1);
+    }
+
+    return 0;
+}
 
+// Called every frame to update the audio.
+// Streams custom music, and generates audio when the audio thread could not be created.
+void Audio_tick()
+{
     if (!Audio_sound_enabled) return;
 
+    WavStream_fill(&Audio_wavstream);
+
+    if (Audio_thread != NULL) return;
+
+    Audio_render_frame();
+
+    // Drop the frame rather than stall the game when the buffer is full
+    if (!Audio_write_frame())
+        AudioStats.dropped_frames++;
+}
+
+// Generate a frame of audio into the mix buffer
+void Audio_render_frame()
+{
     // Update audio streams from PCM & YM Devices
+    uint32_t start = getMicroseconds();
     SegaPCM_stream_update();
+    uint32_t pcm_done = getMicroseconds();
     YM_stream_update();
+    uint32_t ym_done = getMicroseconds();
 
     // Get the audio buffers we've just output
     int16_t *pcm_buffer = SegaPCM_get_buffer();
     int16_t *ym_buffer  = YM_get_buffer();
-    int16_t *wav_buffer = Audio_wavfile.data;
+    int16_t *wav_buffer = Audio_wav_buffer;
+    int16_t *mix_buffer = (int16_t*) Audio_mix_buffer;
 
-    int samples_written = SegaPCM_buffer_size;
+    uint32_t chip_samples = SegaPCM_buffer_size;
 
-    // And mix them into the mix_buffer
-    for (int i = 0; i < samples_written; i++)
-    {
-        int32_t mix_data = wav_buffer[Audio_wavfile.pos] + pcm_buffer[i] + ym_buffer[i];
+    // Mix the chips together at their internal rate
+    Mixer_mix2(Audio_chip_buffer, pcm_buffer, Mixer_gain(SegaPCM_get_volume()),
+                                  ym_buffer,  Mixer_gain(YM_get_volume()), chip_samples);
 
-        // Clip mix data
-        if (mix_data >= (1 << 15))
-            mix_data = (1 << 15);
-        else if (mix_data < -(1 << 15))
-            mix_data = -(1 << 15);
+    // Convert them to the output rate
+    Audio_mix_samples = Resampler_process(&Audio_resampler, Audio_chip_buffer, chip_samples / CHANNELS, mix_buffer) * CHANNELS;
 
-        Audio_mix_buffer[i] = mix_data;
+    // And mix in the wav, which is already at the output rate
+    WavStream_read(&Audio_wavstream, wav_buffer, Audio_mix_samples);
+    Mixer_mix2(mix_buffer, mix_buffer, MIXER_UNITY, wav_buffer, MIXER_UNITY, Audio_mix_samples);
 
-        // Loop wav files
-        if (++Audio_wavfile.pos >= Audio_wavfile.length)
-            Audio_wavfile.pos = 0;
-    }
+    Audio_pcm_us = pcm_done - start;
+    Audio_ym_us  = ym_done - pcm_done;
+    Audio_mix_us = getMicroseconds() - ym_done;
+}
 
-    // Cast mix_buffer to a byte array, to align it with internal SDL format 
-    uint8_t* mbuf8 = (uint8_t*) Audio_mix_buffer;
+// Copy the mix buffer to the output buffer. Returns FALSE if there is no room.
+Boolean Audio_write_frame()
+{
+    uint32_t samples = Audio_mix_samples;
+    int16_t* mbuf    = (int16_t*) Audio_mix_buffer;
 
-    // produce samples from the sound emulation
-    bytes_per_ms = (bytes_per_sample) * (FREQ/1000.0);
-    bytes_written = (BITS == 8 ? samples_written : samples_written*2);
-    
-    SDL_LockAudio();
+    if (Spsc_free(&Audio_ring_spsc) < samples)
+        return FALSE;
 
-    // this is the gap as of the most recent callback
-    int gap = dsp_write_pos - dsp_read_pos;
-    // an estimation of the current gap, adding time since then
-    if (callbacktick != 0)
-        Audio_gap_est = (int) (gap - (bytes_per_ms)*(getMilliseconds() - callbacktick));
+    uint32_t pos        = Spsc_write_index(&Audio_ring_spsc);
+    uint32_t first_part = Audio_ring_spsc.size - pos;
 
-    // if there isn't enough room...
-    while (gap + bytes_written > dsp_buffer_bytes) 
+    // no wrap
+    if (samples <= first_part)
     {
-        // then we allow the callback to run..
-        SDL_UnlockAudio();
-        // and delay until it runs and allows space.
-        sleep(1);
-        SDL_LockAudio();
-        //printf("sound buffer overflow:%d %d\n",gap, dsp_buffer_bytes);
-        gap = dsp_write_pos - dsp_read_pos;
+        memcpy(Audio_ring + pos, mbuf, samples * sizeof(int16_t));
     }
-    // now we copy the data into the buffer and adjust the positions
-    newpos = dsp_write_pos + bytes_written;
-    if (newpos/dsp_buffer_bytes == dsp_write_pos/dsp_buffer_bytes) 
+    // wraps
+    else
     {
-        // no wrap
-        memcpy(dsp_buffer+(dsp_write_pos%dsp_buffer_bytes), mbuf8, bytes_written);
+        memcpy(Audio_ring + pos, mbuf, first_part * sizeof(int16_t));
+        memcpy(Audio_ring, mbuf + first_part, (samples - first_part) * sizeof(int16_t));
     }
-    else 
-    {
-        // wraps
-        int first_part_size = dsp_buffer_bytes - (dsp_write_pos%dsp_buffer_bytes);
-        memcpy(dsp_buffer+(dsp_write_pos%dsp_buffer_bytes), mbuf8, first_part_size);
-        memcpy(dsp_buffer, mbuf8+first_part_size, bytes_written-first_part_size);
-    }
-    dsp_write_pos = newpos;
 
-    // Sound callback has not yet been called
-    if (callbacktick == 0)
-        dsp_read_pos += bytes_written;
+    Spsc_push(&Audio_ring_spsc, samples);
 
-    while (dsp_read_pos > dsp_buffer_bytes) 
+    if (!Audio_device_running)
     {
-        dsp_write_pos -= dsp_buffer_bytes;
-        dsp_read_pos -= dsp_buffer_bytes;
+        Audio_device_running = TRUE;
+        SDL_PauseAudio(0);
     }
-    SDL_UnlockAudio();
+
+    uint32_t latency_ms = (Spsc_used(&Audio_ring_spsc) / CHANNELS) * 1000 / FREQ;
+    AudioStats_frame(latency_ms, Audio_pcm_us, Audio_ym_us, Audio_mix_us);
+    return TRUE;
 }
 
 // Adjust the speed of the emulator, based on audio streaming performance.
 // This ensures that we avoid pops and crackles (in theory). 
+//
+// A proportional controller on the smoothed buffer occupancy. Returns a frame time multiplier:
+// below 1.0 to produce audio faster when the buffer is draining, above 1.0 when it is filling up.
 double Audio_adjust_speed()
 {
     if (!Audio_sound_enabled)
         return 1.0;
 
-    double alpha = 2.0 / (1.0+40.0);
-    int gap_too_small;
-    int gap_too_large;
-    Boolean inited = FALSE;
-
-    if (!inited) 
-    {
-        inited = TRUE;
-        Audio_avg_gap = Audio_gap_est;
-    }
-    else 
-    {
-        Audio_avg_gap = Audio_avg_gap + alpha * (Audio_gap_est - Audio_avg_gap);
-    }
-
-    gap_too_small = (SND_DELAY * FREQ * bytes_per_sample)/1000;
-    gap_too_large = ((SND_DELAY + SND_SPREAD) * FREQ * bytes_per_sample)/1000;
-    
-    if (Audio_avg_gap < gap_too_small) 
-    {
-        double speed = 0.9;
-        return speed;
-    }
-    if (Audio_avg_gap > gap_too_large)
-    {
-        double speed = 1.1;
-        return speed;
-    }
-    return 1.0;
-}
+    const double alpha = 2.0 / (1.0+40.0);
 
-// Empty Wav Buffer
-static int16_t EMPTY_BUFFER[] = {0, 0, 0, 0};
+    double fill = (double) Spsc_used(&Audio_ring_spsc);
 
-void Audio_load_wav(const char* filename)
-{
-    if (Audio_sound_enabled)
-    {
-        Audio_clear_wav();
+    // The callback drains SAMPLES at a time, so the mean occupancy sits half a callback above the floor
+    double samples_per_ms = (FREQ * CHANNELS) / 1000.0;
+    double target = ((SND_DELAY + SND_SPREAD / 2.0) * samples_per_ms) + (SAMPLES * CHANNELS / 2.0);
 
-        // Load Wav File
-        SDL_AudioSpec wave;
-    
-        uint8_t *data;
-        uint32_t length;
+    // Start from the target. The first readings include the queued silence, which the
+    // first callback drains at once, and would otherwise slow the game just as it starts.
+    if (Audio_avg_fill < 0)
+        Audio_avg_fill = target;
+    else
+        Audio_avg_fill = Audio_avg_fill + alpha * (fill - Audio_avg_fill);
 
-        Audio_pause_audio();
+    double error  = (Audio_avg_fill - target) / ((SND_SPREAD / 2.0) * samples_per_ms);
 
-        if( SDL_LoadWAV(filename, &wave, &data, &length) == NULL)
-        {
-            Audio_wavfile.loaded = 0;
-            Audio_resume_audio();
-            fprintf(stderr, "Error: Could not load wav:  %s.\n", filename);
-            return;
-        }
-        
-        SDL_LockAudio();
+    double speed = 1.0 + (RATE_GAIN * error);
 
-        // Halve Volume Of Wav File
-        uint8_t* data_vol = (uint8_t*)malloc(length);
-        SDL_MixAudio(data_vol, data, length, SDL_MIX_MAXVOLUME / 2);
+    if (speed < 1.0 - RATE_LIMIT)
+        speed = 1.0 - RATE_LIMIT;
+    else if (speed > 1.0 + RATE_LIMIT)
+        speed = 1.0 + RATE_LIMIT;
 
-        // WAV File Needs Conversion To Target Format
-        if (wave.format != AUDIO_S16 || wave.channels != 2 || wave.freq != FREQ)
-        {
-            SDL_AudioCVT cvt;
-            SDL_BuildAudioCVT(&cvt, wave.format, wave.channels, wave.freq,
-                                    AUDIO_S16,   CHANNELS,      FREQ);
-
-            cvt.buf = (uint8_t*) malloc(length*cvt.len_mult);
-            memcpy(cvt.buf, data_vol, length);
-            cvt.len = length;
-            SDL_ConvertAudio(&cvt);
-            SDL_FreeWAV(data);
-            free(data_vol);
-
-            Audio_wavfile.data = (int16_t*) cvt.buf;
-            Audio_wavfile.length = cvt.len_cvt / 2;
-            Audio_wavfile.pos = 0;
-            Audio_wavfile.loaded = 1;
-        }
-        // No Conversion Needed
-        else
-        {
-            SDL_FreeWAV(data);
-            Audio_wavfile.data = (int16_t*) data_vol;
-            Audio_wavfile.length = length / 2;
-            Audio_wavfile.pos = 0;
-            Audio_wavfile.loaded = 2;
-        }
+    AudioStats_speed(speed);
 
-        Audio_resume_audio();
-        SDL_UnlockAudio();
-    }
+    return speed;
 }
 
-void Audio_clear_wav()
+// Stream a custom music track. Only the header is read here; playback starts on the next frame.
+void Audio_load_wav(const char* filename)
 {
-    if (Audio_wavfile.loaded)
+    if (Audio_sound_enabled)
     {
-        if (Audio_wavfile.data)
-            free(Audio_wavfile.data);
+        if (!WavStream_open(&Audio_wavstream, filename))
+            fprintf(stderr, "Error: Could not load wav:  %s.\n", filename);
     }
+}
 
-    Audio_wavfile.length = 1;
-    Audio_wavfile.data   = EMPTY_BUFFER;
-    Audio_wavfile.pos    = 0;
-    Audio_wavfile.loaded = FALSE;
+void Audio_clear_wav()
+{
+    WavStream_close(&Audio_wavstream);
 }
 
 // SDL Audio Callback Function
@@ -411,50 +573,48 @@ void Audio_clear_wav()
 
 void fill_audio(void *udata, Uint8 *stream, int len)
 {
-    int gap;
-    int newpos;
-    int underflow_amount = 0;
-#define MAX_SAMPLE_SIZE 4
-    static char last_bytes[MAX_SAMPLE_SIZE];
-
-    gap = dsp_write_pos - dsp_read_pos;
-    if (gap < len) 
-    {
-        underflow_amount = len - gap;
-        len = gap;
-    }
-    newpos = dsp_read_pos + len;
+    int16_t* out      = (int16_t*) stream;
+    uint32_t wanted   = len / sizeof(int16_t);
+    uint32_t samples  = Spsc_used(&Audio_ring_spsc);
+    static int16_t last_sample[2];
+
+    if (samples > wanted)
+        samples = wanted;
+    // Keep whole stereo frames
+    samples -= samples % CHANNELS;
+
+    uint32_t pos        = Spsc_read_index(&Audio_ring_spsc);
+    uint32_t first_part = Audio_ring_spsc.size - pos;
 
     // No Wrap
-    if (newpos/dsp_buffer_bytes == dsp_read_pos/dsp_buffer_bytes) 
+    if (samples <= first_part)
     {
-        memcpy(stream, dsp_buffer + (dsp_read_pos%dsp_buffer_bytes), len);
+        memcpy(out, Audio_ring + pos, samples * sizeof(int16_t));
     }
     // Wrap
-    else 
+    else
     {
-        int first_part_size = dsp_buffer_bytes - (dsp_read_pos%dsp_buffer_bytes);
-        memcpy(stream,  dsp_buffer + (dsp_read_pos%dsp_buffer_bytes), first_part_size);
-        memcpy(stream + first_part_size, dsp_buffer, len - first_part_size);
+        memcpy(out, Audio_ring + pos, first_part * sizeof(int16_t));
+        memcpy(out + first_part, Audio_ring, (samples - first_part) * sizeof(int16_t));
     }
+    Spsc_pop(&Audio_ring_spsc, samples);
+
     // Save the last sample as we may need it to fill underflow
-    if (gap >= bytes_per_sample) 
-    {
-        memcpy(last_bytes, stream + len - bytes_per_sample, bytes_per_sample);
-    }
+    if (samples >= CHANNELS)
+        memcpy(last_sample, out + samples - CHANNELS, CHANNELS * sizeof(int16_t));
+
     // Just repeat the last good sample if underflow
-    if (underflow_amount > 0 ) 
+    if (samples < wanted)
     {
-        int i;
-        for (i = 0; i < underflow_amount/bytes_per_sample; i++) 
-        {
-            memcpy(stream + len +i*bytes_per_sample, last_bytes, bytes_per_sample);
-        }
+        AudioStats.underruns++;
+        AudioStats.underrun_samples += wanted - samples;
+        for (uint32_t i = samples; i + CHANNELS <= wanted; i += CHANNELS)
+            memcpy(out + i, last_sample, CHANNELS * sizeof(int16_t));
     }
-    dsp_read_pos = newpos;
 
-    // Record the tick at which the callback occured.
-    callbacktick = getMilliseconds();
+    // Wake the audio thread, as there is now space in the buffer
+    if (Audio_wake_sem != NULL)
+        SDL_SemPost(Audio_wake_sem);
 }
 
 #endif
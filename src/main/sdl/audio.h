@@ -9,6 +9,10 @@
     
     In order to achieve seamless audio, when audio is enabled the framerate
     is adjusted to essentially sync the video to the audio output.
+
+    Sound generation runs on a dedicated audio thread. The game thread
+    passes sound commands and engine data to it through a lock-free queue,
+    so it never waits on the audio device.
     
     This is based upon code from the Atari800 emulator project.
     Copyright (c) 1998-2008 Atari800 development team
@@ -17,16 +21,10 @@
 #pragma once
 
 #include "globals.h"
+#include "sdl/audiostats.h"
 
 #ifdef COMPILE_SOUND_CODE
 
-struct wav_t {
-    uint8_t loaded;
-    int16_t *data;
-    uint32_t pos;
-    uint32_t length;
-};
-
 extern Boolean Audio_sound_enabled;
 
 void Audio_init();
@@ -36,6 +34,11 @@ void Audio_stop_audio();
 double Audio_adjust_speed();
 void Audio_load_wav(const char* filename);
 void Audio_clear_wav();
+void Audio_pause_audio();
+void Audio_resume_audio();
+Boolean Audio_post_command(uint8_t cmd, uint8_t value, const uint8_t* engine_data);
+void Audio_lock_state();
+void Audio_unlock_state();
 
 #endif
 
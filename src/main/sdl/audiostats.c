@@ -0,0 +1,118 @@
+/***************************************************************************
+    Audio Telemetry.
+
+    Counters and a per-frame trace of the audio pipeline: output buffer
+    latency, underruns, overflow waits, the speed factor from the rate
+    controller and the time taken to synthesise each chip.
+
+    Dumped at exit, and drawn with the FPS counter when it is enabled:
+    latency and underruns, speed and dropped frames, then chip times.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <string.h>
+#include "sdl/audiostats.h"
+#include "engine/ohud.h"
+
+#ifdef COMPILE_SOUND_CODE
+
+audiostats_t AudioStats;
+
+// Written by the audio thread only
+static audiostats_trace_t AudioStats_trace[AUDIOSTATS_TRACE];
+static uint32_t AudioStats_underruns_last;
+
+#define CLAMP16(x) ((x) > 0xFFFF ? 0xFFFF : (uint16_t) (x))
+
+void AudioStats_reset()
+{
+    memset(&AudioStats, 0, sizeof(AudioStats));
+    memset(AudioStats_trace, 0, sizeof(AudioStats_trace));
+    AudioStats.latency_min = 0xFFFF;
+    AudioStats.speed_min   = 0xFFFF;
+    AudioStats.speed       = 1000;
+    AudioStats_underruns_last = 0;
+}
+
+// Record a frame of audio. Called from the thread generating audio.
+void AudioStats_frame(uint32_t latency_ms, uint32_t pcm_us, uint32_t ym_us, uint32_t mix_us)
+{
+    audiostats_trace_t* t = &AudioStats_trace[AudioStats.frames & (AUDIOSTATS_TRACE - 1)];
+    uint32_t underruns    = AudioStats.underruns;
+
+    t->frame      = AudioStats.frames;
+    t->latency_ms = CLAMP16(latency_ms);
+    t->speed      = AudioStats.speed;
+    t->pcm_us     = CLAMP16(pcm_us);
+    t->ym_us      = CLAMP16(ym_us);
+    t->mix_us     = CLAMP16(mix_us);
+    t->underruns  = CLAMP16(underruns - AudioStats_underruns_last);
+    AudioStats_underruns_last = underruns;
+
+    if (t->latency_ms < AudioStats.latency_min) AudioStats.latency_min = t->latency_ms;
+    if (t->latency_ms > AudioStats.latency_max) AudioStats.latency_max = t->latency_ms;
+    if (t->speed < AudioStats.speed_min)        AudioStats.speed_min   = t->speed;
+    if (t->speed > AudioStats.speed_max)        AudioStats.speed_max   = t->speed;
+    if (t->pcm_us > AudioStats.pcm_us_max)      AudioStats.pcm_us_max  = t->pcm_us;
+    if (t->ym_us > AudioStats.ym_us_max)        AudioStats.ym_us_max   = t->ym_us;
+
+    AudioStats.pcm_us_total += pcm_us;
+    AudioStats.ym_us_total  += ym_us;
+    AudioStats.frames++;
+}
+
+// Record the speed factor. Called from the game thread.
+void AudioStats_speed(double speed)
+{
+    AudioStats.speed = CLAMP16((uint32_t) (speed * 1000.0));
+}
+
+// Print the counters and the trace of the most recent frames
+void AudioStats_dump(FILE* f)
+{
+    uint32_t i;
+    const uint32_t frames = AudioStats.frames;
+
+    if (frames == 0)
+        return;
+
+    fprintf(f, "Audio Report:\n");
+    fprintf(f, "Frames %u, underruns %u (%u samples repeated), overflow waits %u, dropped frames %u, command waits %u\n",
+            frames, AudioStats.underruns, AudioStats.underrun_samples, AudioStats.overflow_waits,
+            AudioStats.dropped_frames, AudioStats.cmd_waits);
+    fprintf(f, "Latency %u-%ums, speed %u-%u/1000\n",
+            AudioStats.latency_min, AudioStats.latency_max, AudioStats.speed_min, AudioStats.speed_max);
+    fprintf(f, "SegaPCM avg %uus max %uus, YM2151 avg %uus max %uus\n",
+            AudioStats.pcm_us_total / frames, AudioStats.pcm_us_max,
+            AudioStats.ym_us_total / frames, AudioStats.ym_us_max);
+
+    fprintf(f, "%8s %8s %6s %6s %6s %6s %6s\n", "Frame", "Latency", "Speed", "PCMus", "YMus", "Mixus", "Under");
+
+    for (i = frames > AUDIOSTATS_TRACE ? frames - AUDIOSTATS_TRACE : 0; i < frames; i++)
+    {
+        audiostats_trace_t* t = &AudioStats_trace[i & (AUDIOSTATS_TRACE - 1)];
+        fprintf(f, "%8u %8u %6u %6u %6u %6u %6u\n", t->frame, t->latency_ms, t->speed, t->pcm_us, t->ym_us, t->mix_us, t->underruns);
+    }
+}
+
+// Draw below the FPS counter. Nothing is drawn until the first frame of audio has been output.
+void AudioStats_draw()
+{
+    char line[32];
+    const uint32_t frames = AudioStats.frames;
+    audiostats_trace_t* t = &AudioStats_trace[(frames - 1) & (AUDIOSTATS_TRACE - 1)];
+
+    if (frames == 0)
+        return;
+
+    sprintf(line, "LAT%-3u UR%-5u", t->latency_ms, AudioStats.underruns);
+    OHud_blit_text_new(26, 1, line, HUD_GREY);
+    sprintf(line, "SPD%u.%03u DR%-3u", t->speed / 1000, t->speed % 1000, AudioStats.dropped_frames % 1000);
+    OHud_blit_text_new(26, 2, line, HUD_GREY);
+    sprintf(line, "PCM%-4u YM%-4u", t->pcm_us, t->ym_us);
+    OHud_blit_text_new(26, 3, line, HUD_GREY);
+}
+
+#endif
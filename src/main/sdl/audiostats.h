@@ -0,0 +1,63 @@
+/***************************************************************************
+    Audio Telemetry.
+
+    Counters and a per-frame trace of the audio pipeline: output buffer
+    latency, underruns, overflow waits, the speed factor from the rate
+    controller and the time taken to synthesise each chip.
+
+    Dumped at exit, and drawn with the FPS counter when it is enabled:
+    latency and underruns, speed and dropped frames, then chip times.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <stdio.h>
+#include "globals.h"
+
+#ifdef COMPILE_SOUND_CODE
+
+// Number of audio frames kept in the trace. Must be a power of two.
+#define AUDIOSTATS_TRACE 256
+
+typedef struct
+{
+    uint32_t frame;         // Audio frame number
+    uint16_t latency_ms;    // Output buffer latency after the frame was written
+    uint16_t speed;         // Last speed factor from Audio_adjust_speed (x1000)
+    uint16_t pcm_us;        // SegaPCM synthesis time
+    uint16_t ym_us;         // YM2151 synthesis time
+    uint16_t mix_us;        // Resample and mix time
+    uint16_t underruns;     // Underrun events in this frame
+} audiostats_trace_t;
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t underruns;         // Callback ran out of samples
+    uint32_t underrun_samples;  // Samples filled by repeating the last good sample
+    uint32_t overflow_waits;    // Audio thread waited for space in the output buffer
+    uint32_t dropped_frames;    // Frames dropped because the output buffer was full
+    uint32_t cmd_waits;         // Game thread waited for space in the command queue
+    uint16_t latency_min;
+    uint16_t latency_max;
+    uint16_t speed_min;
+    uint16_t speed_max;
+    uint32_t pcm_us_total;
+    uint32_t ym_us_total;
+    uint16_t pcm_us_max;
+    uint16_t ym_us_max;
+    volatile uint16_t speed;    // Written by the game thread
+} audiostats_t;
+
+extern audiostats_t AudioStats;
+
+void AudioStats_reset();
+void AudioStats_frame(uint32_t latency_ms, uint32_t pcm_us, uint32_t ym_us, uint32_t mix_us);
+void AudioStats_speed(double speed);
+void AudioStats_dump(FILE* f);
+void AudioStats_draw();
+
+#endif
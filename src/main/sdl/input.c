@@ -15,8 +15,8 @@
 #include "frontend/config.h"
  
 
-Boolean Input_keys[15];
-Boolean Input_keys_old[15];
+ENGINE_LOCAL Boolean Input_keys[16];
+ENGINE_LOCAL Boolean Input_keys_old[16];
 
 // Has gamepad been found?
 Boolean Input_gamepad;
@@ -171,6 +171,10 @@ void Input_handle_key(const int key, const Boolean is_pressed)
             Input_keys[INPUT_TIMER] = is_pressed;
             break;
 
+        case SDLK_F4:
+            Input_keys[INPUT_REWIND] = is_pressed;
+            break;
+
         case SDLK_F5:
             Input_keys[INPUT_MENU] = is_pressed;
             break;
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "stdint.h"
+#include "globals.h"
 #include <SDL.h>
 
 typedef enum presses
@@ -30,10 +31,11 @@ typedef enum presses
     INPUT_STEP  = 12,
     INPUT_TIMER = 13,
     INPUT_MENU = 14,     
+    INPUT_REWIND = 15,
 };
 
-extern Boolean Input_keys[15];
-extern Boolean Input_keys_old[15];
+extern ENGINE_LOCAL Boolean Input_keys[16];
+extern ENGINE_LOCAL Boolean Input_keys_old[16];
 
 // Has gamepad been found?
 extern Boolean Input_gamepad;
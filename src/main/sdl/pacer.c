@@ -0,0 +1,181 @@
+/***************************************************************************
+    Frame Pacer.
+
+    Waits for absolute frame deadlines, rather than sleeping for the time
+    left in a frame. Sleeps until shortly before each deadline, then spins
+    for the remainder. As deadlines are absolute, time lost oversleeping
+    one frame is taken from the next, rather than accumulating.
+
+    On Linux the sleep is clock_nanosleep on the monotonic clock. Other
+    platforms use the platform timer's millisecond sleep, and spin for the
+    remaining time.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "sdl/pacer.h"
+#include "sdl/timer.h"
+
+#if defined(__linux__)
+#define PACER_POSIX
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+static int Pacer_mode = PACER_OFF;
+static double Pacer_deadline; // Next deadline in microseconds
+
+// Statistics
+static uint32_t Pacer_histogram[PACER_BUCKETS];
+static uint32_t Pacer_frames;
+static uint32_t Pacer_early, Pacer_late; // Frames outside the histogram
+static uint32_t Pacer_within;            // Frames within 0.5ms of the deadline
+static uint32_t Pacer_missed;            // Frames more than a frame late. The deadline restarts from these.
+static int32_t  Pacer_worst;             // Latest frame in microseconds
+
+uint64_t Pacer_now_us();
+void Pacer_sleep_until(double deadline);
+void Pacer_record(int32_t error_us);
+
+void Pacer_init(int mode)
+{
+    Pacer_mode = mode;
+
+    if (mode != PACER_REALTIME)
+        return;
+
+#ifdef PACER_POSIX
+    // The lowest real time priority is enough to pre-empt normal threads
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    if (sched_setscheduler(0, SCHED_FIFO, &param) != 0)
+        fprintf(stderr, "Pacer: Unable to set real time priority (%s). Running at normal priority.\n", strerror(errno));
+#else
+    fprintf(stderr, "Pacer: Real time priority is not supported on this platform.\n");
+#endif
+}
+
+// Start the deadlines from now. Called before the first frame.
+void Pacer_start()
+{
+    Pacer_deadline = (double) Pacer_now_us();
+}
+
+// Wait for the deadline of the current frame, and set the next one frame_us after it
+void Pacer_wait(double frame_us)
+{
+    uint64_t now;
+
+    Pacer_deadline += frame_us;
+
+    if ((double) Pacer_now_us() + PACER_SPIN_US < Pacer_deadline)
+        Pacer_sleep_until(Pacer_deadline - PACER_SPIN_US);
+
+    while ((double) (now = Pacer_now_us()) < Pacer_deadline)
+        ;
+
+    int32_t error_us = (int32_t) ((double) now - Pacer_deadline);
+    Pacer_record(error_us);
+
+    // Don't run frames back to back to catch up on a stall
+    if (error_us > frame_us)
+    {
+        Pacer_deadline = (double) now;
+        Pacer_missed++;
+    }
+}
+
+uint64_t Pacer_now_us()
+{
+#ifdef PACER_POSIX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+#else
+    // Extend the platform timer, which wraps after 71 minutes
+    static uint32_t last;
+    static uint64_t high;
+    uint32_t now = getMicroseconds();
+    if (now < last)
+        high += (uint64_t) 1 << 32;
+    last = now;
+    return high | now;
+#endif
+}
+
+void Pacer_sleep_until(double deadline)
+{
+#ifdef PACER_POSIX
+    struct timespec ts;
+    uint64_t us = (uint64_t) deadline;
+    ts.tv_sec  = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+#else
+    double remaining = deadline - (double) Pacer_now_us();
+    if (remaining >= 1000)
+        sleep((int) (remaining / 1000));
+#endif
+}
+
+void Pacer_record(int32_t error_us)
+{
+    // Round to the nearest bucket
+    int32_t bucket = (error_us + (error_us < 0 ? -PACER_BUCKET_US / 2 : PACER_BUCKET_US / 2)) / PACER_BUCKET_US;
+    bucket += PACER_BUCKETS / 2;
+
+    if (bucket < 0)
+        Pacer_early++;
+    else if (bucket >= PACER_BUCKETS)
+        Pacer_late++;
+    else
+        Pacer_histogram[bucket]++;
+
+    if (error_us >= -500 && error_us <= 500)
+        Pacer_within++;
+    if (error_us > Pacer_worst)
+        Pacer_worst = error_us;
+    Pacer_frames++;
+}
+
+// Print the histogram of frame error. Called at exit.
+void Pacer_report()
+{
+    int i;
+    uint32_t peak = 1;
+
+    if (Pacer_mode == PACER_OFF || Pacer_frames == 0)
+        return;
+
+    for (i = 0; i < PACER_BUCKETS; i++)
+    {
+        if (Pacer_histogram[i] > peak)
+            peak = Pacer_histogram[i];
+    }
+
+    fprintf(stderr, "Frame Pacer Report:\n");
+    fprintf(stderr, "%u frames, %.2f%% within +/-0.5ms of the deadline. Worst %.2fms late. %u missed.\n",
+            Pacer_frames, Pacer_within * 100.0 / Pacer_frames, Pacer_worst / 1000.0, Pacer_missed);
+
+    if (Pacer_early)
+        fprintf(stderr, "  early : %8u\n", Pacer_early);
+    for (i = 0; i < PACER_BUCKETS; i++)
+    {
+        if (Pacer_histogram[i] == 0)
+            continue;
+
+        char bar[41];
+        int len = (int) ((Pacer_histogram[i] * 40ULL) / peak);
+        memset(bar, '#', len);
+        bar[len] = 0;
+        fprintf(stderr, "%+6.2fms: %8u %s\n", ((i - PACER_BUCKETS / 2) * PACER_BUCKET_US) / 1000.0, Pacer_histogram[i], bar);
+    }
+    if (Pacer_late)
+        fprintf(stderr, "  late  : %8u\n", Pacer_late);
+}
@@ -0,0 +1,36 @@
+/***************************************************************************
+    Frame Pacer.
+
+    Waits for absolute frame deadlines, rather than sleeping for the time
+    left in a frame. Sleeps until shortly before each deadline, then spins
+    for the remainder.
+
+    Records how far each frame lands from its deadline in a histogram,
+    which is reported at exit.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.h"
+
+enum
+{
+    PACER_OFF,      // Sleep for the remaining milliseconds of each frame (original)
+    PACER_ON,       // Wait for absolute deadlines
+    PACER_REALTIME, // As PACER_ON, with the main thread at real time priority where supported
+};
+
+// Time before a deadline spent spinning rather than sleeping
+#define PACER_SPIN_US 300
+
+// Histogram of frame error. Buckets are PACER_BUCKET_US wide, centred on the deadline.
+#define PACER_BUCKET_US 100
+#define PACER_BUCKETS   41
+
+void Pacer_init(int mode);
+void Pacer_start();
+void Pacer_wait(double frame_us);
+void Pacer_report();
@@ -17,6 +17,10 @@ typedef struct
 } Timer;
 
 
+// Platform timer
+uint32_t getMicroseconds();
+void sleep(int ms);
+
 //The various clock actions
 void Timer_init(Timer* timer);
 void Timer_start(Timer* timer);
@@ -0,0 +1,281 @@
+/***************************************************************************
+    Streaming WAV Reader.
+
+    Plays custom music straight from disk. The file is read in small chunks,
+    converted to 16-bit stereo at the output rate and queued in a short
+    ring buffer, so only a fraction of a second of audio is held in memory.
+
+    The game thread opens the file and keeps the ring topped up. The audio
+    thread reads from the ring without locking. Opening a new file only
+    parses the header, so playback can start on the next frame.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <string.h>
+#include "arena.h"
+#include "sdl/wavstream.h"
+
+Boolean WavStream_read_header(wavstream_t* ws);
+Boolean WavStream_next_frame(wavstream_t* ws, int16_t* frame);
+uint32_t WavStream_read32(const uint8_t* p);
+uint16_t WavStream_read16(const uint8_t* p);
+
+void WavStream_init(wavstream_t* ws, uint32_t out_rate)
+{
+    memset(ws, 0, sizeof(wavstream_t));
+    ws->out_rate = out_rate;
+    ws->ring     = (int16_t*) Arena_alloc(ARENA_AUDIO, WAVSTREAM_RING_FRAMES * 2 * sizeof(int16_t));
+    ws->raw      = (uint8_t*) Arena_alloc(ARENA_AUDIO, WAVSTREAM_RAW_SIZE);
+    Spsc_init(&ws->spsc, WAVSTREAM_RING_FRAMES * 2);
+}
+
+void WavStream_destroy(wavstream_t* ws)
+{
+    WavStream_close(ws);
+
+    // Free in reverse order of allocation
+    Arena_free(ws->raw);
+    Arena_free(ws->ring);
+    ws->raw  = NULL;
+    ws->ring = NULL;
+}
+
+Boolean WavStream_open(wavstream_t* ws, const char* filename)
+{
+    WavStream_close(ws);
+
+    if (ws->ring == NULL)
+        return FALSE;
+
+    ws->file = fopen(filename, "rb");
+    if (ws->file == NULL)
+        return FALSE;
+
+    if (!WavStream_read_header(ws))
+    {
+        fprintf(stderr, "Error: Unsupported wav format: %s.\n", filename);
+        WavStream_close(ws);
+        return FALSE;
+    }
+
+    ws->data_pos = 0;
+    ws->raw_len  = 0;
+    ws->raw_pos  = 0;
+    ws->frac     = 0;
+
+    // Prime the interpolator with the first two frames
+    if (!WavStream_next_frame(ws, ws->prev) || !WavStream_next_frame(ws, ws->cur))
+    {
+        WavStream_close(ws);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// Stop playback. The reader empties the ring before the next file is streamed into it.
+void WavStream_close(wavstream_t* ws)
+{
+    if (ws->file)
+    {
+        fclose(ws->file);
+        ws->file = NULL;
+    }
+
+    ws->flush_req++;
+}
+
+// Walk the RIFF chunks to find the format and the sample data
+Boolean WavStream_read_header(wavstream_t* ws)
+{
+    uint8_t header[16];
+    uint32_t rate = 0;
+    Boolean have_fmt = FALSE;
+
+    if (fread(header, 1, 12, ws->file) != 12 || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0)
+        return FALSE;
+
+    while (fread(header, 1, 8, ws->file) == 8)
+    {
+        uint32_t size = WavStream_read32(header + 4);
+
+        if (memcmp(header, "fmt ", 4) == 0 && size >= 16)
+        {
+            if (fread(header, 1, 16, ws->file) != 16)
+                return FALSE;
+
+            // PCM only
+            if (WavStream_read16(header) != 1)
+                return FALSE;
+
+            ws->channels    = WavStream_read16(header + 2);
+            rate            = WavStream_read32(header + 4);
+            ws->block_align = WavStream_read16(header + 12);
+            ws->bits        = WavStream_read16(header + 14);
+            have_fmt        = TRUE;
+
+            fseek(ws->file, (size - 16) + (size & 1), SEEK_CUR);
+        }
+        else if (memcmp(header, "data", 4) == 0)
+        {
+            ws->data_start  = (uint32_t) ftell(ws->file);
+            ws->data_length = size;
+            break;
+        }
+        else
+        {
+            // Chunks are padded to an even length
+            fseek(ws->file, size + (size & 1), SEEK_CUR);
+        }
+    }
+
+    if (!have_fmt || ws->data_length == 0 || rate == 0)
+        return FALSE;
+
+    if ((ws->channels != 1 && ws->channels != 2) || (ws->bits != 8 && ws->bits != 16))
+        return FALSE;
+
+    if (ws->block_align != ws->channels * (ws->bits / 8) || ws->data_length < ws->block_align)
+        return FALSE;
+
+    ws->step = (uint32_t) (((uint64_t) rate << 16) / ws->out_rate);
+    return TRUE;
+}
+
+// Decode the next frame from the file, looping at the end. Volume is halved.
+Boolean WavStream_next_frame(wavstream_t* ws, int16_t* frame)
+{
+    if (ws->raw_pos + ws->block_align > ws->raw_len)
+    {
+        uint32_t remaining = ws->data_length - ws->data_pos;
+
+        // Loop
+        if (remaining < ws->block_align)
+        {
+            fseek(ws->file, ws->data_start, SEEK_SET);
+            ws->data_pos = 0;
+            remaining    = ws->data_length;
+        }
+
+        uint32_t want = remaining < WAVSTREAM_RAW_SIZE ? remaining : WAVSTREAM_RAW_SIZE;
+        want -= want % ws->block_align;
+
+        ws->raw_len   = (uint32_t) fread(ws->raw, 1, want, ws->file);
+        ws->raw_pos   = 0;
+        ws->data_pos += ws->raw_len;
+
+        if (ws->raw_len < ws->block_align)
+            return FALSE;
+    }
+
+    const uint8_t* p = ws->raw + ws->raw_pos;
+    int32_t l, r;
+
+    if (ws->bits == 8)
+    {
+        l = (p[0] - 0x80) * 256;
+        r = ws->channels == 2 ? (p[1] - 0x80) * 256 : l;
+    }
+    else
+    {
+        l = (int16_t) WavStream_read16(p);
+        r = ws->channels == 2 ? (int16_t) WavStream_read16(p + 2) : l;
+    }
+
+    ws->raw_pos += ws->block_align;
+
+    frame[0] = (int16_t) (l >> 1);
+    frame[1] = (int16_t) (r >> 1);
+    return TRUE;
+}
+
+// Top up the ring. Called every frame from the game thread.
+void WavStream_fill(wavstream_t* ws)
+{
+    uint32_t frames, i;
+
+    // Wait for the reader to empty the ring of the previous file
+    if (ws->file == NULL || ws->flush_ack != ws->flush_req)
+        return;
+
+    frames = Spsc_free(&ws->spsc) / 2;
+    uint32_t pos = Spsc_write_index(&ws->spsc);
+
+    for (i = 0; i < frames; i++)
+    {
+        // Linear interpolation to the output rate.
+        // Samples are already halved, so the difference times the fraction fits in 32 bits.
+        while (ws->frac >= 0x10000)
+        {
+            ws->prev[0] = ws->cur[0];
+            ws->prev[1] = ws->cur[1];
+            ws->frac   -= 0x10000;
+
+            if (!WavStream_next_frame(ws, ws->cur))
+            {
+                fprintf(stderr, "Error: Could not read wav.\n");
+                Spsc_push(&ws->spsc, i * 2);
+                WavStream_close(ws);
+                return;
+            }
+        }
+
+        int16_t* out = ws->ring + ((pos + (i * 2)) & ws->spsc.mask);
+        out[0] = ws->prev[0] + (int16_t) (((ws->cur[0] - ws->prev[0]) * (int32_t) ws->frac) >> 16);
+        out[1] = ws->prev[1] + (int16_t) (((ws->cur[1] - ws->prev[1]) * (int32_t) ws->frac) >> 16);
+
+        ws->frac += ws->step;
+    }
+
+    Spsc_push(&ws->spsc, frames * 2);
+}
+
+// Copy interleaved stereo samples from the ring. Pads with silence when nothing is queued.
+void WavStream_read(wavstream_t* ws, int16_t* out, uint32_t samples)
+{
+    uint32_t i, available;
+    uint32_t req = ws->flush_req;
+
+    SPSC_BARRIER();
+
+    if (ws->flush_ack != req)
+    {
+        Spsc_pop(&ws->spsc, Spsc_used(&ws->spsc));
+        ws->flush_ack = req;
+    }
+
+    available = Spsc_used(&ws->spsc);
+    if (available > samples)
+        available = samples;
+
+    uint32_t pos        = Spsc_read_index(&ws->spsc);
+    uint32_t first_part = ws->spsc.size - pos;
+
+    // Copy in at most two blocks, either side of the wrap
+    if (available <= first_part)
+    {
+        memcpy(out, ws->ring + pos, available * sizeof(int16_t));
+    }
+    else
+    {
+        memcpy(out, ws->ring + pos, first_part * sizeof(int16_t));
+        memcpy(out + first_part, ws->ring, (available - first_part) * sizeof(int16_t));
+    }
+
+    for (i = available; i < samples; i++)
+        out[i] = 0;
+
+    Spsc_pop(&ws->spsc, available);
+}
+
+uint32_t WavStream_read32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+uint16_t WavStream_read16(const uint8_t* p)
+{
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
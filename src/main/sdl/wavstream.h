@@ -0,0 +1,68 @@
+/***************************************************************************
+    Streaming WAV Reader.
+
+    Plays custom music straight from disk. The file is read in small chunks,
+    converted to 16-bit stereo at the output rate and queued in a short
+    ring buffer, so only a fraction of a second of audio is held in memory.
+
+    The game thread opens the file and keeps the ring topped up. The audio
+    thread reads from the ring without locking. Opening a new file only
+    parses the header, so playback can start on the next frame.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <stdio.h>
+#include "stdint.h"
+#include "spsc.h"
+
+// Size of the decoded ring buffer in stereo frames. Must be a power of two.
+#define WAVSTREAM_RING_FRAMES 8192
+
+// Size of the raw read buffer in bytes
+#define WAVSTREAM_RAW_SIZE    4096
+
+typedef struct
+{
+    FILE* file;
+    uint32_t data_start;    // File offset of the sample data
+    uint32_t data_length;   // Length of the sample data in bytes
+    uint32_t data_pos;      // Bytes read from the sample data
+    uint16_t channels;
+    uint16_t bits;
+    uint16_t block_align;   // Bytes per frame in the file
+    uint32_t out_rate;
+
+    // Rate conversion (16.16 fixed point)
+    uint32_t step;
+    uint32_t frac;
+    int16_t  prev[2];
+    int16_t  cur[2];
+
+    // Raw read buffer
+    uint8_t* raw;
+    uint32_t raw_len;
+    uint32_t raw_pos;
+
+    // Decoded stereo samples
+    int16_t* ring;
+    spsc_t   spsc;
+
+    // The ring is emptied by the reader when a new file is opened
+    volatile uint32_t flush_req;
+    volatile uint32_t flush_ack;
+} wavstream_t;
+
+void WavStream_init(wavstream_t* ws, uint32_t out_rate);
+void WavStream_destroy(wavstream_t* ws);
+
+// Game thread
+Boolean WavStream_open(wavstream_t* ws, const char* filename);
+void WavStream_close(wavstream_t* ws);
+void WavStream_fill(wavstream_t* ws);
+
+// Audio thread
+void WavStream_read(wavstream_t* ws, int16_t* out, uint32_t samples);
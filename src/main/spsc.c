@@ -0,0 +1,67 @@
+/***************************************************************************
+    Single Producer, Single Consumer Ring Buffer Indices.
+
+    Lock-free indices for a power of two sized ring buffer, shared between
+    exactly one writing thread and one reading thread. The caller owns the
+    element storage and uses Spsc_write_index / Spsc_read_index to address it.
+
+    The head and tail are free running counters, so the fill level is exact:
+    head - tail, with no wasted slot.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include "spsc.h"
+
+void Spsc_init(spsc_t* spsc, uint32_t size)
+{
+    spsc->size = size;
+    spsc->mask = size - 1;
+    Spsc_reset(spsc);
+}
+
+// Only safe while neither thread is using the buffer
+void Spsc_reset(spsc_t* spsc)
+{
+    spsc->head = 0;
+    spsc->tail = 0;
+}
+
+// Number of elements available to the consumer
+uint32_t Spsc_used(spsc_t* spsc)
+{
+    uint32_t used = spsc->head - spsc->tail;
+    SPSC_BARRIER(); // Element reads must not be moved before the index read
+    return used;
+}
+
+// Number of elements available to the producer
+uint32_t Spsc_free(spsc_t* spsc)
+{
+    return spsc->size - Spsc_used(spsc);
+}
+
+uint32_t Spsc_write_index(spsc_t* spsc)
+{
+    return spsc->head & spsc->mask;
+}
+
+// Publish count elements written at the write index
+void Spsc_push(spsc_t* spsc, uint32_t count)
+{
+    SPSC_BARRIER(); // Element writes must complete before the index is published
+    spsc->head += count;
+}
+
+uint32_t Spsc_read_index(spsc_t* spsc)
+{
+    return spsc->tail & spsc->mask;
+}
+
+// Release count elements read from the read index
+void Spsc_pop(spsc_t* spsc, uint32_t count)
+{
+    SPSC_BARRIER(); // Element reads must complete before the space is released
+    spsc->tail += count;
+}
@@ -0,0 +1,51 @@
+/***************************************************************************
+    Single Producer, Single Consumer Ring Buffer Indices.
+
+    Lock-free indices for a power of two sized ring buffer, shared between
+    exactly one writing thread and one reading thread. The caller owns the
+    element storage and uses Spsc_write_index / Spsc_read_index to address it.
+
+    The head and tail are free running counters, so the fill level is exact:
+    head - tail, with no wasted slot.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.h"
+
+// Memory barrier between publishing data and publishing an index.
+#if defined(__GNUC__) && !defined(__mc68000__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define SPSC_BARRIER() __sync_synchronize()
+#elif defined(__GNUC__)
+// Single CPU targets (e.g. 68k Amiga) only need to stop the compiler reordering
+#define SPSC_BARRIER() __asm__ __volatile__("" ::: "memory")
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define SPSC_BARRIER() _ReadWriteBarrier()
+#else
+#define SPSC_BARRIER()
+#endif
+
+typedef struct
+{
+    volatile uint32_t head; // Written by the producer only
+    volatile uint32_t tail; // Written by the consumer only
+    uint32_t size;          // Number of elements. Must be a power of two.
+    uint32_t mask;
+} spsc_t;
+
+void Spsc_init(spsc_t* spsc, uint32_t size);
+void Spsc_reset(spsc_t* spsc);
+uint32_t Spsc_used(spsc_t* spsc);
+uint32_t Spsc_free(spsc_t* spsc);
+
+// Producer
+uint32_t Spsc_write_index(spsc_t* spsc);
+void Spsc_push(spsc_t* spsc, uint32_t count);
+
+// Consumer
+uint32_t Spsc_read_index(spsc_t* spsc);
+void Spsc_pop(spsc_t* spsc, uint32_t count);
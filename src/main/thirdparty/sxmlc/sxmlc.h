@@ -93,11 +93,13 @@ extern "C" {
 	void __free(void* mem);
 	char* __strdup(const char* s);
 #else
-	#define __malloc malloc
-	#define __calloc calloc
-	#define __realloc realloc
-	#define __free free
-	#define __strdup strdup
+	/* Cannonball: XML documents are allocated from the config memory arena */
+	#include "arena.h"
+	#define __malloc(sz) Arena_alloc(ARENA_CONFIG, (sz))
+	#define __calloc(count, sz) Arena_calloc(ARENA_CONFIG, (count), (sz))
+	#define __realloc(mem, sz) Arena_realloc(ARENA_CONFIG, (mem), (sz))
+	#define __free Arena_free
+	#define __strdup(s) Arena_strdup(ARENA_CONFIG, (s))
 #endif
 
 #ifndef MEM_INCR_RLA
@@ -80,7 +80,7 @@ Level TrackLoader_levels[STAGES]; // Normal Stages
 Level TrackLoader_levels_end[5];  // End Section
 Level TrackLoader_level_split;    // Split Section
 
-uint8_t* current_path; // CPU 1 Road Path
+ENGINE_LOCAL uint8_t* current_path; // CPU 1 Road Path
     
 void TrackLoader_setup_level(Level* l, RomLoader* data, const int STAGE_ADR);
 void TrackLoader_setup_section(Level* l, RomLoader* data, const int STAGE_ADR);
@@ -362,6 +362,25 @@ void TrackLoader_init_path_end()
     current_path = TrackLoader_levels_end[0].path; // Path is shared for end sections
 }
 
+uint8_t* TrackLoader_get_path()
+{
+    return current_path;
+}
+
+// Bytes of data that can be read from the start of the current path
+uint32_t TrackLoader_path_length()
+{
+    const RomLoader* data = Roms_rom1p;
+
+    if (TrackLoader_layout.rom && current_path >= TrackLoader_layout.rom && current_path < TrackLoader_layout.rom + TrackLoader_layout.length)
+        data = &TrackLoader_layout;
+
+    if (current_path == NULL || current_path < data->rom || current_path >= data->rom + data->length)
+        return 0;
+
+    return (uint32_t) (data->rom + data->length - current_path);
+}
+
 // ------------------------------------------------------------------------------------------------
 //                                        HELPER FUNCTIONS TO READ DATA
 // ------------------------------------------------------------------------------------------------
@@ -97,6 +97,8 @@ void TrackLoader_init_track_bonus(const uint32_t);
 void TrackLoader_init_path(const uint32_t);
 void TrackLoader_init_path_split();
 void TrackLoader_init_path_end();
+uint8_t* TrackLoader_get_path();
+uint32_t TrackLoader_path_length();
 
 uint32_t TrackLoader_read_pal_sky_table(uint16_t entry);
 uint32_t TrackLoader_read_pal_gnd_table(uint16_t entry);    
@@ -0,0 +1,142 @@
+/***************************************************************************
+    Turbo Headless Simulation.
+
+    Runs the game engine as fast as possible, without frame pacing, for
+    AI tuning, time trial validation and soak testing. Rendering is
+    skipped, or sampled every Nth frame, and audio synthesis is optional.
+
+    The time spent in each stage of the frame is reported, along with the
+    overall ticks per second.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "main.h"
+#include "roms.h"
+#include "turbo.h"
+#include "video.h"
+#include "sdl/input.h"
+#include "sdl/timer.h"
+#include "frontend/config.h"
+#include "engine/oinputs.h"
+#include "engine/oroadcache.h"
+#include "engine/osprites.h"
+#include "engine/otiles.h"
+#include "engine/outrun.h"
+#include "engine/audio/OSoundInt.h"
+#include "hwaudio/segapcm.h"
+#include "hwaudio/ym2151.h"
+
+enum
+{
+    TURBO_INPUT,
+    TURBO_SOUND,
+    TURBO_RENDER,
+    TURBO_STAGES
+};
+
+static uint64_t Turbo_stage_us[TURBO_STAGES];
+
+void Turbo_report(const char* name, uint64_t us, uint32_t frames, uint64_t total_us);
+
+// Run frames of the game, starting from boot, and report the cost of each stage.
+// draw_every: render every Nth frame. 0 never renders.
+// audio:      run the sound program and synthesise the sound chips. There is no audio output.
+Boolean Turbo_run(uint32_t frames, uint32_t draw_every, Boolean audio)
+{
+    uint32_t frame, start;
+    uint64_t total_us = 0;
+    uint32_t drawn = 0;
+
+    if (Config_engine.jap && !Roms_load_japanese_roms())
+        return FALSE;
+
+    memset(Turbo_stage_us, 0, sizeof(Turbo_stage_us));
+    memset(Outrun_stage_us, 0, sizeof(Outrun_stage_us));
+    OSprites_sort_us        = 0;
+    OSprites_peak_count     = 0;
+    OSprites_dropped_frames = 0;
+    Outrun_profile = TRUE;
+
+    Outrun_init();
+    cannonball_state = STATE_GAME;
+
+    for (frame = 0; frame < frames; frame++)
+    {
+        uint32_t frame_start = getMicroseconds();
+
+        // Determine whether to tick the current frame, as the main loop does
+        cannonball_frame++;
+        if (Config_fps == 30)
+            cannonball_tick_frame = 1;
+        else if (Config_fps == 60)
+            cannonball_tick_frame = cannonball_frame & 1;
+        else if (Config_fps == 120)
+            cannonball_tick_frame = (cannonball_frame & 3) == 1;
+
+        start = getMicroseconds();
+        if (cannonball_tick_frame)
+            OInputs_tick(NULL);
+        OInputs_do_gear();
+        Turbo_stage_us[TURBO_INPUT] += getMicroseconds() - start;
+
+        Outrun_tick(NULL, cannonball_tick_frame);
+        Input_frame_done();
+
+        if (audio)
+        {
+            start = getMicroseconds();
+            OSoundInt_tick();
+            SegaPCM_stream_update();
+            YM_stream_update();
+            Turbo_stage_us[TURBO_SOUND] += getMicroseconds() - start;
+        }
+
+        if (draw_every && (frame % draw_every) == 0)
+        {
+            start = getMicroseconds();
+            Video_draw_frame();
+            Turbo_stage_us[TURBO_RENDER] += getMicroseconds() - start;
+            drawn++;
+        }
+
+        total_us += getMicroseconds() - frame_start;
+    }
+
+    Outrun_profile = FALSE;
+
+    double secs = (double) total_us / 1000000.0;
+
+    fprintf(stderr, "Turbo: %u frames at %d fps, %u rendered, audio %s\n", frames, Config_fps, drawn, audio ? "on" : "off");
+    if (secs > 0)
+        fprintf(stderr, "%.3fs, %.0f ticks/sec, %.1fx realtime\n", secs, frames / secs, (frames / secs) / Config_fps);
+
+    Turbo_report("Input",  Turbo_stage_us[TURBO_INPUT],         frames, total_us);
+    Turbo_report("Logic",  Outrun_stage_us[OUTRUN_STAGE_LOGIC], frames, total_us);
+    Turbo_report(" Sort",  OSprites_sort_us,                    frames, total_us); // Part of logic
+    Turbo_report("Road",   Outrun_stage_us[OUTRUN_STAGE_ROAD],  frames, total_us);
+    Turbo_report("V-Int",  Outrun_stage_us[OUTRUN_STAGE_VINT],  frames, total_us);
+    Turbo_report("Sound",  Turbo_stage_us[TURBO_SOUND],         frames, total_us);
+    Turbo_report("Render", Turbo_stage_us[TURBO_RENDER],        frames, total_us);
+    if (drawn)
+        fprintf(stderr, "%-8s %10.1fus per rendered frame\n", "", (double) Turbo_stage_us[TURBO_RENDER] / drawn);
+
+    fprintf(stderr, "Sprites: peak %u in a frame, %u frames dropped over the hardware limit%s\n",
+            OSprites_peak_count, OSprites_dropped_frames, Config_engine.unlimited_sprites ? " (unlimited)" : "");
+
+    ORoadCache_report();
+    OTiles_report();
+
+    return TRUE;
+}
+
+void Turbo_report(const char* name, uint64_t us, uint32_t frames, uint64_t total_us)
+{
+    fprintf(stderr, "%-8s %10.3fs %10.1fus/tick %6.1f%%\n", name,
+            (double) us / 1000000.0,
+            frames   ? (double) us / frames : 0.0,
+            total_us ? (double) us * 100.0 / total_us : 0.0);
+}
@@ -0,0 +1,19 @@
+/***************************************************************************
+    Turbo Headless Simulation.
+
+    Runs the game engine as fast as possible, without frame pacing, for
+    AI tuning, time trial validation and soak testing. Rendering is
+    skipped, or sampled every Nth frame, and audio synthesis is optional.
+
+    The time spent in each stage of the frame is reported, along with the
+    overall ticks per second.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.h"
+
+Boolean Turbo_run(uint32_t frames, uint32_t draw_every, Boolean audio);
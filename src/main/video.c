@@ -9,9 +9,16 @@
     See license.txt for more details.
 ***************************************************************************/
 
+#include <string.h>
 #include "Video.h"
 #include "setup.h"
 #include "globals.h"
+#include "arena.h"
+#include "savestate.h"
+
+#ifdef ENGINE_THREADS
+#include <SDL.h>
+#endif
 
 #ifdef WITH_OPENGL
 #include "sdl/rendergl.h"
@@ -21,24 +28,50 @@
 
     
 uint16_t *Video_pixels = NULL;
-Boolean Video_enabled;
+static uint32_t Video_pixels_size; // Bytes allocated for Video_pixels
+ENGINE_LOCAL Boolean Video_enabled;
+
+// Set on threads that run the engine without a display. Palette writes are not
+// converted, as the converted palette is shared with the renderer.
+ENGINE_LOCAL Boolean Video_headless;
+
+// Set by the main loop when running the engine at a fixed step
+uint16_t Video_interp_alpha = VIDEO_INTERP_ONE;
+
+#ifdef ENGINE_THREADS
+// Guards the sprite and road RAM bank swap against the renderer taking the front banks
+SDL_mutex* Video_bank_mutex = NULL;
+#endif
 
 
 
     
-uint8_t palette[S16_PALETTE_ENTRIES * 2]; // 2 Bytes Per Palette Entry
+ENGINE_LOCAL uint8_t palette[S16_PALETTE_ENTRIES * 2]; // 2 Bytes Per Palette Entry
 void Video_refresh_palette(uint32_t);
 
 
 void Video_Create(void)
 {
     HWTiles_Create();
+#ifdef ENGINE_THREADS
+    if (Video_bank_mutex == NULL)
+        Video_bank_mutex = SDL_CreateMutex();
+#endif
 }
 
 void Video_Destroy(void)
 {
     HWTiles_Destroy();
-    if (Video_pixels) free(Video_pixels);
+#ifdef ENGINE_THREADS
+    if (Video_bank_mutex)
+    {
+        SDL_DestroyMutex(Video_bank_mutex);
+        Video_bank_mutex = NULL;
+    }
+#endif
+    Arena_free(Video_pixels);
+    Video_pixels = NULL;
+    Video_pixels_size = 0;
     Render_disable();
 }
 
@@ -47,9 +80,15 @@ int Video_init(video_settings_t* settings)
     if (!Video_set_video_mode(settings))
         return 0;
 
-    // Internal pixel array. The size of this is always constant
-    if (Video_pixels) free(Video_pixels);
-    Video_pixels = (uint16_t*)malloc(Config_s16_width * Config_s16_height * sizeof(uint16_t));
+    // Internal pixel array. Only reallocated when the video mode needs a larger one,
+    // as the arena does not reclaim blocks below the top of a region.
+    uint32_t size = Config_s16_width * Config_s16_height * sizeof(uint16_t);
+    if (size > Video_pixels_size)
+    {
+        Arena_free(Video_pixels);
+        Video_pixels = (uint16_t*)Arena_alloc(ARENA_VIDEO, size);
+        Video_pixels_size = Video_pixels ? size : 0;
+    }
 
     // Convert S16 tiles to a more useable format
     HWTiles_init(Roms_tiles.rom, Config_video.hires != 0);
@@ -57,31 +96,34 @@ int Video_init(video_settings_t* settings)
     Video_clear_tile_ram();
     Video_clear_text_ram();
     if (Roms_tiles.rom)
-    {
-        free(Roms_tiles.rom);
-        Roms_tiles.rom = NULL;
-    }
+        RomLoader_unload(&Roms_tiles);
 
     // Convert S16 sprites
     HWSprites_init(Roms_sprites.rom);
     if (Roms_sprites.rom)
-    {
-        free(Roms_sprites.rom);
-        Roms_sprites.rom = NULL;
-    }
+        RomLoader_unload(&Roms_sprites);
 
     // Convert S16 Road Stuff
     HWRoad_init(Roms_road.rom, Config_video.hires != 0);
     if (Roms_road.rom)
-    {
-        free(Roms_road.rom);
-        Roms_road.rom = NULL;
-    }
+        RomLoader_unload(&Roms_road);
 
     Video_enabled = TRUE;
     return 1;
 }
 
+// Reset the video hardware owned by the calling thread, without converting any graphics.
+// Used when the engine runs on a thread other than the one that called Video_init.
+void Video_init_state()
+{
+    HWTiles_Create();
+    HWSprites_init_state();
+    HWRoad_init_state();
+    Video_clear_tile_ram();
+    Video_clear_text_ram();
+    memset(palette, 0, sizeof(palette));
+}
+
 void Video_disable()
 {
     Render_disable();
@@ -140,7 +182,21 @@ void Video_draw_frame()
     else
     {
         // OutRun Hardware Video Emulation
+        Boolean interp = Video_interp_alpha < VIDEO_INTERP_ONE;
+
+        // Copy the front banks, then render from the copies without holding the lock
+        Video_lock_banks();
+        HWSprites_snapshot();
+        HWRoad_snapshot();
+        Video_unlock_banks();
+
         HWTiles_update_tile_values();
+        if (interp)
+        {
+            HWTiles_interp_apply(Video_interp_alpha);
+            HWRoad_interp_begin(Video_interp_alpha);
+            HWSprites_interp_begin(Video_interp_alpha);
+        }
         HWRoad_render_background(Video_pixels);
  
         if (Config_video.detailLevel == 2)        
@@ -159,6 +215,37 @@ void Video_draw_frame()
     Render_finalize_frame();
 }
 
+// Record the positions on screen before an engine step, to interpolate from
+void Video_interp_capture()
+{
+    Video_lock_banks();
+    HWTiles_interp_capture();
+    HWRoad_interp_capture();
+    HWSprites_interp_capture();
+    Video_unlock_banks();
+}
+
+// Sprite and road RAM are double buffered. The engine writes the back buffers,
+// and each swap publishes the front buffers. The renderer copies the front
+// buffers into banks of its own before drawing a frame. Swaps and the copies
+// are the only points where the two meet, so they are serialised.
+// Without ENGINE_THREADS the engine and renderer share a thread, and there is no lock.
+void Video_lock_banks()
+{
+#ifdef ENGINE_THREADS
+    if (Video_bank_mutex)
+        SDL_mutexP(Video_bank_mutex);
+#endif
+}
+
+void Video_unlock_banks()
+{
+#ifdef ENGINE_THREADS
+    if (Video_bank_mutex)
+        SDL_mutexV(Video_bank_mutex);
+#endif
+}
+
 // ---------------------------------------------------------------------------
 // Text Handling Code
 // ---------------------------------------------------------------------------
@@ -272,7 +359,7 @@ uint8_t Video_read_tile8(uint32_t addr)
 
 void Video_write_sprite16(uint32_t* addr, const uint16_t data)
 {
-    HWSprites_write(*addr & 0xfff, data);
+    HWSprites_write(*addr & ((HWSPRITES_ENTRIES_MAX * 16) - 1), data);
     *addr += 2;
 }
 
@@ -357,6 +444,20 @@ void Video_refresh_palette(uint32_t palAddr)
     uint32_t g = (a & 0x00f0) >> 3; // g ggg0
     uint32_t b = (a & 0x0f00) >> 7; // b bbb0
      
+    if (!Video_headless)
+        Render_convert_palette(palAddr, r, g, b);
+}
 
-    Render_convert_palette(palAddr, r, g, b);
+// Rebuild the converted palette after palette RAM has been restored
+void Video_restore_palette()
+{
+    uint32_t adr;
+
+    for (adr = 0; adr < S16_PALETTE_ENTRIES * 2; adr += 2)
+        Video_refresh_palette(adr);
+}
+
+void Video_register_state()
+{
+    SAVESTATE_ADD(SAVESTATE_VIDEO, palette);
 }
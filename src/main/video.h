@@ -22,15 +22,27 @@
 
 extern uint16_t *Video_pixels;
 
-extern Boolean Video_enabled;
+// Fixed point distance between the last two engine steps, used when interpolating frames
+#define VIDEO_INTERP_SHIFT 8
+#define VIDEO_INTERP_ONE   (1 << VIDEO_INTERP_SHIFT)
+
+// Distance of the next frame drawn. VIDEO_INTERP_ONE draws the last engine step as it is.
+extern uint16_t Video_interp_alpha;
+
+extern ENGINE_LOCAL Boolean Video_enabled;
+extern ENGINE_LOCAL Boolean Video_headless;
 
 void Video_Create();
 void Video_Destroy();
     
 int Video_init(video_settings_t* settings);
+void Video_init_state();
 void Video_disable();
 int Video_set_video_mode(video_settings_t* settings);
 void Video_draw_frame();
+void Video_interp_capture();
+void Video_lock_banks();
+void Video_unlock_banks();
 
 void Video_clear_text_ram();
 void Video_write_text8(uint32_t, const uint8_t);
@@ -58,3 +70,5 @@ uint8_t Video_read_pal8(uint32_t);
 uint16_t Video_read_pal16IncP(uint32_t*);
 uint16_t Video_read_pal16(uint32_t);
 uint32_t Video_read_pal32(uint32_t*);
+void Video_restore_palette();
+void Video_register_state();